@@ -0,0 +1,561 @@
+//Std imports
+#include <string>
+#include <cstring>
+
+//Crypto++ imports
+#include <cryptopp/aes.h>
+using CryptoPP::AES;
+
+#include <cryptopp/gcm.h>
+using CryptoPP::GCM;
+
+#include <cryptopp/ccm.h>
+using CryptoPP::CCM;
+
+#include <cryptopp/cryptlib.h>
+using CryptoPP::AuthenticatedSymmetricCipher;
+
+#include <cryptopp/simple.h>
+using CryptoPP::InvalidKeyLength;
+
+#include <cryptopp/algparam.h>
+using CryptoPP::MakeParameters;
+using CryptoPP::ConstByteArrayParameter;
+#include <cryptopp/argnames.h>
+
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+#include <cryptopp/cpu.h>
+
+//Node and class headers import
+#include <node.h>
+#include <node_buffer.h>
+#include "aead.h"
+#include "chacha20poly1305.h"
+#include "buffers.h"
+
+using namespace v8;
+using namespace std;
+
+//One-shot operations on inputs at least this long are run on the libuv thread pool when a callback is given
+static const size_t AEAD_ASYNC_THRESHOLD = 64 * 1024;
+
+bool AEAD_GetAlgorithm(string const& name, AEADAlgorithm& algorithm){
+	if (name == "aes-gcm") algorithm = AEAD_AES_GCM;
+	else if (name == "aes-ccm") algorithm = AEAD_AES_CCM;
+	else if (name == "chacha20-poly1305") algorithm = AEAD_CHACHA20_POLY1305;
+	else return false;
+	return true;
+}
+
+bool AEAD_IsValidIVLength(AEADAlgorithm algorithm, size_t ivLength){
+	if (algorithm == AEAD_AES_CCM) return ivLength >= 7 && ivLength <= 13;
+	if (algorithm == AEAD_CHACHA20_POLY1305) return ivLength == CHACHA20POLY1305_NONCE_LENGTH;
+	//Any non-empty IV for GCM, 12 bytes being the recommended (and fastest) length
+	return ivLength > 0;
+}
+
+bool AEAD_IsValidTagLength(AEADAlgorithm algorithm, size_t tagLength){
+	if (algorithm == AEAD_AES_CCM) return tagLength >= 4 && tagLength <= 16 && tagLength % 2 == 0;
+	if (algorithm == AEAD_CHACHA20_POLY1305) return tagLength == CHACHA20POLY1305_TAG_LENGTH;
+	return tagLength >= 12 && tagLength <= 16;
+}
+
+/*
+* AES modes, keyed (with the IV) by Crypto++
+*/
+class CryptoPPAEADCipher : public AEADCipher {
+
+public:
+	CryptoPPAEADCipher(AuthenticatedSymmetricCipher* cipher) : cipher_(cipher){
+	}
+	//Crypto++ wipes the key schedule
+	~CryptoPPAEADCipher(){
+		delete cipher_;
+	}
+	void Begin(string const& aad, size_t messageLength){
+		if (cipher_->NeedsPrespecifiedDataLengths()) cipher_->SpecifyDataLengths(aad.size(), messageLength, 0);
+		cipher_->Update((const byte*) aad.data(), aad.size());
+	}
+	void ProcessData(byte* output, const byte* input, size_t length){
+		cipher_->ProcessData(output, input, length);
+	}
+	void Final(byte* tag, size_t tagLength){
+		cipher_->TruncatedFinal(tag, tagLength);
+	}
+	bool Verify(const byte* tag, size_t tagLength){
+		return cipher_->TruncatedVerify(tag, tagLength);
+	}
+
+private:
+	AuthenticatedSymmetricCipher* cipher_;
+};
+
+/*
+* ChaCha20-Poly1305, implemented in chacha20poly1305.cc. The tag is always 16 bytes long (checked by AEAD_IsValidTagLength)
+*/
+class ChaChaAEADCipher : public AEADCipher {
+
+public:
+	ChaChaAEADCipher(bool encryption, const byte* key, const byte* nonce) : cipher_(key, nonce), encryption_(encryption){
+	}
+	void Begin(string const& aad, size_t messageLength){
+		cipher_.Begin((const byte*) aad.data(), aad.size());
+	}
+	void ProcessData(byte* output, const byte* input, size_t length){
+		if (encryption_) cipher_.Encrypt(output, input, length);
+		else cipher_.Decrypt(output, input, length);
+	}
+	void Final(byte* tag, size_t tagLength){
+		cipher_.Final(tag);
+	}
+	bool Verify(const byte* tag, size_t tagLength){
+		return cipher_.Verify(tag);
+	}
+
+private:
+	ChaCha20Poly1305 cipher_;
+	bool encryption_;
+};
+
+AEADCipher* AEAD_NewCipher(AEADAlgorithm algorithm, bool encryption, const byte* key, size_t keyLength, const byte* iv, size_t ivLength, size_t tagLength){
+	if (algorithm == AEAD_CHACHA20_POLY1305){
+		if (keyLength != CHACHA20POLY1305_KEY_LENGTH) throw InvalidKeyLength("ChaCha20-Poly1305", keyLength);
+		return new ChaChaAEADCipher(encryption, key, iv);
+	}
+	AuthenticatedSymmetricCipher* cipher;
+	if (algorithm == AEAD_AES_CCM){
+		if (encryption) cipher = new CCM<AES>::Encryption();
+		else cipher = new CCM<AES>::Decryption();
+	} else {
+		if (encryption) cipher = new GCM<AES>::Encryption();
+		else cipher = new GCM<AES>::Decryption();
+	}
+	try {
+		//CCM's tag length is part of its key setup; GCM truncates the tag when it's computed
+		if (algorithm == AEAD_AES_CCM) cipher->SetKey(key, keyLength, MakeParameters(CryptoPP::Name::IV(), ConstByteArrayParameter(iv, ivLength))(CryptoPP::Name::DigestSize(), (int) tagLength));
+		else cipher->SetKey(key, keyLength, MakeParameters(CryptoPP::Name::IV(), ConstByteArrayParameter(iv, ivLength)));
+	} catch (CryptoPP::Exception& e){
+		delete cipher;
+		throw;
+	}
+	return new CryptoPPAEADCipher(cipher);
+}
+
+void AEAD_Encrypt(AEADCipher& cipher, string const& aad, const byte* message, size_t messageLength, byte* output, size_t tagLength){
+	cipher.Begin(aad, messageLength);
+	cipher.ProcessData(output, message, messageLength);
+	cipher.Final(output + messageLength, tagLength);
+}
+
+bool AEAD_Decrypt(AEADCipher& cipher, string const& aad, const byte* cipherText, size_t cipherTextLength, byte* output, size_t tagLength){
+	const size_t messageLength = cipherTextLength - tagLength;
+	//Copying the tag, in case output overlaps it
+	byte tag[16];
+	memcpy(tag, cipherText + messageLength, tagLength);
+	cipher.Begin(aad, messageLength);
+	cipher.ProcessData(output, cipherText, messageLength);
+	const bool valid = cipher.Verify(tag, tagLength);
+	//Unauthenticated plaintext is never handed out
+	if (!valid) SecureWipeArray(output, messageLength);
+	return valid;
+}
+
+/*
+* Parameters shared by the cryptopp.aead methods : algorithm, key, iv, then an options object at optionsIndex
+* {aad : Buffer, tagLength : Number, output : Buffer, messageLength : Number}
+*/
+struct AEADParams {
+	AEADAlgorithm algorithm;
+	const byte* key;
+	size_t keyLength;
+	string iv, aad;
+	size_t tagLength;
+	//Only checked in the methods that take them
+	Local<Value> output;
+	bool hasMessageLength;
+	size_t messageLength;
+};
+
+//Throws a TypeError and returns false if the parameters are invalid
+static bool getParams(const Arguments& args, int optionsIndex, AEADParams& params){
+	String::AsciiValue algorithmVal(args[0]->ToString());
+	if (!AEAD_GetAlgorithm(string(*algorithmVal), params.algorithm)){
+		ThrowException(v8::Exception::TypeError(String::New("Unknown algorithm. Possible values are \"aes-gcm\", \"aes-ccm\" and \"chacha20-poly1305\"")));
+		return false;
+	}
+	if (!(node::Buffer::HasInstance(args[1]) && node::Buffer::HasInstance(args[2]))){
+		ThrowException(v8::Exception::TypeError(String::New("key and iv must be Buffers")));
+		return false;
+	}
+	params.key = (const byte*) node::Buffer::Data(args[1]->ToObject());
+	params.keyLength = node::Buffer::Length(args[1]->ToObject());
+	params.iv = string(node::Buffer::Data(args[2]->ToObject()), node::Buffer::Length(args[2]->ToObject()));
+	if (!AEAD_IsValidIVLength(params.algorithm, params.iv.size())){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid IV length")));
+		return false;
+	}
+	params.aad = "";
+	params.tagLength = 16;
+	params.output = Local<Value>::New(Undefined());
+	params.hasMessageLength = false;
+	params.messageLength = 0;
+	if (args.Length() > optionsIndex && !args[optionsIndex]->IsUndefined()){
+		if (!(args[optionsIndex]->IsObject() && !args[optionsIndex]->IsFunction())){
+			ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+			return false;
+		}
+		Local<Object> optionsObj = Local<Object>::Cast(args[optionsIndex]);
+		Local<Value> aadVal = optionsObj->Get(String::NewSymbol("aad"));
+		if (!aadVal->IsUndefined()){
+			if (!node::Buffer::HasInstance(aadVal)){
+				ThrowException(v8::Exception::TypeError(String::New("aad must be a Buffer")));
+				return false;
+			}
+			params.aad = string(node::Buffer::Data(aadVal->ToObject()), node::Buffer::Length(aadVal->ToObject()));
+		}
+		Local<Value> tagLengthVal = optionsObj->Get(String::NewSymbol("tagLength"));
+		if (!tagLengthVal->IsUndefined()){
+			if (!(tagLengthVal->IsUint32() && AEAD_IsValidTagLength(params.algorithm, tagLengthVal->Uint32Value()))){
+				ThrowException(v8::Exception::TypeError(String::New("Invalid tag length")));
+				return false;
+			}
+			params.tagLength = tagLengthVal->Uint32Value();
+		}
+		params.output = optionsObj->Get(String::NewSymbol("output"));
+		Local<Value> messageLengthVal = optionsObj->Get(String::NewSymbol("messageLength"));
+		if (!messageLengthVal->IsUndefined()){
+			if (!(messageLengthVal->IsNumber() && messageLengthVal->NumberValue() >= 0)){
+				ThrowException(v8::Exception::TypeError(String::New("Invalid message length")));
+				return false;
+			}
+			params.hasMessageLength = true;
+			params.messageLength = (size_t) messageLengthVal->NumberValue();
+		}
+	}
+	return true;
+}
+
+//The output Buffer given in the options, or a new one. Throws a TypeError and returns false if the given one doesn't have the expected length,
+//and a RangeError if the output is longer than the largest Buffer (an input close to it, plus the tag)
+static bool getOutput(Local<Value> outputVal, size_t length, Local<Object>& output){
+	if (length > BUFFER_MAX_LENGTH){
+		ThrowException(v8::Exception::RangeError(String::New("The output would be longer than the largest Buffer (1073741823 bytes)")));
+		return false;
+	}
+	if (outputVal->IsUndefined()){
+		output = Local<Object>::New(node::Buffer::New(length)->handle_);
+		return true;
+	}
+	if (!(node::Buffer::HasInstance(outputVal) && node::Buffer::Length(outputVal->ToObject()) == length)){
+		ThrowException(v8::Exception::TypeError(String::New("output must be a Buffer with the same length as the result")));
+		return false;
+	}
+	output = outputVal->ToObject();
+	return true;
+}
+
+/*
+* One-shot operations on the thread pool. The input and output Buffers are kept alive until the job is done
+*/
+struct AEADJob {
+	uv_work_t request;
+	AEADCipher* cipher;
+	bool encryption;
+	string aad;
+	const byte* input;
+	size_t inputLength, tagLength;
+	byte* output;
+	bool valid;
+	Persistent<Object> inputHandle, outputHandle;
+	Persistent<Function> callback;
+};
+
+static void AEADWork(uv_work_t* req){
+	AEADJob* job = static_cast<AEADJob*>(req->data);
+	try {
+		if (job->encryption){
+			AEAD_Encrypt(*job->cipher, job->aad, job->input, job->inputLength, job->output, job->tagLength);
+			job->valid = true;
+		} else job->valid = AEAD_Decrypt(*job->cipher, job->aad, job->input, job->inputLength, job->output, job->tagLength);
+	} catch (CryptoPP::Exception& e){
+		job->valid = false;
+	}
+}
+
+//Back on the main thread
+static void AEADDone(uv_work_t* req, int status){
+	HandleScope scope;
+	AEADJob* job = static_cast<AEADJob*>(req->data);
+	Local<Value> result = job->valid ? Local<Value>::New(job->outputHandle) : Local<Value>::New(Null());
+	Local<Function> callback = Local<Function>::New(job->callback);
+	job->inputHandle.Dispose();
+	job->outputHandle.Dispose();
+	job->callback.Dispose();
+	delete job->cipher;
+	delete job;
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { result };
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+//Runs the operation, synchronously or on the thread pool, and returns (or passes to the callback) the output Buffer, or null if decryption failed. Takes ownership of cipher
+static Handle<Value> runOneShot(const Arguments& args, int callbackIndex, AEADCipher* cipher, bool encryption, AEADParams const& params, Local<Object> input, Local<Object> output){
+	HandleScope scope;
+	const byte* inputData = (const byte*) node::Buffer::Data(input);
+	const size_t inputLength = node::Buffer::Length(input);
+	byte* outputData = (byte*) node::Buffer::Data(output);
+	const bool hasCallback = args.Length() > callbackIndex && !args[callbackIndex]->IsUndefined();
+	if (hasCallback && inputLength >= AEAD_ASYNC_THRESHOLD){
+		AEADJob* job = new AEADJob();
+		job->request.data = job;
+		job->cipher = cipher;
+		job->encryption = encryption;
+		job->aad = params.aad;
+		job->input = inputData;
+		job->inputLength = inputLength;
+		job->tagLength = params.tagLength;
+		job->output = outputData;
+		job->valid = false;
+		job->inputHandle = Persistent<Object>::New(input);
+		job->outputHandle = Persistent<Object>::New(output);
+		job->callback = Persistent<Function>::New(Local<Function>::Cast(args[callbackIndex]));
+		uv_queue_work(uv_default_loop(), &job->request, AEADWork, AEADDone);
+		return scope.Close(Undefined());
+	}
+	bool valid = true;
+	try {
+		if (encryption) AEAD_Encrypt(*cipher, params.aad, inputData, inputLength, outputData, params.tagLength);
+		else valid = AEAD_Decrypt(*cipher, params.aad, inputData, inputLength, outputData, params.tagLength);
+	} catch (CryptoPP::Exception& e){
+		delete cipher;
+		throw;
+	}
+	delete cipher;
+	Local<Value> result = valid ? Local<Value>::New(output) : Local<Value>::New(Null());
+	if (!hasCallback){
+		return scope.Close(result);
+	} else {
+		Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
+		const unsigned argc = 1;
+		Local<Value> argv[argc] = { result };
+		callback->Call(Context::GetCurrent()->Global(), argc, argv);
+		return scope.Close(Undefined());
+	}
+}
+
+//Method signature : cryptopp.aead.encrypt(algorithm, key, iv, plainText, [options], [callback(cipherText)]) : cipherText is the encrypted message followed by the tag
+static Handle<Value> aeadEncrypt(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 4 && args.Length() <= 6)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	AEADParams params;
+	if (!getParams(args, 4, params)) return scope.Close(Undefined());
+	if (!node::Buffer::HasInstance(args[3])){
+		ThrowException(v8::Exception::TypeError(String::New("plainText must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> input = args[3]->ToObject(), output;
+	if (!getOutput(params.output, node::Buffer::Length(input) + params.tagLength, output)) return scope.Close(Undefined());
+	try {
+		AEADCipher* cipher = AEAD_NewCipher(params.algorithm, true, params.key, params.keyLength, (const byte*) params.iv.data(), params.iv.size(), params.tagLength);
+		return scope.Close(runOneShot(args, 5, cipher, true, params, input, output));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+}
+
+//Method signature : cryptopp.aead.decrypt(algorithm, key, iv, cipherText, [options], [callback(plainText)]) : plainText is null if the ciphertext doesn't authenticate
+static Handle<Value> aeadDecrypt(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 4 && args.Length() <= 6)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	AEADParams params;
+	if (!getParams(args, 4, params)) return scope.Close(Undefined());
+	if (!node::Buffer::HasInstance(args[3])){
+		ThrowException(v8::Exception::TypeError(String::New("cipherText must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> input = args[3]->ToObject(), output;
+	if (node::Buffer::Length(input) < params.tagLength){
+		ThrowException(v8::Exception::TypeError(String::New("cipherText is shorter than the tag")));
+		return scope.Close(Undefined());
+	}
+	if (!getOutput(params.output, node::Buffer::Length(input) - params.tagLength, output)) return scope.Close(Undefined());
+	try {
+		AEADCipher* cipher = AEAD_NewCipher(params.algorithm, false, params.key, params.keyLength, (const byte*) params.iv.data(), params.iv.size(), params.tagLength);
+		return scope.Close(runOneShot(args, 5, cipher, false, params, input, output));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+}
+
+static Handle<Value> createStream(const Arguments& args, bool encryption){
+	HandleScope scope;
+	if (!(args.Length() >= 3 && args.Length() <= 4)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	AEADParams params;
+	if (!getParams(args, 3, params)) return scope.Close(Undefined());
+	if (params.algorithm == AEAD_AES_CCM && !params.hasMessageLength){
+		ThrowException(v8::Exception::TypeError(String::New("CCM streams need the message length (options.messageLength)")));
+		return scope.Close(Undefined());
+	}
+	try {
+		AEADCipher* cipher = AEAD_NewCipher(params.algorithm, encryption, params.key, params.keyLength, (const byte*) params.iv.data(), params.iv.size(), params.tagLength);
+		return scope.Close(AEADStream::Create(cipher, encryption, params.tagLength, params.aad, params.messageLength));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+}
+
+//Method signature : cryptopp.aead.createEncryptor(algorithm, key, iv, [options]) : returns a stream object, with update(data, [output]) and final() (that returns the tag)
+static Handle<Value> aeadCreateEncryptor(const Arguments& args){
+	return createStream(args, true);
+}
+
+//Method signature : cryptopp.aead.createDecryptor(algorithm, key, iv, [options]) : returns a stream object, with update(data, [output]) and final(tag) (that returns whether the ciphertext is authentic)
+static Handle<Value> aeadCreateDecryptor(const Arguments& args){
+	return createStream(args, false);
+}
+
+//Method signature : cryptopp.aead.hardwareSupport() : returns {aesni, pclmul, chacha}, whether the CPU has these instructions and the ChaCha20 kernel in use ("avx2", "sse2" or "portable")
+static Handle<Value> aeadHardwareSupport(const Arguments& args){
+	HandleScope scope;
+	bool aesni = false, pclmul = false;
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64
+	aesni = CryptoPP::HasAESNI();
+	pclmul = CryptoPP::HasCLMUL();
+#endif
+	Local<Object> result = Object::New();
+	result->Set(String::NewSymbol("aesni"), Boolean::New(aesni));
+	result->Set(String::NewSymbol("pclmul"), Boolean::New(pclmul));
+	result->Set(String::NewSymbol("chacha"), String::New(ChaCha20_KernelName()));
+	return scope.Close(result);
+}
+
+Persistent<Function> AEADStream::constructor;
+
+AEADStream::AEADStream() : cipher_(0), encryption_(true), tagLength_(16), finished_(false){
+}
+
+AEADStream::~AEADStream(){
+	delete cipher_;
+	cipher_ = 0;
+}
+
+void AEADStream::Init(){
+	//Prepare constructor template
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
+	tpl->SetClassName(String::NewSymbol("AEADStream"));
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+	//Prototype
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("update"), FunctionTemplate::New(Update)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("final"), FunctionTemplate::New(Final)->GetFunction());
+	constructor = Persistent<Function>::New(tpl->GetFunction());
+}
+
+Handle<Object> AEADStream::Create(AEADCipher* cipher, bool encryption, size_t tagLength, string const& aad, size_t messageLength){
+	HandleScope scope;
+	Local<Object> instance = constructor->NewInstance();
+	AEADStream* stream = ObjectWrap::Unwrap<AEADStream>(instance);
+	stream->cipher_ = cipher;
+	stream->encryption_ = encryption;
+	stream->tagLength_ = tagLength;
+	cipher->Begin(aad, messageLength);
+	return scope.Close(instance);
+}
+
+Handle<Value> AEADStream::New(const Arguments& args){
+	HandleScope scope;
+	AEADStream* stream = new AEADStream();
+	stream->Wrap(args.This());
+	return args.This();
+}
+
+/*
+* Buffer data, Buffer output (optional)
+* Returns the encrypted (or decrypted) data, in output if given. Decrypted data is NOT authenticated until final() returns true
+*/
+Handle<Value> AEADStream::Update(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() == 1 || args.Length() == 2)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	AEADStream* stream = ObjectWrap::Unwrap<AEADStream>(args.This());
+	if (stream->finished_){
+		ThrowException(v8::Exception::Error(String::New("final() has already been called on this stream")));
+		return scope.Close(Undefined());
+	}
+	if (!node::Buffer::HasInstance(args[0])){
+		ThrowException(v8::Exception::TypeError(String::New("data must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> input = args[0]->ToObject(), output;
+	if (!getOutput(args.Length() == 2 ? args[1] : Local<Value>::New(Undefined()), node::Buffer::Length(input), output)) return scope.Close(Undefined());
+	try {
+		stream->cipher_->ProcessData((byte*) node::Buffer::Data(output), (const byte*) node::Buffer::Data(input), node::Buffer::Length(input));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(output);
+}
+
+/*
+* Encryption : no parameter, returns the tag
+* Decryption : Buffer tag, returns whether the whole ciphertext is authentic
+*/
+Handle<Value> AEADStream::Final(const Arguments& args){
+	HandleScope scope;
+	AEADStream* stream = ObjectWrap::Unwrap<AEADStream>(args.This());
+	if (stream->finished_){
+		ThrowException(v8::Exception::Error(String::New("final() has already been called on this stream")));
+		return scope.Close(Undefined());
+	}
+	if (!stream->encryption_ && !(args.Length() == 1 && node::Buffer::HasInstance(args[0]))){
+		ThrowException(v8::Exception::TypeError(String::New("The tag must be given as a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Value> result;
+	try {
+		if (stream->encryption_){
+			node::Buffer* tag = node::Buffer::New(stream->tagLength_);
+			stream->cipher_->Final((byte*) node::Buffer::Data(tag), stream->tagLength_);
+			result = Local<Object>::New(tag->handle_);
+		} else {
+			Local<Object> tag = args[0]->ToObject();
+			bool valid = node::Buffer::Length(tag) == stream->tagLength_ && stream->cipher_->Verify((const byte*) node::Buffer::Data(tag), stream->tagLength_);
+			result = Local<Value>::New(Boolean::New(valid));
+		}
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	//Releasing the key right away rather than when the object is collected
+	stream->finished_ = true;
+	delete stream->cipher_;
+	stream->cipher_ = 0;
+	return scope.Close(result);
+}
+
+void AEAD_Init(Handle<Object> exports){
+	AEADStream::Init();
+	Local<Object> aeadObj = Object::New();
+	aeadObj->Set(String::NewSymbol("encrypt"), FunctionTemplate::New(aeadEncrypt)->GetFunction());
+	aeadObj->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(aeadDecrypt)->GetFunction());
+	aeadObj->Set(String::NewSymbol("createEncryptor"), FunctionTemplate::New(aeadCreateEncryptor)->GetFunction());
+	aeadObj->Set(String::NewSymbol("createDecryptor"), FunctionTemplate::New(aeadCreateDecryptor)->GetFunction());
+	aeadObj->Set(String::NewSymbol("hardwareSupport"), FunctionTemplate::New(aeadHardwareSupport)->GetFunction());
+	exports->Set(String::NewSymbol("aead"), aeadObj);
+}
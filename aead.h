@@ -0,0 +1,81 @@
+#ifndef AEAD_H
+#define AEAD_H
+
+#include <string>
+
+#include <cryptopp/config.h>
+
+#include <node.h>
+#include <uv.h>
+
+/*
+* Authenticated encryption over Buffers : AES-GCM, AES-CCM and ChaCha20-Poly1305, exposed as cryptopp.aead.
+* Crypto++ picks the AES-NI and PCLMULQDQ (GHASH) code paths by itself when the CPU supports them. On CPUs without them, ChaCha20-Poly1305 is the faster choice.
+* A ciphertext is the encrypted message followed by the authentication tag.
+*/
+enum AEADAlgorithm {
+	AEAD_AES_GCM,
+	AEAD_AES_CCM,
+	AEAD_CHACHA20_POLY1305
+};
+
+/*
+* A keyed cipher, for one message : Begin(), ProcessData() as many times as needed, then Final() (encryption) or Verify() (decryption).
+* Methods throw a CryptoPP::Exception if lengths aren't accepted
+*/
+class AEADCipher {
+
+public:
+	virtual ~AEADCipher(){}
+	//messageLength is only used by CCM, that needs it up front
+	virtual void Begin(std::string const& aad, size_t messageLength) = 0;
+	virtual void ProcessData(byte* output, const byte* input, size_t length) = 0;
+	virtual void Final(byte* tag, size_t tagLength) = 0;
+	virtual bool Verify(const byte* tag, size_t tagLength) = 0;
+};
+
+//Returns false if the algorithm name is unknown
+bool AEAD_GetAlgorithm(std::string const& name, AEADAlgorithm& algorithm);
+bool AEAD_IsValidIVLength(AEADAlgorithm algorithm, size_t ivLength);
+bool AEAD_IsValidTagLength(AEADAlgorithm algorithm, size_t tagLength);
+//Keyed cipher, to be deleted by the caller. Throws a CryptoPP::Exception if the key length isn't valid
+AEADCipher* AEAD_NewCipher(AEADAlgorithm algorithm, bool encryption, const byte* key, size_t keyLength, const byte* iv, size_t ivLength, size_t tagLength);
+
+/*
+* One-shot encryption / decryption. output can be the same memory as the input (in-place processing).
+* Encryption writes messageLength + tagLength bytes to output. Decryption writes cipherTextLength - tagLength bytes,
+* and wipes them (returning false) if the ciphertext doesn't authenticate.
+*/
+void AEAD_Encrypt(AEADCipher& cipher, std::string const& aad, const byte* message, size_t messageLength, byte* output, size_t tagLength);
+bool AEAD_Decrypt(AEADCipher& cipher, std::string const& aad, const byte* cipherText, size_t cipherTextLength, byte* output, size_t tagLength);
+
+/*
+* Streaming encryption / decryption, created by cryptopp.aead.createEncryptor() / createDecryptor()
+* The associated data is given when the stream is created. CCM needs the total message length up front too.
+*/
+class AEADStream : public node::ObjectWrap {
+
+public:
+	static void Init();
+	//Wraps the keyed cipher (which the stream then owns) in a new stream object. Throws a CryptoPP::Exception if the lengths aren't accepted by the cipher
+	static v8::Handle<v8::Object> Create(AEADCipher* cipher, bool encryption, size_t tagLength, std::string const& aad, size_t messageLength);
+
+private:
+	AEADStream();
+	~AEADStream();
+	AEADCipher* cipher_;
+	bool encryption_;
+	size_t tagLength_;
+	//Set once final() has been called : the stream can't be used anymore
+	bool finished_;
+
+	static v8::Handle<v8::Value> New(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Update(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Final(const v8::Arguments& args);
+	static v8::Persistent<v8::Function> constructor;
+};
+
+//Sets the cryptopp.aead object
+void AEAD_Init(v8::Handle<v8::Object> exports);
+
+#endif
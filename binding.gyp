@@ -2,13 +2,16 @@
 	"targets" :[
 		{
 			"target_name": "cryptopp",
-			"sources": ["node-cryptopp.cpp", "keyring.cc"],
+			"sources": ["node-cryptopp.cpp", "keyring.cc", "noncepool.cc", "ecbatch.cc", "fastec.cc", "fastec2n.cc", "gf2m.cc", "ecladder.cc", "curve25519.cc", "aead.cc", "chacha20poly1305.cc", "eciesaead.cc", "session.cc", "kdf.cc", "kekcache.cc", "secarena.cc", "random.cc", "multiprimersa.cc", "ecpoint.cc", "keystore.cc", "multikeyring.cc"],
 			"include_dirs": ["."],
 			"libraries": ["../cryptopp/libcryptopp.a"],
 			"cflags!": ["-fno-exceptions"],
 			"cflags_cc!": ["-fno-exceptions", "-fno-rtti"],
 			"cflags_cc+": ["-frtti"],
 			"conditions": [
+				['OS=="linux"', {
+					"libraries": ["-lrt"]
+				}],
 				['OS=="mac"', {
 					"xcode_settings": {
 						"GCC_ENABLE_CPP_EXCEPTIONS": "YES",
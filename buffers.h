@@ -0,0 +1,9 @@
+#ifndef BUFFERS_H
+#define BUFFERS_H
+
+#include <cstddef>
+
+//Largest Buffer node accepts (kMaxLength) : node::Buffer::New() returns 0 past it, so lengths are checked against it first
+static const size_t BUFFER_MAX_LENGTH = 0x3fffffff;
+
+#endif
@@ -0,0 +1,426 @@
+#include <cstring>
+
+#include <cryptopp/cryptlib.h>
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+using CryptoPP::VerifyBufsEqual;
+
+#include "chacha20poly1305.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#if defined(__SSE2__) || defined(_M_X64)
+#define CHACHA20_SSE2
+#include <emmintrin.h>
+#endif
+//The AVX2 kernel is compiled for AVX2 on its own (target attribute), and only called if the CPU has it
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define CHACHA20_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+static inline uint32_t load32(const byte* p){
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline void store32(byte* p, uint32_t v){
+	p[0] = (byte) v;
+	p[1] = (byte) (v >> 8);
+	p[2] = (byte) (v >> 16);
+	p[3] = (byte) (v >> 24);
+}
+
+/*
+* ChaCha20 kernels : XOR blocks (64 bytes each) of key stream into in, starting at the block counter of state. Same memory for in and out is fine
+*/
+#define CHACHA_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define CHACHA_QR(a, b, c, d) \
+	a += b; d ^= a; d = CHACHA_ROTL(d, 16); \
+	c += d; b ^= c; b = CHACHA_ROTL(b, 12); \
+	a += b; d ^= a; d = CHACHA_ROTL(d, 8); \
+	c += d; b ^= c; b = CHACHA_ROTL(b, 7);
+
+static void chachaBlock(const uint32_t state[16], uint32_t counter, byte out[64]){
+	uint32_t x[16];
+	memcpy(x, state, sizeof(x));
+	x[12] = counter;
+	for (int i = 0; i < 10; i++){
+		CHACHA_QR(x[0], x[4], x[8], x[12]);
+		CHACHA_QR(x[1], x[5], x[9], x[13]);
+		CHACHA_QR(x[2], x[6], x[10], x[14]);
+		CHACHA_QR(x[3], x[7], x[11], x[15]);
+		CHACHA_QR(x[0], x[5], x[10], x[15]);
+		CHACHA_QR(x[1], x[6], x[11], x[12]);
+		CHACHA_QR(x[2], x[7], x[8], x[13]);
+		CHACHA_QR(x[3], x[4], x[9], x[14]);
+	}
+	for (int i = 0; i < 16; i++) store32(out + 4 * i, x[i] + (i == 12 ? counter : state[i]));
+	SecureWipeArray(x, 16);
+}
+
+static void chachaPortable(const uint32_t state[16], const byte* in, byte* out, size_t blocks){
+	byte stream[64];
+	for (size_t b = 0; b < blocks; b++){
+		chachaBlock(state, state[12] + (uint32_t) b, stream);
+		for (int i = 0; i < 64; i++) out[64 * b + i] = in[64 * b + i] ^ stream[i];
+	}
+	SecureWipeArray(stream, sizeof(stream));
+}
+
+#ifdef CHACHA20_SSE2
+#define CHACHA_ROTL128(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n))
+#define CHACHA_QR128(a, b, c, d) \
+	a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = CHACHA_ROTL128(d, 16); \
+	c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = CHACHA_ROTL128(b, 12); \
+	a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = CHACHA_ROTL128(d, 8); \
+	c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = CHACHA_ROTL128(b, 7);
+
+//Transposes 4 vectors of 4 words, so that v[i] ends up with word i of each input
+static inline void transpose128(__m128i& a, __m128i& b, __m128i& c, __m128i& d){
+	const __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d), t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+	a = _mm_unpacklo_epi64(t0, t1);
+	b = _mm_unpackhi_epi64(t0, t1);
+	c = _mm_unpacklo_epi64(t2, t3);
+	d = _mm_unpackhi_epi64(t2, t3);
+}
+
+//4 blocks at a time : vector j holds word j of the 4 blocks
+static void chachaSSE2(const uint32_t state[16], const byte* in, byte* out, size_t blocks){
+	uint32_t counter = state[12];
+	for (; blocks >= 4; blocks -= 4, counter += 4, in += 256, out += 256){
+		__m128i s[16], x[16];
+		for (int i = 0; i < 16; i++) s[i] = _mm_set1_epi32((int) state[i]);
+		s[12] = _mm_add_epi32(_mm_set1_epi32((int) counter), _mm_set_epi32(3, 2, 1, 0));
+		for (int i = 0; i < 16; i++) x[i] = s[i];
+		for (int i = 0; i < 10; i++){
+			CHACHA_QR128(x[0], x[4], x[8], x[12]);
+			CHACHA_QR128(x[1], x[5], x[9], x[13]);
+			CHACHA_QR128(x[2], x[6], x[10], x[14]);
+			CHACHA_QR128(x[3], x[7], x[11], x[15]);
+			CHACHA_QR128(x[0], x[5], x[10], x[15]);
+			CHACHA_QR128(x[1], x[6], x[11], x[12]);
+			CHACHA_QR128(x[2], x[7], x[8], x[13]);
+			CHACHA_QR128(x[3], x[4], x[9], x[14]);
+		}
+		for (int i = 0; i < 16; i++) x[i] = _mm_add_epi32(x[i], s[i]);
+		for (int i = 0; i < 16; i += 4) transpose128(x[i], x[i + 1], x[i + 2], x[i + 3]);
+		//Block b is made of x[b], x[4 + b], x[8 + b], x[12 + b]
+		for (int b = 0; b < 4; b++){
+			for (int j = 0; j < 4; j++){
+				const __m128i m = _mm_loadu_si128((const __m128i*) (in + 64 * b + 16 * j));
+				_mm_storeu_si128((__m128i*) (out + 64 * b + 16 * j), _mm_xor_si128(m, x[4 * j + b]));
+			}
+		}
+	}
+	if (blocks > 0){
+		uint32_t tail[16];
+		memcpy(tail, state, sizeof(tail));
+		tail[12] = counter;
+		chachaPortable(tail, in, out, blocks);
+	}
+}
+#endif
+
+#ifdef CHACHA20_AVX2
+#define CHACHA_ROTL256(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n))
+#define CHACHA_QR256(a, b, c, d) \
+	a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = CHACHA_ROTL256(d, 16); \
+	c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = CHACHA_ROTL256(b, 12); \
+	a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = CHACHA_ROTL256(d, 8); \
+	c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = CHACHA_ROTL256(b, 7);
+
+//Same as transpose128, in each 128-bit half
+__attribute__((target("avx2"))) static inline void transpose256(__m256i& a, __m256i& b, __m256i& c, __m256i& d){
+	const __m256i t0 = _mm256_unpacklo_epi32(a, b), t1 = _mm256_unpacklo_epi32(c, d), t2 = _mm256_unpackhi_epi32(a, b), t3 = _mm256_unpackhi_epi32(c, d);
+	a = _mm256_unpacklo_epi64(t0, t1);
+	b = _mm256_unpackhi_epi64(t0, t1);
+	c = _mm256_unpacklo_epi64(t2, t3);
+	d = _mm256_unpackhi_epi64(t2, t3);
+}
+
+//8 blocks at a time. After the per-half transposition, the low halves hold blocks 0 to 3 and the high halves blocks 4 to 7
+__attribute__((target("avx2"))) static void chachaAVX2(const uint32_t state[16], const byte* in, byte* out, size_t blocks){
+	uint32_t counter = state[12];
+	for (; blocks >= 8; blocks -= 8, counter += 8, in += 512, out += 512){
+		__m256i s[16], x[16];
+		for (int i = 0; i < 16; i++) s[i] = _mm256_set1_epi32((int) state[i]);
+		s[12] = _mm256_add_epi32(_mm256_set1_epi32((int) counter), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+		for (int i = 0; i < 16; i++) x[i] = s[i];
+		for (int i = 0; i < 10; i++){
+			CHACHA_QR256(x[0], x[4], x[8], x[12]);
+			CHACHA_QR256(x[1], x[5], x[9], x[13]);
+			CHACHA_QR256(x[2], x[6], x[10], x[14]);
+			CHACHA_QR256(x[3], x[7], x[11], x[15]);
+			CHACHA_QR256(x[0], x[5], x[10], x[15]);
+			CHACHA_QR256(x[1], x[6], x[11], x[12]);
+			CHACHA_QR256(x[2], x[7], x[8], x[13]);
+			CHACHA_QR256(x[3], x[4], x[9], x[14]);
+		}
+		for (int i = 0; i < 16; i++) x[i] = _mm256_add_epi32(x[i], s[i]);
+		for (int i = 0; i < 16; i += 4) transpose256(x[i], x[i + 1], x[i + 2], x[i + 3]);
+		for (int b = 0; b < 4; b++){
+			//Words 0-7 and 8-15 of blocks b and b + 4
+			const __m256i lo = _mm256_permute2x128_si256(x[b], x[4 + b], 0x20), hi = _mm256_permute2x128_si256(x[8 + b], x[12 + b], 0x20);
+			const __m256i lo4 = _mm256_permute2x128_si256(x[b], x[4 + b], 0x31), hi4 = _mm256_permute2x128_si256(x[8 + b], x[12 + b], 0x31);
+			_mm256_storeu_si256((__m256i*) (out + 64 * b), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (in + 64 * b)), lo));
+			_mm256_storeu_si256((__m256i*) (out + 64 * b + 32), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (in + 64 * b + 32)), hi));
+			_mm256_storeu_si256((__m256i*) (out + 64 * (b + 4)), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (in + 64 * (b + 4))), lo4));
+			_mm256_storeu_si256((__m256i*) (out + 64 * (b + 4) + 32), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (in + 64 * (b + 4) + 32)), hi4));
+		}
+	}
+	if (blocks > 0){
+		uint32_t tail[16];
+		memcpy(tail, state, sizeof(tail));
+		tail[12] = counter;
+#ifdef CHACHA20_SSE2
+		chachaSSE2(tail, in, out, blocks);
+#else
+		chachaPortable(tail, in, out, blocks);
+#endif
+	}
+}
+#endif
+
+typedef void (*ChaChaKernel)(const uint32_t state[16], const byte* in, byte* out, size_t blocks);
+
+struct ChaChaKernelChoice {
+	ChaChaKernel kernel;
+	const char* name;
+};
+
+static ChaChaKernelChoice chooseKernel(){
+	ChaChaKernelChoice choice = {chachaPortable, "portable"};
+#ifdef CHACHA20_SSE2
+	choice.kernel = chachaSSE2;
+	choice.name = "sse2";
+#endif
+#ifdef CHACHA20_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")){
+		choice.kernel = chachaAVX2;
+		choice.name = "avx2";
+	}
+#endif
+	return choice;
+}
+
+//Picked when the module is loaded, before any other thread can use it
+static const ChaChaKernelChoice chachaKernel = chooseKernel();
+
+const char* ChaCha20_KernelName(){
+	return chachaKernel.name;
+}
+
+/*
+* Poly1305, with 26-bit limbs. Only whole blocks are processed : the AEAD construction pads everything to 16 bytes
+*/
+static void poly1305Blocks(uint32_t h[5], const uint32_t r[5], const byte* m, size_t blocks){
+	const uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+	const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+	uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+	for (; blocks > 0; blocks--, m += 16){
+		h0 += load32(m) & 0x3ffffff;
+		h1 += (load32(m + 3) >> 2) & 0x3ffffff;
+		h2 += (load32(m + 6) >> 4) & 0x3ffffff;
+		h3 += (load32(m + 9) >> 6) & 0x3ffffff;
+		h4 += (load32(m + 12) >> 8) | (1 << 24);
+		const uint64_t d0 = (uint64_t) h0 * r0 + (uint64_t) h1 * s4 + (uint64_t) h2 * s3 + (uint64_t) h3 * s2 + (uint64_t) h4 * s1;
+		uint64_t d1 = (uint64_t) h0 * r1 + (uint64_t) h1 * r0 + (uint64_t) h2 * s4 + (uint64_t) h3 * s3 + (uint64_t) h4 * s2;
+		uint64_t d2 = (uint64_t) h0 * r2 + (uint64_t) h1 * r1 + (uint64_t) h2 * r0 + (uint64_t) h3 * s4 + (uint64_t) h4 * s3;
+		uint64_t d3 = (uint64_t) h0 * r3 + (uint64_t) h1 * r2 + (uint64_t) h2 * r1 + (uint64_t) h3 * r0 + (uint64_t) h4 * s4;
+		uint64_t d4 = (uint64_t) h0 * r4 + (uint64_t) h1 * r3 + (uint64_t) h2 * r2 + (uint64_t) h3 * r1 + (uint64_t) h4 * r0;
+		h0 = (uint32_t) d0 & 0x3ffffff;
+		d1 += d0 >> 26;
+		h1 = (uint32_t) d1 & 0x3ffffff;
+		d2 += d1 >> 26;
+		h2 = (uint32_t) d2 & 0x3ffffff;
+		d3 += d2 >> 26;
+		h3 = (uint32_t) d3 & 0x3ffffff;
+		d4 += d3 >> 26;
+		h4 = (uint32_t) d4 & 0x3ffffff;
+		h0 += (uint32_t) (d4 >> 26) * 5;
+		h1 += h0 >> 26;
+		h0 &= 0x3ffffff;
+	}
+	h[0] = h0;
+	h[1] = h1;
+	h[2] = h2;
+	h[3] = h3;
+	h[4] = h4;
+}
+
+ChaCha20Poly1305::ChaCha20Poly1305(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH]){
+	//"expand 32-byte k"
+	state_[0] = 0x61707865;
+	state_[1] = 0x3320646e;
+	state_[2] = 0x79622d32;
+	state_[3] = 0x6b206574;
+	for (int i = 0; i < 8; i++) state_[4 + i] = load32(key + 4 * i);
+	state_[12] = 0;
+	for (int i = 0; i < 3; i++) state_[13 + i] = load32(nonce + 4 * i);
+	keyStreamUsed_ = 64;
+	blockUsed_ = 0;
+	aadLength_ = messageLength_ = 0;
+	memset(r_, 0, sizeof(r_));
+	memset(s_, 0, sizeof(s_));
+	memset(h_, 0, sizeof(h_));
+}
+
+ChaCha20Poly1305::~ChaCha20Poly1305(){
+	SecureWipeArray(state_, 16);
+	SecureWipeArray(keyStream_, sizeof(keyStream_));
+	SecureWipeArray(r_, 5);
+	SecureWipeArray(s_, 4);
+	SecureWipeArray(h_, 5);
+	SecureWipeArray(block_, sizeof(block_));
+}
+
+void ChaCha20Poly1305::Begin(const byte* aad, size_t aadLength){
+	//The one-time Poly1305 key is the beginning of block 0, the message is encrypted from block 1
+	byte polyKey[64];
+	chachaBlock(state_, 0, polyKey);
+	r_[0] = load32(polyKey) & 0x3ffffff;
+	r_[1] = (load32(polyKey + 3) >> 2) & 0x3ffff03;
+	r_[2] = (load32(polyKey + 6) >> 4) & 0x3ffc0ff;
+	r_[3] = (load32(polyKey + 9) >> 6) & 0x3f03fff;
+	r_[4] = (load32(polyKey + 12) >> 8) & 0x00fffff;
+	for (int i = 0; i < 4; i++) s_[i] = load32(polyKey + 16 + 4 * i);
+	SecureWipeArray(polyKey, sizeof(polyKey));
+	memset(h_, 0, sizeof(h_));
+	state_[12] = 1;
+	keyStreamUsed_ = 64;
+	blockUsed_ = 0;
+	aadLength_ = aadLength;
+	messageLength_ = 0;
+	Authenticate(aad, aadLength);
+	PadAuthenticator();
+}
+
+void ChaCha20Poly1305::Authenticate(const byte* data, size_t length){
+	if (blockUsed_ > 0){
+		const size_t n = length < 16 - blockUsed_ ? length : 16 - blockUsed_;
+		memcpy(block_ + blockUsed_, data, n);
+		blockUsed_ += n;
+		data += n;
+		length -= n;
+		if (blockUsed_ < 16) return;
+		poly1305Blocks(h_, r_, block_, 1);
+		blockUsed_ = 0;
+	}
+	poly1305Blocks(h_, r_, data, length / 16);
+	data += length & ~(size_t) 15;
+	length &= 15;
+	memcpy(block_, data, length);
+	blockUsed_ = length;
+}
+
+void ChaCha20Poly1305::PadAuthenticator(){
+	if (blockUsed_ == 0) return;
+	memset(block_ + blockUsed_, 0, 16 - blockUsed_);
+	poly1305Blocks(h_, r_, block_, 1);
+	blockUsed_ = 0;
+}
+
+void ChaCha20Poly1305::Crypt(byte* output, const byte* input, size_t length){
+	//Block counter limit (32 bits, block 0 being used for the Poly1305 key)
+	if (messageLength_ + length > (((uint64_t) 1) << 38) - 64) throw CryptoPP::InvalidArgument("ChaCha20-Poly1305: message length exceeds maximum");
+	messageLength_ += length;
+	//Rest of the current key stream block
+	while (length > 0 && keyStreamUsed_ < 64){
+		*output++ = *input++ ^ keyStream_[keyStreamUsed_++];
+		length--;
+	}
+	const size_t blocks = length / 64;
+	if (blocks > 0){
+		chachaKernel.kernel(state_, input, output, blocks);
+		state_[12] += (uint32_t) blocks;
+		input += 64 * blocks;
+		output += 64 * blocks;
+		length -= 64 * blocks;
+	}
+	if (length > 0){
+		chachaBlock(state_, state_[12], keyStream_);
+		state_[12]++;
+		for (keyStreamUsed_ = 0; keyStreamUsed_ < length; keyStreamUsed_++) output[keyStreamUsed_] = input[keyStreamUsed_] ^ keyStream_[keyStreamUsed_];
+	}
+}
+
+void ChaCha20Poly1305::Encrypt(byte* output, const byte* input, size_t length){
+	Crypt(output, input, length);
+	Authenticate(output, length);
+}
+
+void ChaCha20Poly1305::Decrypt(byte* output, const byte* input, size_t length){
+	//Authenticating first, output can be the same memory as input
+	Authenticate(input, length);
+	Crypt(output, input, length);
+}
+
+void ChaCha20Poly1305::ComputeTag(byte tag[CHACHA20POLY1305_TAG_LENGTH]){
+	PadAuthenticator();
+	byte lengths[16];
+	for (int i = 0; i < 8; i++){
+		lengths[i] = (byte) (aadLength_ >> (8 * i));
+		lengths[8 + i] = (byte) (messageLength_ >> (8 * i));
+	}
+	poly1305Blocks(h_, r_, lengths, 1);
+	//Full carry, then h - p if h >= p (constant time)
+	uint32_t h0 = h_[0], h1 = h_[1], h2 = h_[2], h3 = h_[3], h4 = h_[4];
+	h2 += h1 >> 26; h1 &= 0x3ffffff;
+	h3 += h2 >> 26; h2 &= 0x3ffffff;
+	h4 += h3 >> 26; h3 &= 0x3ffffff;
+	h0 += (h4 >> 26) * 5; h4 &= 0x3ffffff;
+	h1 += h0 >> 26; h0 &= 0x3ffffff;
+	uint32_t g0 = h0 + 5;
+	uint32_t g1 = h1 + (g0 >> 26); g0 &= 0x3ffffff;
+	uint32_t g2 = h2 + (g1 >> 26); g1 &= 0x3ffffff;
+	uint32_t g3 = h3 + (g2 >> 26); g2 &= 0x3ffffff;
+	uint32_t g4 = h4 + (g3 >> 26) - (1 << 26); g3 &= 0x3ffffff;
+	const uint32_t mask = (g4 >> 31) - 1;
+	h0 = (h0 & ~mask) | (g0 & mask);
+	h1 = (h1 & ~mask) | (g1 & mask);
+	h2 = (h2 & ~mask) | (g2 & mask);
+	h3 = (h3 & ~mask) | (g3 & mask);
+	h4 = (h4 & ~mask) | (g4 & mask);
+	//h + s mod 2^128
+	uint64_t f = (uint64_t) (h0 | (h1 << 26)) + s_[0];
+	store32(tag, (uint32_t) f);
+	f = (uint64_t) ((h1 >> 6) | (h2 << 20)) + s_[1] + (f >> 32);
+	store32(tag + 4, (uint32_t) f);
+	f = (uint64_t) ((h2 >> 12) | (h3 << 14)) + s_[2] + (f >> 32);
+	store32(tag + 8, (uint32_t) f);
+	f = (uint64_t) ((h3 >> 18) | (h4 << 8)) + s_[3] + (f >> 32);
+	store32(tag + 12, (uint32_t) f);
+}
+
+void ChaCha20Poly1305::Final(byte tag[CHACHA20POLY1305_TAG_LENGTH]){
+	ComputeTag(tag);
+}
+
+bool ChaCha20Poly1305::Verify(const byte tag[CHACHA20POLY1305_TAG_LENGTH]){
+	byte computed[CHACHA20POLY1305_TAG_LENGTH];
+	ComputeTag(computed);
+	const bool valid = VerifyBufsEqual(computed, tag, CHACHA20POLY1305_TAG_LENGTH);
+	SecureWipeArray(computed, sizeof(computed));
+	return valid;
+}
+
+void ChaCha20Poly1305_Encrypt(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH], const byte* aad, size_t aadLength, const byte* message, size_t messageLength, byte* output){
+	ChaCha20Poly1305 cipher(key, nonce);
+	cipher.Begin(aad, aadLength);
+	cipher.Encrypt(output, message, messageLength);
+	cipher.Final(output + messageLength);
+}
+
+bool ChaCha20Poly1305_Decrypt(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH], const byte* aad, size_t aadLength, const byte* cipherText, size_t cipherTextLength, byte* output){
+	if (cipherTextLength < CHACHA20POLY1305_TAG_LENGTH) return false;
+	const size_t messageLength = cipherTextLength - CHACHA20POLY1305_TAG_LENGTH;
+	byte tag[CHACHA20POLY1305_TAG_LENGTH];
+	memcpy(tag, cipherText + messageLength, sizeof(tag));
+	ChaCha20Poly1305 cipher(key, nonce);
+	cipher.Begin(aad, aadLength);
+	cipher.Decrypt(output, cipherText, messageLength);
+	const bool valid = cipher.Verify(tag);
+	if (!valid) SecureWipeArray(output, messageLength);
+	return valid;
+}
@@ -0,0 +1,63 @@
+#ifndef CHACHA20POLY1305_H
+#define CHACHA20POLY1305_H
+
+#include <stdint.h>
+#include <string>
+
+#include <cryptopp/config.h>
+
+/*
+* ChaCha20-Poly1305 authenticated encryption (RFC 8439), which Crypto++ 5.6.2 doesn't provide. Meant for hosts without AES instructions,
+* where it is much faster than AES-GCM, and constant time. ChaCha20 runs on 8 blocks at a time with AVX2 or 4 with SSE2,
+* the kernel being picked once, from the CPU features, when the module is loaded.
+*/
+
+static const size_t CHACHA20POLY1305_KEY_LENGTH = 32;
+static const size_t CHACHA20POLY1305_NONCE_LENGTH = 12;
+static const size_t CHACHA20POLY1305_TAG_LENGTH = 16;
+
+//Name of the ChaCha20 kernel in use : "avx2", "sse2" or "portable"
+const char* ChaCha20_KernelName();
+
+/*
+* One key and nonce. Each message (there should only be one per nonce) is started with Begin(), then encrypted or decrypted
+* in as many pieces as needed, and ended by Final() or Verify(). Messages are limited to 2^38 - 64 bytes : a CryptoPP::Exception is thrown past that.
+*/
+class ChaCha20Poly1305 {
+
+public:
+	ChaCha20Poly1305(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH]);
+	//Wipes the key and the authenticator state
+	~ChaCha20Poly1305();
+
+	void Begin(const byte* aad, size_t aadLength);
+	void Encrypt(byte* output, const byte* input, size_t length);
+	void Decrypt(byte* output, const byte* input, size_t length);
+	void Final(byte tag[CHACHA20POLY1305_TAG_LENGTH]);
+	//Constant-time comparison with the computed tag
+	bool Verify(const byte tag[CHACHA20POLY1305_TAG_LENGTH]);
+
+private:
+	void Crypt(byte* output, const byte* input, size_t length);
+	void Authenticate(const byte* data, size_t length);
+	//Pads the authenticated data with zeros to a multiple of 16 bytes
+	void PadAuthenticator();
+	void ComputeTag(byte tag[CHACHA20POLY1305_TAG_LENGTH]);
+
+	//ChaCha20 state, word 12 being the block counter
+	uint32_t state_[16];
+	byte keyStream_[64];
+	size_t keyStreamUsed_;
+	//Poly1305 key (r, in 26-bit limbs, and s), accumulator and partial block
+	uint32_t r_[5], s_[4], h_[5];
+	byte block_[16];
+	size_t blockUsed_;
+	uint64_t aadLength_, messageLength_;
+};
+
+//One-shot versions. output receives messageLength + 16 bytes (the ciphertext followed by the tag) and can be message itself
+void ChaCha20Poly1305_Encrypt(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH], const byte* aad, size_t aadLength, const byte* message, size_t messageLength, byte* output);
+//Writes cipherTextLength - 16 bytes to output. Returns false (output being wiped) if cipherText doesn't authenticate or is shorter than a tag
+bool ChaCha20Poly1305_Decrypt(const byte key[CHACHA20POLY1305_KEY_LENGTH], const byte nonce[CHACHA20POLY1305_NONCE_LENGTH], const byte* aad, size_t aadLength, const byte* cipherText, size_t cipherTextLength, byte* output);
+
+#endif
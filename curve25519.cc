@@ -0,0 +1,549 @@
+#include <cstring>
+
+#include <uv.h>
+
+#include <cryptopp/sha.h>
+using CryptoPP::SHA512;
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+#include "curve25519.h"
+#include "fe25519.h"
+#include "fe256.h"
+
+using namespace std;
+
+#if defined(FE25519_AVAILABLE) && defined(FE256_AVAILABLE)
+
+/*
+* Ed25519 points, in extended twisted Edwards coordinates : x = X / Z, y = Y / Z, x * y = T / Z.
+* The addition (add-2008-hwcd-3) and doubling (dbl-2008-hwcd) formulas are complete on this curve.
+*/
+struct EdPoint {
+	FE25519 X, Y, Z, T;
+};
+
+//Second operand of an addition, with the parts of the formula that only depend on it
+struct EdCached {
+	FE25519 YplusX, YminusX, Z, T2d;
+};
+
+//Same, for points with Z = 1 (fixed-base table)
+struct EdNiels {
+	FE25519 YplusX, YminusX, T2d;
+};
+
+//Little endian encodings of d = -121665 / 121666, 2 * d, sqrt(-1) and of the base point
+static const byte edD[32] = {0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00, 0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c, 0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52};
+static const byte edD2[32] = {0x59, 0xf1, 0xb2, 0x26, 0x94, 0x9b, 0xd6, 0xeb, 0x56, 0xb1, 0x83, 0x82, 0x9a, 0x14, 0xe0, 0x00, 0x30, 0xd1, 0xf3, 0xee, 0xf2, 0x80, 0x8e, 0x19, 0xe7, 0xfc, 0xdf, 0x56, 0xdc, 0xd9, 0x06, 0x24};
+static const byte edSqrtM1[32] = {0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4, 0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f, 0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b, 0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b};
+static const byte edBase[32] = {0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66};
+
+static FE25519 feD, feD2, feSqrtM1;
+
+/*
+* Fixed-base comb : baseTable[16 * i + j] = j * 16^i * B, for the 64 nibbles of a scalar. 120KB, built once and read-only afterwards
+*/
+static EdNiels baseTable[64 * 16];
+static uv_once_t tablesOnce = UV_ONCE_INIT;
+
+static EdPoint EdIdentity(){
+	EdPoint r;
+	r.X = FE25519_Zero();
+	r.Y = FE25519_One();
+	r.Z = FE25519_One();
+	r.T = FE25519_Zero();
+	return r;
+}
+
+static EdCached EdToCached(EdPoint const& p){
+	EdCached r;
+	r.YplusX = FE25519_Add(p.Y, p.X);
+	r.YminusX = FE25519_Sub(p.Y, p.X);
+	r.Z = p.Z;
+	r.T2d = FE25519_Mul(p.T, feD2);
+	return r;
+}
+
+//Last step shared by the additions and the doubling
+static EdPoint EdComplete(FE25519 const& E, FE25519 const& F, FE25519 const& G, FE25519 const& H){
+	EdPoint r;
+	r.X = FE25519_Mul(E, F);
+	r.Y = FE25519_Mul(G, H);
+	r.T = FE25519_Mul(E, H);
+	r.Z = FE25519_Mul(F, G);
+	return r;
+}
+
+static EdPoint EdAdd(EdPoint const& p, EdCached const& q){
+	const FE25519 A = FE25519_Mul(FE25519_Sub(p.Y, p.X), q.YminusX);
+	const FE25519 B = FE25519_Mul(FE25519_Add(p.Y, p.X), q.YplusX);
+	const FE25519 C = FE25519_Mul(p.T, q.T2d);
+	const FE25519 ZZ = FE25519_Mul(p.Z, q.Z);
+	const FE25519 D = FE25519_Add(ZZ, ZZ);
+	return EdComplete(FE25519_Sub(B, A), FE25519_Sub(D, C), FE25519_Add(D, C), FE25519_Add(B, A));
+}
+
+static EdPoint EdAddNiels(EdPoint const& p, EdNiels const& q){
+	const FE25519 A = FE25519_Mul(FE25519_Sub(p.Y, p.X), q.YminusX);
+	const FE25519 B = FE25519_Mul(FE25519_Add(p.Y, p.X), q.YplusX);
+	const FE25519 C = FE25519_Mul(p.T, q.T2d);
+	const FE25519 D = FE25519_Add(p.Z, p.Z);
+	return EdComplete(FE25519_Sub(B, A), FE25519_Sub(D, C), FE25519_Add(D, C), FE25519_Add(B, A));
+}
+
+static EdPoint EdDouble(EdPoint const& p){
+	const FE25519 A = FE25519_Sqr(p.X);
+	const FE25519 B = FE25519_Sqr(p.Y);
+	const FE25519 ZZ = FE25519_Sqr(p.Z);
+	const FE25519 C = FE25519_Add(ZZ, ZZ);
+	//a = -1
+	const FE25519 D = FE25519_Neg(A);
+	const FE25519 E = FE25519_Sub(FE25519_Sub(FE25519_Sqr(FE25519_Add(p.X, p.Y)), A), B);
+	const FE25519 G = FE25519_Add(D, B);
+	return EdComplete(E, FE25519_Sub(G, C), G, FE25519_Sub(D, B));
+}
+
+static EdPoint EdNegate(EdPoint const& p){
+	EdPoint r = p;
+	r.X = FE25519_Neg(p.X);
+	r.T = FE25519_Neg(p.T);
+	return r;
+}
+
+static void EdEncode(byte* out, EdPoint const& p){
+	const FE25519 zInv = FE25519_Inverse(p.Z);
+	const FE25519 x = FE25519_Mul(p.X, zInv);
+	FE25519_ToBytes(out, FE25519_Mul(p.Y, zInv));
+	out[31] ^= (byte) (FE25519_IsNegative(x) << 7);
+}
+
+//Only used on public values (keys and signatures), hence the branches. Rejects non-canonical encodings of y
+static bool EdDecode(EdPoint& p, const byte* in){
+	const FE25519 y = FE25519_FromBytes(in);
+	byte canonical[32];
+	FE25519_ToBytes(canonical, y);
+	canonical[31] |= in[31] & 0x80;
+	if (memcmp(canonical, in, 32) != 0) return false;
+	//x^2 = (y^2 - 1) / (d * y^2 + 1) = u / v, and x = u * v^3 * (u * v^7)^((p - 5) / 8) is a root of either u / v or -u / v
+	const FE25519 y2 = FE25519_Sqr(y);
+	const FE25519 u = FE25519_Sub(y2, FE25519_One());
+	const FE25519 v = FE25519_Add(FE25519_Mul(feD, y2), FE25519_One());
+	const FE25519 v3 = FE25519_Mul(FE25519_Sqr(v), v);
+	const FE25519 v7 = FE25519_Mul(FE25519_Sqr(v3), v);
+	FE25519 x = FE25519_Mul(FE25519_Mul(u, v3), FE25519_Pow22523(FE25519_Mul(u, v7)));
+	const FE25519 vx2 = FE25519_Mul(v, FE25519_Sqr(x));
+	if (!FE25519_Equal(vx2, u)){
+		if (!FE25519_Equal(vx2, FE25519_Neg(u))) return false;
+		x = FE25519_Mul(x, feSqrtM1);
+	}
+	const uint64_t sign = in[31] >> 7;
+	if (FE25519_IsZero(x) && sign) return false;
+	if (FE25519_IsNegative(x) != sign) x = FE25519_Neg(x);
+	p.X = x;
+	p.Y = y;
+	p.Z = FE25519_One();
+	p.T = FE25519_Mul(x, y);
+	return true;
+}
+
+//Whether 8 * p is the neutral element (0, 1)
+static bool EdIsSmallOrder(EdPoint const& p){
+	const EdPoint q = EdDouble(EdDouble(EdDouble(p)));
+	return FE25519_IsZero(q.X) && FE25519_Equal(q.Y, q.Z);
+}
+
+static void initTables(){
+	feD = FE25519_FromBytes(edD);
+	feD2 = FE25519_FromBytes(edD2);
+	feSqrtM1 = FE25519_FromBytes(edSqrtM1);
+	EdPoint row;
+	EdDecode(row, edBase);
+	//Projective multiples first, then a single inversion (Montgomery's trick) to bring them all to Z = 1
+	vector<EdPoint> points(64 * 16);
+	for (int i = 0; i < 64; i++){
+		points[16 * i] = EdIdentity();
+		const EdCached rowCached = EdToCached(row);
+		for (int j = 1; j < 16; j++) points[16 * i + j] = EdAdd(points[16 * i + j - 1], rowCached);
+		for (int j = 0; j < 4; j++) row = EdDouble(row);
+	}
+	vector<FE25519> prefix(points.size());
+	FE25519 acc = FE25519_One();
+	for (size_t i = 0; i < points.size(); i++){
+		prefix[i] = acc;
+		acc = FE25519_Mul(acc, points[i].Z);
+	}
+	FE25519 inv = FE25519_Inverse(acc);
+	for (size_t i = points.size(); i-- > 0;){
+		const FE25519 zInv = FE25519_Mul(inv, prefix[i]);
+		inv = FE25519_Mul(inv, points[i].Z);
+		const FE25519 x = FE25519_Mul(points[i].X, zInv), y = FE25519_Mul(points[i].Y, zInv);
+		baseTable[i].YplusX = FE25519_Add(y, x);
+		baseTable[i].YminusX = FE25519_Sub(y, x);
+		baseTable[i].T2d = FE25519_Mul(FE25519_Mul(x, y), feD2);
+	}
+}
+
+//k * B for a 32-byte little endian scalar, in constant time
+static EdPoint EdMultiplyBase(const byte* k){
+	uv_once(&tablesOnce, initTables);
+	EdPoint r = EdIdentity();
+	for (int i = 0; i < 64; i++){
+		const uint64_t digit = (k[i / 2] >> (4 * (i & 1))) & 15;
+		EdNiels t = baseTable[16 * i];
+		for (uint64_t j = 1; j < 16; j++){
+			const uint64_t match = (((digit ^ j) - 1) >> 63) & 1;
+			FE25519_CMov(t.YplusX, baseTable[16 * i + j].YplusX, match);
+			FE25519_CMov(t.YminusX, baseTable[16 * i + j].YminusX, match);
+			FE25519_CMov(t.T2d, baseTable[16 * i + j].T2d, match);
+		}
+		r = EdAddNiels(r, t);
+	}
+	return r;
+}
+
+/*
+* sum(scalars[i] * points[i]) with scalars as 32-byte little endian strings, all the points sharing the same doublings (Straus).
+* Variable time : only used for verifications, on public values
+*/
+static EdPoint EdMultiScalar(vector<EdPoint> const& points, vector<byte> const& scalars){
+	uv_once(&tablesOnce, initTables);
+	const size_t n = points.size();
+	vector<EdCached> tables(16 * n);
+	for (size_t i = 0; i < n; i++){
+		const EdCached p = EdToCached(points[i]);
+		EdPoint multiple = points[i];
+		tables[16 * i + 1] = p;
+		for (int j = 2; j < 16; j++){
+			multiple = EdAdd(multiple, p);
+			tables[16 * i + j] = EdToCached(multiple);
+		}
+	}
+	EdPoint r = EdIdentity();
+	for (int w = 63; w >= 0; w--){
+		if (w != 63){
+			for (int j = 0; j < 4; j++) r = EdDouble(r);
+		}
+		for (size_t i = 0; i < n; i++){
+			const int digit = (scalars[32 * i + w / 2] >> (4 * (w & 1))) & 15;
+			if (digit != 0) r = EdAdd(r, tables[16 * i + digit]);
+		}
+	}
+	return r;
+}
+
+/*
+* Scalars modulo the group order L, through the Montgomery arithmetic of fe256.h. Values are 32-byte little endian strings
+*/
+static FE256 ScalarLoad(const byte* in){
+	FE256 r;
+	for (int i = 0; i < 4; i++){
+		r.v[i] = 0;
+		for (int j = 7; j >= 0; j--) r.v[i] = (r.v[i] << 8) | in[8 * i + j];
+	}
+	return r;
+}
+
+static void ScalarStore(byte* out, FE256 const& a){
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 8; j++) out[8 * i + j] = (byte) (a.v[i] >> (8 * j));
+	}
+}
+
+//a mod L for any 256-bit a (a < 16 * L), subtracting 8L, 4L, 2L and L when possible
+static FE256 ScalarReduce(FE256 a){
+	FE256 multiple = Ed25519Scalar::Modulus(), d;
+	FE256 multiples[4];
+	for (int i = 0; i < 4; i++){
+		multiples[i] = multiple;
+		FE256_AddRaw(multiple, multiple, multiple);
+	}
+	for (int i = 3; i >= 0; i--){
+		const uint64_t borrow = FE256_SubRaw(d, a, multiples[i]);
+		FE256_CMov(a, d, borrow ^ 1);
+	}
+	return a;
+}
+
+//Montgomery form of a 32-byte string, reduced modulo L first
+static FE256 ScalarFromBytes(Ed25519Scalar const& sc, const byte* in){
+	return sc.FromPlain(ScalarReduce(ScalarLoad(in)));
+}
+
+//64-byte hash output, as a number modulo L : lo + hi * 2^256, 2^256 being the Montgomery radix
+static void ScalarReduceWide(byte* out, const byte* in){
+	const Ed25519Scalar sc;
+	FE256 hi = ScalarFromBytes(sc, in + 32);
+	FE256 r = sc.ToPlain(sc.Add(ScalarFromBytes(sc, in), sc.FromPlain(hi)));
+	ScalarStore(out, r);
+	FE256_Wipe(&hi, sizeof(hi));
+	FE256_Wipe(&r, sizeof(r));
+}
+
+//out = (a * b + c) mod L
+static void ScalarMulAdd(byte* out, const byte* a, const byte* b, const byte* c){
+	const Ed25519Scalar sc;
+	FE256 r = sc.ToPlain(sc.Add(sc.Mul(ScalarFromBytes(sc, a), ScalarFromBytes(sc, b)), ScalarFromBytes(sc, c)));
+	ScalarStore(out, r);
+	FE256_Wipe(&r, sizeof(r));
+}
+
+static bool ScalarIsCanonical(const byte* s){
+	return FE256_Less(ScalarLoad(s), Ed25519Scalar::Modulus()) != 0;
+}
+
+static void Clamp(byte* k){
+	k[0] &= 248;
+	k[31] &= 127;
+	k[31] |= 64;
+}
+
+//SHA-512 of the concatenation of up to three strings
+static void Hash512(byte* out, const byte* a, size_t aLength, const byte* b, size_t bLength, const byte* c, size_t cLength){
+	SHA512 hash;
+	hash.Update(a, aLength);
+	hash.Update(b, bLength);
+	hash.Update(c, cLength);
+	hash.Final(out);
+}
+
+/*
+* X25519
+*/
+
+//RFC 7748 Montgomery ladder, in constant time
+static void X25519_ScalarMult(byte* out, const byte* scalar, const byte* point){
+	byte k[32];
+	memcpy(k, scalar, 32);
+	Clamp(k);
+	const FE25519 x1 = FE25519_FromBytes(point);
+	FE25519 x2 = FE25519_One(), z2 = FE25519_Zero(), x3 = x1, z3 = FE25519_One();
+	uint64_t swap = 0;
+	for (int t = 254; t >= 0; t--){
+		const uint64_t bit = (k[t / 8] >> (t % 8)) & 1;
+		swap ^= bit;
+		FE25519_CSwap(x2, x3, swap);
+		FE25519_CSwap(z2, z3, swap);
+		swap = bit;
+		const FE25519 A = FE25519_Add(x2, z2), B = FE25519_Sub(x2, z2);
+		const FE25519 AA = FE25519_Sqr(A), BB = FE25519_Sqr(B);
+		const FE25519 E = FE25519_Sub(AA, BB);
+		const FE25519 C = FE25519_Add(x3, z3), D = FE25519_Sub(x3, z3);
+		const FE25519 DA = FE25519_Mul(D, A), CB = FE25519_Mul(C, B);
+		x3 = FE25519_Sqr(FE25519_Add(DA, CB));
+		z3 = FE25519_Mul(x1, FE25519_Sqr(FE25519_Sub(DA, CB)));
+		x2 = FE25519_Mul(AA, BB);
+		z2 = FE25519_Mul(E, FE25519_Add(AA, FE25519_Mul121665(E)));
+	}
+	FE25519_CSwap(x2, x3, swap);
+	FE25519_CSwap(z2, z3, swap);
+	FE25519_ToBytes(out, FE25519_Mul(x2, FE25519_Inverse(z2)));
+	FE256_Wipe(k, sizeof(k));
+}
+
+void X25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, SecByteBlock& publicKey){
+	privateKey.New(CURVE25519_KEY_LENGTH);
+	rng.GenerateBlock(privateKey.BytePtr(), privateKey.size());
+	byte k[32];
+	memcpy(k, privateKey.BytePtr(), 32);
+	Clamp(k);
+	//k * 9 through the Edwards comb and the birational map u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y), much faster than the ladder
+	const EdPoint P = EdMultiplyBase(k);
+	FE256_Wipe(k, sizeof(k));
+	publicKey.New(CURVE25519_KEY_LENGTH);
+	FE25519_ToBytes(publicKey.BytePtr(), FE25519_Mul(FE25519_Add(P.Z, P.Y), FE25519_Inverse(FE25519_Sub(P.Z, P.Y))));
+}
+
+bool X25519_Agree(SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret){
+	if (privateKey.size() != CURVE25519_KEY_LENGTH || publicKey.size() != CURVE25519_KEY_LENGTH) return false;
+	secret.New(CURVE25519_KEY_LENGTH);
+	X25519_ScalarMult(secret.BytePtr(), privateKey.BytePtr(), publicKey.BytePtr());
+	byte zero = 0;
+	for (size_t i = 0; i < secret.size(); i++) zero |= secret[i];
+	return zero != 0;
+}
+
+/*
+* Ed25519
+*/
+
+//Secret scalar (clamped first half of SHA-512(seed)), nonce prefix (second half) and encoded public key
+static void Ed25519_Expand(const byte* seed, byte* expanded, byte* publicKey){
+	SHA512().CalculateDigest(expanded, seed, 32);
+	Clamp(expanded);
+	EdEncode(publicKey, EdMultiplyBase(expanded));
+}
+
+void Ed25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, string& publicKey){
+	privateKey.New(CURVE25519_KEY_LENGTH);
+	rng.GenerateBlock(privateKey.BytePtr(), privateKey.size());
+	Ed25519_PublicKey(privateKey, publicKey);
+}
+
+bool Ed25519_PublicKey(SecByteBlock const& privateKey, string& publicKey){
+	if (privateKey.size() != CURVE25519_KEY_LENGTH) return false;
+	byte expanded[64], A[32];
+	Ed25519_Expand(privateKey.BytePtr(), expanded, A);
+	FE256_Wipe(expanded, sizeof(expanded));
+	publicKey.assign((const char*) A, 32);
+	return true;
+}
+
+bool Ed25519_Sign(SecByteBlock const& privateKey, string const& message, string& signature){
+	if (privateKey.size() != CURVE25519_KEY_LENGTH) return false;
+	const byte* M = (const byte*) message.data();
+	byte expanded[64], A[32], hash[64], r[32], k[32], sig[64];
+	Ed25519_Expand(privateKey.BytePtr(), expanded, A);
+	//r = H(prefix || M), R = r * B
+	Hash512(hash, expanded + 32, 32, M, message.size(), 0, 0);
+	ScalarReduceWide(r, hash);
+	EdEncode(sig, EdMultiplyBase(r));
+	//k = H(R || A || M), S = r + k * a
+	Hash512(hash, sig, 32, A, 32, M, message.size());
+	ScalarReduceWide(k, hash);
+	ScalarMulAdd(sig + 32, k, expanded, r);
+	signature.assign((const char*) sig, 64);
+	FE256_Wipe(expanded, sizeof(expanded));
+	FE256_Wipe(hash, sizeof(hash));
+	FE256_Wipe(r, sizeof(r));
+	return true;
+}
+
+/*
+* Parsed signature : -A and -R, S and k = H(R || A || M). Returns false if the key or the signature is malformed
+*/
+struct Ed25519_Equation {
+	EdPoint minusA, minusR;
+	byte S[32], k[32];
+};
+
+static bool Ed25519_Parse(string const& publicKey, string const& message, string const& signature, Ed25519_Equation& eq){
+	if (publicKey.size() != CURVE25519_KEY_LENGTH || signature.size() != ED25519_SIGNATURE_LENGTH) return false;
+	const byte* A = (const byte*) publicKey.data();
+	const byte* sig = (const byte*) signature.data();
+	if (!ScalarIsCanonical(sig + 32)) return false;
+	EdPoint P;
+	if (!EdDecode(P, A)) return false;
+	eq.minusA = EdNegate(P);
+	if (!EdDecode(P, sig)) return false;
+	eq.minusR = EdNegate(P);
+	memcpy(eq.S, sig + 32, 32);
+	byte hash[64];
+	Hash512(hash, sig, 32, A, 32, (const byte*) message.data(), message.size());
+	ScalarReduceWide(eq.k, hash);
+	return true;
+}
+
+bool Ed25519_Verify(string const& publicKey, string const& message, string const& signature){
+	uv_once(&tablesOnce, initTables);
+	Ed25519_Equation eq;
+	if (!Ed25519_Parse(publicKey, message, signature, eq)) return false;
+	//S * B - k * A - R
+	vector<EdPoint> points(2);
+	vector<byte> scalars(64, 0);
+	points[0] = eq.minusA;
+	memcpy(&scalars[0], eq.k, 32);
+	points[1] = eq.minusR;
+	scalars[32] = 1;
+	const EdPoint P = EdAdd(EdMultiplyBase(eq.S), EdToCached(EdMultiScalar(points, scalars)));
+	return EdIsSmallOrder(P);
+}
+
+bool Ed25519_VerifyBatch(vector<string> const& publicKeys, vector<string> const& messages, vector<string> const& signatures, vector<bool>& valid){
+	uv_once(&tablesOnce, initTables);
+	const size_t n = signatures.size();
+	valid.assign(n, false);
+	//Parsing, malformed entries being invalid right away
+	vector<Ed25519_Equation> equations;
+	vector<size_t> indexes;
+	equations.reserve(n);
+	for (size_t i = 0; i < n; i++){
+		Ed25519_Equation eq;
+		if (i < publicKeys.size() && i < messages.size() && Ed25519_Parse(publicKeys[i], messages[i], signatures[i], eq)){
+			equations.push_back(eq);
+			indexes.push_back(i);
+		}
+	}
+	const size_t m = equations.size();
+	if (m <= 1){
+		if (m == 1) valid[indexes[0]] = Ed25519_Verify(publicKeys[indexes[0]], messages[indexes[0]], signatures[indexes[0]]);
+		return m == n && (m == 0 || valid[indexes[0]]);
+	}
+	/*
+	* With random 128-bit z_i : (sum z_i * S_i) * B - sum (z_i * k_i) * A_i - sum z_i * R_i. Each valid equation contributes a small order point,
+	* and an invalid one makes the whole sum a small order point with probability 2^-128 at most
+	*/
+	AutoSeededRandomPool prng;
+	const Ed25519Scalar sc;
+	FE256 sum = sc.Zero();
+	vector<EdPoint> points(2 * m);
+	vector<byte> scalars(64 * m, 0);
+	byte z[32];
+	memset(z, 0, sizeof(z));
+	for (size_t i = 0; i < m; i++){
+		prng.GenerateBlock(z, 16);
+		const FE256 zMont = ScalarFromBytes(sc, z);
+		sum = sc.Add(sum, sc.Mul(zMont, ScalarFromBytes(sc, equations[i].S)));
+		points[2 * i] = equations[i].minusR;
+		memcpy(&scalars[64 * i], z, 32);
+		points[2 * i + 1] = equations[i].minusA;
+		ScalarStore(&scalars[64 * i + 32], sc.ToPlain(sc.Mul(zMont, ScalarFromBytes(sc, equations[i].k))));
+	}
+	byte sumBytes[32];
+	ScalarStore(sumBytes, sc.ToPlain(sum));
+	const EdPoint P = EdAdd(EdMultiplyBase(sumBytes), EdToCached(EdMultiScalar(points, scalars)));
+	bool allValid = m == n;
+	if (EdIsSmallOrder(P)){
+		for (size_t i = 0; i < m; i++) valid[indexes[i]] = true;
+	} else {
+		for (size_t i = 0; i < m; i++){
+			const size_t j = indexes[i];
+			valid[j] = Ed25519_Verify(publicKeys[j], messages[j], signatures[j]);
+			allValid = allValid && valid[j];
+		}
+	}
+	return allValid;
+}
+
+#else
+
+#include <cryptopp/cryptlib.h>
+
+static void notAvailable(){
+	throw CryptoPP::Exception(CryptoPP::Exception::NOT_IMPLEMENTED, "X25519 and Ed25519 need a compiler with 128-bit integers");
+}
+
+void X25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, SecByteBlock& publicKey){
+	notAvailable();
+}
+
+bool X25519_Agree(SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret){
+	notAvailable();
+	return false;
+}
+
+void Ed25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, string& publicKey){
+	notAvailable();
+}
+
+bool Ed25519_PublicKey(SecByteBlock const& privateKey, string& publicKey){
+	notAvailable();
+	return false;
+}
+
+bool Ed25519_Sign(SecByteBlock const& privateKey, string const& message, string& signature){
+	notAvailable();
+	return false;
+}
+
+bool Ed25519_Verify(string const& publicKey, string const& message, string const& signature){
+	notAvailable();
+	return false;
+}
+
+bool Ed25519_VerifyBatch(vector<string> const& publicKeys, vector<string> const& messages, vector<string> const& signatures, vector<bool>& valid){
+	notAvailable();
+	return false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CURVE25519_H
+#define CURVE25519_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+#include <cryptopp/cryptlib.h>
+using CryptoPP::RandomNumberGenerator;
+
+/*
+* X25519 key agreement (RFC 7748) and Ed25519 signatures (RFC 8032), which Crypto++ 5.6.2 doesn't provide.
+* Keys, secrets and signatures use the RFC encodings : 32-byte keys (the Ed25519 private key being the seed), 64-byte signatures.
+* Secret-dependent computations run in constant time. Everything is built on fe25519.h, which needs 128-bit integers :
+* without them these functions throw a CryptoPP::Exception (NOT_IMPLEMENTED).
+*/
+
+//Length of keys and of the X25519 secret
+static const size_t CURVE25519_KEY_LENGTH = 32;
+static const size_t ED25519_SIGNATURE_LENGTH = 64;
+
+void X25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, SecByteBlock& publicKey);
+//Returns false if a key doesn't have the right length, or if the public key is a low-order point (the secret would then be 0)
+bool X25519_Agree(SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret);
+
+void Ed25519_GenerateKeyPair(RandomNumberGenerator& rng, SecByteBlock& privateKey, std::string& publicKey);
+//Public key of the given seed. Returns false if the private key doesn't have the right length
+bool Ed25519_PublicKey(SecByteBlock const& privateKey, std::string& publicKey);
+//Returns false if the private key doesn't have the right length
+bool Ed25519_Sign(SecByteBlock const& privateKey, std::string const& message, std::string& signature);
+//Malformed keys and signatures are reported as invalid signatures. Uses the cofactored equation [8][S]B = [8]R + [8][k]A, like the batch verification
+bool Ed25519_Verify(std::string const& publicKey, std::string const& message, std::string const& signature);
+/*
+* Checks the signatures all at once, with a random linear combination of their equations (a single multi-scalar multiplication).
+* When that combination doesn't hold, the signatures are checked one by one to find the invalid ones.
+* valid[i] tells whether signatures[i] is valid; returns true when all of them are.
+*/
+bool Ed25519_VerifyBatch(std::vector<std::string> const& publicKeys, std::vector<std::string> const& messages, std::vector<std::string> const& signatures, std::vector<bool>& valid);
+
+#endif
@@ -0,0 +1,81 @@
+#include <map>
+
+#include <uv.h>
+
+#include "ecbatch.h"
+#include "ecmath.h"
+#include "fastec.h"
+
+using namespace std;
+
+typedef WeierstrassCurve<IntegerField> IntegerCurve;
+typedef FixedBaseTable<IntegerField> IntegerTable;
+
+/*
+* Fixed-base tables, by curve name. They are built on first use and never freed (a few hundred KB at most per curve).
+* The tables only hold affine points and are read-only once built, so they can be shared between threads; the curves and fields
+* (whose Crypto++ internals are not thread safe) are rebuilt for each call
+*/
+static uv_once_t tablesOnce = UV_ONCE_INIT;
+static uv_mutex_t tablesMutex;
+static map<string, IntegerTable*> tables;
+
+static void initTablesMutex(){
+	uv_mutex_init(&tablesMutex);
+}
+
+static IntegerCurve makeCurve(DL_GroupParameters_EC<ECP> const& params){
+	const ECP& ec = params.GetCurve();
+	return IntegerCurve(IntegerField(ec.GetField().GetModulus()), ec.GetA(), ec.GetB());
+}
+
+static IntegerTable const& getTable(DL_GroupParameters_EC<ECP> const& params, string const& curveName, IntegerCurve const& curve){
+	uv_once(&tablesOnce, initTablesMutex);
+	uv_mutex_lock(&tablesMutex);
+	IntegerTable* table = tables[curveName];
+	if (table == 0){
+		const ECPPoint& G = params.GetSubgroupGenerator();
+		IntegerCurve::Affine base;
+		base.x = curve.Field().FromInteger(G.x);
+		base.y = curve.Field().FromInteger(G.y);
+		base.infinity = false;
+		table = new IntegerTable(curve, base, params.GetSubgroupOrder().BitCount());
+		tables[curveName] = table;
+	}
+	uv_mutex_unlock(&tablesMutex);
+	return *table;
+}
+
+void ECDSA_BatchSignWithNonces(DL_GroupParameters_EC<ECP> const& params, string const& curveName, Integer const& x, vector<Integer> const& k, vector<Integer> const& e, vector<string>& signatures){
+	FastEC const* fast = FastEC::For(params);
+	if (fast != 0){
+		fast->SignBatch(x, k, e, signatures);
+		return;
+	}
+	const Integer& q = params.GetSubgroupOrder();
+	const size_t n = k.size();
+	const IntegerCurve curve = makeCurve(params);
+	IntegerTable const& table = getTable(params, curveName, curve);
+	//Nonce points, then one inversion for all their z coordinates
+	vector<IntegerCurve::Jacobian> points(n);
+	for (size_t i = 0; i < n; i++) points[i] = table.Multiply(curve, k[i]);
+	vector<IntegerCurve::Affine> affinePoints;
+	curve.BatchNormalize(points, affinePoints);
+	//One inversion for all the nonces, modulo the subgroup order
+	const IntegerField scalars(q);
+	vector<Integer> kInv(n);
+	for (size_t i = 0; i < n; i++) kInv[i] = scalars.FromInteger(k[i]);
+	BatchInverse(scalars, kInv);
+	const size_t qLength = q.ByteCount();
+	signatures.assign(n, string());
+	for (size_t i = 0; i < n; i++){
+		if (affinePoints[i].infinity) continue;
+		const Integer r = curve.Field().ToInteger(affinePoints[i].x) % q;
+		if (r.IsZero()) continue;
+		const Integer s = (scalars.ToInteger(kInv[i]) * (e[i] + x * r)) % q;
+		if (s.IsZero()) continue;
+		signatures[i].assign(2 * qLength, '\0');
+		r.Encode((byte*) &signatures[i][0], qLength);
+		s.Encode((byte*) &signatures[i][qLength], qLength);
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef ECBATCH_H
+#define ECBATCH_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::DL_GroupParameters_EC;
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+#include "rfc6979.h"
+
+/*
+* Batched ECDSA signing, for many messages under one private key.
+* The nonce points k_i * G are computed in Jacobian coordinates from a fixed-base table (built once per curve) and normalized together,
+* then the nonces themselves are inverted together : a batch of n signatures costs two modular inversions instead of 2n.
+* Signatures have the same r || s layout as the ones of ecdsa.prime.sign
+*/
+
+/*
+* Signs with the given nonces (k_i in [1, q - 1]) and message representatives e_i. signatures[i] is left empty when the nonce gave r = 0 or s = 0.
+* curveName is the key of the fixed-base table cache
+*/
+void ECDSA_BatchSignWithNonces(DL_GroupParameters_EC<ECP> const& params, std::string const& curveName, Integer const& x, std::vector<Integer> const& k, std::vector<Integer> const& e, std::vector<std::string>& signatures);
+
+template <class H>
+std::vector<std::string> ECDSA_BatchSign(DL_GroupParameters_EC<ECP> const& params, std::string const& curveName, Integer const& x, std::vector<std::string> const& messages, bool deterministic){
+	const Integer& q = params.GetSubgroupOrder();
+	const size_t n = messages.size();
+	std::vector<Integer> k(n), e(n);
+	std::vector<std::string> signatures;
+	AutoSeededRandomPool prng;
+	byte digest[H::DIGESTSIZE];
+	for (size_t i = 0; i < n; i++){
+		H().CalculateDigest(digest, (const byte*) messages[i].data(), messages[i].size());
+		e[i] = RFC6979_bits2int(digest, sizeof(digest), q.BitCount());
+		if (deterministic) k[i] = RFC6979_NonceGenerator<H>(q, x, digest, sizeof(digest)).NextK();
+		else k[i].Randomize(prng, Integer::One(), q - 1);
+	}
+	ECDSA_BatchSignWithNonces(params, curveName, x, k, e, signatures);
+	//r = 0 or s = 0 : (very) unlikely, these messages are signed again one by one
+	for (size_t i = 0; i < n; i++){
+		if (!signatures[i].empty()) continue;
+		if (deterministic){
+			signatures[i] = ECDSA_DeterministicSign<H>(params, x, messages[i]);
+			continue;
+		}
+		std::vector<Integer> ki(1), ei(1, e[i]);
+		std::vector<std::string> si;
+		do {
+			ki[0].Randomize(prng, Integer::One(), q - 1);
+			ECDSA_BatchSignWithNonces(params, curveName, x, ki, ei, si);
+		} while (si[0].empty());
+		signatures[i] = si[0];
+	}
+	return signatures;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#include <string>
+#include <cstring>
+#include <vector>
+
+#include <cryptopp/sha.h>
+using CryptoPP::SHA256;
+#include <cryptopp/pubkey.h>
+using CryptoPP::P1363_KDF2;
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::DL_GroupParameters_EC;
+
+#include "eciesaead.h"
+#include "fastec.h"
+#include "chacha20poly1305.h"
+#include "secarena.h"
+
+using namespace std;
+
+//ChaCha20-Poly1305 key from the encoded ephemeral point and the x coordinate of the shared point
+static void deriveKey(DL_GroupParameters_EC<ECP> const& params, const byte* ephemeral, size_t ephemeralLength, Integer const& sharedX, byte key[CHACHA20POLY1305_KEY_LENGTH]){
+	const size_t fieldLength = params.GetCurve().GetField().MaxElementByteLength();
+	ArenaByteBlock input(ephemeralLength + fieldLength);
+	memcpy(input.begin(), ephemeral, ephemeralLength);
+	sharedX.Encode(input.begin() + ephemeralLength, fieldLength);
+	P1363_KDF2<SHA256>::DeriveKey(key, CHACHA20POLY1305_KEY_LENGTH, input.begin(), input.size(), 0, 0);
+}
+
+//x coordinate of k * point. Returns false if point isn't a valid public element, or if the result is the point at infinity
+static bool sharedX(DL_GroupParameters_EC<ECP> const& params, FastEC const* fast, Integer const& k, ECPPoint const& point, Integer& x){
+	if (fast != 0){
+		Integer y;
+		return fast->Multiply(k, point.x, point.y, x, y);
+	}
+	if (!params.ValidateElement(3, point, 0)) return false;
+	const ECPPoint shared = params.ExponentiateElement(point, k);
+	if (shared.identity) return false;
+	x = shared.x;
+	return true;
+}
+
+bool ECIES_IsAEADCipherText(string const& cipherText){
+	return cipherText.size() > 0 && (cipherText[0] == 0x02 || cipherText[0] == 0x03);
+}
+
+bool ECIES_AEADEncrypt(OID const& curve, RandomNumberGenerator& rng, ECPPoint const& publicElement, string const& plainText, string& cipherText){
+	DL_GroupParameters_EC<ECP> params(curve);
+	FastEC const* fast = FastEC::For(curve);
+	//Ephemeral key pair
+	Integer k, x;
+	k.Randomize(rng, Integer::One(), params.GetSubgroupOrder() - 1);
+	ECPPoint ephemeral;
+	if (fast != 0) fast->MultiplyBase(k, ephemeral.x, ephemeral.y);
+	else ephemeral = params.ExponentiateBase(k);
+	ephemeral.identity = false;
+	if (!sharedX(params, fast, k, publicElement, x)) return false;
+	const size_t pointLength = params.GetCurve().EncodedPointSize(true);
+	cipherText.resize(pointLength + plainText.size() + CHACHA20POLY1305_TAG_LENGTH);
+	byte* out = (byte*) &cipherText[0];
+	params.GetCurve().EncodePoint(out, ephemeral, true);
+	byte key[CHACHA20POLY1305_KEY_LENGTH], nonce[CHACHA20POLY1305_NONCE_LENGTH] = {0};
+	deriveKey(params, out, pointLength, x, key);
+	ChaCha20Poly1305_Encrypt(key, nonce, 0, 0, (const byte*) plainText.data(), plainText.size(), out + pointLength);
+	SecureWipeArray(key, sizeof(key));
+	return true;
+}
+
+bool ECIES_AEADDecrypt(OID const& curve, Integer const& privateExponent, string const& cipherText, string& plainText){
+	if (!ECIES_IsAEADCipherText(cipherText)) return false;
+	DL_GroupParameters_EC<ECP> params(curve);
+	const size_t pointLength = params.GetCurve().EncodedPointSize(true);
+	if (cipherText.size() < pointLength + CHACHA20POLY1305_TAG_LENGTH) return false;
+	const byte* in = (const byte*) cipherText.data();
+	//Decompression fails when x isn't the coordinate of a point of the curve
+	ECPPoint ephemeral;
+	if (!params.GetCurve().DecodePoint(ephemeral, in, pointLength)) return false;
+	Integer x;
+	if (!sharedX(params, FastEC::For(curve), privateExponent, ephemeral, x)) return false;
+	byte key[CHACHA20POLY1305_KEY_LENGTH], nonce[CHACHA20POLY1305_NONCE_LENGTH] = {0};
+	deriveKey(params, in, pointLength, x, key);
+	const size_t messageLength = cipherText.size() - pointLength - CHACHA20POLY1305_TAG_LENGTH;
+	string decrypted(messageLength, '\0');
+	const bool valid = ChaCha20Poly1305_Decrypt(key, nonce, 0, 0, in + pointLength, messageLength + CHACHA20POLY1305_TAG_LENGTH, messageLength > 0 ? (byte*) &decrypted[0] : 0);
+	SecureWipeArray(key, sizeof(key));
+	if (valid) plainText.swap(decrypted);
+	return valid;
+}
+
+bool ECIES_IsMultiCipherText(string const& cipherText){
+	return cipherText.size() > 0 && (byte) cipherText[0] == ECIES_MULTI_ENVELOPE;
+}
+
+ECIESMultiEncryption::ECIESMultiEncryption(OID const& curve, RandomNumberGenerator& rng, vector<ECPPoint> const& recipients, string const& plainText) : curve_(curve), fast_(FastEC::For(curve)), recipients_(recipients), plainText_(plainText), dataKey_(CHACHA20POLY1305_KEY_LENGTH){
+	DL_GroupParameters_EC<ECP> params(curve);
+	ephemeralExponent_.Randomize(rng, Integer::One(), params.GetSubgroupOrder() - 1);
+	ECPPoint ephemeral;
+	if (fast_ != 0) fast_->MultiplyBase(ephemeralExponent_, ephemeral.x, ephemeral.y);
+	else ephemeral = params.ExponentiateBase(ephemeralExponent_);
+	ephemeral.identity = false;
+	rng.GenerateBlock(dataKey_.begin(), dataKey_.size());
+	pointLength_ = params.GetCurve().EncodedPointSize(true);
+	headerLength_ = 1 + 4 + pointLength_;
+	const size_t count = recipients.size();
+	envelope_.resize(headerLength_ + count * (CHACHA20POLY1305_KEY_LENGTH + CHACHA20POLY1305_TAG_LENGTH) + plainText.size() + CHACHA20POLY1305_TAG_LENGTH);
+	byte* out = (byte*) &envelope_[0];
+	out[0] = ECIES_MULTI_ENVELOPE;
+	for (size_t i = 0; i < 4; i++) out[1 + i] = (byte) (count >> (8 * (3 - i)));
+	params.GetCurve().EncodePoint(out + 5, ephemeral, true);
+}
+
+//The ephemeral exponent and the data key are wiped by their destructors; the plaintext copy isn't a SecBlock
+ECIESMultiEncryption::~ECIESMultiEncryption(){
+	if (plainText_.size() > 0) SecureWipeArray(&plainText_[0], plainText_.size());
+}
+
+bool ECIESMultiEncryption::Wrap(size_t first, size_t count){
+	//Crypto++'s curves aren't thread safe (ECP keeps a scratch point) : each call has its own parameters
+	DL_GroupParameters_EC<ECP> params(curve_);
+	byte* out = (byte*) &envelope_[0];
+	const byte* ephemeral = out + 5;
+	const byte nonce[CHACHA20POLY1305_NONCE_LENGTH] = {0};
+	byte key[CHACHA20POLY1305_KEY_LENGTH];
+	bool valid = true;
+	for (size_t i = first; i < first + count && i < recipients_.size(); i++){
+		Integer x;
+		if (!sharedX(params, fast_, ephemeralExponent_, recipients_[i], x)){
+			valid = false;
+			continue;
+		}
+		deriveKey(params, ephemeral, pointLength_, x, key);
+		ChaCha20Poly1305_Encrypt(key, nonce, 0, 0, dataKey_.begin(), dataKey_.size(), out + headerLength_ + i * (CHACHA20POLY1305_KEY_LENGTH + CHACHA20POLY1305_TAG_LENGTH));
+	}
+	SecureWipeArray(key, sizeof(key));
+	return valid;
+}
+
+void ECIESMultiEncryption::EncryptPayload(){
+	byte* out = (byte*) &envelope_[0];
+	const byte nonce[CHACHA20POLY1305_NONCE_LENGTH] = {0};
+	const size_t payloadOffset = headerLength_ + recipients_.size() * (CHACHA20POLY1305_KEY_LENGTH + CHACHA20POLY1305_TAG_LENGTH);
+	ChaCha20Poly1305_Encrypt(dataKey_.begin(), nonce, out, headerLength_, (const byte*) plainText_.data(), plainText_.size(), out + payloadOffset);
+}
+
+bool ECIES_MultiDecrypt(OID const& curve, Integer const& privateExponent, string const& envelope, string& plainText){
+	if (!ECIES_IsMultiCipherText(envelope)) return false;
+	DL_GroupParameters_EC<ECP> params(curve);
+	const size_t pointLength = params.GetCurve().EncodedPointSize(true), headerLength = 1 + 4 + pointLength, wrappedLength = CHACHA20POLY1305_KEY_LENGTH + CHACHA20POLY1305_TAG_LENGTH;
+	if (envelope.size() < headerLength + CHACHA20POLY1305_TAG_LENGTH) return false;
+	const byte* in = (const byte*) envelope.data();
+	size_t count = 0;
+	for (size_t i = 0; i < 4; i++) count = (count << 8) | in[1 + i];
+	if ((envelope.size() - headerLength - CHACHA20POLY1305_TAG_LENGTH) / wrappedLength < count) return false;
+	ECPPoint ephemeral;
+	if (!params.GetCurve().DecodePoint(ephemeral, in + 5, pointLength)) return false;
+	Integer x;
+	if (!sharedX(params, FastEC::For(curve), privateExponent, ephemeral, x)) return false;
+	const byte nonce[CHACHA20POLY1305_NONCE_LENGTH] = {0};
+	byte key[CHACHA20POLY1305_KEY_LENGTH], dataKey[CHACHA20POLY1305_KEY_LENGTH];
+	deriveKey(params, in + 5, pointLength, x, key);
+	//Trying every wrapped key : the one for this private key is the one that authenticates
+	bool found = false;
+	for (size_t i = 0; i < count && !found; i++){
+		found = ChaCha20Poly1305_Decrypt(key, nonce, 0, 0, in + headerLength + i * wrappedLength, wrappedLength, dataKey);
+	}
+	SecureWipeArray(key, sizeof(key));
+	if (!found){
+		SecureWipeArray(dataKey, sizeof(dataKey));
+		return false;
+	}
+	const size_t payloadOffset = headerLength + count * wrappedLength, messageLength = envelope.size() - payloadOffset - CHACHA20POLY1305_TAG_LENGTH;
+	string decrypted(messageLength, '\0');
+	const bool valid = ChaCha20Poly1305_Decrypt(dataKey, nonce, in, headerLength, in + payloadOffset, messageLength + CHACHA20POLY1305_TAG_LENGTH, messageLength > 0 ? (byte*) &decrypted[0] : 0);
+	SecureWipeArray(dataKey, sizeof(dataKey));
+	if (valid) plainText.swap(decrypted);
+	return valid;
+}
@@ -0,0 +1,75 @@
+#ifndef ECIESAEAD_H
+#define ECIESAEAD_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECPPoint;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+#include <cryptopp/osrng.h>
+using CryptoPP::RandomNumberGenerator;
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+
+class FastEC;
+
+/*
+* ECIES on prime curves with ChaCha20-Poly1305 as the data encapsulation mechanism, instead of Crypto++'s XOR + HMAC-SHA1.
+* Ciphertext : ephemeral public point, compressed (02/03 || x) || encrypted message || 16-byte tag.
+* The key is P1363 KDF2 with SHA256 over the ephemeral point and the x coordinate of the shared point; the nonce is zero, each key being used once.
+* Crypto++ ciphertexts start with an uncompressed point (04), so the first byte tells both formats apart.
+* The curve multiplications go through FastEC when the curve has a fast implementation.
+*/
+
+//Whether the ciphertext (not hex encoded) is in the format above
+bool ECIES_IsAEADCipherText(std::string const& cipherText);
+//Returns false if the public key isn't a point of the curve
+bool ECIES_AEADEncrypt(OID const& curve, RandomNumberGenerator& rng, ECPPoint const& publicElement, std::string const& plainText, std::string& cipherText);
+//Returns false if the ciphertext is malformed or doesn't authenticate
+bool ECIES_AEADDecrypt(OID const& curve, Integer const& privateExponent, std::string const& cipherText, std::string& plainText);
+
+/*
+* Multi-recipient envelope : the message is encrypted once with ChaCha20-Poly1305 under a random data key, and the data key is wrapped for each recipient.
+* Envelope : 0x10 || recipient count (4 bytes, big endian) || ephemeral public point, compressed || for each recipient, wrapped data key (32 bytes) || tag (16 bytes)
+* || encrypted message || tag. The message is authenticated along with the first three fields.
+* Every recipient shares the ephemeral key pair : the wrapping key of a recipient is derived as above (KDF2 over the ephemeral point and x(k * Q)),
+* and a data key is wrapped with ChaCha20-Poly1305 (zero nonce). Envelopes don't tell which wrapped key belongs to whom : a recipient tries each of them,
+* which only costs symmetric operations once the shared point is computed.
+*/
+static const byte ECIES_MULTI_ENVELOPE = 0x10;
+
+bool ECIES_IsMultiCipherText(std::string const& cipherText);
+
+class ECIESMultiEncryption {
+public:
+	//Draws the data key and the ephemeral key pair. The recipients must be points of the curve (Crypto++'s ECP::VerifyPoint)
+	ECIESMultiEncryption(OID const& curve, RandomNumberGenerator& rng, std::vector<ECPPoint> const& recipients, std::string const& plainText);
+	~ECIESMultiEncryption();
+	/*
+	* Wraps the data key for the recipients first to first + count - 1, and EncryptPayload() encrypts the message. They write to different parts
+	* of the envelope and only read the rest, so they can run on several threads at the same time.
+	* Wrap() returns false if one of the shared points is the point at infinity (small subgroup public key)
+	*/
+	bool Wrap(size_t first, size_t count);
+	void EncryptPayload();
+	//Once every key is wrapped and the message encrypted
+	std::string const& Envelope() const { return envelope_; }
+
+private:
+	OID curve_;
+	FastEC const* fast_;
+	std::vector<ECPPoint> recipients_;
+	std::string plainText_, envelope_;
+	Integer ephemeralExponent_;
+	SecByteBlock dataKey_;
+	size_t headerLength_, pointLength_;
+};
+
+//Returns false if the envelope is malformed, if none of the wrapped keys is for this private key, or if the message doesn't authenticate
+bool ECIES_MultiDecrypt(OID const& curve, Integer const& privateExponent, std::string const& envelope, std::string& plainText);
+
+#endif
@@ -0,0 +1,143 @@
+#include <map>
+#include <string>
+
+#include <uv.h>
+
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::DL_GroupParameters_EC;
+#include <cryptopp/oids.h>
+#include <cryptopp/filters.h>
+using CryptoPP::StringSink;
+
+#include "ecladder.h"
+#include "ecmath.h"
+#include "fe256.h"
+#include "fpn.h"
+
+using namespace std;
+
+#ifdef FPN_AVAILABLE
+
+//Up to 576 bits, for secp521r1 (and orders one bit longer than their field, as secp160k1's and secp224k1's)
+static const size_t ECLADDER_MAX_LIMBS = 9;
+
+template <class F>
+class ECLadderImpl : public ECLadder {
+public:
+	typedef typename F::Element Element;
+
+	ECLadderImpl(F const& field, DL_GroupParameters_EC<ECP> const& params) : ECLadder(params.GetCurve().GetField().GetModulus(), params.GetSubgroupOrder(), params.GetCofactor() > Integer::One()),
+		curve_(field, field.FromInteger(params.GetCurve().GetA()), field.FromInteger(params.GetCurve().GetB()), params.GetCurve().GetField().GetModulus()){}
+
+	bool Agree(SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret) const {
+		Element x;
+		if (!DecodePublicKey(publicKey, x)) return false;
+		const unsigned int bits = order_.BitCount();
+		Element result;
+		if (cofactor_){
+			//n * Q must be the point at infinity
+			uint64_t n[ECLADDER_MAX_LIMBS];
+			LoadScalar(order_, n);
+			if (curve_.Ladder(x, n, bits, result)) return false;
+		}
+		uint64_t k[ECLADDER_MAX_LIMBS];
+		LoadScalar(Integer(privateKey.BytePtr(), privateKey.size()) % order_, k);
+		const bool finite = curve_.Ladder(x, k, bits, result);
+		FE256_Wipe(k, sizeof(k));
+		if (!finite) return false;
+		secret.New(length_);
+		curve_.Field().ToInteger(result).Encode(secret.BytePtr(), length_);
+		return true;
+	}
+
+private:
+	//Validates the public key, and keeps its x coordinate
+	bool DecodePublicKey(SecByteBlock const& publicKey, Element& x) const {
+		const F& f = curve_.Field();
+		const byte* in = publicKey.BytePtr();
+		if (publicKey.size() == 1 + 2 * length_ && in[0] == 0x04){
+			const Integer px(in + 1, length_), py(in + 1 + length_, length_);
+			if (px >= modulus_ || py >= modulus_) return false;
+			x = f.FromInteger(px);
+			const Element y = f.FromInteger(py);
+			//(x, 0) has order 2
+			return !f.IsZero(y) && f.Equal(f.Sqr(y), curve_.Rhs(x)) != 0;
+		}
+		Integer px;
+		if (publicKey.size() == 1 + length_ && (in[0] == 0x02 || in[0] == 0x03)) px = Integer(in + 1, length_);
+		else if (publicKey.size() == length_) px = Integer(in, length_);
+		else return false;
+		if (px >= modulus_) return false;
+		x = f.FromInteger(px);
+		return curve_.IsValidX(x);
+	}
+
+	//Little endian limbs of k < 2^(64 * ECLADDER_MAX_LIMBS)
+	static void LoadScalar(Integer const& k, uint64_t* limbs){
+		byte buffer[8 * ECLADDER_MAX_LIMBS];
+		k.Encode(buffer, sizeof(buffer));
+		for (size_t i = 0; i < ECLADDER_MAX_LIMBS; i++){
+			uint64_t limb = 0;
+			for (size_t j = 0; j < 8; j++) limb = (limb << 8) | buffer[8 * (ECLADDER_MAX_LIMBS - 1 - i) + j];
+			limbs[i] = limb;
+		}
+		FE256_Wipe(buffer, sizeof(buffer));
+	}
+
+	XOnlyCurve<F> curve_;
+};
+
+//0 for binary curves and for moduli of unexpected sizes
+static ECLadder* NewInstance(OID const& curve){
+	const DL_GroupParameters_EC<ECP> params(curve);
+	const Integer& p = params.GetCurve().GetField().GetModulus();
+	if (curve == CryptoPP::ASN1::secp256r1()) return new ECLadderImpl<P256Field>(P256Field(), params);
+	if (curve == CryptoPP::ASN1::secp256k1()) return new ECLadderImpl<Secp256k1Field>(Secp256k1Field(), params);
+	switch ((p.BitCount() + 63) / 64){
+		case 2: return new ECLadderImpl<MontgomeryFieldN<2> >(MontgomeryFieldN<2>(p), params);
+		case 3: return new ECLadderImpl<MontgomeryFieldN<3> >(MontgomeryFieldN<3>(p), params);
+		case 4: return new ECLadderImpl<MontgomeryFieldN<4> >(MontgomeryFieldN<4>(p), params);
+		case 6: return new ECLadderImpl<MontgomeryFieldN<6> >(MontgomeryFieldN<6>(p), params);
+		case 9: return new ECLadderImpl<MontgomeryFieldN<9> >(MontgomeryFieldN<9>(p), params);
+		default: return 0;
+	}
+}
+
+//Instances are built on first use, and kept for the lifetime of the process. The key is the curve's DER encoded OID; unsupported curves map to 0
+static uv_once_t instancesOnce = UV_ONCE_INIT;
+static uv_mutex_t instancesMutex;
+static map<string, ECLadder*> instances;
+
+static void initInstancesMutex(){
+	uv_mutex_init(&instancesMutex);
+}
+
+ECLadder const* ECLadder::For(OID const& curve){
+	string key;
+	StringSink keySink(key);
+	curve.DEREncode(keySink);
+	uv_once(&instancesOnce, initInstancesMutex);
+	uv_mutex_lock(&instancesMutex);
+	map<string, ECLadder*>::iterator entry = instances.find(key);
+	if (entry == instances.end()){
+		ECLadder* instance = 0;
+		try {
+			instance = NewInstance(curve);
+		} catch (CryptoPP::Exception const& e){
+			//Not a prime curve
+		}
+		entry = instances.insert(make_pair(key, instance)).first;
+	}
+	ECLadder const* instance = entry->second;
+	uv_mutex_unlock(&instancesMutex);
+	return instance;
+}
+
+#else
+
+ECLadder const* ECLadder::For(OID const& curve){
+	return 0;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ECLADDER_H
+#define ECLADDER_H
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+
+/*
+* ECDH on prime curves with the x-only Montgomery ladder of ecmath.h : the secret is the x coordinate of the shared point, so y is never computed.
+* The peer's public key can be uncompressed (04 || x || y), compressed (02 or 03 || x) or x-only (x alone). It is validated once : from x and y
+* when y is given, otherwise by checking that x^3 + ax + b is a non-zero square (both square roots then give points of the curve, with the same
+* secret), so compressed keys don't need to be decompressed. On curves with a cofactor (secp112r2, secp128r2), the point must also be in the subgroup.
+* Field arithmetic is fixed-width : the fields of fe256.h for secp256r1 and secp256k1, MontgomeryFieldN (fpn.h) for the other curves.
+* Secrets are the same as Crypto++'s ECDH<ECP>. ECLadder::For() returns 0 when the compiler has no 128-bit integer type : callers then use Crypto++.
+* The instances are immutable once built, and can be used from any thread.
+*/
+class ECLadder {
+public:
+	static ECLadder const* For(OID const& curve);
+
+	virtual ~ECLadder(){}
+	//Subgroup order
+	Integer const& Order() const { return order_; }
+	//Length in bytes of field elements, and of secrets
+	size_t Length() const { return length_; }
+
+	//secret = x(k * Q), k being the private key (big endian) and Q the public key, in one of the encodings above. Returns false if Q isn't valid
+	virtual bool Agree(SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret) const = 0;
+
+protected:
+	ECLadder(Integer const& modulus, Integer const& order, bool cofactor) : modulus_(modulus), order_(order), length_(modulus.ByteCount()), cofactor_(cofactor){}
+
+	Integer modulus_, order_;
+	size_t length_;
+	bool cofactor_;
+};
+
+#endif
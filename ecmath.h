@@ -0,0 +1,532 @@
+#ifndef ECMATH_H
+#define ECMATH_H
+
+#include <vector>
+#include <stdint.h>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/modarith.h>
+using CryptoPP::MontgomeryRepresentation;
+
+/*
+* Short Weierstrass curve arithmetic (y^2 = x^3 + ax + b) in Jacobian coordinates, written once for any field type F.
+* F must provide :
+*   typedef Element;
+*   Element Zero(), One(), Add(a, b), Sub(a, b), Mul(a, b), Sqr(a), Inverse(a);
+*   bool IsZero(a);
+*   Element FromInteger(Integer), Integer ToInteger(Element)
+* Unlike the point classes of Crypto++, Jacobian points can be kept as they are until the end of a computation, so that many
+* of them can be brought back to affine coordinates with a single field inversion (Montgomery's trick).
+* WeierstrassCurve and FixedBaseTable are not constant time; CompleteCurve and CompleteFixedBaseTable, further down, are.
+*/
+
+//Field of integers modulo an odd prime, on top of Crypto++'s Montgomery representation. Elements are kept in Montgomery form.
+class IntegerField {
+public:
+	typedef Integer Element;
+	explicit IntegerField(Integer const& p) : mr_(p), zero_(Integer::Zero()), one_(mr_.ConvertIn(Integer::One())){}
+	Element Zero() const { return zero_; }
+	Element One() const { return one_; }
+	Element Add(Element const& a, Element const& b) const { return mr_.Add(a, b); }
+	Element Sub(Element const& a, Element const& b) const { return mr_.Subtract(a, b); }
+	Element Mul(Element const& a, Element const& b) const { return mr_.Multiply(a, b); }
+	Element Sqr(Element const& a) const { return mr_.Square(a); }
+	Element Inverse(Element const& a) const { return mr_.MultiplicativeInverse(a); }
+	bool IsZero(Element const& a) const { return a.IsZero(); }
+	Element FromInteger(Integer const& a) const { return mr_.ConvertIn(a % mr_.GetModulus()); }
+	Integer ToInteger(Element const& a) const { return mr_.ConvertOut(a); }
+private:
+	MontgomeryRepresentation mr_;
+	Integer zero_, one_;
+};
+
+/*
+* Montgomery's trick : inverts every element of v in place, with one inversion and 3(n-1) multiplications.
+* Zero elements are left as they are.
+*/
+template <class F>
+void BatchInverse(F const& f, std::vector<typename F::Element>& v){
+	typedef typename F::Element Element;
+	if (v.empty()) return;
+	std::vector<Element> prefix(v.size());
+	Element acc = f.One();
+	for (size_t i = 0; i < v.size(); i++){
+		if (!f.IsZero(v[i])) acc = f.Mul(acc, v[i]);
+		prefix[i] = acc;
+	}
+	Element inv = f.Inverse(acc);
+	for (size_t i = v.size() - 1; i > 0; i--){
+		if (f.IsZero(v[i])) continue;
+		const Element vi = v[i];
+		v[i] = f.Mul(inv, prefix[i - 1]);
+		inv = f.Mul(inv, vi);
+	}
+	if (!f.IsZero(v[0])) v[0] = inv;
+}
+
+template <class F>
+struct AffinePoint {
+	typename F::Element x, y;
+	bool infinity;
+};
+
+template <class F>
+struct JacobianPoint {
+	typename F::Element X, Y, Z;
+	bool infinity;
+};
+
+template <class F>
+class WeierstrassCurve {
+public:
+	typedef typename F::Element Element;
+	typedef AffinePoint<F> Affine;
+	typedef JacobianPoint<F> Jacobian;
+
+	WeierstrassCurve(F const& field, Integer const& a, Integer const& b) : f(field), a_(field.FromInteger(a)), b_(field.FromInteger(b)){}
+
+	F const& Field() const { return f; }
+	Element const& A() const { return a_; }
+	Element const& B() const { return b_; }
+
+	Jacobian Infinity() const {
+		Jacobian R;
+		R.X = f.One(); R.Y = f.One(); R.Z = f.Zero();
+		R.infinity = true;
+		return R;
+	}
+
+	Jacobian ToJacobian(Affine const& P) const {
+		if (P.infinity) return Infinity();
+		Jacobian R;
+		R.X = P.x; R.Y = P.y; R.Z = f.One();
+		R.infinity = false;
+		return R;
+	}
+
+	//dbl-2007-bl
+	Jacobian Double(Jacobian const& P) const {
+		if (P.infinity || f.IsZero(P.Y)) return Infinity();
+		const Element XX = f.Sqr(P.X), YY = f.Sqr(P.Y), YYYY = f.Sqr(YY), ZZ = f.Sqr(P.Z);
+		Element S = f.Sub(f.Sub(f.Sqr(f.Add(P.X, YY)), XX), YYYY);
+		S = f.Add(S, S);
+		const Element M = f.Add(f.Add(f.Add(XX, XX), XX), f.Mul(a_, f.Sqr(ZZ)));
+		Jacobian R;
+		R.X = f.Sub(f.Sqr(M), f.Add(S, S));
+		Element YYYY8 = f.Add(YYYY, YYYY);
+		YYYY8 = f.Add(YYYY8, YYYY8);
+		YYYY8 = f.Add(YYYY8, YYYY8);
+		R.Y = f.Sub(f.Mul(M, f.Sub(S, R.X)), YYYY8);
+		R.Z = f.Sub(f.Sub(f.Sqr(f.Add(P.Y, P.Z)), YY), ZZ);
+		R.infinity = false;
+		return R;
+	}
+
+	//madd-2007-bl, P + Q with Q in affine coordinates
+	Jacobian AddMixed(Jacobian const& P, Affine const& Q) const {
+		if (Q.infinity) return P;
+		if (P.infinity) return ToJacobian(Q);
+		const Element Z1Z1 = f.Sqr(P.Z);
+		const Element U2 = f.Mul(Q.x, Z1Z1);
+		const Element S2 = f.Mul(Q.y, f.Mul(P.Z, Z1Z1));
+		const Element H = f.Sub(U2, P.X);
+		Element r = f.Sub(S2, P.Y);
+		if (f.IsZero(H)){
+			if (f.IsZero(r)) return Double(ToJacobian(Q));
+			return Infinity();
+		}
+		r = f.Add(r, r);
+		const Element HH = f.Sqr(H);
+		Element I = f.Add(HH, HH);
+		I = f.Add(I, I);
+		const Element J = f.Mul(H, I);
+		const Element V = f.Mul(P.X, I);
+		Jacobian R;
+		R.X = f.Sub(f.Sub(f.Sqr(r), J), f.Add(V, V));
+		const Element Y1J = f.Mul(P.Y, J);
+		R.Y = f.Sub(f.Mul(r, f.Sub(V, R.X)), f.Add(Y1J, Y1J));
+		R.Z = f.Sub(f.Sub(f.Sqr(f.Add(P.Z, H)), Z1Z1), HH);
+		R.infinity = false;
+		return R;
+	}
+
+	//Brings all the points back to affine coordinates with one field inversion
+	void BatchNormalize(std::vector<Jacobian> const& points, std::vector<Affine>& result) const {
+		std::vector<Element> zInv(points.size());
+		for (size_t i = 0; i < points.size(); i++) zInv[i] = points[i].infinity ? f.Zero() : points[i].Z;
+		BatchInverse(f, zInv);
+		result.resize(points.size());
+		for (size_t i = 0; i < points.size(); i++){
+			if (points[i].infinity){
+				result[i].x = f.Zero(); result[i].y = f.Zero();
+				result[i].infinity = true;
+				continue;
+			}
+			const Element zInv2 = f.Sqr(zInv[i]);
+			result[i].x = f.Mul(points[i].X, zInv2);
+			result[i].y = f.Mul(points[i].Y, f.Mul(zInv2, zInv[i]));
+			result[i].infinity = false;
+		}
+	}
+
+private:
+	F f;
+	Element a_, b_;
+};
+
+/*
+* Fixed-base comb for a generator G : table[i][j - 1] = j * 16^i * G, in affine coordinates.
+* k*G is then the sum of one table entry per 4-bit digit of k, without any doubling.
+*/
+template <class F>
+class FixedBaseTable {
+public:
+	typedef WeierstrassCurve<F> Curve;
+	typedef typename Curve::Affine Affine;
+	typedef typename Curve::Jacobian Jacobian;
+
+	FixedBaseTable(Curve const& curve, Affine const& G, unsigned int maxBits) : windows_((maxBits + 3) / 4), table_(windows_){
+		Affine base = G;
+		for (unsigned int i = 0; i < windows_; i++){
+			std::vector<Jacobian> row(16);
+			row[0] = curve.ToJacobian(base);
+			for (unsigned int j = 1; j < 15; j++) row[j] = curve.AddMixed(row[j - 1], base);
+			//16 * base, the base of the next window
+			row[15] = curve.Double(row[7]);
+			std::vector<Affine> normalized;
+			curve.BatchNormalize(row, normalized);
+			base = normalized[15];
+			normalized.pop_back();
+			table_[i] = normalized;
+		}
+	}
+
+	Jacobian Multiply(Curve const& curve, Integer const& k) const {
+		Jacobian R = curve.Infinity();
+		for (unsigned int i = 0; i < windows_; i++){
+			const unsigned int digit = k.GetBits(4 * i, 4);
+			if (digit != 0) R = curve.AddMixed(R, table_[i][digit - 1]);
+		}
+		return R;
+	}
+
+	unsigned int MaxBits() const { return 4 * windows_; }
+
+private:
+	unsigned int windows_;
+	std::vector<std::vector<Affine> > table_;
+};
+
+/*
+* Complete addition formulas (Renes, Costello, Batina, "Complete addition formulas for prime order elliptic curves", 2016),
+* in homogeneous projective coordinates (x = X / Z, y = Y / Z), for curves with a = -3 (algorithms 4 and 6) or a = 0 (algorithms 7 and 9).
+* They hold for every pair of inputs, the point at infinity (0 : 1 : 0) and doublings included, so the scalar multiplications below
+* don't branch on their inputs. They are constant time as long as the field is; F must then also provide
+* CMov(r, a, flag) (r = flag ? a : r) and Equal(a, b), both in constant time.
+* The curves must have a prime order (no cofactor).
+*/
+template <class F>
+struct ProjectivePoint {
+	typename F::Element X, Y, Z;
+};
+
+template <class F>
+class CompleteCurve {
+public:
+	typedef typename F::Element Element;
+	typedef ProjectivePoint<F> Projective;
+	enum CoefficientA { A_MINUS_3, A_ZERO };
+
+	CompleteCurve(F const& field, CoefficientA a, Element const& b) : f(field), a_(a), b_(b), b3_(field.Add(field.Add(b, b), b)){}
+
+	F const& Field() const { return f; }
+
+	Projective Identity() const {
+		Projective R;
+		R.X = f.Zero(); R.Y = f.One(); R.Z = f.Zero();
+		return R;
+	}
+
+	Projective FromAffine(Element const& x, Element const& y) const {
+		Projective R;
+		R.X = x; R.Y = y; R.Z = f.One();
+		return R;
+	}
+
+	//y^2 = x^3 + ax + b
+	bool IsOnCurve(Element const& x, Element const& y) const {
+		Element rhs = f.Mul(f.Sqr(x), x);
+		if (a_ == A_MINUS_3) rhs = f.Sub(rhs, f.Add(f.Add(x, x), x));
+		rhs = f.Add(rhs, b_);
+		return f.Equal(f.Sqr(y), rhs) != 0;
+	}
+
+	//Returns false for the point at infinity
+	bool ToAffine(Projective const& P, Element& x, Element& y) const {
+		if (f.IsZero(P.Z)) return false;
+		const Element zInv = f.Inverse(P.Z);
+		x = f.Mul(P.X, zInv);
+		y = f.Mul(P.Y, zInv);
+		return true;
+	}
+
+	Projective Negate(Projective const& P) const {
+		Projective R = P;
+		R.Y = f.Neg(P.Y);
+		return R;
+	}
+
+	//R = flag ? P : R
+	void CMov(Projective& R, Projective const& P, uint64_t flag) const {
+		f.CMov(R.X, P.X, flag);
+		f.CMov(R.Y, P.Y, flag);
+		f.CMov(R.Z, P.Z, flag);
+	}
+
+	//table[index], reading every entry
+	Projective Lookup(const Projective* table, unsigned int size, unsigned int index) const {
+		Projective R = table[0];
+		for (unsigned int i = 1; i < size; i++){
+			const uint64_t diff = i ^ index;
+			CMov(R, table[i], 1 ^ ((diff | ((uint64_t) 0 - diff)) >> 63));
+		}
+		return R;
+	}
+
+	Projective Add(Projective const& P, Projective const& Q) const {
+		Element t0, t1, t2, t3, t4, X3, Y3, Z3;
+		t0 = f.Mul(P.X, Q.X); t1 = f.Mul(P.Y, Q.Y); t2 = f.Mul(P.Z, Q.Z);
+		t3 = f.Add(P.X, P.Y); t4 = f.Add(Q.X, Q.Y); t3 = f.Mul(t3, t4);
+		t4 = f.Add(t0, t1); t3 = f.Sub(t3, t4); t4 = f.Add(P.Y, P.Z);
+		X3 = f.Add(Q.Y, Q.Z); t4 = f.Mul(t4, X3); X3 = f.Add(t1, t2);
+		t4 = f.Sub(t4, X3); X3 = f.Add(P.X, P.Z); Y3 = f.Add(Q.X, Q.Z);
+		X3 = f.Mul(X3, Y3); Y3 = f.Add(t0, t2); Y3 = f.Sub(X3, Y3);
+		if (a_ == A_MINUS_3){
+			Z3 = f.Mul(b_, t2); X3 = f.Sub(Y3, Z3); Z3 = f.Add(X3, X3);
+			X3 = f.Add(X3, Z3); Z3 = f.Sub(t1, X3); X3 = f.Add(t1, X3);
+			Y3 = f.Mul(b_, Y3); t1 = f.Add(t2, t2); t2 = f.Add(t1, t2);
+			Y3 = f.Sub(Y3, t2); Y3 = f.Sub(Y3, t0); t1 = f.Add(Y3, Y3);
+			Y3 = f.Add(t1, Y3); t1 = f.Add(t0, t0); t0 = f.Add(t1, t0);
+			t0 = f.Sub(t0, t2); t1 = f.Mul(t4, Y3); t2 = f.Mul(t0, Y3);
+			Y3 = f.Mul(X3, Z3); Y3 = f.Add(Y3, t2); X3 = f.Mul(t3, X3);
+			X3 = f.Sub(X3, t1); Z3 = f.Mul(t4, Z3); t1 = f.Mul(t3, t0);
+			Z3 = f.Add(Z3, t1);
+		} else {
+			X3 = f.Add(t0, t0); t0 = f.Add(X3, t0); t2 = f.Mul(b3_, t2);
+			Z3 = f.Add(t1, t2); t1 = f.Sub(t1, t2); Y3 = f.Mul(b3_, Y3);
+			X3 = f.Mul(t4, Y3); t2 = f.Mul(t3, t1); X3 = f.Sub(t2, X3);
+			Y3 = f.Mul(Y3, t0); t1 = f.Mul(t1, Z3); Y3 = f.Add(t1, Y3);
+			t0 = f.Mul(t0, t3); Z3 = f.Mul(Z3, t4); Z3 = f.Add(Z3, t0);
+		}
+		Projective R;
+		R.X = X3; R.Y = Y3; R.Z = Z3;
+		return R;
+	}
+
+	Projective Double(Projective const& P) const {
+		Element t0, t1, t2, t3, X3, Y3, Z3;
+		if (a_ == A_MINUS_3){
+			t0 = f.Sqr(P.X); t1 = f.Sqr(P.Y); t2 = f.Sqr(P.Z);
+			t3 = f.Mul(P.X, P.Y); t3 = f.Add(t3, t3); Z3 = f.Mul(P.X, P.Z);
+			Z3 = f.Add(Z3, Z3); Y3 = f.Mul(b_, t2); Y3 = f.Sub(Y3, Z3);
+			X3 = f.Add(Y3, Y3); Y3 = f.Add(X3, Y3); X3 = f.Sub(t1, Y3);
+			Y3 = f.Add(t1, Y3); Y3 = f.Mul(X3, Y3); X3 = f.Mul(X3, t3);
+			t3 = f.Add(t2, t2); t2 = f.Add(t2, t3); Z3 = f.Mul(b_, Z3);
+			Z3 = f.Sub(Z3, t2); Z3 = f.Sub(Z3, t0); t3 = f.Add(Z3, Z3);
+			Z3 = f.Add(Z3, t3); t3 = f.Add(t0, t0); t0 = f.Add(t3, t0);
+			t0 = f.Sub(t0, t2); t0 = f.Mul(t0, Z3); Y3 = f.Add(Y3, t0);
+			t0 = f.Mul(P.Y, P.Z); t0 = f.Add(t0, t0); Z3 = f.Mul(t0, Z3);
+			X3 = f.Sub(X3, Z3); Z3 = f.Mul(t0, t1); Z3 = f.Add(Z3, Z3);
+			Z3 = f.Add(Z3, Z3);
+		} else {
+			t0 = f.Sqr(P.Y); Z3 = f.Add(t0, t0); Z3 = f.Add(Z3, Z3);
+			Z3 = f.Add(Z3, Z3); t1 = f.Mul(P.Y, P.Z); t2 = f.Sqr(P.Z);
+			t2 = f.Mul(b3_, t2); X3 = f.Mul(t2, Z3); Y3 = f.Add(t0, t2);
+			Z3 = f.Mul(t1, Z3); t1 = f.Add(t2, t2); t2 = f.Add(t1, t2);
+			t0 = f.Sub(t0, t2); Y3 = f.Mul(t0, Y3); Y3 = f.Add(X3, Y3);
+			t1 = f.Mul(P.X, P.Y); X3 = f.Mul(t0, t1); X3 = f.Add(X3, X3);
+		}
+		Projective R;
+		R.X = X3; R.Y = Y3; R.Z = Z3;
+		return R;
+	}
+
+	//table[j] = j * P, for j in [0, 15]
+	void BuildWindowTable(Projective const& P, Projective table[16]) const {
+		table[0] = Identity();
+		table[1] = P;
+		for (unsigned int j = 2; j < 16; j++) table[j] = (j % 2 == 0) ? Double(table[j / 2]) : Add(table[j - 1], P);
+	}
+
+	//4-bit digit number i of a scalar given as little endian 64-bit limbs
+	static unsigned int Digit(const uint64_t* k, unsigned int i){
+		return (unsigned int) (k[i / 16] >> (4 * (i % 16))) & 0x0F;
+	}
+
+	/*
+	* k * P with fixed 4-bit windows, reading the digits [0, windows) of k. The sequence of operations only depends on windows.
+	* Several (table, scalar) pairs can be given to get k1 * P1 + k2 * P2 + ... with shared doublings
+	*/
+	Projective MultiplyTables(const Projective* const* tables, const uint64_t* const* k, unsigned int count, unsigned int windows) const {
+		Projective R = Identity();
+		for (unsigned int i = windows; i-- > 0;){
+			if (i + 1 != windows) R = Double(Double(Double(Double(R))));
+			for (unsigned int t = 0; t < count; t++) R = Add(R, Lookup(tables[t], 16, Digit(k[t], i)));
+		}
+		return R;
+	}
+
+	Projective Multiply(Projective const& P, const uint64_t* k, unsigned int windows) const {
+		Projective table[16];
+		BuildWindowTable(P, table);
+		const Projective* tables[1] = { table };
+		const uint64_t* scalars[1] = { k };
+		return MultiplyTables(tables, scalars, 1, windows);
+	}
+
+private:
+	F f;
+	CoefficientA a_;
+	Element b_, b3_;
+};
+
+/*
+* Fixed-base comb for the complete formulas : rows[i][j] = j * 16^i * G, entry 0 being the point at infinity. k * G is one constant time
+* lookup and one addition per 4-bit digit of k, without any doubling.
+*/
+template <class F>
+class CompleteFixedBaseTable {
+public:
+	typedef CompleteCurve<F> Curve;
+	typedef typename Curve::Projective Projective;
+	typedef typename F::Element Element;
+
+	CompleteFixedBaseTable(Curve const& curve, Projective const& G, unsigned int windows) : windows_(windows), rows_(windows * 16){
+		F const& f = curve.Field();
+		Projective base = G;
+		std::vector<Element> zInv(windows * 16);
+		for (unsigned int i = 0; i < windows; i++){
+			curve.BuildWindowTable(base, &rows_[16 * i]);
+			base = curve.Double(rows_[16 * i + 8]);
+		}
+		//Normalizing to Z = 1, except for the points at infinity
+		for (size_t i = 0; i < rows_.size(); i++) zInv[i] = rows_[i].Z;
+		BatchInverse(f, zInv);
+		for (size_t i = 0; i < rows_.size(); i++){
+			if (f.IsZero(rows_[i].Z)) continue;
+			rows_[i].X = f.Mul(rows_[i].X, zInv[i]);
+			rows_[i].Y = f.Mul(rows_[i].Y, zInv[i]);
+			rows_[i].Z = f.One();
+		}
+	}
+
+	Projective Multiply(Curve const& curve, const uint64_t* k) const {
+		Projective R = curve.Identity();
+		for (unsigned int i = 0; i < windows_; i++) R = curve.Add(R, curve.Lookup(&rows_[16 * i], 16, Curve::Digit(k, i)));
+		return R;
+	}
+
+private:
+	unsigned int windows_;
+	std::vector<Projective> rows_;
+};
+
+/*
+* x-only arithmetic on y^2 = x^3 + ax + b, for ECDH (Brier and Joye, "Weierstrass elliptic curves and side-channel attacks", PKC 2002).
+* Points are (X : Z), the point at infinity being (1 : 0); P + Q is computed from P, Q and the affine x of P - Q. The Montgomery ladder
+* keeps R2 - R1 = P, so that only x(P) is needed, and does the same operations whatever the scalar : it is constant time when F is.
+* F needs CMov() on top of the interface above.
+*/
+template <class F>
+class XOnlyCurve {
+public:
+	typedef typename F::Element Element;
+
+	//p is the field modulus, for Euler's criterion
+	XOnlyCurve(F const& field, Element const& a, Element const& b, Integer const& p) : f(field), a_(a), b_(b),
+		b4_(field.Add(field.Add(b, b), field.Add(b, b))), euler_((p - Integer::One()) >> 1){
+		const Element three = f.Add(f.Add(f.One(), f.One()), f.One());
+		aZero_ = f.IsZero(a);
+		aMinus3_ = f.IsZero(f.Add(a, three));
+	}
+
+	F const& Field() const { return f; }
+
+	//x^3 + ax + b
+	Element Rhs(Element const& x) const {
+		return f.Add(f.Mul(f.Add(f.Sqr(x), a_), x), b_);
+	}
+
+	//Whether x is the x coordinate of a point of the curve other than (x, 0) : x^3 + ax + b is a non-zero square (Euler's criterion).
+	//Not constant time : x is public
+	bool IsValidX(Element const& x) const {
+		const Element rhs = Rhs(x);
+		if (f.IsZero(rhs)) return false;
+		Element r = f.One();
+		for (unsigned int i = euler_.BitCount(); i-- > 0;){
+			r = f.Sqr(r);
+			if (euler_.GetBit(i)) r = f.Mul(r, rhs);
+		}
+		return f.Equal(r, f.One()) != 0;
+	}
+
+	//x(kP), k being given as little endian 64-bit limbs, bits long. Returns false if kP is the point at infinity
+	bool Ladder(Element const& x, const uint64_t* k, unsigned int bits, Element& result) const {
+		Element X1 = f.One(), Z1 = f.Zero(), X2 = x, Z2 = f.One();
+		for (unsigned int i = bits; i-- > 0;){
+			const uint64_t bit = (k[i / 64] >> (i % 64)) & 1;
+			CSwap(X1, X2, bit);
+			CSwap(Z1, Z2, bit);
+			DifferentialAdd(X1, Z1, X2, Z2, x);
+			Double(X1, Z1);
+			CSwap(X1, X2, bit);
+			CSwap(Z1, Z2, bit);
+		}
+		if (f.IsZero(Z1)) return false;
+		result = f.Mul(X1, f.Inverse(Z1));
+		return true;
+	}
+
+private:
+	void CSwap(Element& a, Element& b, uint64_t flag) const {
+		const Element t = a;
+		f.CMov(a, b, flag);
+		f.CMov(b, t, flag);
+	}
+
+	//aZ
+	Element MulA(Element const& Z) const {
+		if (aZero_) return f.Zero();
+		if (aMinus3_) return f.Neg(f.Add(f.Add(Z, Z), Z));
+		return f.Mul(a_, Z);
+	}
+
+	//(X2 : Z2) = (X1 : Z1) + (X2 : Z2), x being the affine x of their difference :
+	//X = 2 (X1 Z2 + X2 Z1)(X1 X2 + a Z1 Z2) + 4b (Z1 Z2)^2 - x (X1 Z2 - X2 Z1)^2, Z = (X1 Z2 - X2 Z1)^2
+	void DifferentialAdd(Element const& X1, Element const& Z1, Element& X2, Element& Z2, Element const& x) const {
+		const Element T1 = f.Mul(X1, Z2), T2 = f.Mul(X2, Z1), T3 = f.Mul(X1, X2), T4 = f.Mul(Z1, Z2);
+		const Element U = f.Sqr(f.Sub(T1, T2));
+		const Element V = f.Mul(f.Add(T1, T2), f.Add(T3, MulA(T4)));
+		X2 = f.Sub(f.Add(f.Add(V, V), f.Mul(b4_, f.Sqr(T4))), f.Mul(x, U));
+		Z2 = U;
+	}
+
+	//X = (X^2 - a Z^2)^2 - 8b X Z^3, Z = 4 (X^3 Z + a X Z^3 + b Z^4)
+	void Double(Element& X, Element& Z) const {
+		const Element XX = f.Sqr(X), ZZ = f.Sqr(Z), XZ = f.Mul(X, Z);
+		const Element XZ3 = f.Mul(XZ, ZZ);
+		const Element bXZ3 = f.Mul(b4_, XZ3);
+		Element t = f.Add(f.Add(f.Mul(XZ, XX), MulA(XZ3)), f.Mul(b_, f.Sqr(ZZ)));
+		t = f.Add(t, t);
+		X = f.Sub(f.Sqr(f.Sub(XX, MulA(ZZ))), f.Add(bXZ3, bXZ3));
+		Z = f.Add(t, t);
+	}
+
+	F f;
+	Element a_, b_, b4_;
+	Integer euler_;
+	bool aZero_, aMinus3_;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include <string>
+#include <list>
+#include <map>
+
+#include <uv.h>
+
+#include <cryptopp/filters.h>
+using CryptoPP::StringSink;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::EC2N;
+using CryptoPP::DL_GroupParameters_EC;
+
+#include "ecpoint.h"
+
+using namespace std;
+
+/*
+* Cache of decompressed points : the key is the curve's DER encoded OID followed by the compressed point, the value is the uncompressed point
+* (decoding it only parses the coordinates). The list is ordered from the most to the least recently used entry
+*/
+typedef list<pair<string, string> > CacheList;
+
+static uv_once_t cacheOnce = UV_ONCE_INIT;
+static uv_mutex_t cacheMutex;
+static CacheList cacheEntries;
+static map<string, CacheList::iterator> cacheIndex;
+static size_t cacheCapacity = ECPOINT_DEFAULT_CACHE_CAPACITY;
+
+static void initCacheMutex(){
+	uv_mutex_init(&cacheMutex);
+}
+
+//Called with the mutex locked
+static void trimCache(){
+	while (cacheEntries.size() > cacheCapacity){
+		cacheIndex.erase(cacheEntries.back().first);
+		cacheEntries.pop_back();
+	}
+}
+
+static bool cacheLookup(string const& key, string& uncompressed){
+	uv_once(&cacheOnce, initCacheMutex);
+	uv_mutex_lock(&cacheMutex);
+	map<string, CacheList::iterator>::iterator entry = cacheIndex.find(key);
+	const bool found = entry != cacheIndex.end();
+	if (found){
+		cacheEntries.splice(cacheEntries.begin(), cacheEntries, entry->second);
+		uncompressed = entry->second->second;
+	}
+	uv_mutex_unlock(&cacheMutex);
+	return found;
+}
+
+static void cacheInsert(string const& key, string const& uncompressed){
+	uv_once(&cacheOnce, initCacheMutex);
+	uv_mutex_lock(&cacheMutex);
+	//Another thread may have decompressed the same point meanwhile
+	if (cacheCapacity > 0 && cacheIndex.count(key) == 0){
+		cacheEntries.push_front(make_pair(key, uncompressed));
+		cacheIndex[key] = cacheEntries.begin();
+		trimCache();
+	}
+	uv_mutex_unlock(&cacheMutex);
+}
+
+void ECPoint_SetCacheCapacity(size_t capacity){
+	uv_once(&cacheOnce, initCacheMutex);
+	uv_mutex_lock(&cacheMutex);
+	cacheCapacity = capacity;
+	trimCache();
+	uv_mutex_unlock(&cacheMutex);
+}
+
+size_t ECPoint_CacheCapacity(){
+	uv_once(&cacheOnce, initCacheMutex);
+	uv_mutex_lock(&cacheMutex);
+	const size_t capacity = cacheCapacity;
+	uv_mutex_unlock(&cacheMutex);
+	return capacity;
+}
+
+//Whether data starts with something that looks like a compressed point
+template <class EC>
+static bool isCompressed(DL_GroupParameters_EC<EC> const& params, const byte* data, size_t length){
+	return length >= params.GetCurve().EncodedPointSize(true) && (data[0] == 0x02 || data[0] == 0x03);
+}
+
+//The curves' DecodePoint() doesn't check that uncompressed points are on the curve, nor that coordinates are field elements
+template <class EC>
+static bool decodePoint(DL_GroupParameters_EC<EC> const& params, const byte* data, size_t length, typename EC::Point& point){
+	return params.GetCurve().DecodePoint(point, data, length) && !point.identity && params.GetCurve().VerifyPoint(point);
+}
+
+template <class EC>
+static string encodePoint(DL_GroupParameters_EC<EC> const& params, typename EC::Point const& point, bool compressed){
+	string encoded(params.GetCurve().EncodedPointSize(compressed), '\0');
+	params.GetCurve().EncodePoint((byte*) &encoded[0], point, compressed);
+	return encoded;
+}
+
+template <class EC>
+static bool decode(OID const& curve, string const& encoded, typename EC::Point& point){
+	DL_GroupParameters_EC<EC> params(curve);
+	const byte* data = (const byte*) encoded.data();
+	const size_t compressedLength = params.GetCurve().EncodedPointSize(true), uncompressedLength = params.GetCurve().EncodedPointSize(false);
+	if (encoded.size() == uncompressedLength && data[0] == 0x04) return decodePoint(params, data, encoded.size(), point);
+	if (!(encoded.size() == compressedLength && isCompressed(params, data, encoded.size()))) return false;
+	string key, uncompressed;
+	StringSink keySink(key);
+	curve.DEREncode(keySink);
+	key += encoded;
+	if (cacheLookup(key, uncompressed)) return params.GetCurve().DecodePoint(point, (const byte*) uncompressed.data(), uncompressed.size());
+	if (!decodePoint(params, data, encoded.size(), point)) return false;
+	cacheInsert(key, encodePoint(params, point, false));
+	return true;
+}
+
+template <class EC>
+static bool compressPrefix(OID const& curve, string& data){
+	DL_GroupParameters_EC<EC> params(curve);
+	const size_t uncompressedLength = params.GetCurve().EncodedPointSize(false);
+	typename EC::Point point;
+	if (data.size() < uncompressedLength || data[0] != 0x04) return false;
+	if (!params.GetCurve().DecodePoint(point, (const byte*) data.data(), uncompressedLength)) return false;
+	data.replace(0, uncompressedLength, encodePoint(params, point, true));
+	return true;
+}
+
+template <class EC>
+static bool decompressPrefix(OID const& curve, string& data){
+	DL_GroupParameters_EC<EC> params(curve);
+	const size_t compressedLength = params.GetCurve().EncodedPointSize(true);
+	typename EC::Point point;
+	if (!isCompressed(params, (const byte*) data.data(), data.size())) return false;
+	if (!decodePoint(params, (const byte*) data.data(), compressedLength, point)) return false;
+	data.replace(0, compressedLength, encodePoint(params, point, false));
+	return true;
+}
+
+bool ECPoint_DecodeP(OID const& curve, string const& encoded, ECPPoint& point){
+	return decode<ECP>(curve, encoded, point);
+}
+
+bool ECPoint_DecodeB(OID const& curve, string const& encoded, EC2NPoint& point){
+	return decode<EC2N>(curve, encoded, point);
+}
+
+string ECPoint_EncodeP(OID const& curve, ECPPoint const& point, bool compressed){
+	return encodePoint(DL_GroupParameters_EC<ECP>(curve), point, compressed);
+}
+
+string ECPoint_EncodeB(OID const& curve, EC2NPoint const& point, bool compressed){
+	return encodePoint(DL_GroupParameters_EC<EC2N>(curve), point, compressed);
+}
+
+bool ECPoint_DecompressP(OID const& curve, string const& encoded, string& uncompressed){
+	ECPPoint point;
+	if (!ECPoint_DecodeP(curve, encoded, point)) return false;
+	uncompressed = ECPoint_EncodeP(curve, point, false);
+	return true;
+}
+
+bool ECPoint_DecompressB(OID const& curve, string const& encoded, string& uncompressed){
+	EC2NPoint point;
+	if (!ECPoint_DecodeB(curve, encoded, point)) return false;
+	uncompressed = ECPoint_EncodeB(curve, point, false);
+	return true;
+}
+
+bool ECPoint_CompressPrefixP(OID const& curve, string& data){
+	return compressPrefix<ECP>(curve, data);
+}
+
+bool ECPoint_CompressPrefixB(OID const& curve, string& data){
+	return compressPrefix<EC2N>(curve, data);
+}
+
+bool ECPoint_DecompressPrefixP(OID const& curve, string& data){
+	return decompressPrefix<ECP>(curve, data);
+}
+
+bool ECPoint_DecompressPrefixB(OID const& curve, string& data){
+	return decompressPrefix<EC2N>(curve, data);
+}
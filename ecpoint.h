@@ -0,0 +1,48 @@
+#ifndef ECPOINT_H
+#define ECPOINT_H
+
+#include <string>
+
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECPPoint;
+using CryptoPP::EC2NPoint;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+
+/*
+* SEC1 point encodings (SEC 1 v2, section 2.3.3), for the public keys of prime (P) and binary (B) curves :
+* compressed, 02 or 03 || x (the first byte giving the parity of y, or of y / x on binary curves), or uncompressed, 04 || x || y.
+* Coordinates are as long as a field element, leading zeros included. Compressed points are about half as long.
+*
+* Decompressing costs a modular square root (prime curves) or solving a quadratic equation (binary curves), so decoded compressed
+* points are kept in a cache shared by every curve : a key that is used again isn't decompressed again. The cache is a LRU list of
+* ECPOINT_DEFAULT_CACHE_CAPACITY points by default; it can be used from any thread.
+*/
+static const size_t ECPOINT_DEFAULT_CACHE_CAPACITY = 4096;
+
+//Both return false if encoded isn't one of the encodings above, or isn't a point of the curve
+bool ECPoint_DecodeP(OID const& curve, std::string const& encoded, ECPPoint& point);
+bool ECPoint_DecodeB(OID const& curve, std::string const& encoded, EC2NPoint& point);
+std::string ECPoint_EncodeP(OID const& curve, ECPPoint const& point, bool compressed);
+std::string ECPoint_EncodeB(OID const& curve, EC2NPoint const& point, bool compressed);
+
+//Same as decoding then encoding without compression (Crypto++'s ECDH public key format). Returns false if encoded isn't valid
+bool ECPoint_DecompressP(OID const& curve, std::string const& encoded, std::string& uncompressed);
+bool ECPoint_DecompressB(OID const& curve, std::string const& encoded, std::string& uncompressed);
+
+/*
+* Point compression at the start of a message, for ECIES ciphertexts (ephemeral point || encrypted message || MAC).
+* Crypto++'s ECIES (without the DHAES mode) doesn't derive its keys from the ephemeral point's encoding, so it can be changed afterwards.
+* Compress returns false if data doesn't start with an uncompressed point, Decompress if it doesn't start with a compressed point
+* of the curve. These don't go through the cache, ephemeral points being used once
+*/
+bool ECPoint_CompressPrefixP(OID const& curve, std::string& data);
+bool ECPoint_CompressPrefixB(OID const& curve, std::string& data);
+bool ECPoint_DecompressPrefixP(OID const& curve, std::string& data);
+bool ECPoint_DecompressPrefixB(OID const& curve, std::string& data);
+
+//Maximum number of points in the cache. 0 disables it
+void ECPoint_SetCacheCapacity(size_t capacity);
+size_t ECPoint_CacheCapacity();
+
+#endif
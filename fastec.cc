@@ -0,0 +1,302 @@
+#include <uv.h>
+
+#include <cryptopp/oids.h>
+
+#include "fastec.h"
+#include "fe256.h"
+#include "ecmath.h"
+
+using namespace std;
+
+#ifdef FE256_AVAILABLE
+
+template <class F, class S>
+class FastECImpl : public FastEC {
+public:
+	typedef CompleteCurve<F> Curve;
+	typedef typename Curve::Projective Projective;
+	typedef typename F::Element Element;
+	typedef typename S::Element Scalar;
+
+	FastECImpl(typename Curve::CoefficientA a, FE256 const& b, FE256 const& gx, FE256 const& gy) : FastEC(FE256_ToInteger(F::Modulus()), FE256_ToInteger(S::Modulus())),
+		curve_(F(), a, F().FromPlain(b)), base_(curve_, curve_.FromAffine(F().FromPlain(gx), F().FromPlain(gy)), 64){}
+
+	void MultiplyBase(Integer const& k, Integer& x, Integer& y) const {
+		FE256 scalar = ScalarFromInteger(k);
+		const Projective R = base_.Multiply(curve_, scalar.v);
+		FE256_Wipe(&scalar, sizeof(scalar));
+		Element ax, ay;
+		if (!curve_.ToAffine(R, ax, ay)){
+			x = Integer::Zero();
+			y = Integer::Zero();
+			return;
+		}
+		x = curve_.Field().ToInteger(ax);
+		y = curve_.Field().ToInteger(ay);
+	}
+
+	bool Multiply(Integer const& k, Integer const& px, Integer const& py, Integer& x, Integer& y) const {
+		Projective P;
+		if (!PointFromIntegers(px, py, P)) return false;
+		FE256 scalar = ScalarFromInteger(k);
+		const Projective R = MultiplyPoint(P, scalar);
+		FE256_Wipe(&scalar, sizeof(scalar));
+		Element ax, ay;
+		if (!curve_.ToAffine(R, ax, ay)) return false;
+		x = curve_.Field().ToInteger(ax);
+		y = curve_.Field().ToInteger(ay);
+		return true;
+	}
+
+	bool Sign(Integer const& x, Integer const& k, Integer const& e, string& signature) const {
+		FE256 kPlain = ScalarFromInteger(k);
+		const Projective R = base_.Multiply(curve_, kPlain.v);
+		Element rx, ry;
+		FE256 r = {{0, 0, 0, 0}};
+		if (curve_.ToAffine(R, rx, ry)) r = FE256_ReduceOnce(curve_.Field().ToPlain(rx), S::Modulus());
+		if (FE256_IsZero(r)){
+			FE256_Wipe(&kPlain, sizeof(kPlain));
+			return false;
+		}
+		FE256 xPlain = ScalarFromInteger(x);
+		Scalar kM = scalars_.FromPlain(kPlain), xM = scalars_.FromPlain(xPlain);
+		Scalar sM = scalars_.Mul(scalars_.Inverse(kM), scalars_.Add(scalars_.FromPlain(RepresentativeFromInteger(e)), scalars_.Mul(xM, scalars_.FromPlain(r))));
+		const FE256 s = scalars_.ToPlain(sM);
+		FE256_Wipe(&kPlain, sizeof(kPlain));
+		FE256_Wipe(&xPlain, sizeof(xPlain));
+		FE256_Wipe(&kM, sizeof(kM));
+		FE256_Wipe(&xM, sizeof(xM));
+		FE256_Wipe(&sM, sizeof(sM));
+		if (FE256_IsZero(s)) return false;
+		EncodeSignature(r, s, signature);
+		return true;
+	}
+
+	bool Verify(Integer const& qx, Integer const& qy, Integer const& e, string const& signature) const {
+		if (signature.size() != 64) return false;
+		FE256 r, s;
+		FE256_LoadBE(r, (const byte*) signature.data());
+		FE256_LoadBE(s, (const byte*) signature.data() + 32);
+		if (FE256_IsZero(r) || FE256_IsZero(s) || !FE256_Less(r, S::Modulus()) || !FE256_Less(s, S::Modulus())) return false;
+		Projective Q;
+		if (!PointFromIntegers(qx, qy, Q)) return false;
+		const Scalar w = scalars_.Inverse(scalars_.FromPlain(s));
+		const FE256 u1 = scalars_.ToPlain(scalars_.Mul(scalars_.FromPlain(RepresentativeFromInteger(e)), w));
+		const FE256 u2 = scalars_.ToPlain(scalars_.Mul(scalars_.FromPlain(r), w));
+		const Projective R = curve_.Add(base_.Multiply(curve_, u1.v), MultiplyPoint(Q, u2));
+		Element rx, ry;
+		if (!curve_.ToAffine(R, rx, ry)) return false;
+		return FE256_Equal(FE256_ReduceOnce(curve_.Field().ToPlain(rx), S::Modulus()), r) != 0;
+	}
+
+	void SignBatch(Integer const& x, vector<Integer> const& k, vector<Integer> const& e, vector<string>& signatures) const {
+		const size_t n = k.size();
+		vector<Projective> points(n);
+		vector<Element> zInv(n);
+		vector<Scalar> kInv(n);
+		for (size_t i = 0; i < n; i++){
+			FE256 kPlain = ScalarFromInteger(k[i]);
+			points[i] = base_.Multiply(curve_, kPlain.v);
+			zInv[i] = points[i].Z;
+			kInv[i] = scalars_.FromPlain(kPlain);
+			FE256_Wipe(&kPlain, sizeof(kPlain));
+		}
+		//One field inversion for the nonce points, one scalar inversion for the nonces
+		BatchInverse(curve_.Field(), zInv);
+		BatchInverse(scalars_, kInv);
+		FE256 xPlain = ScalarFromInteger(x);
+		Scalar xM = scalars_.FromPlain(xPlain);
+		signatures.assign(n, string());
+		for (size_t i = 0; i < n; i++){
+			if (curve_.Field().IsZero(points[i].Z)) continue;
+			const FE256 r = FE256_ReduceOnce(curve_.Field().ToPlain(curve_.Field().Mul(points[i].X, zInv[i])), S::Modulus());
+			if (FE256_IsZero(r)) continue;
+			const FE256 s = scalars_.ToPlain(scalars_.Mul(kInv[i], scalars_.Add(scalars_.FromPlain(RepresentativeFromInteger(e[i])), scalars_.Mul(xM, scalars_.FromPlain(r)))));
+			if (FE256_IsZero(s)) continue;
+			EncodeSignature(r, s, signatures[i]);
+		}
+		FE256_Wipe(&xPlain, sizeof(xPlain));
+		FE256_Wipe(&xM, sizeof(xM));
+		if (n > 0) FE256_Wipe(&kInv[0], n * sizeof(Scalar));
+	}
+
+protected:
+	//k * P, for k reduced modulo the order
+	virtual Projective MultiplyPoint(Projective const& P, FE256 const& k) const {
+		return curve_.Multiply(P, k.v, 64);
+	}
+
+	FE256 ScalarFromInteger(Integer const& k) const {
+		return FE256_FromInteger(k % Order());
+	}
+
+	//Message representatives are at most 256 bits long (truncated digests), but may be above the order
+	static FE256 RepresentativeFromInteger(Integer const& e){
+		return FE256_ReduceOnce(FE256_FromInteger(e), S::Modulus());
+	}
+
+	bool PointFromIntegers(Integer const& px, Integer const& py, Projective& P) const {
+		if (px.IsNegative() || py.IsNegative() || px >= Modulus() || py >= Modulus()) return false;
+		const Element x = curve_.Field().FromPlain(FE256_FromInteger(px)), y = curve_.Field().FromPlain(FE256_FromInteger(py));
+		if (!curve_.IsOnCurve(x, y)) return false;
+		P = curve_.FromAffine(x, y);
+		return true;
+	}
+
+	static void EncodeSignature(FE256 const& r, FE256 const& s, string& signature){
+		signature.assign(64, '\0');
+		FE256_StoreBE((byte*) &signature[0], r);
+		FE256_StoreBE((byte*) &signature[32], s);
+	}
+
+	Curve curve_;
+	S scalars_;
+	CompleteFixedBaseTable<F> base_;
+};
+
+/*
+* secp256k1 : variable-base multiplications use the endomorphism (x, y) -> (beta * x, y), which multiplies points by lambda.
+* k is split into k1 + k2 * lambda with |k1|, |k2| < 2^128 (constants and method of libsecp256k1), halving the number of doublings
+*/
+class Secp256k1Impl : public FastECImpl<Secp256k1Field, Secp256k1Scalar> {
+public:
+	Secp256k1Impl() : FastECImpl<Secp256k1Field, Secp256k1Scalar>(Curve::A_ZERO, B(), Gx(), Gy()){}
+
+protected:
+	Projective MultiplyPoint(Projective const& P, FE256 const& k) const {
+		FE256 k1, k2;
+		uint64_t negative1, negative2;
+		SplitScalar(k, k1, negative1, k2, negative2);
+		Projective P1 = P, P2 = P;
+		curve_.CMov(P1, curve_.Negate(P), negative1);
+		static const FE256 beta = {{0xC1396C28719501EEULL, 0x9CF0497512F58995ULL, 0x6E64479EAC3434E9ULL, 0x7AE96A2B657C0710ULL}};
+		P2.X = curve_.Field().Mul(P.X, beta);
+		curve_.CMov(P2, curve_.Negate(P2), negative2);
+		Projective table1[16], table2[16];
+		curve_.BuildWindowTable(P1, table1);
+		curve_.BuildWindowTable(P2, table2);
+		const Projective* tables[2] = { table1, table2 };
+		const uint64_t* scalars[2] = { k1.v, k2.v };
+		//33 windows of 4 bits cover the 128-bit halves, with some margin
+		const Projective R = curve_.MultiplyTables(tables, scalars, 2, 33);
+		FE256_Wipe(&k1, sizeof(k1));
+		FE256_Wipe(&k2, sizeof(k2));
+		return R;
+	}
+
+private:
+	static FE256 B(){
+		FE256 b = {{7, 0, 0, 0}};
+		return b;
+	}
+	static FE256 Gx(){
+		FE256 gx = {{0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL}};
+		return gx;
+	}
+	static FE256 Gy(){
+		FE256 gy = {{0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL}};
+		return gy;
+	}
+
+	//round(k * g / 2^384)
+	static FE256 MulShift384(FE256 const& k, FE256 const& g){
+		uint64_t t[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+		for (int i = 0; i < 4; i++){
+			FE256_uint128 acc = 0;
+			for (int j = 0; j < 4; j++){
+				acc += (FE256_uint128) k.v[j] * g.v[i] + t[i + j];
+				t[i + j] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			t[i + 4] = (uint64_t) acc;
+		}
+		FE256_uint128 acc = (FE256_uint128) t[6] + (t[5] >> 63);
+		FE256 r;
+		r.v[0] = (uint64_t) acc;
+		r.v[1] = t[7] + (uint64_t) (acc >> 64);
+		r.v[2] = 0;
+		r.v[3] = 0;
+		FE256_Wipe(t, sizeof(t));
+		return r;
+	}
+
+	//a * b mod n, for plain values
+	FE256 MulPlain(FE256 const& a, FE256 const& b) const {
+		return scalars_.Mul(scalars_.FromPlain(a), b);
+	}
+
+	//k = (negative1 ? -k1 : k1) + (negative2 ? -k2 : k2) * lambda mod n
+	void SplitScalar(FE256 const& k, FE256& k1, uint64_t& negative1, FE256& k2, uint64_t& negative2) const {
+		static const FE256 g1 = {{0xE893209A45DBB031ULL, 0x3DAA8A1471E8CA7FULL, 0xE86C90E49284EB15ULL, 0x3086D221A7D46BCDULL}};
+		static const FE256 g2 = {{0x1571B4AE8AC47F71ULL, 0x221208AC9DF506C6ULL, 0x6F547FA90ABFE4C4ULL, 0xE4437ED6010E8828ULL}};
+		static const FE256 minusB1 = {{0x6F547FA90ABFE4C3ULL, 0xE4437ED6010E8828ULL, 0x0000000000000000ULL, 0x0000000000000000ULL}};
+		static const FE256 minusB2 = {{0xD765CDA83DB1562CULL, 0x8A280AC50774346DULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL}};
+		static const FE256 minusLambda = {{0xE0CFC810B51283CFULL, 0xA880B9FC8EC739C2ULL, 0x5AD9E3FD77ED9BA4ULL, 0xAC9C52B33FA3CF1FULL}};
+		static const FE256 halfOrder = {{0xDFE92F46681B20A0ULL, 0x5D576E7357A4501DULL, 0xFFFFFFFFFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL}};
+		const FE256 n = Secp256k1Scalar::Modulus();
+		FE256 c1 = MulShift384(k, g1), c2 = MulShift384(k, g2);
+		k2 = FE256_AddMod(MulPlain(c1, minusB1), MulPlain(c2, minusB2), n);
+		k1 = FE256_AddMod(MulPlain(k2, minusLambda), k, n);
+		//Values above n / 2 stand for negative ones
+		FE256 opposite;
+		negative1 = FE256_Less(halfOrder, k1);
+		FE256_SubRaw(opposite, n, k1);
+		FE256_CMov(k1, opposite, negative1);
+		negative2 = FE256_Less(halfOrder, k2);
+		FE256_SubRaw(opposite, n, k2);
+		FE256_CMov(k2, opposite, negative2);
+		FE256_Wipe(&c1, sizeof(c1));
+		FE256_Wipe(&c2, sizeof(c2));
+		FE256_Wipe(&opposite, sizeof(opposite));
+	}
+};
+
+static FE256 p256B(){
+	FE256 b = {{0x3BCE3C3E27D2604BULL, 0x651D06B0CC53B0F6ULL, 0xB3EBBD55769886BCULL, 0x5AC635D8AA3A93E7ULL}};
+	return b;
+}
+static FE256 p256Gx(){
+	FE256 gx = {{0xF4A13945D898C296ULL, 0x77037D812DEB33A0ULL, 0xF8BCE6E563A440F2ULL, 0x6B17D1F2E12C4247ULL}};
+	return gx;
+}
+static FE256 p256Gy(){
+	FE256 gy = {{0xCBB6406837BF51F5ULL, 0x2BCE33576B315ECEULL, 0x8EE7EB4A7C0F9E16ULL, 0x4FE342E2FE1A7F9BULL}};
+	return gy;
+}
+
+//Both instances (and their fixed-base tables) are built on first use, and kept for the lifetime of the process
+static uv_once_t instancesOnce = UV_ONCE_INIT;
+static FastEC* secp256r1Instance = 0;
+static FastEC* secp256k1Instance = 0;
+
+static void initInstances(){
+	secp256r1Instance = new FastECImpl<P256Field, P256Scalar>(CompleteCurve<P256Field>::A_MINUS_3, p256B(), p256Gx(), p256Gy());
+	secp256k1Instance = new Secp256k1Impl();
+}
+
+FastEC const* FastEC::For(OID const& curve){
+	if (!(curve == CryptoPP::ASN1::secp256r1() || curve == CryptoPP::ASN1::secp256k1())) return 0;
+	uv_once(&instancesOnce, initInstances);
+	return curve == CryptoPP::ASN1::secp256r1() ? secp256r1Instance : secp256k1Instance;
+}
+
+FastEC const* FastEC::For(DL_GroupParameters_EC<ECP> const& params){
+	uv_once(&instancesOnce, initInstances);
+	const Integer& p = params.GetCurve().GetField().GetModulus();
+	const Integer& n = params.GetSubgroupOrder();
+	if (p == secp256r1Instance->Modulus() && n == secp256r1Instance->Order()) return secp256r1Instance;
+	if (p == secp256k1Instance->Modulus() && n == secp256k1Instance->Order()) return secp256k1Instance;
+	return 0;
+}
+
+#else
+
+FastEC const* FastEC::For(OID const& curve){
+	return 0;
+}
+
+FastEC const* FastEC::For(DL_GroupParameters_EC<ECP> const& params){
+	return 0;
+}
+
+#endif
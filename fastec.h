@@ -0,0 +1,211 @@
+#ifndef FASTEC_H
+#define FASTEC_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::ECPPoint;
+using CryptoPP::DL_GroupParameters_EC;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+using CryptoPP::RandomNumberGenerator;
+#include <cryptopp/sha.h>
+using CryptoPP::SHA1;
+#include <cryptopp/hmac.h>
+using CryptoPP::HMAC;
+#include <cryptopp/pubkey.h>
+using CryptoPP::P1363_KDF2;
+#include <cryptopp/misc.h>
+using CryptoPP::xorbuf;
+using CryptoPP::VerifyBufsEqual;
+
+#include "rfc6979.h"
+
+/*
+* Dedicated implementations of secp256r1 and secp256k1, used instead of Crypto++'s generic ECP code for ECDSA, ECDH and ECIES on these two curves.
+* Field elements and scalars are fixed-size arrays of 4 64-bit limbs (fe256.h) with special reductions for both primes; points use the complete
+* formulas of ecmath.h and secret scalars are processed in constant time. secp256k1 variable-base multiplications use the GLV endomorphism.
+* Outputs are the same as Crypto++'s (signature layout, ECDH secrets, ECIES ciphertexts), so keys and messages are interchangeable.
+* FastEC::For() returns 0 for the other curves, and for every curve when the compiler has no 128-bit integer type : callers then use Crypto++.
+* The instances are immutable once built, and can be used from any thread.
+*/
+class FastEC {
+public:
+	typedef Integer Coordinate;
+	typedef ECPPoint Point;
+
+	static FastEC const* For(OID const& curve);
+	static FastEC const* For(DL_GroupParameters_EC<ECP> const& params);
+
+	virtual ~FastEC(){}
+	//Subgroup order
+	Integer const& Order() const { return order_; }
+	Integer const& Modulus() const { return modulus_; }
+	//Length in bytes of field elements and scalars
+	size_t Length() const { return 32; }
+
+	//(x, y) = k * G
+	virtual void MultiplyBase(Integer const& k, Integer& x, Integer& y) const = 0;
+	//(x, y) = k * (px, py). Returns false if (px, py) isn't a point of the curve, or if the result is the point at infinity
+	virtual bool Multiply(Integer const& k, Integer const& px, Integer const& py, Integer& x, Integer& y) const = 0;
+	//ECDSA signature (r || s) with the nonce k and the message representative e. Returns false if r or s turns out to be 0
+	virtual bool Sign(Integer const& x, Integer const& k, Integer const& e, std::string& signature) const = 0;
+	virtual bool Verify(Integer const& qx, Integer const& qy, Integer const& e, std::string const& signature) const = 0;
+	//Same as ECDSA_BatchSignWithNonces (ecbatch.h)
+	virtual void SignBatch(Integer const& x, std::vector<Integer> const& k, std::vector<Integer> const& e, std::vector<std::string>& signatures) const = 0;
+
+protected:
+	FastEC(Integer const& modulus, Integer const& order) : modulus_(modulus), order_(order){}
+
+private:
+	Integer modulus_, order_;
+};
+
+/*
+* ECDSA, ECDH and ECIES on top of an engine E : FastEC, or FastEC2N (fastec2n.h) for binary curves. E provides Order(), Length() (bytes per field element),
+* MultiplyBase(), Multiply(), Sign() and Verify(), with E::Coordinate coordinates (Integer or PolynomialMod2) and E::Point public points.
+* Every function returns false, without doing anything, when the curve has no fast implementation (fast is 0).
+*/
+
+//Random private exponent in [1, n - 1] and its public point
+template <class E>
+bool FastEC_GenerateKeyPair(E const* fast, RandomNumberGenerator& rng, Integer& privateExponent, typename E::Point& publicElement){
+	if (fast == 0) return false;
+	privateExponent.Randomize(rng, Integer::One(), fast->Order() - 1);
+	fast->MultiplyBase(privateExponent, publicElement.x, publicElement.y);
+	publicElement.identity = false;
+	return true;
+}
+
+template <class H, class E>
+bool FastECDSA_Sign(E const* fast, Integer const& x, std::string const& message, bool deterministic, std::string& signature){
+	if (fast == 0) return false;
+	const Integer& q = fast->Order();
+	byte digest[H::DIGESTSIZE];
+	H().CalculateDigest(digest, (const byte*) message.data(), message.size());
+	const Integer e = RFC6979_bits2int(digest, sizeof(digest), q.BitCount());
+	if (deterministic){
+		RFC6979_NonceGenerator<H> generator(q, x, digest, sizeof(digest));
+		while (!fast->Sign(x, generator.NextK(), e, signature));
+	} else {
+		AutoSeededRandomPool prng;
+		Integer k;
+		do {
+			k.Randomize(prng, Integer::One(), q - 1);
+		} while (!fast->Sign(x, k, e, signature));
+	}
+	return true;
+}
+
+//signature is the raw r || s
+template <class H, class E>
+bool FastECDSA_Verify(E const* fast, typename E::Point const& publicElement, std::string const& message, std::string const& signature, bool& valid){
+	if (fast == 0) return false;
+	byte digest[H::DIGESTSIZE];
+	H().CalculateDigest(digest, (const byte*) message.data(), message.size());
+	const Integer e = RFC6979_bits2int(digest, sizeof(digest), fast->Order().BitCount());
+	valid = fast->Verify(publicElement.x, publicElement.y, e, signature);
+	return true;
+}
+
+/*
+* ECDH, with Crypto++'s encodings : private keys are big endian integers as long as the order, public keys are uncompressed points (04 || x || y)
+* and the secret is the x coordinate of the shared point.
+*/
+template <class E>
+bool FastECDH_GenerateKeyPair(E const* fast, RandomNumberGenerator& rng, SecByteBlock& privateKey, SecByteBlock& publicKey){
+	Integer x;
+	typename E::Point Q;
+	if (!FastEC_GenerateKeyPair(fast, rng, x, Q)) return false;
+	const size_t length = fast->Length();
+	privateKey.New(fast->Order().ByteCount());
+	x.Encode(privateKey.BytePtr(), privateKey.size());
+	publicKey.New(1 + 2 * length);
+	publicKey[0] = 0x04;
+	Q.x.Encode(publicKey.BytePtr() + 1, length);
+	Q.y.Encode(publicKey.BytePtr() + 1 + length, length);
+	return true;
+}
+
+//Also returns false when the public key is invalid, or isn't an uncompressed point
+template <class E>
+bool FastECDH_Agree(E const* fast, SecByteBlock const& privateKey, SecByteBlock const& publicKey, SecByteBlock& secret){
+	if (fast == 0) return false;
+	const size_t length = fast->Length();
+	if (publicKey.size() != 1 + 2 * length || publicKey[0] != 0x04) return false;
+	const Integer x(privateKey.BytePtr(), privateKey.size());
+	const typename E::Coordinate px(publicKey.BytePtr() + 1, length), py(publicKey.BytePtr() + 1 + length, length);
+	typename E::Coordinate sx, sy;
+	if (!fast->Multiply(x, px, py, sx, sy)) return false;
+	secret.New(length);
+	sx.Encode(secret.BytePtr(), length);
+	return true;
+}
+
+/*
+* ECIES, compatible with Crypto++'s ECIES<ECP> and ECIES<EC2N> (P1363 KDF2 with SHA1, XOR encryption, HMAC-SHA1, no DHAES mode).
+* Ciphertext : ephemeral public point (04 || x || y) || encrypted message || MAC.
+*/
+//Length of the HMAC key derived with the XOR key stream, and length of the tag
+static const size_t FASTECIES_MAC_KEY_LENGTH = HMAC<SHA1>::DEFAULT_KEYLENGTH;
+static const size_t FASTECIES_TAG_LENGTH = HMAC<SHA1>::DIGESTSIZE;
+
+//Also returns false when the public key isn't a point of the curve
+template <class E>
+bool FastECIES_Encrypt(E const* fast, RandomNumberGenerator& rng, typename E::Point const& publicElement, std::string const& plainText, std::string& cipherText){
+	if (fast == 0) return false;
+	const size_t length = fast->Length();
+	const Integer k(rng, Integer::One(), fast->Order() - 1);
+	typename E::Coordinate vx, vy, zx, zy;
+	if (!fast->Multiply(k, publicElement.x, publicElement.y, zx, zy)) return false;
+	fast->MultiplyBase(k, vx, vy);
+	ArenaByteBlock z(length), key(plainText.size() + FASTECIES_MAC_KEY_LENGTH);
+	zx.Encode(z.BytePtr(), length);
+	P1363_KDF2<SHA1>::DeriveKey(key.BytePtr(), key.size(), z.BytePtr(), z.size(), 0, 0);
+	cipherText.assign(1 + 2 * length + plainText.size() + FASTECIES_TAG_LENGTH, '\0');
+	byte* out = (byte*) &cipherText[0];
+	out[0] = 0x04;
+	vx.Encode(out + 1, length);
+	vy.Encode(out + 1 + length, length);
+	byte* encrypted = out + 1 + 2 * length;
+	if (!plainText.empty()) xorbuf(encrypted, (const byte*) plainText.data(), key.BytePtr(), plainText.size());
+	HMAC<SHA1> mac(key.BytePtr() + plainText.size(), FASTECIES_MAC_KEY_LENGTH);
+	mac.Update(encrypted, plainText.size());
+	mac.Final(encrypted + plainText.size());
+	return true;
+}
+
+//Also returns false when the ciphertext is malformed or doesn't authenticate
+template <class E>
+bool FastECIES_Decrypt(E const* fast, Integer const& privateExponent, std::string const& cipherText, std::string& plainText){
+	if (fast == 0) return false;
+	const size_t length = fast->Length();
+	if (cipherText.size() < 1 + 2 * length + FASTECIES_TAG_LENGTH || cipherText[0] != 0x04) return false;
+	const byte* in = (const byte*) cipherText.data();
+	const typename E::Coordinate vx(in + 1, length), vy(in + 1 + length, length);
+	typename E::Coordinate zx, zy;
+	if (!fast->Multiply(privateExponent, vx, vy, zx, zy)) return false;
+	const byte* encrypted = in + 1 + 2 * length;
+	const size_t plainTextLength = cipherText.size() - 1 - 2 * length - FASTECIES_TAG_LENGTH;
+	ArenaByteBlock z(length), key(plainTextLength + FASTECIES_MAC_KEY_LENGTH);
+	zx.Encode(z.BytePtr(), length);
+	P1363_KDF2<SHA1>::DeriveKey(key.BytePtr(), key.size(), z.BytePtr(), z.size(), 0, 0);
+	byte tag[FASTECIES_TAG_LENGTH];
+	HMAC<SHA1> mac(key.BytePtr() + plainTextLength, FASTECIES_MAC_KEY_LENGTH);
+	mac.Update(encrypted, plainTextLength);
+	mac.Final(tag);
+	if (!VerifyBufsEqual(tag, encrypted + plainTextLength, FASTECIES_TAG_LENGTH)) return false;
+	plainText.assign(plainTextLength, '\0');
+	if (plainTextLength > 0) xorbuf((byte*) &plainText[0], encrypted, key.BytePtr(), plainTextLength);
+	return true;
+}
+
+#endif
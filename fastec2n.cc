@@ -0,0 +1,207 @@
+#include <map>
+
+#include <uv.h>
+
+#include <cryptopp/filters.h>
+using CryptoPP::StringSink;
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+#include "fastec2n.h"
+#include "secarena.h"
+
+using namespace std;
+
+FastEC2N::FastEC2N(DL_GroupParameters_EC<EC2N> const& params, unsigned int m, vector<unsigned int> const& exponents) : field_(m, exponents),
+	order_(params.GetSubgroupOrder()), cofactor_(params.GetCofactor() > Integer::One()){
+	const EC2N& curve = params.GetCurve();
+	const EC2NPoint& G = params.GetSubgroupGenerator();
+	field_.FromPolynomial(curve.GetA(), a_);
+	field_.FromPolynomial(curve.GetB(), b_);
+	field_.FromPolynomial(G.x, gx_);
+	field_.FromPolynomial(G.y, gy_);
+}
+
+//y^2 + xy = x^3 + ax^2 + b, as y(y + x) = x^2(x + a) + b
+bool FastEC2N::OnCurve(GF2mElement const& x, GF2mElement const& y) const {
+	const GF2mElement left = field_.Mul(y, field_.Add(y, x));
+	const GF2mElement right = field_.Add(field_.Mul(field_.Sqr(x), field_.Add(x, a_)), b_);
+	return field_.Equal(left, right);
+}
+
+/*
+* Montgomery ladder (Lopez and Dahab, "Fast multiplication on elliptic curves over GF(2^m) without precomputation", CHES 1999).
+* R1 = (X1 : Z1) and R2 = (X2 : Z2) start at the point at infinity (1 : 0) and at P, and R2 - R1 = P all along :
+* R1 + R2 has X = x * Z + X1 Z2 X2 Z1 and Z = (X1 Z2 + X2 Z1)^2, 2 R1 has X = X1^4 + b Z1^4 and Z = X1^2 Z1^2.
+* At the end, R1 = kP and R2 = (k + 1)P give the y coordinate of kP.
+*/
+FastEC2N::AffinePoint FastEC2N::Ladder(Integer const& k, unsigned int bits, GF2mElement const& x, GF2mElement const& y) const {
+	const size_t bytes = (bits + 7) / 8;
+	ArenaByteBlock scalar(bytes);
+	k.Encode(scalar.BytePtr(), bytes);
+	GF2mElement X1 = field_.One(), Z1 = field_.Zero(), X2 = x, Z2 = field_.One();
+	for (unsigned int i = bits; i-- > 0;){
+		const uint64_t bit = (scalar[bytes - 1 - i / 8] >> (i % 8)) & 1;
+		field_.CSwap(X1, X2, bit);
+		field_.CSwap(Z1, Z2, bit);
+		const GF2mElement T1 = field_.Mul(X1, Z2), T2 = field_.Mul(X2, Z1);
+		Z2 = field_.Sqr(field_.Add(T1, T2));
+		X2 = field_.Add(field_.Mul(x, Z2), field_.Mul(T1, T2));
+		const GF2mElement XX = field_.Sqr(X1), ZZ = field_.Sqr(Z1);
+		Z1 = field_.Mul(XX, ZZ);
+		X1 = field_.Add(field_.Sqr(XX), field_.Mul(b_, field_.Sqr(ZZ)));
+		field_.CSwap(X1, X2, bit);
+		field_.CSwap(Z1, Z2, bit);
+	}
+	AffinePoint R;
+	R.infinity = field_.IsZero(Z1);
+	if (R.infinity){
+		R.x = field_.Zero();
+		R.y = field_.Zero();
+	} else if (field_.IsZero(Z2)){
+		//kP = -P
+		R.x = x;
+		R.y = field_.Add(x, y);
+	} else {
+		//x_k = X1 / Z1, y_k = (x + x_k)((X1 + x Z1)(X2 + x Z2) + (x^2 + y) Z1 Z2) / (x Z1 Z2) + y, with one inversion
+		const GF2mElement Z1Z2 = field_.Mul(Z1, Z2);
+		const GF2mElement inverse = field_.Inverse(field_.Mul(x, Z1Z2));
+		R.x = field_.Mul(field_.Mul(field_.Mul(X1, Z2), x), inverse);
+		GF2mElement t = field_.Mul(field_.Add(X1, field_.Mul(x, Z1)), field_.Add(X2, field_.Mul(x, Z2)));
+		t = field_.Add(t, field_.Mul(field_.Add(field_.Sqr(x), y), Z1Z2));
+		R.y = field_.Add(field_.Mul(field_.Mul(field_.Add(x, R.x), t), inverse), y);
+	}
+	SecureWipeArray(X1.v, GF2M_MAX_WORDS);
+	SecureWipeArray(Z1.v, GF2M_MAX_WORDS);
+	SecureWipeArray(X2.v, GF2M_MAX_WORDS);
+	SecureWipeArray(Z2.v, GF2M_MAX_WORDS);
+	return R;
+}
+
+//Affine addition, only used on public points (ECDSA verification)
+FastEC2N::AffinePoint FastEC2N::Add(AffinePoint const& P, AffinePoint const& Q) const {
+	if (P.infinity) return Q;
+	if (Q.infinity) return P;
+	AffinePoint R;
+	R.infinity = false;
+	GF2mElement lambda;
+	if (field_.Equal(P.x, Q.x)){
+		//-P = (x, x + y)
+		if (field_.Equal(Q.y, field_.Add(P.x, P.y))){
+			R.infinity = true;
+			R.x = field_.Zero();
+			R.y = field_.Zero();
+			return R;
+		}
+		//Doubling : lambda = x + y / x, x3 = lambda^2 + lambda + a, y3 = x^2 + (lambda + 1) x3
+		lambda = field_.Add(P.x, field_.Mul(P.y, field_.Inverse(P.x)));
+		R.x = field_.Add(field_.Add(field_.Sqr(lambda), lambda), a_);
+		R.y = field_.Add(field_.Sqr(P.x), field_.Mul(field_.Add(lambda, field_.One()), R.x));
+		return R;
+	}
+	//lambda = (y1 + y2) / (x1 + x2), x3 = lambda^2 + lambda + x1 + x2 + a, y3 = lambda (x1 + x3) + x3 + y1
+	const GF2mElement sx = field_.Add(P.x, Q.x);
+	lambda = field_.Mul(field_.Add(P.y, Q.y), field_.Inverse(sx));
+	R.x = field_.Add(field_.Add(field_.Add(field_.Sqr(lambda), lambda), sx), a_);
+	R.y = field_.Add(field_.Add(field_.Mul(lambda, field_.Add(P.x, R.x)), R.x), P.y);
+	return R;
+}
+
+bool FastEC2N::Validate(PolynomialMod2 const& px, PolynomialMod2 const& py, GF2mElement& x, GF2mElement& y) const {
+	if (!field_.FromPolynomial(px, x) || !field_.FromPolynomial(py, y)) return false;
+	//(0, sqrt(b)) has order 2, and the ladder can't recover y from x = 0
+	if (field_.IsZero(x) || !OnCurve(x, y)) return false;
+	return !cofactor_ || Ladder(order_, order_.BitCount(), x, y).infinity;
+}
+
+Integer FastEC2N::XToInteger(GF2mElement const& x) const {
+	byte buffer[8 * GF2M_MAX_WORDS];
+	field_.Encode(buffer, x);
+	return Integer(buffer, field_.ByteLength()) % order_;
+}
+
+void FastEC2N::MultiplyBase(Integer const& k, PolynomialMod2& x, PolynomialMod2& y) const {
+	const AffinePoint R = Ladder(k % order_, order_.BitCount(), gx_, gy_);
+	x = field_.ToPolynomial(R.x);
+	y = field_.ToPolynomial(R.y);
+}
+
+bool FastEC2N::Multiply(Integer const& k, PolynomialMod2 const& px, PolynomialMod2 const& py, PolynomialMod2& x, PolynomialMod2& y) const {
+	GF2mElement ex, ey;
+	if (!Validate(px, py, ex, ey)) return false;
+	const AffinePoint R = Ladder(k % order_, order_.BitCount(), ex, ey);
+	if (R.infinity) return false;
+	x = field_.ToPolynomial(R.x);
+	y = field_.ToPolynomial(R.y);
+	return true;
+}
+
+bool FastEC2N::Sign(Integer const& x, Integer const& k, Integer const& e, string& signature) const {
+	const Integer kReduced = k % order_;
+	const AffinePoint R = Ladder(kReduced, order_.BitCount(), gx_, gy_);
+	if (R.infinity) return false;
+	const Integer r = XToInteger(R.x);
+	if (r.IsZero()) return false;
+	const Integer s = (kReduced.InverseMod(order_) * (e + x * r)) % order_;
+	if (s.IsZero()) return false;
+	const size_t length = order_.ByteCount();
+	signature.assign(2 * length, '\0');
+	r.Encode((byte*) &signature[0], length);
+	s.Encode((byte*) &signature[length], length);
+	return true;
+}
+
+bool FastEC2N::Verify(PolynomialMod2 const& qx, PolynomialMod2 const& qy, Integer const& e, string const& signature) const {
+	const size_t length = order_.ByteCount();
+	if (signature.size() != 2 * length) return false;
+	const Integer r((const byte*) signature.data(), length), s((const byte*) signature.data() + length, length);
+	if (r.IsZero() || s.IsZero() || r >= order_ || s >= order_) return false;
+	GF2mElement x, y;
+	if (!Validate(qx, qy, x, y)) return false;
+	const Integer w = s.InverseMod(order_);
+	const Integer u1 = (e * w) % order_, u2 = (r * w) % order_;
+	const unsigned int bits = order_.BitCount();
+	const AffinePoint R = Add(Ladder(u1, bits, gx_, gy_), Ladder(u2, bits, x, y));
+	if (R.infinity) return false;
+	return XToInteger(R.x) == r;
+}
+
+void FastEC2N::SignBatch(Integer const& x, vector<Integer> const& k, vector<Integer> const& e, vector<string>& signatures) const {
+	signatures.assign(k.size(), string());
+	for (size_t i = 0; i < k.size(); i++){
+		if (!Sign(x, k[i], e[i], signatures[i])) signatures[i].clear();
+	}
+}
+
+//Instances are built on first use, and kept for the lifetime of the process. The key is the curve's DER encoded OID; unsupported curves map to 0
+static uv_once_t instancesOnce = UV_ONCE_INIT;
+static uv_mutex_t instancesMutex;
+static map<string, FastEC2N*> instances;
+
+static void initInstancesMutex(){
+	uv_mutex_init(&instancesMutex);
+}
+
+FastEC2N const* FastEC2N::For(OID const& curve){
+	string key;
+	StringSink keySink(key);
+	curve.DEREncode(keySink);
+	uv_once(&instancesOnce, initInstancesMutex);
+	uv_mutex_lock(&instancesMutex);
+	map<string, FastEC2N*>::iterator entry = instances.find(key);
+	if (entry == instances.end()){
+		FastEC2N* instance = 0;
+		try {
+			DL_GroupParameters_EC<EC2N> params(curve);
+			unsigned int m;
+			vector<unsigned int> exponents;
+			if (GF2mField::FromPolynomial(params.GetCurve().GetField().GetModulus(), m, exponents)) instance = new FastEC2N(params, m, exponents);
+		} catch (CryptoPP::Exception const& e){
+			//Not a binary curve
+		}
+		entry = instances.insert(make_pair(key, instance)).first;
+	}
+	FastEC2N const* instance = entry->second;
+	uv_mutex_unlock(&instancesMutex);
+	return instance;
+}
@@ -0,0 +1,74 @@
+#ifndef FASTEC2N_H
+#define FASTEC2N_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/gf2n.h>
+using CryptoPP::PolynomialMod2;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::EC2N;
+using CryptoPP::EC2NPoint;
+using CryptoPP::DL_GroupParameters_EC;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+
+#include "gf2m.h"
+
+/*
+* Binary curves (y^2 + xy = x^3 + ax^2 + b over GF(2^m), the sect* curves), used instead of Crypto++'s EC2N for ECDSA, ECDH and ECIES.
+* Field arithmetic is in gf2m.h. Multiplications are Montgomery ladders on x-only Lopez-Dahab coordinates, with the same sequence of operations
+* for every scalar of a curve, and y is recovered at the end with a single inversion. Scalars are reduced with Crypto++'s Integer.
+* It has the same interface as FastEC (fastec.h), with polynomials for coordinates, so the ECDSA, ECDH and ECIES templates of fastec.h work with both.
+* Outputs are the same as Crypto++'s. FastEC2N::For() returns 0 when the field polynomial isn't supported by GF2mField.
+* The instances are immutable once built, and can be used from any thread.
+*/
+class FastEC2N {
+public:
+	typedef PolynomialMod2 Coordinate;
+	typedef EC2NPoint Point;
+
+	static FastEC2N const* For(OID const& curve);
+
+	//Subgroup order
+	Integer const& Order() const { return order_; }
+	//Length in bytes of field elements
+	size_t Length() const { return field_.ByteLength(); }
+
+	//(x, y) = k * G
+	void MultiplyBase(Integer const& k, PolynomialMod2& x, PolynomialMod2& y) const;
+	//(x, y) = k * (px, py). Returns false if (px, py) isn't a point of the subgroup, or if the result is the point at infinity
+	bool Multiply(Integer const& k, PolynomialMod2 const& px, PolynomialMod2 const& py, PolynomialMod2& x, PolynomialMod2& y) const;
+	//ECDSA signature (r || s, each as long as the order) with the nonce k and the message representative e. Returns false if r or s turns out to be 0
+	bool Sign(Integer const& x, Integer const& k, Integer const& e, std::string& signature) const;
+	bool Verify(PolynomialMod2 const& qx, PolynomialMod2 const& qy, Integer const& e, std::string const& signature) const;
+	//Signs with each nonce in turn (see ECDSA_BatchSignWithNonces, ecbatch.h)
+	void SignBatch(Integer const& x, std::vector<Integer> const& k, std::vector<Integer> const& e, std::vector<std::string>& signatures) const;
+
+private:
+	FastEC2N(DL_GroupParameters_EC<EC2N> const& params, unsigned int m, std::vector<unsigned int> const& exponents);
+
+	//Affine point, the point at infinity having infinity set
+	struct AffinePoint {
+		GF2mElement x, y;
+		bool infinity;
+	};
+
+	bool OnCurve(GF2mElement const& x, GF2mElement const& y) const;
+	//k * (x, y) for 0 <= k < 2^bits, (x, y) being a point of the curve other than (0, sqrt(b)). Only bits decides the sequence of operations
+	AffinePoint Ladder(Integer const& k, unsigned int bits, GF2mElement const& x, GF2mElement const& y) const;
+	AffinePoint Add(AffinePoint const& P, AffinePoint const& Q) const;
+	//Checks the coordinates, that the point is on the curve and, for curves with a cofactor, that it is in the subgroup
+	bool Validate(PolynomialMod2 const& px, PolynomialMod2 const& py, GF2mElement& x, GF2mElement& y) const;
+	//x mod n
+	Integer XToInteger(GF2mElement const& x) const;
+
+	GF2mField field_;
+	GF2mElement a_, b_, gx_, gy_;
+	Integer order_;
+	bool cofactor_;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef FE25519_H
+#define FE25519_H
+
+/*
+* Arithmetic modulo p = 2^255 - 19, for X25519 and Ed25519 (curve25519.cc). Elements are 5 limbs of 51 bits (radix 2^51), so that
+* products of limbs and their sums fit in 128-bit integers and carries can be delayed. Every operation runs in constant time.
+* Limbs are kept below 2^52 between operations. Needs a compiler with 128-bit integers; FE25519_AVAILABLE is left undefined otherwise.
+*/
+
+#if defined(__SIZEOF_INT128__)
+#define FE25519_AVAILABLE
+
+#include <stdint.h>
+
+#include <cryptopp/config.h>
+
+typedef unsigned __int128 FE25519_uint128;
+
+struct FE25519 {
+	uint64_t v[5];
+};
+
+static const uint64_t FE25519_MASK = ((uint64_t) 1 << 51) - 1;
+
+inline void FE25519_Carry(FE25519& a){
+	for (int i = 0; i < 4; i++){
+		a.v[i + 1] += a.v[i] >> 51;
+		a.v[i] &= FE25519_MASK;
+	}
+	a.v[0] += 19 * (a.v[4] >> 51);
+	a.v[4] &= FE25519_MASK;
+}
+
+inline FE25519 FE25519_Zero(){
+	FE25519 r = {{0, 0, 0, 0, 0}};
+	return r;
+}
+
+inline FE25519 FE25519_One(){
+	FE25519 r = {{1, 0, 0, 0, 0}};
+	return r;
+}
+
+//32 bytes, little endian. The top bit is ignored, and values above p are accepted (they're reduced by the next operations)
+inline FE25519 FE25519_FromBytes(const byte* in){
+	uint64_t w[4];
+	for (int i = 0; i < 4; i++){
+		w[i] = 0;
+		for (int j = 7; j >= 0; j--) w[i] = (w[i] << 8) | in[8 * i + j];
+	}
+	FE25519 r;
+	r.v[0] = w[0] & FE25519_MASK;
+	r.v[1] = ((w[0] >> 51) | (w[1] << 13)) & FE25519_MASK;
+	r.v[2] = ((w[1] >> 38) | (w[2] << 26)) & FE25519_MASK;
+	r.v[3] = ((w[2] >> 25) | (w[3] << 39)) & FE25519_MASK;
+	r.v[4] = (w[3] >> 12) & FE25519_MASK;
+	return r;
+}
+
+//Canonical (fully reduced) little endian encoding
+inline void FE25519_ToBytes(byte* out, FE25519 const& a){
+	FE25519 t = a;
+	FE25519_Carry(t);
+	FE25519_Carry(t);
+	//t is now below 2^255 + 19 : adding 19 and carrying tells whether it is at least p
+	t.v[0] += 19;
+	FE25519_Carry(t);
+	//Subtracting the 19 back, offset by 2^255 so that no limb goes negative, and dropping that offset
+	t.v[0] += FE25519_MASK + 1 - 19;
+	for (int i = 1; i < 5; i++) t.v[i] += FE25519_MASK;
+	for (int i = 0; i < 4; i++){
+		t.v[i + 1] += t.v[i] >> 51;
+		t.v[i] &= FE25519_MASK;
+	}
+	t.v[4] &= FE25519_MASK;
+	const uint64_t w[4] = {
+		t.v[0] | (t.v[1] << 51),
+		(t.v[1] >> 13) | (t.v[2] << 38),
+		(t.v[2] >> 26) | (t.v[3] << 25),
+		(t.v[3] >> 39) | (t.v[4] << 12)
+	};
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 8; j++) out[8 * i + j] = (byte) (w[i] >> (8 * j));
+	}
+}
+
+inline FE25519 FE25519_Add(FE25519 const& a, FE25519 const& b){
+	FE25519 r;
+	for (int i = 0; i < 5; i++) r.v[i] = a.v[i] + b.v[i];
+	FE25519_Carry(r);
+	return r;
+}
+
+//a + 2p - b, so that limbs don't go negative
+inline FE25519 FE25519_Sub(FE25519 const& a, FE25519 const& b){
+	FE25519 r;
+	r.v[0] = a.v[0] + 0xFFFFFFFFFFFDAULL - b.v[0];
+	for (int i = 1; i < 5; i++) r.v[i] = a.v[i] + 0xFFFFFFFFFFFFEULL - b.v[i];
+	FE25519_Carry(r);
+	return r;
+}
+
+inline FE25519 FE25519_Neg(FE25519 const& a){
+	return FE25519_Sub(FE25519_Zero(), a);
+}
+
+//Carries the 128-bit column sums of a product into a reduced element
+inline FE25519 FE25519_Reduce(FE25519_uint128 c[5]){
+	FE25519 r;
+	for (int i = 0; i < 4; i++){
+		c[i + 1] += (uint64_t) (c[i] >> 51);
+		r.v[i] = (uint64_t) c[i] & FE25519_MASK;
+	}
+	r.v[4] = (uint64_t) c[4] & FE25519_MASK;
+	r.v[0] += 19 * (uint64_t) (c[4] >> 51);
+	r.v[1] += r.v[0] >> 51;
+	r.v[0] &= FE25519_MASK;
+	return r;
+}
+
+inline FE25519 FE25519_Mul(FE25519 const& a, FE25519 const& b){
+	const uint64_t b1 = 19 * b.v[1], b2 = 19 * b.v[2], b3 = 19 * b.v[3], b4 = 19 * b.v[4];
+	FE25519_uint128 c[5];
+	c[0] = (FE25519_uint128) a.v[0] * b.v[0] + (FE25519_uint128) a.v[1] * b4 + (FE25519_uint128) a.v[2] * b3 + (FE25519_uint128) a.v[3] * b2 + (FE25519_uint128) a.v[4] * b1;
+	c[1] = (FE25519_uint128) a.v[0] * b.v[1] + (FE25519_uint128) a.v[1] * b.v[0] + (FE25519_uint128) a.v[2] * b4 + (FE25519_uint128) a.v[3] * b3 + (FE25519_uint128) a.v[4] * b2;
+	c[2] = (FE25519_uint128) a.v[0] * b.v[2] + (FE25519_uint128) a.v[1] * b.v[1] + (FE25519_uint128) a.v[2] * b.v[0] + (FE25519_uint128) a.v[3] * b4 + (FE25519_uint128) a.v[4] * b3;
+	c[3] = (FE25519_uint128) a.v[0] * b.v[3] + (FE25519_uint128) a.v[1] * b.v[2] + (FE25519_uint128) a.v[2] * b.v[1] + (FE25519_uint128) a.v[3] * b.v[0] + (FE25519_uint128) a.v[4] * b4;
+	c[4] = (FE25519_uint128) a.v[0] * b.v[4] + (FE25519_uint128) a.v[1] * b.v[3] + (FE25519_uint128) a.v[2] * b.v[2] + (FE25519_uint128) a.v[3] * b.v[1] + (FE25519_uint128) a.v[4] * b.v[0];
+	return FE25519_Reduce(c);
+}
+
+inline FE25519 FE25519_Sqr(FE25519 const& a){
+	const uint64_t d0 = 2 * a.v[0], d1 = 2 * a.v[1], d2 = 38 * a.v[2], d3 = 19 * a.v[3], d4 = 38 * a.v[4];
+	FE25519_uint128 c[5];
+	c[0] = (FE25519_uint128) a.v[0] * a.v[0] + (FE25519_uint128) d1 * (19 * a.v[4]) + (FE25519_uint128) d2 * a.v[3];
+	c[1] = (FE25519_uint128) d0 * a.v[1] + (FE25519_uint128) d2 * a.v[4] + (FE25519_uint128) d3 * a.v[3];
+	c[2] = (FE25519_uint128) d0 * a.v[2] + (FE25519_uint128) a.v[1] * a.v[1] + (FE25519_uint128) d4 * a.v[3];
+	c[3] = (FE25519_uint128) d0 * a.v[3] + (FE25519_uint128) d1 * a.v[2] + (FE25519_uint128) (19 * a.v[4]) * a.v[4];
+	c[4] = (FE25519_uint128) d0 * a.v[4] + (FE25519_uint128) d1 * a.v[3] + (FE25519_uint128) a.v[2] * a.v[2];
+	return FE25519_Reduce(c);
+}
+
+//a^(2^n)
+inline FE25519 FE25519_SqrN(FE25519 const& a, int n){
+	FE25519 r = FE25519_Sqr(a);
+	for (int i = 1; i < n; i++) r = FE25519_Sqr(r);
+	return r;
+}
+
+//a * 121665, the (A - 2) / 4 constant of the X25519 ladder
+inline FE25519 FE25519_Mul121665(FE25519 const& a){
+	FE25519_uint128 c[5];
+	for (int i = 0; i < 5; i++) c[i] = (FE25519_uint128) a.v[i] * 121665;
+	return FE25519_Reduce(c);
+}
+
+//Shared part of the inversion and square root chains. Returns a^(2^250 - 1) and a^11
+inline FE25519 FE25519_Pow2_250(FE25519 const& a, FE25519& a11){
+	const FE25519 a2 = FE25519_Sqr(a);
+	const FE25519 a9 = FE25519_Mul(FE25519_SqrN(a2, 2), a);
+	a11 = FE25519_Mul(a9, a2);
+	const FE25519 e5 = FE25519_Mul(FE25519_Sqr(a11), a9);
+	const FE25519 e10 = FE25519_Mul(FE25519_SqrN(e5, 5), e5);
+	const FE25519 e20 = FE25519_Mul(FE25519_SqrN(e10, 10), e10);
+	const FE25519 e40 = FE25519_Mul(FE25519_SqrN(e20, 20), e20);
+	const FE25519 e50 = FE25519_Mul(FE25519_SqrN(e40, 10), e10);
+	const FE25519 e100 = FE25519_Mul(FE25519_SqrN(e50, 50), e50);
+	const FE25519 e200 = FE25519_Mul(FE25519_SqrN(e100, 100), e100);
+	return FE25519_Mul(FE25519_SqrN(e200, 50), e50);
+}
+
+//a^(p - 2) = 1 / a (0 for a = 0)
+inline FE25519 FE25519_Inverse(FE25519 const& a){
+	FE25519 a11;
+	const FE25519 e250 = FE25519_Pow2_250(a, a11);
+	return FE25519_Mul(FE25519_SqrN(e250, 5), a11);
+}
+
+//a^((p - 5) / 8), used to compute square roots
+inline FE25519 FE25519_Pow22523(FE25519 const& a){
+	FE25519 a11;
+	const FE25519 e250 = FE25519_Pow2_250(a, a11);
+	return FE25519_Mul(FE25519_SqrN(e250, 2), a);
+}
+
+inline uint64_t FE25519_IsZero(FE25519 const& a){
+	byte s[32];
+	FE25519_ToBytes(s, a);
+	byte x = 0;
+	for (int i = 0; i < 32; i++) x |= s[i];
+	return ((uint64_t) x - 1) >> 63;
+}
+
+inline uint64_t FE25519_Equal(FE25519 const& a, FE25519 const& b){
+	return FE25519_IsZero(FE25519_Sub(a, b));
+}
+
+//Lowest bit of the canonical encoding (the "sign" of x in Ed25519 point encodings)
+inline uint64_t FE25519_IsNegative(FE25519 const& a){
+	byte s[32];
+	FE25519_ToBytes(s, a);
+	return s[0] & 1;
+}
+
+//r = flag ? a : r
+inline void FE25519_CMov(FE25519& r, FE25519 const& a, uint64_t flag){
+	const uint64_t mask = (uint64_t) 0 - flag;
+	for (int i = 0; i < 5; i++) r.v[i] ^= (r.v[i] ^ a.v[i]) & mask;
+}
+
+//Swaps a and b when flag is 1
+inline void FE25519_CSwap(FE25519& a, FE25519& b, uint64_t flag){
+	const uint64_t mask = (uint64_t) 0 - flag;
+	for (int i = 0; i < 5; i++){
+		const uint64_t x = (a.v[i] ^ b.v[i]) & mask;
+		a.v[i] ^= x;
+		b.v[i] ^= x;
+	}
+}
+
+#endif
+
+#endif
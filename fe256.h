@@ -0,0 +1,367 @@
+#ifndef FE256_H
+#define FE256_H
+
+/*
+* Fixed-width (4 x 64-bit limbs) arithmetic modulo 256-bit primes, for the fast secp256r1 / secp256k1 code in fastec.cc.
+* Elements live on the stack, every operation runs in constant time (no branch nor memory access depending on the values)
+* and they all follow the field interface of ecmath.h, so that the generic curve code can use them.
+* Needs a compiler with 128-bit integers (gcc, clang on 64-bit targets); FE256_AVAILABLE is left undefined otherwise.
+*/
+
+#if defined(__SIZEOF_INT128__)
+#define FE256_AVAILABLE
+
+#include <stdint.h>
+#include <cstring>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+
+typedef unsigned __int128 FE256_uint128;
+
+//Little endian limbs
+struct FE256 {
+	uint64_t v[4];
+};
+
+inline void FE256_LoadBE(FE256& r, const byte* in){
+	for (int i = 0; i < 4; i++){
+		uint64_t limb = 0;
+		for (int j = 0; j < 8; j++) limb = (limb << 8) | in[8 * (3 - i) + j];
+		r.v[i] = limb;
+	}
+}
+
+inline void FE256_StoreBE(byte* out, FE256 const& a){
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 8; j++) out[8 * (3 - i) + j] = (byte) (a.v[i] >> (56 - 8 * j));
+	}
+}
+
+inline FE256 FE256_FromInteger(Integer const& a){
+	byte buffer[32];
+	a.Encode(buffer, 32);
+	FE256 r;
+	FE256_LoadBE(r, buffer);
+	memset(buffer, 0, sizeof(buffer));
+	return r;
+}
+
+inline Integer FE256_ToInteger(FE256 const& a){
+	byte buffer[32];
+	FE256_StoreBE(buffer, a);
+	Integer r(buffer, 32);
+	memset(buffer, 0, sizeof(buffer));
+	return r;
+}
+
+//r = a + b, returns the carry
+inline uint64_t FE256_AddRaw(FE256& r, FE256 const& a, FE256 const& b){
+	FE256_uint128 acc = 0;
+	for (int i = 0; i < 4; i++){
+		acc += (FE256_uint128) a.v[i] + b.v[i];
+		r.v[i] = (uint64_t) acc;
+		acc >>= 64;
+	}
+	return (uint64_t) acc;
+}
+
+//r = a - b, returns the borrow
+inline uint64_t FE256_SubRaw(FE256& r, FE256 const& a, FE256 const& b){
+	uint64_t borrow = 0;
+	for (int i = 0; i < 4; i++){
+		FE256_uint128 d = (FE256_uint128) a.v[i] - b.v[i] - borrow;
+		r.v[i] = (uint64_t) d;
+		borrow = (uint64_t) (d >> 64) & 1;
+	}
+	return borrow;
+}
+
+//r = flag ? a : r
+inline void FE256_CMov(FE256& r, FE256 const& a, uint64_t flag){
+	const uint64_t mask = (uint64_t) 0 - flag;
+	for (int i = 0; i < 4; i++) r.v[i] = (r.v[i] & ~mask) | (a.v[i] & mask);
+}
+
+//Clears secret values from the stack
+inline void FE256_Wipe(void* p, size_t length){
+	volatile byte* b = (volatile byte*) p;
+	while (length--) *b++ = 0;
+}
+
+inline uint64_t FE256_IsZero(FE256 const& a){
+	const uint64_t x = a.v[0] | a.v[1] | a.v[2] | a.v[3];
+	return 1 ^ ((x | ((uint64_t) 0 - x)) >> 63);
+}
+
+inline uint64_t FE256_Equal(FE256 const& a, FE256 const& b){
+	FE256 d;
+	for (int i = 0; i < 4; i++) d.v[i] = a.v[i] ^ b.v[i];
+	return FE256_IsZero(d);
+}
+
+//Returns 1 when a < b
+inline uint64_t FE256_Less(FE256 const& a, FE256 const& b){
+	FE256 d;
+	return FE256_SubRaw(d, a, b);
+}
+
+//a mod m for a < 2m
+inline FE256 FE256_ReduceOnce(FE256 const& a, FE256 const& m){
+	FE256 r = a, d;
+	const uint64_t borrow = FE256_SubRaw(d, a, m);
+	FE256_CMov(r, d, borrow ^ 1);
+	return r;
+}
+
+//(a + b) mod m, a and b reduced
+inline FE256 FE256_AddMod(FE256 const& a, FE256 const& b, FE256 const& m){
+	FE256 s, d;
+	const uint64_t carry = FE256_AddRaw(s, a, b);
+	const uint64_t borrow = FE256_SubRaw(d, s, m);
+	FE256_CMov(s, d, carry | (borrow ^ 1));
+	return s;
+}
+
+//(a - b) mod m, a and b reduced
+inline FE256 FE256_SubMod(FE256 const& a, FE256 const& b, FE256 const& m){
+	FE256 d, c, masked;
+	const uint64_t borrow = FE256_SubRaw(d, a, b);
+	const uint64_t mask = (uint64_t) 0 - borrow;
+	for (int i = 0; i < 4; i++) masked.v[i] = m.v[i] & mask;
+	FE256_AddRaw(c, d, masked);
+	return c;
+}
+
+/*
+* Montgomery arithmetic modulo the prime described by P (limbs P0..P3, N0 = -p^-1 mod 2^64, R2_0..R2_3 = 2^512 mod p).
+* The limbs are compile-time constants : for the P-256 prime (N0 = 1, P2 = 0) the compiler drops the corresponding multiplications,
+* which gives the usual special reduction for that prime. Also used for the scalar fields (the curve orders).
+*/
+template <class P>
+class MontgomeryField256 {
+public:
+	typedef FE256 Element;
+
+	static FE256 Modulus(){
+		FE256 m = {{P::P0, P::P1, P::P2, P::P3}};
+		return m;
+	}
+	Element Zero() const {
+		FE256 z = {{0, 0, 0, 0}};
+		return z;
+	}
+	Element One() const {
+		FE256 one = {{1, 0, 0, 0}};
+		return FromPlain(one);
+	}
+	Element Add(Element const& a, Element const& b) const { return FE256_AddMod(a, b, Modulus()); }
+	Element Sub(Element const& a, Element const& b) const { return FE256_SubMod(a, b, Modulus()); }
+	Element Neg(Element const& a) const { return FE256_SubMod(Zero(), a, Modulus()); }
+	Element Sqr(Element const& a) const { return Mul(a, a); }
+	bool IsZero(Element const& a) const { return FE256_IsZero(a) != 0; }
+
+	//Coarsely integrated operand scanning
+	Element Mul(Element const& a, Element const& b) const {
+		const uint64_t p[4] = {P::P0, P::P1, P::P2, P::P3};
+		uint64_t t[6] = {0, 0, 0, 0, 0, 0};
+		for (int i = 0; i < 4; i++){
+			FE256_uint128 acc = 0;
+			for (int j = 0; j < 4; j++){
+				acc += (FE256_uint128) a.v[j] * b.v[i] + t[j];
+				t[j] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			acc += t[4];
+			t[4] = (uint64_t) acc;
+			t[5] = (uint64_t) (acc >> 64);
+			const uint64_t m = t[0] * P::N0;
+			acc = (FE256_uint128) m * p[0] + t[0];
+			acc >>= 64;
+			for (int j = 1; j < 4; j++){
+				acc += (FE256_uint128) m * p[j] + t[j];
+				t[j - 1] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			acc += t[4];
+			t[3] = (uint64_t) acc;
+			t[4] = t[5] + (uint64_t) (acc >> 64);
+		}
+		FE256 r = {{t[0], t[1], t[2], t[3]}}, d;
+		const uint64_t borrow = FE256_SubRaw(d, r, Modulus());
+		FE256_CMov(r, d, t[4] | (borrow ^ 1));
+		return r;
+	}
+
+	//a^(p - 2) : the exponent is public, so the square-and-multiply can follow its bits
+	Element Inverse(Element const& a) const {
+		FE256 e = Modulus(), two = {{2, 0, 0, 0}};
+		FE256_SubRaw(e, e, two);
+		Element r = One();
+		for (int i = 255; i >= 0; i--){
+			r = Sqr(r);
+			if ((e.v[i / 64] >> (i % 64)) & 1) r = Mul(r, a);
+		}
+		return r;
+	}
+
+	//Plain value (below the modulus) <-> Montgomery form
+	Element FromPlain(FE256 const& a) const {
+		FE256 r2 = {{P::R2_0, P::R2_1, P::R2_2, P::R2_3}};
+		return Mul(a, r2);
+	}
+	FE256 ToPlain(Element const& a) const {
+		FE256 one = {{1, 0, 0, 0}};
+		return Mul(a, one);
+	}
+
+	Element FromInteger(Integer const& a) const { return FromPlain(FE256_FromInteger(a % FE256_ToInteger(Modulus()))); }
+	Integer ToInteger(Element const& a) const { return FE256_ToInteger(ToPlain(a)); }
+	//Big endian, 32 bytes. Returns false (and leaves r untouched) if the value isn't below the modulus
+	bool FromBytes(Element& r, const byte* in) const {
+		FE256 a;
+		FE256_LoadBE(a, in);
+		if (!FE256_Less(a, Modulus())) return false;
+		r = FromPlain(a);
+		return true;
+	}
+	void ToBytes(byte* out, Element const& a) const { FE256_StoreBE(out, ToPlain(a)); }
+
+	void CMov(Element& r, Element const& a, uint64_t flag) const { FE256_CMov(r, a, flag); }
+	uint64_t Equal(Element const& a, Element const& b) const { return FE256_Equal(a, b); }
+};
+
+/*
+* Arithmetic modulo the secp256k1 prime p = 2^256 - 0x1000003D1, with elements in plain (not Montgomery) form.
+* Products are reduced by folding the upper half twice, since 2^256 = 0x1000003D1 mod p.
+*/
+class Secp256k1Field {
+public:
+	typedef FE256 Element;
+
+	static FE256 Modulus(){
+		FE256 m = {{0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL}};
+		return m;
+	}
+	Element Zero() const {
+		FE256 z = {{0, 0, 0, 0}};
+		return z;
+	}
+	Element One() const {
+		FE256 one = {{1, 0, 0, 0}};
+		return one;
+	}
+	Element Add(Element const& a, Element const& b) const { return FE256_AddMod(a, b, Modulus()); }
+	Element Sub(Element const& a, Element const& b) const { return FE256_SubMod(a, b, Modulus()); }
+	Element Neg(Element const& a) const { return FE256_SubMod(Zero(), a, Modulus()); }
+	Element Sqr(Element const& a) const { return Mul(a, a); }
+	bool IsZero(Element const& a) const { return FE256_IsZero(a) != 0; }
+
+	Element Mul(Element const& a, Element const& b) const {
+		static const uint64_t C = 0x1000003D1ULL;
+		uint64_t t[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+		for (int i = 0; i < 4; i++){
+			FE256_uint128 acc = 0;
+			for (int j = 0; j < 4; j++){
+				acc += (FE256_uint128) a.v[j] * b.v[i] + t[i + j];
+				t[i + j] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			t[i + 4] = (uint64_t) acc;
+		}
+		//t_lo + t_hi * C : 256 bits and a carry below 2^34
+		FE256 r;
+		FE256_uint128 acc = 0;
+		for (int i = 0; i < 4; i++){
+			acc += (FE256_uint128) t[i + 4] * C + t[i];
+			r.v[i] = (uint64_t) acc;
+			acc >>= 64;
+		}
+		//Second fold, of the carry
+		acc = (FE256_uint128) ((uint64_t) acc) * C + r.v[0];
+		r.v[0] = (uint64_t) acc;
+		acc >>= 64;
+		for (int i = 1; i < 4; i++){
+			acc += r.v[i];
+			r.v[i] = (uint64_t) acc;
+			acc >>= 64;
+		}
+		//A last carry can only happen when r is now tiny : adding C can't overflow again
+		const uint64_t carry = (uint64_t) acc;
+		acc = (FE256_uint128) r.v[0] + (C & ((uint64_t) 0 - carry));
+		r.v[0] = (uint64_t) acc;
+		acc >>= 64;
+		for (int i = 1; i < 4; i++){
+			acc += r.v[i];
+			r.v[i] = (uint64_t) acc;
+			acc >>= 64;
+		}
+		return FE256_ReduceOnce(r, Modulus());
+	}
+
+	//a^(p - 2), the exponent being public
+	Element Inverse(Element const& a) const {
+		FE256 e = Modulus(), two = {{2, 0, 0, 0}};
+		FE256_SubRaw(e, e, two);
+		Element r = One();
+		for (int i = 255; i >= 0; i--){
+			r = Sqr(r);
+			if ((e.v[i / 64] >> (i % 64)) & 1) r = Mul(r, a);
+		}
+		return r;
+	}
+
+	Element FromPlain(FE256 const& a) const { return a; }
+	FE256 ToPlain(Element const& a) const { return a; }
+
+	Element FromInteger(Integer const& a) const { return FE256_FromInteger(a % FE256_ToInteger(Modulus())); }
+	Integer ToInteger(Element const& a) const { return FE256_ToInteger(a); }
+	bool FromBytes(Element& r, const byte* in) const {
+		FE256 a;
+		FE256_LoadBE(a, in);
+		if (!FE256_Less(a, Modulus())) return false;
+		r = a;
+		return true;
+	}
+	void ToBytes(byte* out, Element const& a) const { FE256_StoreBE(out, a); }
+
+	void CMov(Element& r, Element const& a, uint64_t flag) const { FE256_CMov(r, a, flag); }
+	uint64_t Equal(Element const& a, Element const& b) const { return FE256_Equal(a, b); }
+};
+
+//Prime of secp256r1 (NIST P-256)
+struct P256FieldParams {
+	static const uint64_t P0 = 0xFFFFFFFFFFFFFFFFULL, P1 = 0x00000000FFFFFFFFULL, P2 = 0x0000000000000000ULL, P3 = 0xFFFFFFFF00000001ULL;
+	static const uint64_t N0 = 0x1ULL;
+	static const uint64_t R2_0 = 0x0000000000000003ULL, R2_1 = 0xFFFFFFFBFFFFFFFFULL, R2_2 = 0xFFFFFFFFFFFFFFFEULL, R2_3 = 0x00000004FFFFFFFDULL;
+};
+
+//Order of secp256r1
+struct P256OrderParams {
+	static const uint64_t P0 = 0xF3B9CAC2FC632551ULL, P1 = 0xBCE6FAADA7179E84ULL, P2 = 0xFFFFFFFFFFFFFFFFULL, P3 = 0xFFFFFFFF00000000ULL;
+	static const uint64_t N0 = 0xCCD1C8AAEE00BC4FULL;
+	static const uint64_t R2_0 = 0x83244C95BE79EEA2ULL, R2_1 = 0x4699799C49BD6FA6ULL, R2_2 = 0x2845B2392B6BEC59ULL, R2_3 = 0x66E12D94F3D95620ULL;
+};
+
+//Order of Ed25519's base point (not a curve of fastec.cc, used by curve25519.cc)
+struct Ed25519OrderParams {
+	static const uint64_t P0 = 0x5812631A5CF5D3EDULL, P1 = 0x14DEF9DEA2F79CD6ULL, P2 = 0x0000000000000000ULL, P3 = 0x1000000000000000ULL;
+	static const uint64_t N0 = 0xD2B51DA312547E1BULL;
+	static const uint64_t R2_0 = 0xA40611E3449C0F01ULL, R2_1 = 0xD00E1BA768859347ULL, R2_2 = 0xCEEC73D217F5BE65ULL, R2_3 = 0x0399411B7C309A3DULL;
+};
+
+//Order of secp256k1
+struct Secp256k1OrderParams {
+	static const uint64_t P0 = 0xBFD25E8CD0364141ULL, P1 = 0xBAAEDCE6AF48A03BULL, P2 = 0xFFFFFFFFFFFFFFFEULL, P3 = 0xFFFFFFFFFFFFFFFFULL;
+	static const uint64_t N0 = 0x4B0DFF665588B13FULL;
+	static const uint64_t R2_0 = 0x896CF21467D7D140ULL, R2_1 = 0x741496C20E7CF878ULL, R2_2 = 0xE697F5E45BCD07C6ULL, R2_3 = 0x9D671CD581C69BC5ULL;
+};
+
+typedef MontgomeryField256<P256FieldParams> P256Field;
+typedef MontgomeryField256<P256OrderParams> P256Scalar;
+typedef MontgomeryField256<Secp256k1OrderParams> Secp256k1Scalar;
+typedef MontgomeryField256<Ed25519OrderParams> Ed25519Scalar;
+
+#endif
+
+#endif
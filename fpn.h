@@ -0,0 +1,183 @@
+#ifndef FPN_H
+#define FPN_H
+
+/*
+* Fixed-width (N x 64-bit limbs) Montgomery arithmetic modulo any odd prime below 2^(64N), for the prime curves that have no dedicated
+* field in fe256.h (secp112r1 to secp224k1, secp384r1, secp521r1). Unlike MontgomeryField256, the modulus is given at construction.
+* Elements live on the stack, every operation runs in constant time, and they follow the field interface of ecmath.h.
+* Built on fe256.h : FPN_AVAILABLE is left undefined when FE256_AVAILABLE is.
+*/
+
+#include "fe256.h"
+
+#ifdef FE256_AVAILABLE
+#define FPN_AVAILABLE
+
+//Little endian limbs
+template <size_t N>
+struct FPN {
+	uint64_t v[N];
+};
+
+template <size_t N>
+class MontgomeryFieldN {
+public:
+	typedef FPN<N> Element;
+
+	explicit MontgomeryFieldN(Integer const& p) : modulus_(p){
+		p_ = Load(p);
+		exponent_ = Load(p - 2);
+		r_ = Load(Integer::Power2(64 * N) % p);
+		r2_ = Load(Integer::Power2(128 * N) % p);
+		//-p^-1 mod 2^64, by Newton's iteration (each step doubles the number of correct low bits)
+		uint64_t inverse = 1;
+		for (int i = 0; i < 6; i++) inverse *= 2 - p_.v[0] * inverse;
+		n0_ = (uint64_t) 0 - inverse;
+	}
+
+	Element Zero() const {
+		Element z;
+		memset(z.v, 0, sizeof(z.v));
+		return z;
+	}
+	Element One() const { return r_; }
+
+	Element Add(Element const& a, Element const& b) const {
+		Element s, d;
+		FE256_uint128 acc = 0;
+		for (size_t i = 0; i < N; i++){
+			acc += (FE256_uint128) a.v[i] + b.v[i];
+			s.v[i] = (uint64_t) acc;
+			acc >>= 64;
+		}
+		const uint64_t carry = (uint64_t) acc;
+		const uint64_t borrow = SubRaw(d, s, p_);
+		CMov(s, d, carry | (borrow ^ 1));
+		return s;
+	}
+
+	Element Sub(Element const& a, Element const& b) const {
+		Element d;
+		const uint64_t mask = (uint64_t) 0 - SubRaw(d, a, b);
+		FE256_uint128 acc = 0;
+		for (size_t i = 0; i < N; i++){
+			acc += (FE256_uint128) d.v[i] + (p_.v[i] & mask);
+			d.v[i] = (uint64_t) acc;
+			acc >>= 64;
+		}
+		return d;
+	}
+
+	Element Neg(Element const& a) const { return Sub(Zero(), a); }
+	Element Sqr(Element const& a) const { return Mul(a, a); }
+
+	//Coarsely integrated operand scanning, as MontgomeryField256::Mul
+	Element Mul(Element const& a, Element const& b) const {
+		uint64_t t[N + 2];
+		memset(t, 0, sizeof(t));
+		for (size_t i = 0; i < N; i++){
+			FE256_uint128 acc = 0;
+			for (size_t j = 0; j < N; j++){
+				acc += (FE256_uint128) a.v[j] * b.v[i] + t[j];
+				t[j] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			acc += t[N];
+			t[N] = (uint64_t) acc;
+			t[N + 1] = (uint64_t) (acc >> 64);
+			const uint64_t m = t[0] * n0_;
+			acc = (FE256_uint128) m * p_.v[0] + t[0];
+			acc >>= 64;
+			for (size_t j = 1; j < N; j++){
+				acc += (FE256_uint128) m * p_.v[j] + t[j];
+				t[j - 1] = (uint64_t) acc;
+				acc >>= 64;
+			}
+			acc += t[N];
+			t[N - 1] = (uint64_t) acc;
+			t[N] = t[N + 1] + (uint64_t) (acc >> 64);
+		}
+		Element r, d;
+		memcpy(r.v, t, sizeof(r.v));
+		const uint64_t borrow = SubRaw(d, r, p_);
+		CMov(r, d, t[N] | (borrow ^ 1));
+		return r;
+	}
+
+	//a^(p - 2) : the exponent is public, so the square-and-multiply can follow its bits
+	Element Inverse(Element const& a) const {
+		Element r = One();
+		for (size_t i = 64 * N; i-- > 0;){
+			r = Sqr(r);
+			if ((exponent_.v[i / 64] >> (i % 64)) & 1) r = Mul(r, a);
+		}
+		return r;
+	}
+
+	bool IsZero(Element const& a) const {
+		uint64_t x = 0;
+		for (size_t i = 0; i < N; i++) x |= a.v[i];
+		return x == 0;
+	}
+
+	//Plain value (below the modulus) <-> Montgomery form
+	Element FromInteger(Integer const& a) const { return Mul(Load(a % modulus_), r2_); }
+	Integer ToInteger(Element const& a) const {
+		Element one = Zero();
+		one.v[0] = 1;
+		return ToIntegerRaw(Mul(a, one));
+	}
+
+	void CMov(Element& r, Element const& a, uint64_t flag) const {
+		const uint64_t mask = (uint64_t) 0 - flag;
+		for (size_t i = 0; i < N; i++) r.v[i] = (r.v[i] & ~mask) | (a.v[i] & mask);
+	}
+	uint64_t Equal(Element const& a, Element const& b) const {
+		uint64_t x = 0;
+		for (size_t i = 0; i < N; i++) x |= a.v[i] ^ b.v[i];
+		return 1 ^ ((x | ((uint64_t) 0 - x)) >> 63);
+	}
+
+private:
+	//r = a - b, returns the borrow
+	static uint64_t SubRaw(Element& r, Element const& a, Element const& b){
+		uint64_t borrow = 0;
+		for (size_t i = 0; i < N; i++){
+			FE256_uint128 d = (FE256_uint128) a.v[i] - b.v[i] - borrow;
+			r.v[i] = (uint64_t) d;
+			borrow = (uint64_t) (d >> 64) & 1;
+		}
+		return borrow;
+	}
+
+	static Element Load(Integer const& a){
+		byte buffer[8 * N];
+		a.Encode(buffer, sizeof(buffer));
+		Element r;
+		for (size_t i = 0; i < N; i++){
+			uint64_t limb = 0;
+			for (size_t j = 0; j < 8; j++) limb = (limb << 8) | buffer[8 * (N - 1 - i) + j];
+			r.v[i] = limb;
+		}
+		FE256_Wipe(buffer, sizeof(buffer));
+		return r;
+	}
+
+	static Integer ToIntegerRaw(Element const& a){
+		byte buffer[8 * N];
+		for (size_t i = 0; i < N; i++){
+			for (size_t j = 0; j < 8; j++) buffer[8 * (N - 1 - i) + j] = (byte) (a.v[i] >> (56 - 8 * j));
+		}
+		Integer r(buffer, sizeof(buffer));
+		FE256_Wipe(buffer, sizeof(buffer));
+		return r;
+	}
+
+	Integer modulus_;
+	Element p_, exponent_, r_, r2_;
+	uint64_t n0_;
+};
+
+#endif
+
+#endif
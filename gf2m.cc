@@ -0,0 +1,286 @@
+#include <cstring>
+
+#include <cryptopp/config.h>
+#include <cryptopp/cpu.h>
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+#include "gf2m.h"
+
+using namespace std;
+
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64
+//The PCLMULQDQ kernel is compiled for PCLMUL on its own (target attribute), and only called if the CPU has it
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define GF2M_PCLMUL
+#include <wmmintrin.h>
+#endif
+#endif
+
+/*
+* Carry-less multiplication kernels : r (2 * words) = a (words) * b (words), schoolbook
+*/
+typedef void (*GF2mMulKernel)(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t words);
+
+//Low 64 bits of the carry-less product of x and y. Each product of masked values adds up at most 15 bits in a position below 64, so the carries
+//stay in the 3-bit holes between the bits that are kept
+static inline uint64_t bmul64(uint64_t x, uint64_t y){
+	const uint64_t m0 = 0x1111111111111111ULL, m1 = 0x2222222222222222ULL, m2 = 0x4444444444444444ULL, m3 = 0x8888888888888888ULL;
+	const uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+	const uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+	uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+	uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+	uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+	uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+	return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+static inline uint64_t rev64(uint64_t x){
+	x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+	x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+	return (x >> 32) | (x << 32);
+}
+
+//The high half is the low half of the product of the bit-reversed operands, reversed again
+static void mulPortable(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t words){
+	uint64_t ar[GF2M_MAX_WORDS], br[GF2M_MAX_WORDS];
+	for (size_t i = 0; i < words; i++){
+		ar[i] = rev64(a[i]);
+		br[i] = rev64(b[i]);
+	}
+	memset(r, 0, 2 * words * sizeof(uint64_t));
+	for (size_t i = 0; i < words; i++){
+		for (size_t j = 0; j < words; j++){
+			r[i + j] ^= bmul64(a[i], b[j]);
+			r[i + j + 1] ^= rev64(bmul64(ar[i], br[j])) >> 1;
+		}
+	}
+	SecureWipeArray(ar, words);
+	SecureWipeArray(br, words);
+}
+
+#ifdef GF2M_PCLMUL
+//Column by column : the 128-bit products of the words whose indices add up to k are summed in a register, then added to r[k] and r[k + 1]
+__attribute__((target("pclmul,sse2"))) static void mulPCLMUL(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t words){
+	uint64_t halves[2];
+	memset(r, 0, 2 * words * sizeof(uint64_t));
+	for (size_t k = 0; k < 2 * words - 1; k++){
+		__m128i acc = _mm_setzero_si128();
+		for (size_t i = k < words ? 0 : k - words + 1; i <= k && i < words; i++){
+			acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long) a[i]), _mm_set_epi64x(0, (long long) b[k - i]), 0x00));
+		}
+		_mm_storeu_si128((__m128i*) halves, acc);
+		r[k] ^= halves[0];
+		r[k + 1] ^= halves[1];
+	}
+	SecureWipeArray(halves, 2);
+}
+#endif
+
+struct GF2mKernelChoice {
+	GF2mMulKernel kernel;
+	const char* name;
+};
+
+static GF2mKernelChoice chooseKernel(){
+	GF2mKernelChoice choice = {mulPortable, "portable"};
+#ifdef GF2M_PCLMUL
+	if (CryptoPP::HasCLMUL()){
+		choice.kernel = mulPCLMUL;
+		choice.name = "pclmul";
+	}
+#endif
+	return choice;
+}
+
+//Picked when the module is loaded, before any other thread can use it
+static const GF2mKernelChoice gf2mKernel = chooseKernel();
+
+const char* GF2m_KernelName(){
+	return gf2mKernel.name;
+}
+
+//Coefficients of x, spread over the even bits (squaring of a 32-bit polynomial)
+static inline uint64_t spread32(uint64_t x){
+	x &= 0xFFFFFFFFULL;
+	x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+	x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	x = (x | (x << 2)) & 0x3333333333333333ULL;
+	x = (x | (x << 1)) & 0x5555555555555555ULL;
+	return x;
+}
+
+GF2mField::GF2mField(unsigned int m, vector<unsigned int> const& exponents) : m_(m), words_((m + 63) / 64), exponents_(exponents){
+	//The constant term is folded like the others
+	exponents_.push_back(0);
+}
+
+bool GF2mField::Supports(unsigned int m, vector<unsigned int> const& exponents){
+	if (m == 0 || (m + 63) / 64 > GF2M_MAX_WORDS) return false;
+	if (!(exponents.size() == 1 || exponents.size() == 3)) return false;
+	for (size_t i = 0; i < exponents.size(); i++){
+		if (exponents[i] == 0 || (i > 0 && exponents[i] >= exponents[i - 1])) return false;
+	}
+	return exponents[0] < m && m - exponents[0] >= 64;
+}
+
+bool GF2mField::FromPolynomial(PolynomialMod2 const& f, unsigned int& m, vector<unsigned int>& exponents){
+	if (f.Degree() < 1 || !f.GetBit(0)) return false;
+	m = f.Degree();
+	exponents.clear();
+	for (unsigned int i = m - 1; i > 0; i--){
+		if (f.GetBit(i)) exponents.push_back(i);
+	}
+	return Supports(m, exponents);
+}
+
+GF2mElement GF2mField::Zero() const {
+	GF2mElement r;
+	memset(r.v, 0, sizeof(r.v));
+	return r;
+}
+
+GF2mElement GF2mField::One() const {
+	GF2mElement r = Zero();
+	r.v[0] = 1;
+	return r;
+}
+
+GF2mElement GF2mField::Add(GF2mElement const& a, GF2mElement const& b) const {
+	GF2mElement r = Zero();
+	for (size_t i = 0; i < words_; i++) r.v[i] = a.v[i] ^ b.v[i];
+	return r;
+}
+
+GF2mElement GF2mField::Mul(GF2mElement const& a, GF2mElement const& b) const {
+	uint64_t z[2 * GF2M_MAX_WORDS];
+	gf2mKernel.kernel(z, a.v, b.v, words_);
+	GF2mElement r;
+	Reduce(z, r);
+	return r;
+}
+
+GF2mElement GF2mField::Sqr(GF2mElement const& a) const {
+	uint64_t z[2 * GF2M_MAX_WORDS];
+	for (size_t i = 0; i < words_; i++){
+		z[2 * i] = spread32(a.v[i]);
+		z[2 * i + 1] = spread32(a.v[i] >> 32);
+	}
+	GF2mElement r;
+	Reduce(z, r);
+	return r;
+}
+
+GF2mElement GF2mField::SqrN(GF2mElement const& a, unsigned int n) const {
+	GF2mElement r = a;
+	for (unsigned int i = 0; i < n; i++) r = Sqr(r);
+	return r;
+}
+
+/*
+* a^-1 = a^(2^m - 2) = (a^(2^(m-1) - 1))^2. With b_k = a^(2^k - 1) : b_(2k) = b_k^(2^k) * b_k and b_(k+1) = b_k^2 * a,
+* so b_(m-1) takes the bits of m - 1, from the most significant one : m - 1 squarings and about 2 log2(m) multiplications
+*/
+GF2mElement GF2mField::Inverse(GF2mElement const& a) const {
+	const unsigned int e = m_ - 1;
+	int top = 31;
+	while (!((e >> top) & 1)) top--;
+	GF2mElement b = a;
+	unsigned int k = 1;
+	for (int i = top - 1; i >= 0; i--){
+		b = Mul(SqrN(b, k), b);
+		k *= 2;
+		if ((e >> i) & 1){
+			b = Mul(Sqr(b), a);
+			k++;
+		}
+	}
+	return Sqr(b);
+}
+
+bool GF2mField::IsZero(GF2mElement const& a) const {
+	uint64_t acc = 0;
+	for (size_t i = 0; i < words_; i++) acc |= a.v[i];
+	return acc == 0;
+}
+
+bool GF2mField::Equal(GF2mElement const& a, GF2mElement const& b) const {
+	return IsZero(Add(a, b));
+}
+
+void GF2mField::CSwap(GF2mElement& a, GF2mElement& b, uint64_t flag) const {
+	const uint64_t mask = 0 - flag;
+	for (size_t i = 0; i < words_; i++){
+		const uint64_t t = mask & (a.v[i] ^ b.v[i]);
+		a.v[i] ^= t;
+		b.v[i] ^= t;
+	}
+}
+
+bool GF2mField::Decode(GF2mElement& r, const byte* in) const {
+	const size_t length = ByteLength();
+	r = Zero();
+	for (size_t i = 0; i < length; i++){
+		const size_t bit = 8 * (length - 1 - i);
+		r.v[bit / 64] |= (uint64_t) in[i] << (bit % 64);
+	}
+	//Bits m and above of the top word
+	return m_ % 64 == 0 || (r.v[words_ - 1] >> (m_ % 64)) == 0;
+}
+
+void GF2mField::Encode(byte* out, GF2mElement const& a) const {
+	const size_t length = ByteLength();
+	for (size_t i = 0; i < length; i++){
+		const size_t bit = 8 * (length - 1 - i);
+		out[i] = (byte) (a.v[bit / 64] >> (bit % 64));
+	}
+}
+
+bool GF2mField::FromPolynomial(PolynomialMod2 const& a, GF2mElement& r) const {
+	if (a.BitCount() > m_) return false;
+	byte buffer[8 * GF2M_MAX_WORDS];
+	a.Encode(buffer, ByteLength());
+	const bool valid = Decode(r, buffer);
+	SecureWipeArray(buffer, sizeof(buffer));
+	return valid;
+}
+
+PolynomialMod2 GF2mField::ToPolynomial(GF2mElement const& a) const {
+	byte buffer[8 * GF2M_MAX_WORDS];
+	Encode(buffer, a);
+	const PolynomialMod2 r(buffer, ByteLength());
+	SecureWipeArray(buffer, sizeof(buffer));
+	return r;
+}
+
+/*
+* Word by word, from the top : t^(m + i) = t^(i + k1) + ... + t^i. The words above the one holding t^m are folded first, each of them
+* landing at least a word lower (m - k1 >= 64); then the bits at or above t^m in that word
+*/
+void GF2mField::Reduce(uint64_t* z, GF2mElement& r) const {
+	const size_t top = m_ / 64;
+	for (size_t j = 2 * words_ - 1; j > top; j--){
+		const uint64_t zz = z[j];
+		z[j] = 0;
+		for (size_t i = 0; i < exponents_.size(); i++){
+			const unsigned int n = m_ - exponents_[i], shift = n % 64;
+			z[j - n / 64] ^= zz >> shift;
+			if (shift != 0) z[j - n / 64 - 1] ^= zz << (64 - shift);
+		}
+	}
+	const unsigned int shift = m_ % 64;
+	const uint64_t zz = z[top] >> shift;
+	z[top] ^= zz << shift;
+	for (size_t i = 0; i < exponents_.size(); i++){
+		const unsigned int p = exponents_[i], offset = p % 64;
+		z[p / 64] ^= zz << offset;
+		if (offset != 0) z[p / 64 + 1] ^= zz >> (64 - offset);
+	}
+	memcpy(r.v, z, words_ * sizeof(uint64_t));
+	memset(r.v + words_, 0, (GF2M_MAX_WORDS - words_) * sizeof(uint64_t));
+	SecureWipeArray(z, 2 * words_);
+}
@@ -0,0 +1,74 @@
+#ifndef GF2M_H
+#define GF2M_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <cryptopp/gf2n.h>
+using CryptoPP::PolynomialMod2;
+
+/*
+* Arithmetic in the binary fields GF(2^m) = GF(2)[t] / f(t) of the sect* curves, for fastec2n.cc. f is a trinomial or a pentanomial.
+* Elements are polynomials of degree < m, as GF2M_MAX_WORDS 64-bit words on the stack (bit i of word j is the coefficient of t^(64j + i)).
+* Multiplications use carry-less multiplications : the PCLMULQDQ instruction when the CPU has it, and otherwise a portable
+* version made of integer multiplications with "holes" between the bits (as in BearSSL). The kernel is picked once, when the module is loaded.
+* Squarings interleave the bits with zeros, and inverses are Itoh-Tsujii exponentiations. No operation branches on, or indexes memory with,
+* the value of an element : only m and f decide what is done.
+*/
+
+//Up to 576 bits, for sect571k1 / sect571r1
+static const size_t GF2M_MAX_WORDS = 9;
+
+struct GF2mElement {
+	uint64_t v[GF2M_MAX_WORDS];
+};
+
+//Name of the carry-less multiplication kernel in use : "pclmul" or "portable"
+const char* GF2m_KernelName();
+
+class GF2mField {
+public:
+	/*
+	* f(t) = t^m + t^k1 + ... + 1, exponents being the terms between t^m and 1 in decreasing order (k1 for a trinomial, k1, k2 and k3 for a pentanomial).
+	* Reductions fold a word at a time, which needs m - k1 >= 64 : true for every SEC 2 curve. Check Supports() first
+	*/
+	GF2mField(unsigned int m, std::vector<unsigned int> const& exponents);
+	static bool Supports(unsigned int m, std::vector<unsigned int> const& exponents);
+	//m and the exponents of f, from the field modulus of Crypto++. Returns false if f doesn't have one of the supported shapes
+	static bool FromPolynomial(PolynomialMod2 const& f, unsigned int& m, std::vector<unsigned int>& exponents);
+
+	unsigned int Degree() const { return m_; }
+	//Length of the big endian encoding of an element
+	size_t ByteLength() const { return (m_ + 7) / 8; }
+
+	GF2mElement Zero() const;
+	GF2mElement One() const;
+	GF2mElement Add(GF2mElement const& a, GF2mElement const& b) const;
+	GF2mElement Mul(GF2mElement const& a, GF2mElement const& b) const;
+	GF2mElement Sqr(GF2mElement const& a) const;
+	//a^(2^n)
+	GF2mElement SqrN(GF2mElement const& a, unsigned int n) const;
+	//The inverse of 0 is 0
+	GF2mElement Inverse(GF2mElement const& a) const;
+	bool IsZero(GF2mElement const& a) const;
+	bool Equal(GF2mElement const& a, GF2mElement const& b) const;
+	//Swaps a and b if flag is 1 (flag is 0 or 1)
+	void CSwap(GF2mElement& a, GF2mElement& b, uint64_t flag) const;
+
+	//in is ByteLength() bytes long. Returns false if it encodes a polynomial of degree >= m
+	bool Decode(GF2mElement& r, const byte* in) const;
+	void Encode(byte* out, GF2mElement const& a) const;
+	//Returns false if a has a degree >= m
+	bool FromPolynomial(PolynomialMod2 const& a, GF2mElement& r) const;
+	PolynomialMod2 ToPolynomial(GF2mElement const& a) const;
+
+private:
+	//r = z mod f, z being a product (2 * GF2M_MAX_WORDS words). z is overwritten
+	void Reduce(uint64_t* z, GF2mElement& r) const;
+
+	unsigned int m_;
+	size_t words_;
+	std::vector<unsigned int> exponents_;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef HKDF_H
+#define HKDF_H
+
+#include <cstring>
+
+#include <cryptopp/cryptlib.h>
+#include <cryptopp/hmac.h>
+using CryptoPP::HMAC;
+#include <cryptopp/misc.h>
+
+/*
+* HKDF (RFC 5869), which Crypto++ 5.6.2 doesn't provide. H is the hash function (SHA1, SHA256, SHA512...).
+* An empty salt stands for a string of zeros as long as a digest. outputLength can't exceed 255 digests : a CryptoPP::InvalidArgument is thrown past that.
+*/
+template <class H>
+void HKDF_DeriveKey(byte* output, size_t outputLength, const byte* secret, size_t secretLength, const byte* salt, size_t saltLength, const byte* info, size_t infoLength){
+	const size_t digestSize = H::DIGESTSIZE;
+	if (outputLength > 255 * digestSize) throw CryptoPP::InvalidArgument("HKDF: output length exceeds maximum");
+	//Extract
+	byte zeros[H::DIGESTSIZE], prk[H::DIGESTSIZE], block[H::DIGESTSIZE];
+	memset(zeros, 0, sizeof(zeros));
+	HMAC<H> extractor(saltLength > 0 ? salt : zeros, saltLength > 0 ? saltLength : sizeof(zeros));
+	extractor.Update(secret, secretLength);
+	extractor.Final(prk);
+	//Expand : T(i) = HMAC(PRK, T(i - 1) || info || i)
+	for (size_t i = 1, offset = 0; offset < outputLength; i++, offset += digestSize){
+		HMAC<H> expander(prk, sizeof(prk));
+		if (i > 1) expander.Update(block, sizeof(block));
+		expander.Update(info, infoLength);
+		const byte counter = (byte) i;
+		expander.Update(&counter, 1);
+		expander.Final(block);
+		memcpy(output + offset, block, outputLength - offset < digestSize ? outputLength - offset : digestSize);
+	}
+	CryptoPP::SecureWipeArray(prk, sizeof(prk));
+	CryptoPP::SecureWipeArray(block, sizeof(block));
+}
+
+#endif
@@ -0,0 +1,303 @@
+//Std imports
+#include <string>
+#include <cstring>
+
+//Crypto++ imports
+#include <cryptopp/cryptlib.h>
+#include <cryptopp/sha.h>
+using CryptoPP::SHA1;
+using CryptoPP::SHA256;
+using CryptoPP::SHA512;
+
+#include <cryptopp/hmac.h>
+using CryptoPP::HMAC;
+
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+//Node and class headers import
+#include <node.h>
+#include <node_buffer.h>
+#include <uv.h>
+#include "kdf.h"
+#include "hkdf.h"
+#include "threadpool.h"
+#include "buffers.h"
+
+using namespace v8;
+using namespace std;
+
+bool KDF_GetHash(string const& name, KDFHash& hash){
+	if (name == "sha1") hash = KDF_SHA1;
+	else if (name == "sha256") hash = KDF_SHA256;
+	else if (name == "sha512") hash = KDF_SHA512;
+	else return false;
+	return true;
+}
+
+size_t KDF_DigestSize(KDFHash hash){
+	if (hash == KDF_SHA1) return SHA1::DIGESTSIZE;
+	if (hash == KDF_SHA256) return SHA256::DIGESTSIZE;
+	return SHA512::DIGESTSIZE;
+}
+
+//T_i = U_1 ^ U_2 ^ ... ^ U_c, with U_1 = HMAC(P, S || INT(i)) and U_j = HMAC(P, U_{j-1}), i starting at 1
+template <class H>
+static void pbkdf2Blocks(const byte* password, size_t passwordLength, const byte* salt, size_t saltLength, unsigned int iterations, byte* output, size_t outputLength, size_t firstBlock, size_t blockCount){
+	HMAC<H> hmac(password, passwordLength);
+	byte u[H::DIGESTSIZE], t[H::DIGESTSIZE];
+	for (size_t block = firstBlock; block < firstBlock + blockCount; block++){
+		const size_t offset = block * H::DIGESTSIZE;
+		if (offset >= outputLength) break;
+		const uint32_t index = (uint32_t) (block + 1);
+		const byte indexBytes[4] = {(byte) (index >> 24), (byte) (index >> 16), (byte) (index >> 8), (byte) index};
+		hmac.Update(salt, saltLength);
+		hmac.Update(indexBytes, sizeof(indexBytes));
+		hmac.Final(u);
+		memcpy(t, u, sizeof(t));
+		for (unsigned int j = 1; j < iterations; j++){
+			hmac.Update(u, sizeof(u));
+			hmac.Final(u);
+			for (size_t k = 0; k < sizeof(t); k++) t[k] ^= u[k];
+		}
+		memcpy(output + offset, t, outputLength - offset < sizeof(t) ? outputLength - offset : sizeof(t));
+	}
+	SecureWipeArray(u, sizeof(u));
+	SecureWipeArray(t, sizeof(t));
+}
+
+void KDF_PBKDF2Blocks(KDFHash hash, const byte* password, size_t passwordLength, const byte* salt, size_t saltLength, unsigned int iterations, byte* output, size_t outputLength, size_t firstBlock, size_t blockCount){
+	if (hash == KDF_SHA1) pbkdf2Blocks<SHA1>(password, passwordLength, salt, saltLength, iterations, output, outputLength, firstBlock, blockCount);
+	else if (hash == KDF_SHA256) pbkdf2Blocks<SHA256>(password, passwordLength, salt, saltLength, iterations, output, outputLength, firstBlock, blockCount);
+	else pbkdf2Blocks<SHA512>(password, passwordLength, salt, saltLength, iterations, output, outputLength, firstBlock, blockCount);
+}
+
+void KDF_PBKDF2(KDFHash hash, const byte* password, size_t passwordLength, const byte* salt, size_t saltLength, unsigned int iterations, byte* output, size_t outputLength){
+	const size_t digestSize = KDF_DigestSize(hash);
+	KDF_PBKDF2Blocks(hash, password, passwordLength, salt, saltLength, iterations, output, outputLength, 0, (outputLength + digestSize - 1) / digestSize);
+}
+
+void KDF_HKDF(KDFHash hash, const byte* secret, size_t secretLength, const byte* salt, size_t saltLength, const byte* info, size_t infoLength, byte* output, size_t outputLength){
+	if (hash == KDF_SHA1) HKDF_DeriveKey<SHA1>(output, outputLength, secret, secretLength, salt, saltLength, info, infoLength);
+	else if (hash == KDF_SHA256) HKDF_DeriveKey<SHA256>(output, outputLength, secret, secretLength, salt, saltLength, info, infoLength);
+	else HKDF_DeriveKey<SHA512>(output, outputLength, secret, secretLength, salt, saltLength, info, infoLength);
+}
+
+/*
+* A derivation running on the thread pool, split into jobs. The output Buffer is written to directly, each job having its own blocks
+*/
+struct KDFTask {
+	KDFHash hash;
+	bool hkdf;
+	SecByteBlock password, salt, info;
+	unsigned int iterations;
+	byte* output;
+	size_t outputLength;
+	//Jobs not done yet
+	size_t pending;
+	Persistent<Object> outputHandle;
+	Persistent<Function> callback;
+};
+
+struct KDFJob {
+	uv_work_t request;
+	KDFTask* task;
+	size_t firstBlock, blockCount;
+};
+
+static void KDFWork(uv_work_t* req){
+	KDFJob* job = static_cast<KDFJob*>(req->data);
+	KDFTask* task = job->task;
+	if (task->hkdf) KDF_HKDF(task->hash, task->password.BytePtr(), task->password.size(), task->salt.BytePtr(), task->salt.size(), task->info.BytePtr(), task->info.size(), task->output, task->outputLength);
+	else KDF_PBKDF2Blocks(task->hash, task->password.BytePtr(), task->password.size(), task->salt.BytePtr(), task->salt.size(), task->iterations, task->output, task->outputLength, job->firstBlock, job->blockCount);
+}
+
+//Back on the main thread. The last job to finish calls the callback
+static void KDFDone(uv_work_t* req, int status){
+	HandleScope scope;
+	KDFJob* job = static_cast<KDFJob*>(req->data);
+	KDFTask* task = job->task;
+	delete job;
+	if (--task->pending > 0) return;
+	Local<Value> result = Local<Value>::New(task->outputHandle);
+	Local<Function> callback = Local<Function>::New(task->callback);
+	task->outputHandle.Dispose();
+	task->callback.Dispose();
+	delete task;
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { result };
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+static void queueJob(KDFTask* task, size_t firstBlock, size_t blockCount){
+	KDFJob* job = new KDFJob();
+	job->request.data = job;
+	job->task = task;
+	job->firstBlock = firstBlock;
+	job->blockCount = blockCount;
+	uv_queue_work(uv_default_loop(), &job->request, KDFWork, KDFDone);
+}
+
+//A Buffer, or a string (UTF-8 encoded). Throws a TypeError and returns false otherwise
+static bool getBytes(Local<Value> value, const char* name, SecByteBlock& bytes){
+	if (node::Buffer::HasInstance(value)){
+		bytes.Assign((const byte*) node::Buffer::Data(value->ToObject()), node::Buffer::Length(value->ToObject()));
+		return true;
+	}
+	if (value->IsString()){
+		String::Utf8Value str(value);
+		bytes.Assign((const byte*) *str, str.length());
+		return true;
+	}
+	ThrowException(v8::Exception::TypeError(String::New((string(name) + " must be a Buffer or a string").c_str())));
+	return false;
+}
+
+//Method signature : cryptopp.kdf.pbkdf2(password, salt, iterations, keyLength, [hashName], [callback(key)]) : hashName is "sha1", "sha256" (default) or "sha512". With a callback, the derivation runs on the thread pool
+static Handle<Value> kdfPBKDF2(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 4 && args.Length() <= 6)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	KDFTask* task = new KDFTask();
+	task->hkdf = false;
+	task->hash = KDF_SHA256;
+	if (!(getBytes(args[0], "password", task->password) && getBytes(args[1], "salt", task->salt))){
+		delete task;
+		return scope.Close(Undefined());
+	}
+	if (!(args[2]->IsUint32() && args[2]->Uint32Value() > 0)){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("iterations must be a positive integer")));
+		return scope.Close(Undefined());
+	}
+	task->iterations = args[2]->Uint32Value();
+	if (!(args[3]->IsUint32() && args[3]->Uint32Value() > 0)){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("keyLength must be a positive integer")));
+		return scope.Close(Undefined());
+	}
+	task->outputLength = args[3]->Uint32Value();
+	if (task->outputLength > BUFFER_MAX_LENGTH){
+		delete task;
+		ThrowException(v8::Exception::RangeError(String::New("keyLength must be at most 1073741823")));
+		return scope.Close(Undefined());
+	}
+	//The callback can take the place of hashName
+	const bool callbackAsHash = args.Length() == 5 && args[4]->IsFunction();
+	if (args.Length() >= 5 && !args[4]->IsUndefined() && !callbackAsHash){
+		String::AsciiValue hashNameVal(args[4]->ToString());
+		if (!KDF_GetHash(string(*hashNameVal), task->hash)){
+			delete task;
+			ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name. Possible values are \"sha1\", \"sha256\" and \"sha512\"")));
+			return scope.Close(Undefined());
+		}
+	}
+	Local<Object> output = Local<Object>::New(node::Buffer::New(task->outputLength)->handle_);
+	task->output = (byte*) node::Buffer::Data(output);
+	Local<Value> callbackVal = callbackAsHash ? args[4] : (args.Length() == 6 ? args[5] : Local<Value>());
+	if (callbackVal.IsEmpty() || callbackVal->IsUndefined()){
+		KDF_PBKDF2(task->hash, task->password.BytePtr(), task->password.size(), task->salt.BytePtr(), task->salt.size(), task->iterations, task->output, task->outputLength);
+		delete task;
+		return scope.Close(output);
+	}
+	if (!callbackVal->IsFunction()){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("callback must be a function")));
+		return scope.Close(Undefined());
+	}
+	//Blocks are spread evenly over the jobs
+	const size_t digestSize = KDF_DigestSize(task->hash), blocks = (task->outputLength + digestSize - 1) / digestSize;
+	const size_t jobs = blocks < ThreadPoolSize() ? blocks : ThreadPoolSize();
+	task->pending = jobs;
+	task->outputHandle = Persistent<Object>::New(output);
+	task->callback = Persistent<Function>::New(Local<Function>::Cast(callbackVal));
+	for (size_t i = 0, firstBlock = 0; i < jobs; i++){
+		const size_t blockCount = blocks / jobs + (i < blocks % jobs ? 1 : 0);
+		queueJob(task, firstBlock, blockCount);
+		firstBlock += blockCount;
+	}
+	return scope.Close(Undefined());
+}
+
+//Method signature : cryptopp.kdf.hkdf(secret, keyLength, [options], [callback(key)]) : options is {hashName ("sha1", "sha256" (default) or "sha512"), salt, info}. With a callback, the derivation runs on the thread pool
+static Handle<Value> kdfHKDF(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 2 && args.Length() <= 4)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	KDFTask* task = new KDFTask();
+	task->hkdf = true;
+	task->hash = KDF_SHA256;
+	task->iterations = 0;
+	if (!getBytes(args[0], "secret", task->password)){
+		delete task;
+		return scope.Close(Undefined());
+	}
+	if (!(args[1]->IsUint32() && args[1]->Uint32Value() > 0)){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("keyLength must be a positive integer")));
+		return scope.Close(Undefined());
+	}
+	task->outputLength = args[1]->Uint32Value();
+	//The callback can take the place of options
+	const bool callbackAsOptions = args.Length() == 3 && args[2]->IsFunction();
+	if (args.Length() >= 3 && !args[2]->IsUndefined() && !callbackAsOptions){
+		if (!(args[2]->IsObject() && !args[2]->IsFunction())){
+			delete task;
+			ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+			return scope.Close(Undefined());
+		}
+		Local<Object> optionsObj = Local<Object>::Cast(args[2]);
+		Local<Value> hashNameVal = optionsObj->Get(String::NewSymbol("hashName"));
+		if (!hashNameVal->IsUndefined()){
+			String::AsciiValue hashNameStr(hashNameVal->ToString());
+			if (!KDF_GetHash(string(*hashNameStr), task->hash)){
+				delete task;
+				ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name. Possible values are \"sha1\", \"sha256\" and \"sha512\"")));
+				return scope.Close(Undefined());
+			}
+		}
+		Local<Value> saltVal = optionsObj->Get(String::NewSymbol("salt")), infoVal = optionsObj->Get(String::NewSymbol("info"));
+		if ((!saltVal->IsUndefined() && !getBytes(saltVal, "salt", task->salt)) || (!infoVal->IsUndefined() && !getBytes(infoVal, "info", task->info))){
+			delete task;
+			return scope.Close(Undefined());
+		}
+	}
+	if (task->outputLength > 255 * KDF_DigestSize(task->hash)){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("keyLength can't exceed 255 times the digest size")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> output = Local<Object>::New(node::Buffer::New(task->outputLength)->handle_);
+	task->output = (byte*) node::Buffer::Data(output);
+	Local<Value> callbackVal = callbackAsOptions ? args[2] : (args.Length() == 4 ? args[3] : Local<Value>());
+	if (callbackVal.IsEmpty() || callbackVal->IsUndefined()){
+		KDF_HKDF(task->hash, task->password.BytePtr(), task->password.size(), task->salt.BytePtr(), task->salt.size(), task->info.BytePtr(), task->info.size(), task->output, task->outputLength);
+		delete task;
+		return scope.Close(output);
+	}
+	if (!callbackVal->IsFunction()){
+		delete task;
+		ThrowException(v8::Exception::TypeError(String::New("callback must be a function")));
+		return scope.Close(Undefined());
+	}
+	//HKDF blocks are chained : a single job
+	task->pending = 1;
+	task->outputHandle = Persistent<Object>::New(output);
+	task->callback = Persistent<Function>::New(Local<Function>::Cast(callbackVal));
+	queueJob(task, 0, 0);
+	return scope.Close(Undefined());
+}
+
+void KDF_Init(Handle<Object> exports){
+	Local<Object> kdfObj = Object::New();
+	kdfObj->Set(String::NewSymbol("pbkdf2"), FunctionTemplate::New(kdfPBKDF2)->GetFunction());
+	kdfObj->Set(String::NewSymbol("hkdf"), FunctionTemplate::New(kdfHKDF)->GetFunction());
+	exports->Set(String::NewSymbol("kdf"), kdfObj);
+}
@@ -0,0 +1,37 @@
+#ifndef KDF_H
+#define KDF_H
+
+#include <string>
+
+#include <cryptopp/config.h>
+
+#include <node.h>
+
+/*
+* Key derivation functions, exposed as cryptopp.kdf : PBKDF2 (PKCS #5 v2, RFC 8018) and HKDF (RFC 5869, see hkdf.h) with HMAC-SHA1, SHA256 or SHA512.
+* With a callback, derivations run on the libuv thread pool. PBKDF2 output blocks don't depend on each other,
+* so multi-block outputs are split across several jobs that run in parallel.
+*/
+enum KDFHash {
+	KDF_SHA1,
+	KDF_SHA256,
+	KDF_SHA512
+};
+
+//Returns false if the hash name is unknown ("sha1", "sha256" or "sha512")
+bool KDF_GetHash(std::string const& name, KDFHash& hash);
+size_t KDF_DigestSize(KDFHash hash);
+
+/*
+* Computes the PBKDF2 output blocks firstBlock to firstBlock + blockCount - 1 (blocks being numbered from 0) of an outputLength-byte key.
+* output is the whole key : each block is written at its own offset, so that several calls on different blocks can run at the same time
+*/
+void KDF_PBKDF2Blocks(KDFHash hash, const byte* password, size_t passwordLength, const byte* salt, size_t saltLength, unsigned int iterations, byte* output, size_t outputLength, size_t firstBlock, size_t blockCount);
+void KDF_PBKDF2(KDFHash hash, const byte* password, size_t passwordLength, const byte* salt, size_t saltLength, unsigned int iterations, byte* output, size_t outputLength);
+//Throws a CryptoPP::InvalidArgument if outputLength is more than 255 digests
+void KDF_HKDF(KDFHash hash, const byte* secret, size_t secretLength, const byte* salt, size_t saltLength, const byte* info, size_t infoLength, byte* output, size_t outputLength);
+
+//Sets the cryptopp.kdf object
+void KDF_Init(v8::Handle<v8::Object> exports);
+
+#endif
@@ -0,0 +1,216 @@
+//Std imports
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+//POSIX imports
+#include <sys/mman.h>
+#include <unistd.h>
+
+//Crypto++ imports
+#include <cryptopp/sha.h>
+using CryptoPP::SHA256;
+
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+//Node and class headers import
+#include <node.h>
+#include <uv.h>
+#include "kekcache.h"
+
+using namespace v8;
+using namespace std;
+
+struct KEKCacheEntry {
+	bool used;
+	KDFHash hash;
+	unsigned int iterations;
+	//Entries are ordered by last use, for replacement
+	uint64_t lastUse;
+	byte salt[KEKCACHE_SALT_LENGTH];
+	//SHA-256(salt || passphrase)
+	byte passphraseDigest[SHA256::DIGESTSIZE];
+	byte kek[KEKCACHE_KEY_LENGTH];
+};
+
+//0 while the cache is disabled. Guarded by cacheMutex
+static uv_once_t cacheOnce = UV_ONCE_INIT;
+static uv_mutex_t cacheMutex;
+static KEKCacheEntry* entries = 0;
+static size_t entryCount = 0, mappedLength = 0;
+static uint64_t useCounter = 0;
+
+static void initCacheMutex(){
+	uv_mutex_init(&cacheMutex);
+}
+
+static void lockCache(){
+	uv_once(&cacheOnce, initCacheMutex);
+	uv_mutex_lock(&cacheMutex);
+}
+
+static void getPassphraseDigest(const byte* salt, string const& passphrase, byte* digest){
+	SHA256 hash;
+	hash.Update(salt, KEKCACHE_SALT_LENGTH);
+	hash.Update((const byte*) passphrase.data(), passphrase.size());
+	hash.Final(digest);
+}
+
+//Wipes and unmaps the entries. Called with the mutex held
+static void releaseEntries(){
+	if (entries == 0) return;
+	SecureWipeArray((byte*) entries, mappedLength);
+	munlock(entries, mappedLength);
+	munmap(entries, mappedLength);
+	entries = 0;
+	entryCount = 0;
+	mappedLength = 0;
+}
+
+//Returns false if the pages can't be mapped. They are still used if they can't be locked (RLIMIT_MEMLOCK being too low). Called with the mutex held
+static bool allocateEntries(size_t count){
+	const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t length = (count * sizeof(KEKCacheEntry) + pageSize - 1) / pageSize * pageSize;
+	void* region = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED) return false;
+	mlock(region, length);
+#ifdef MADV_DONTDUMP
+	madvise(region, length, MADV_DONTDUMP);
+#endif
+	//Anonymous pages are zeroed : every entry is unused
+	entries = static_cast<KEKCacheEntry*>(region);
+	entryCount = count;
+	mappedLength = length;
+	return true;
+}
+
+//Index of the entry of the passphrase, or -1. A null salt matches any salt. Called with the mutex held
+static long findEntry(KDFHash hash, unsigned int iterations, string const& passphrase, const byte* salt){
+	byte digest[SHA256::DIGESTSIZE];
+	long found = -1;
+	for (size_t i = 0; i < entryCount && found < 0; i++){
+		KEKCacheEntry const& entry = entries[i];
+		if (!entry.used || entry.hash != hash || entry.iterations != iterations) continue;
+		if (salt != 0 && memcmp(entry.salt, salt, KEKCACHE_SALT_LENGTH) != 0) continue;
+		getPassphraseDigest(entry.salt, passphrase, digest);
+		if (CryptoPP::VerifyBufsEqual(digest, entry.passphraseDigest, sizeof(digest))) found = (long) i;
+	}
+	SecureWipeArray(digest, sizeof(digest));
+	return found;
+}
+
+bool KEKCache_Derive(KDFHash hash, unsigned int iterations, string const& passphrase, const byte* salt, byte* kek){
+	lockCache();
+	const long cached = entries != 0 ? findEntry(hash, iterations, passphrase, salt) : -1;
+	if (cached >= 0){
+		memcpy(kek, entries[cached].kek, KEKCACHE_KEY_LENGTH);
+		entries[cached].lastUse = ++useCounter;
+	}
+	uv_mutex_unlock(&cacheMutex);
+	if (cached >= 0) return true;
+	//Derived without holding the lock, for other files to be opened meanwhile
+	KDF_PBKDF2(hash, (const byte*) passphrase.data(), passphrase.size(), salt, KEKCACHE_SALT_LENGTH, iterations, kek, KEKCACHE_KEY_LENGTH);
+	return false;
+}
+
+void KEKCache_Store(KDFHash hash, unsigned int iterations, string const& passphrase, const byte* salt, const byte* kek){
+	lockCache();
+	//Another thread may have derived the same key meanwhile
+	if (entries != 0 && findEntry(hash, iterations, passphrase, salt) < 0){
+		//A free entry, or the least recently used one
+		size_t replaced = 0;
+		for (size_t i = 0; i < entryCount; i++){
+			if (!entries[i].used){
+				replaced = i;
+				break;
+			}
+			if (entries[i].lastUse < entries[replaced].lastUse) replaced = i;
+		}
+		KEKCacheEntry& entry = entries[replaced];
+		entry.used = true;
+		entry.hash = hash;
+		entry.iterations = iterations;
+		entry.lastUse = ++useCounter;
+		memcpy(entry.salt, salt, KEKCACHE_SALT_LENGTH);
+		getPassphraseDigest(salt, passphrase, entry.passphraseDigest);
+		memcpy(entry.kek, kek, KEKCACHE_KEY_LENGTH);
+	}
+	uv_mutex_unlock(&cacheMutex);
+}
+
+bool KEKCache_Find(KDFHash hash, unsigned int iterations, string const& passphrase, byte* salt, byte* kek){
+	lockCache();
+	const long cached = entries != 0 ? findEntry(hash, iterations, passphrase, 0) : -1;
+	if (cached >= 0){
+		memcpy(salt, entries[cached].salt, KEKCACHE_SALT_LENGTH);
+		memcpy(kek, entries[cached].kek, KEKCACHE_KEY_LENGTH);
+		entries[cached].lastUse = ++useCounter;
+	}
+	uv_mutex_unlock(&cacheMutex);
+	return cached >= 0;
+}
+
+/*
+* Signature
+* Number entries [optional] : maximum number of cached keys, 16 by default
+* Enables the cache. Cached keys are dropped (and wiped) if it was already enabled
+*/
+static Handle<Value> kekCacheEnable(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() > 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	size_t count = KEKCACHE_DEFAULT_ENTRIES;
+	if (args.Length() == 1 && !args[0]->IsUndefined()){
+		if (!args[0]->IsNumber()){
+			ThrowException(Exception::TypeError(String::New("entries must be a number")));
+			return scope.Close(Undefined());
+		}
+		const int64_t value = args[0]->IntegerValue();
+		if (value < 1 || value > (int64_t) KEKCACHE_MAX_ENTRIES){
+			ThrowException(Exception::RangeError(String::New("entries must be between 1 and 4096")));
+			return scope.Close(Undefined());
+		}
+		count = (size_t) value;
+	}
+	lockCache();
+	releaseEntries();
+	const bool allocated = allocateEntries(count);
+	uv_mutex_unlock(&cacheMutex);
+	if (!allocated){
+		ThrowException(Exception::Error(String::New("The key cache memory can't be allocated")));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(Undefined());
+}
+
+//No params. Wipes the cached keys, and disables the cache
+static Handle<Value> kekCacheDisable(const Arguments& args){
+	HandleScope scope;
+	lockCache();
+	releaseEntries();
+	uv_mutex_unlock(&cacheMutex);
+	return scope.Close(Undefined());
+}
+
+//No params. Number of cached keys
+static Handle<Value> kekCacheSize(const Arguments& args){
+	HandleScope scope;
+	lockCache();
+	size_t size = 0;
+	for (size_t i = 0; i < entryCount; i++){
+		if (entries[i].used) size++;
+	}
+	uv_mutex_unlock(&cacheMutex);
+	return scope.Close(Number::New(size));
+}
+
+void KEKCache_Init(Handle<Object> exports){
+	Local<Object> kekCacheObj = Object::New();
+	kekCacheObj->Set(String::NewSymbol("enable"), FunctionTemplate::New(kekCacheEnable)->GetFunction());
+	kekCacheObj->Set(String::NewSymbol("disable"), FunctionTemplate::New(kekCacheDisable)->GetFunction());
+	kekCacheObj->Set(String::NewSymbol("size"), FunctionTemplate::New(kekCacheSize)->GetFunction());
+	exports->Set(String::NewSymbol("kekCache"), kekCacheObj);
+}
@@ -0,0 +1,38 @@
+#ifndef KEKCACHE_H
+#define KEKCACHE_H
+
+#include <string>
+
+#include <cryptopp/config.h>
+
+#include <node.h>
+
+#include "kdf.h"
+
+//Length of key-encryption keys : ChaCha20-Poly1305 keys
+static const size_t KEKCACHE_KEY_LENGTH = 32;
+static const size_t KEKCACHE_SALT_LENGTH = 16;
+static const size_t KEKCACHE_DEFAULT_ENTRIES = 16;
+static const size_t KEKCACHE_MAX_ENTRIES = 4096;
+
+/*
+* Cache of the key-encryption keys derived from passphrases (PBKDF2) to encrypt and decrypt key files, exposed as cryptopp.kekCache.
+* Disabled by default. When enabled, a key is derived once per (passphrase, KDF, iterations, salt) : key files written with a passphrase
+* that has a cached key reuse its salt, so that opening many files saved with one passphrase costs a single derivation.
+* Entries are kept in a fixed array of mlock'ed pages (excluded from core dumps where madvise allows it), least recently used entries
+* being replaced, and are wiped when the cache is disabled. Entries are matched on SHA-256(salt || passphrase) rather than on the passphrase.
+* Thread-safe : key files are decrypted on the thread pool.
+*/
+
+//Copies the key-encryption key of the passphrase and salt (KEKCACHE_KEY_LENGTH bytes) from the cache into kek and returns true, or derives it and returns false.
+//A derived key isn't cached : it is given to KEKCache_Store once it has proven right (the key file's tag verifies), for wrong passphrases not to evict valid keys
+bool KEKCache_Derive(KDFHash hash, unsigned int iterations, std::string const& passphrase, const byte* salt, byte* kek);
+//Caches a key given by KEKCache_Derive, in place of the least recently used one. Does nothing if the cache is disabled
+void KEKCache_Store(KDFHash hash, unsigned int iterations, std::string const& passphrase, const byte* salt, const byte* kek);
+//Sets salt (KEKCACHE_SALT_LENGTH bytes) and kek from a cached key of the passphrase, and returns true; returns false if there's none
+bool KEKCache_Find(KDFHash hash, unsigned int iterations, std::string const& passphrase, byte* salt, byte* kek);
+
+//Sets the cryptopp.kekCache object
+void KEKCache_Init(v8::Handle<v8::Object> exports);
+
+#endif
@@ -32,6 +32,19 @@ var isEcdsaValid = cryptopp.ecdsa.prime.verify(ecdsaMessage, ecdsaSignature, ecd
 //Unit test : invalid signature
 assert.equal(isEcdsaValid, true, 'ERROR : the ECDSA signature seems invalid');
 log('ECDSA signature is valid');
+var ecdsaDetSignature = ecdsaKeyRing.sign(ecdsaMessage, undefined, {hashName: 'sha256', deterministic: true});
+assert.equal(ecdsaDetSignature, ecdsaKeyRing.sign(ecdsaMessage, undefined, {hashName: 'sha256', deterministic: true}), 'ERROR : deterministic ECDSA signatures are not reproducible');
+assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, ecdsaDetSignature, ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : the deterministic ECDSA signature seems invalid');
+//Signing with precomputed nonces. The first signatures may be made before the pool gets filled; they must be valid either way
+ecdsaKeyRing.enableNoncePool({size: 8, refillThreshold: 2});
+for (var i = 0; i < 16; i++){
+	var pooledSignature = ecdsaKeyRing.sign(ecdsaMessage, undefined, 'sha256');
+	assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, pooledSignature, ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : ECDSA signature made with a precomputed nonce seems invalid');
+}
+ecdsaKeyRing.disableNoncePool();
+var batchSignatures = ecdsaKeyRing.signBatch([ecdsaMessage, 'Another message'], 'hex', 'sha256');
+assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, batchSignatures[0], ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : the batch ECDSA signature seems invalid');
+assert.equal(cryptopp.ecdsa.prime.verify('Another message', batchSignatures[1], ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : the batch ECDSA signature seems invalid');
 //Method clear to be called when you're done with the key ring, the keypair is flushed from memory
 ecdsaKeyRing.clear();
 ecdsaKeyRing2.clear();
@@ -58,9 +71,111 @@ var eciesDecrypted = eciesKeyRing.decrypt(eciesCipher);
 //Unit test : checking that the plaintexts are the same
 log('eciesMessage : ' + eciesMessage + '\neciesDecrypted : ' + eciesDecrypted);
 assert.equal(eciesDecrypted == eciesMessage, true, 'ERROR : ECIES plaintexts are not the same');
+var eciesAEADCipher = cryptopp.ecies.prime.encrypt(eciesMessage, eciesPubKey.publicKey, eciesPubKey.curveName, {dem: 'chacha20-poly1305'});
+assert.equal(eciesKeyRing2.decrypt(eciesAEADCipher), eciesMessage, 'ERROR : ECIES plaintexts are not the same (ChaCha20-Poly1305)');
+//Compressed ephemeral point with the default DEM : told apart from ChaCha20-Poly1305 ciphertexts, that start the same way
+var eciesCompressedCipher = cryptopp.ecies.prime.encrypt(eciesMessage, eciesPubKey.publicKey, eciesPubKey.curveName, {dem: 'xor-hmac', compressed: true});
+assert.equal(eciesKeyRing2.decrypt(eciesCompressedCipher), eciesMessage, 'ERROR : ECIES plaintexts are not the same (xor-hmac, compressed point)');
+var otherEciesKeyPair = cryptopp.ecies.prime.generateKeyPair(eciesPubKey.curveName);
+var eciesEnvelope = cryptopp.ecies.prime.encryptMulti(eciesMessage, [otherEciesKeyPair.publicKey, eciesPubKey.publicKey], eciesPubKey.curveName);
+assert.equal(eciesKeyRing2.decrypt(eciesEnvelope), eciesMessage, 'ERROR : ECIES plaintexts are not the same (multi-recipient envelope)');
+//Passphrase-protected key file
+eciesKeyRing.save('./eciesKeyRingEncrypted.key', 'passphrase');
+var eciesKeyRing3 = new cryptopp.KeyRing();
+assert.throws(function(){
+	eciesKeyRing3.load('./eciesKeyRingEncrypted.key', false, 'wrong passphrase');
+}, TypeError, 'ERROR : the encrypted key file has been loaded with a wrong passphrase');
+assert.deepEqual(eciesKeyRing3.load('./eciesKeyRingEncrypted.key', false, 'passphrase'), eciesPubKey, 'ERROR : the encrypted key file didn\'t load the same key');
+assert.equal(eciesKeyRing3.decrypt(eciesCipher), eciesMessage, 'ERROR : ECIES plaintexts are not the same (encrypted key file)');
+eciesKeyRing3.clear();
+//Key files are written in the version 3 format, with a checksum
+var eciesKeyFile = fs.readFileSync('./eciesKeyRing.key');
+assert.equal(eciesKeyFile.slice(0, 4).toString('hex'), '4e434b03', 'ERROR : the key file isn\'t in the version 3 format');
+eciesKeyFile[eciesKeyFile.length - 10] ^= 0x01;
+fs.writeFileSync('./eciesKeyRingDamaged.key', eciesKeyFile);
+assert.throws(function(){
+	eciesKeyRing3.load('./eciesKeyRingDamaged.key');
+}, TypeError, 'ERROR : a damaged key file has been loaded');
+fs.unlinkSync('./eciesKeyRingDamaged.key');
+//Key files in the previous format (hex values) can still be loaded
+var previousKeyPair = cryptopp.ecies.prime.generateKeyPair('secp256r1');
+var previousKeyFields = [previousKeyPair.publicKey.x, previousKeyPair.publicKey.y, previousKeyPair.privateKey].map(function(value){
+	return Buffer.concat([new Buffer([value.length >> 8, value.length & 0xff]), new Buffer(value, 'ascii')]);
+});
+fs.writeFileSync('./eciesKeyRingPrevious.key', Buffer.concat([new Buffer([0x04, 0x0c])].concat(previousKeyFields)));
+assert.equal(eciesKeyRing3.load('./eciesKeyRingPrevious.key').publicKey.x, previousKeyPair.publicKey.x, 'ERROR : the previous key file format isn\'t read');
+assert.equal(eciesKeyRing3.decrypt(cryptopp.ecies.prime.encrypt(eciesMessage, previousKeyPair.publicKey, 'secp256r1')), eciesMessage, 'ERROR : ECIES plaintexts are not the same (previous key file format)');
+eciesKeyRing3.clear();
+fs.unlinkSync('./eciesKeyRingPrevious.key');
+//Encrypted key files are binary, with the KDF and its cost in the header, which is authenticated
+var encryptedKeyFile = fs.readFileSync('./eciesKeyRingEncrypted.key');
+assert.equal(encryptedKeyFile.slice(0, 12).toString('hex'), '4e434b450102010000002000', 'ERROR : invalid encrypted key file header');
+eciesKeyRing.save('./eciesKeyRingEncrypted.key', 'passphrase', {iterations: 1000, kdf: 'sha512'});
+encryptedKeyFile = fs.readFileSync('./eciesKeyRingEncrypted.key');
+assert.equal(encryptedKeyFile.slice(4, 12).toString('hex'), '01030100000003e8', 'ERROR : the KDF options weren\'t written in the encrypted key file');
+assert.deepEqual(eciesKeyRing3.load('./eciesKeyRingEncrypted.key', false, 'passphrase'), eciesPubKey, 'ERROR : the encrypted key file (custom KDF) didn\'t load the same key');
+eciesKeyRing3.clear();
+assert.throws(function(){
+	eciesKeyRing.save('./eciesKeyRingEncrypted.key', 'passphrase', {iterations: 0});
+}, TypeError, 'ERROR : a key file was saved with 0 iterations');
+assert.throws(function(){
+	eciesKeyRing.save('./eciesKeyRingEncrypted.key', 'passphrase', {kdf: 'md5'});
+}, TypeError, 'ERROR : a key file was saved with an unknown KDF');
+encryptedKeyFile[11] ^= 0x01;
+fs.writeFileSync('./eciesKeyRingDamaged.key', encryptedKeyFile);
+assert.throws(function(){
+	eciesKeyRing3.load('./eciesKeyRingDamaged.key', false, 'passphrase');
+}, TypeError, 'ERROR : an encrypted key file with a modified header has been loaded');
+fs.unlinkSync('./eciesKeyRingDamaged.key');
+//Encrypted key files in the previous format (3 lines of hex, PBKDF2-HMAC-SHA1) can still be loaded
+var previousSalt = new Buffer(cryptopp.randomBytes(16), 'hex'), previousNonce = new Buffer(cryptopp.randomBytes(12), 'hex');
+var previousKey = cryptopp.kdf.pbkdf2('passphrase', previousSalt, 8192, 32, 'sha1');
+var previousEncrypted = cryptopp.aead.encrypt('chacha20-poly1305', previousKey, previousNonce, fs.readFileSync('./eciesKeyRing.key'), {aad: previousSalt});
+fs.writeFileSync('./eciesKeyRingPrevious.key', [previousSalt, previousNonce, previousEncrypted].map(function(value){ return value.toString('hex'); }).join('\n'));
+assert.deepEqual(eciesKeyRing3.load('./eciesKeyRingPrevious.key', false, 'passphrase'), eciesPubKey, 'ERROR : the previous encrypted key file format isn\'t read');
+eciesKeyRing3.clear();
+fs.unlinkSync('./eciesKeyRingPrevious.key');
+//Cached key-encryption keys : files saved with one passphrase share their salt
+cryptopp.kekCache.enable(4);
+eciesKeyRing.save('./eciesKeyRingCached1.key', 'cached passphrase');
+eciesKeyRing.save('./eciesKeyRingCached2.key', 'cached passphrase');
+assert.equal(cryptopp.kekCache.size(), 1, 'ERROR : invalid number of cached keys');
+assert.equal(fs.readFileSync('./eciesKeyRingCached1.key').slice(12, 28).toString('hex'), fs.readFileSync('./eciesKeyRingCached2.key').slice(12, 28).toString('hex'), 'ERROR : key files saved with a cached key don\'t share their salt');
+assert.deepEqual(eciesKeyRing3.load('./eciesKeyRingCached2.key', false, 'cached passphrase'), eciesPubKey, 'ERROR : the key file didn\'t load the same key (cached key)');
+assert.throws(function(){
+	eciesKeyRing3.load('./eciesKeyRingCached1.key', false, 'wrong passphrase');
+}, TypeError, 'ERROR : a key file has been loaded with a wrong passphrase (cached key)');
+assert.equal(cryptopp.kekCache.size(), 1, 'ERROR : the key of a wrong passphrase has been cached');
+cryptopp.kekCache.disable();
+assert.equal(cryptopp.kekCache.size(), 0, 'ERROR : the key cache wasn\'t emptied');
+assert.deepEqual(eciesKeyRing3.load('./eciesKeyRingCached1.key', false, 'cached passphrase'), eciesPubKey, 'ERROR : the key file didn\'t load the same key (disabled cache)');
+eciesKeyRing3.clear();
+assert.throws(function(){
+	cryptopp.kekCache.enable(0);
+}, RangeError, 'ERROR : the key cache was enabled with 0 entries');
+fs.unlinkSync('./eciesKeyRingCached1.key');
+fs.unlinkSync('./eciesKeyRingCached2.key');
 eciesKeyRing.clear();
 eciesKeyRing2.clear();
 
+log('\n### Compressed public keys ###');
+var compressedKeyRing = new cryptopp.KeyRing();
+var compressedPubKey = compressedKeyRing.createKeyPair('ecdsa', {curveName: 'secp256r1', compressed: true}, './compressedKeyRing.key');
+log('Compressed ECDSA public key : ' + JSON.stringify(compressedPubKey));
+assert.equal(compressedPubKey.publicKey.length, 66, 'ERROR : the public key isn\'t compressed');
+var compressedKeyRing2 = new cryptopp.KeyRing();
+assert.deepEqual(compressedKeyRing2.load('./compressedKeyRing.key'), compressedPubKey, 'ERROR : generated key and loaded key are not the same (compressed public key)');
+var compressedSignature = compressedKeyRing2.sign('Compressed keys', 'hex', 'sha256');
+assert.equal(cryptopp.ecdsa.prime.verify('Compressed keys', compressedSignature, compressedPubKey.publicKey, 'secp256r1', 'sha256'), true, 'ERROR : the signature couldn\'t be verified with the compressed public key');
+compressedKeyRing.clear();
+compressedKeyRing2.clear();
+compressedPubKey = compressedKeyRing.createKeyPair('ecies', {curveName: 'secp256r1', compressed: true});
+compressedKeyRing.save('./compressedKeyRing.key');
+compressedKeyRing2.load('./compressedKeyRing.key');
+assert.equal(compressedKeyRing2.decrypt(cryptopp.ecies.prime.encrypt(eciesMessage, compressedPubKey.publicKey, 'secp256r1', {compressed: true})), eciesMessage, 'ERROR : ECIES plaintexts are not the same (compressed public key)');
+compressedKeyRing.clear();
+compressedKeyRing2.clear();
+
 log('\n### ECDH ###');
 var ecdhKeyRing = new cryptopp.KeyRing();
 var ecdhPubKey = ecdhKeyRing.createKeyPair("ecdh", "secp256r1");
@@ -71,17 +186,111 @@ var ecdhKeyRing2 = new cryptopp.KeyRing();
 ecdhKeyRing2.load('./ecdhKeyRing.key');
 log('Save/load test succeeded');
 var ecdhKeyRing3 = new cryptopp.KeyRing();
-var ecdhPubKey3 = ecdhKeyRing3.createKeyPair('ecdh', 'secp256r1');
+//A compressed public key on one side only
+var ecdhPubKey3 = ecdhKeyRing3.createKeyPair('ecdh', {curveName: 'secp256r1', compressed: true});
+assert.equal(ecdhPubKey3.publicKey.length, 66, 'ERROR : the ECDH public key isn\'t compressed');
 log('ECDH public key 2 : ' + JSON.stringify(ecdhPubKey3));
 var secret1 = ecdhKeyRing.agree(ecdhPubKey3);
 var secret2 = ecdhKeyRing3.agree(ecdhPubKey);
 log('ECDH secret 1 : ' + secret1 + '\nECDH secret 2 : ' + secret2);
 assert.equal(secret1, secret2, 'ERROR : ECDH shared secrets are different!');
 log('ECDH shared secert: ' + secret1);
+assert.equal(secret1.length, 64, 'ERROR : the ECDH shared secret doesn\'t have a fixed length');
+//Sessions : each side decrypts what the other encrypted
+['aes-gcm', 'chacha20-poly1305'].forEach(function(aead){
+	var session1 = ecdhKeyRing.openSession(ecdhPubKey3, {aead: aead, info: new Buffer('test')});
+	var session3 = ecdhKeyRing3.openSession(ecdhPubKey, {aead: aead, info: new Buffer('test')});
+	var sessionMessage = new Buffer('Message sent through a session');
+	var sealed1 = session1.encrypt(sessionMessage), sealed2 = session1.encrypt(sessionMessage, {aad: new Buffer('header')});
+	assert.equal(sealed1.length, sessionMessage.length + 24, 'ERROR : invalid session message length (' + aead + ')');
+	assert.notEqual(sealed1.toString('hex'), sealed2.toString('hex'), 'ERROR : the same session message was encrypted twice the same way (' + aead + ')');
+	assert.equal(session3.decrypt(sealed2, {aad: new Buffer('header')}).toString(), sessionMessage.toString(), 'ERROR : session plaintexts are not the same (' + aead + ')');
+	assert.equal(session3.decrypt(sealed1).toString(), sessionMessage.toString(), 'ERROR : session plaintexts are not the same (' + aead + ')');
+	assert.equal(session3.decrypt(sealed2), null, 'ERROR : a session message was decrypted without its associated data (' + aead + ')');
+	//Directions have different keys
+	assert.equal(session1.decrypt(sealed1), null, 'ERROR : a session decrypted its own message (' + aead + ')');
+	assert.equal(session1.decrypt(session3.encrypt(sessionMessage)).toString(), sessionMessage.toString(), 'ERROR : session plaintexts are not the same (' + aead + ')');
+	session1.close();
+	session3.close();
+	assert.throws(function(){
+		session1.encrypt(sessionMessage);
+	}, Error, 'ERROR : a closed session was used');
+});
+//x-only public key : x alone, without the 02 or 03 prefix
+var ecdhXOnlyPubKey3 = {keyType: 'ecdh', curveName: 'secp256r1', publicKey: ecdhPubKey3.publicKey.substring(2)};
+assert.equal(ecdhKeyRing2.agree(ecdhXOnlyPubKey3), secret1, 'ERROR : the ECDH shared secret is different with an x-only public key');
+var xOnlySession = ecdhKeyRing.openSession(ecdhXOnlyPubKey3), xOnlySession3 = ecdhKeyRing3.openSession(ecdhPubKey);
+assert.equal(xOnlySession3.decrypt(xOnlySession.encrypt(new Buffer('x-only'))).toString(), 'x-only', 'ERROR : session plaintexts are not the same (x-only public key)');
+xOnlySession.close();
+xOnlySession3.close();
 ecdhKeyRing.clear();
 ecdhKeyRing2.clear();
 ecdhKeyRing3.clear();
 
+log('\n### Binary curves ###');
+['sect233k1', 'sect283k1'].forEach(function(curveName){
+	var binaryKeyRing = new cryptopp.KeyRing();
+	var binaryPubKey = binaryKeyRing.createKeyPair('ecdsa', curveName, './binaryKeyRing.key');
+	log('ECDSA public key (' + curveName + ') : ' + JSON.stringify(binaryPubKey));
+	var binaryKeyRing2 = new cryptopp.KeyRing();
+	assert.deepEqual(binaryKeyRing2.load('./binaryKeyRing.key'), binaryPubKey, 'ERROR : generated key and loaded key are not the same (' + curveName + ')');
+	var binarySignature = binaryKeyRing2.sign(ecdsaMessage, undefined, 'sha256');
+	assert.equal(cryptopp.ecdsa.binary.verify(ecdsaMessage, binarySignature, binaryPubKey.publicKey, curveName, 'sha256'), true, 'ERROR : the ECDSA signature seems invalid (' + curveName + ')');
+	var binaryDetSignature = binaryKeyRing.sign(ecdsaMessage, undefined, {hashName: 'sha256', deterministic: true});
+	assert.equal(binaryDetSignature, binaryKeyRing2.sign(ecdsaMessage, undefined, {hashName: 'sha256', deterministic: true}), 'ERROR : deterministic ECDSA signatures are not reproducible (' + curveName + ')');
+	var binaryBatchSignatures = binaryKeyRing.signBatch([ecdsaMessage, 'Another message'], 'hex', 'sha1');
+	assert.equal(cryptopp.ecdsa.binary.verify('Another message', binaryBatchSignatures[1], binaryPubKey.publicKey, curveName, 'sha1'), true, 'ERROR : the batch ECDSA signature seems invalid (' + curveName + ')');
+	binaryKeyRing.clear();
+	binaryKeyRing2.clear();
+	//Compressed ECIES key pair, and compressed ciphertexts
+	binaryPubKey = binaryKeyRing.createKeyPair('ecies', {curveName: curveName, compressed: true});
+	binaryKeyRing.save('./binaryKeyRing.key');
+	assert.deepEqual(binaryKeyRing2.load('./binaryKeyRing.key'), binaryPubKey, 'ERROR : generated key and loaded key are not the same (' + curveName + ', compressed public key)');
+	assert.equal(binaryKeyRing2.decrypt(cryptopp.ecies.binary.encrypt(eciesMessage, binaryPubKey.publicKey, curveName)), eciesMessage, 'ERROR : ECIES plaintexts are not the same (' + curveName + ')');
+	assert.equal(binaryKeyRing2.decrypt(cryptopp.ecies.binary.encrypt(eciesMessage, binaryPubKey.publicKey, curveName, {compressed: true})), eciesMessage, 'ERROR : ECIES plaintexts are not the same (' + curveName + ', compressed ciphertext)');
+	binaryKeyRing.clear();
+	binaryKeyRing2.clear();
+	//ECDH, with a compressed public key on one side
+	var binaryEcdhPubKey = binaryKeyRing.createKeyPair('ecdh', curveName);
+	var binaryEcdhPubKey2 = binaryKeyRing2.createKeyPair('ecdh', {curveName: curveName, compressed: true});
+	var binarySecret = binaryKeyRing.agree(binaryEcdhPubKey2);
+	assert.equal(binarySecret, binaryKeyRing2.agree(binaryEcdhPubKey), 'ERROR : ECDH shared secrets are different! (' + curveName + ')');
+	assert.equal(binarySecret.length, curveName == 'sect233k1' ? 60 : 72, 'ERROR : the ECDH shared secret doesn\'t have a fixed length (' + curveName + ')');
+	binaryKeyRing.clear();
+	binaryKeyRing2.clear();
+});
+
+log('\n### X25519 ###');
+var x25519KeyRing = new cryptopp.KeyRing();
+var x25519PubKey = x25519KeyRing.createKeyPair('x25519');
+log('X25519 public key : ' + JSON.stringify(x25519PubKey));
+x25519KeyRing.save('./x25519KeyRing.key');
+var x25519KeyRing2 = new cryptopp.KeyRing();
+assert.equal(x25519KeyRing2.load('./x25519KeyRing.key').publicKey, x25519PubKey.publicKey, 'ERROR : generated key and loaded key are not the same');
+var x25519KeyRing3 = new cryptopp.KeyRing();
+var x25519PubKey3 = x25519KeyRing3.createKeyPair('x25519');
+assert.equal(x25519KeyRing2.agree(x25519PubKey3), x25519KeyRing3.agree(x25519PubKey), 'ERROR : X25519 shared secrets are different!');
+var x25519Session2 = x25519KeyRing2.openSession(x25519PubKey3), x25519Session3 = x25519KeyRing3.openSession(x25519PubKey);
+assert.equal(x25519Session3.decrypt(x25519Session2.encrypt(new Buffer('X25519 session'))).toString(), 'X25519 session', 'ERROR : X25519 session plaintexts are not the same');
+x25519Session2.close();
+x25519Session3.close();
+x25519KeyRing.clear();
+x25519KeyRing2.clear();
+x25519KeyRing3.clear();
+
+log('\n### Ed25519 ###');
+var ed25519KeyRing = new cryptopp.KeyRing();
+var ed25519PubKey = ed25519KeyRing.createKeyPair('ed25519', undefined, './ed25519KeyRing.key');
+log('Ed25519 public key : ' + JSON.stringify(ed25519PubKey));
+var ed25519Message = 'message to be signed by Ed25519';
+var ed25519Signature = ed25519KeyRing.sign(ed25519Message);
+assert.equal(cryptopp.ed25519.verify(ed25519Message, ed25519Signature, ed25519PubKey.publicKey), true, 'ERROR : Invalid Ed25519 signature');
+var ed25519KeyRing2 = new cryptopp.KeyRing();
+ed25519KeyRing2.load('./ed25519KeyRing.key');
+assert.equal(ed25519KeyRing2.sign(ed25519Message), ed25519Signature, 'ERROR : generated key and loaded key are not the same');
+ed25519KeyRing.clear();
+ed25519KeyRing2.clear();
+
 log('\n### RSA ###');
 var rsaKeyRing = new cryptopp.KeyRing();
 var rsaPubKey = rsaKeyRing.createKeyPair("rsa", 2048);
@@ -110,6 +319,48 @@ log('Save/load test succeeded');
 rsaKeyRing.clear();
 rsaKeyRing2.clear();
 
+log('\n### Multi-prime RSA ###');
+var multiPrimeKeyRing = new cryptopp.KeyRing();
+var multiPrimePubKey = multiPrimeKeyRing.createKeyPair("rsa", {keySize: 4096, primes: 4});
+var multiPrimeCipher = cryptopp.rsa.encrypt(rsaMessage, multiPrimePubKey.modulus, multiPrimePubKey.publicExponent);
+assert.equal(multiPrimeKeyRing.decrypt(multiPrimeCipher), rsaMessage, 'ERROR : multi-prime RSA plaintexts are not the same');
+multiPrimeKeyRing.save('./multiPrimeKeyRing.key');
+var multiPrimeKeyRing2 = new cryptopp.KeyRing();
+multiPrimeKeyRing2.load('./multiPrimeKeyRing.key');
+assert.equal(multiPrimeKeyRing2.publicKeyInfo().modulus, multiPrimePubKey.modulus, 'ERROR : generated multi-prime key and loaded key are not the same');
+assert.equal(multiPrimeKeyRing2.decrypt(multiPrimeCipher), rsaMessage, 'ERROR : the loaded multi-prime RSA key can\'t decrypt');
+var multiPrimeSignature = multiPrimeKeyRing2.sign(rsaMessage, undefined, 'sha256');
+assert.equal(cryptopp.rsa.verify(rsaMessage, multiPrimeSignature, multiPrimePubKey.modulus, multiPrimePubKey.publicExponent, 'sha256'), true, 'ERROR : invalid multi-prime RSA signature');
+log('Multi-prime RSA test succeeded');
+//Batch decryption, with an invalid ciphertext in the middle
+var batchCipherTexts = [];
+for (var i = 0; i < 10; i++) batchCipherTexts.push(cryptopp.rsa.encrypt(rsaMessage + i, multiPrimePubKey.modulus, multiPrimePubKey.publicExponent));
+batchCipherTexts[5] = batchCipherTexts[5].substring(0, batchCipherTexts[5].length - 2) + (batchCipherTexts[5].substring(batchCipherTexts[5].length - 2) == '00' ? '01' : '00');
+//A wrapped binary key, with a zero byte, that must come back byte for byte
+var wrappedKey = cryptopp.randomBytes(32, 'buffer');
+wrappedKey[7] = 0;
+batchCipherTexts.push(cryptopp.rsa.encrypt(wrappedKey, multiPrimePubKey.modulus, multiPrimePubKey.publicExponent));
+var syncBatch = multiPrimeKeyRing2.decryptBatch(batchCipherTexts);
+assert(Buffer.isBuffer(syncBatch[10]), 'ERROR : decryptBatch should return Buffers');
+assert.equal(syncBatch[10].toString('hex'), wrappedKey.toString('hex'), 'ERROR : decryptBatch didn\'t give back the binary key as it was');
+multiPrimeKeyRing2.decryptBatch(batchCipherTexts, function(plainTexts, errors){
+	for (var i = 0; i < batchCipherTexts.length; i++){
+		if (i == 5){
+			assert.equal(plainTexts[i], null, 'ERROR : decryptBatch accepted an invalid ciphertext');
+			assert(errors[i] instanceof Error, 'ERROR : decryptBatch should give an Error for an invalid ciphertext');
+		} else {
+			if (i == 10) assert.equal(plainTexts[i].toString('hex'), wrappedKey.toString('hex'), 'ERROR : decryptBatch didn\'t give back the binary key as it was');
+			else assert.equal(plainTexts[i].toString(), rsaMessage + i, 'ERROR : decryptBatch plaintexts are not the same');
+			assert.equal(errors[i], null, 'ERROR : decryptBatch gave an error for a valid ciphertext');
+		}
+		if (i == 5) assert.equal(syncBatch[i], null, 'ERROR : synchronous decryptBatch accepted an invalid ciphertext');
+		else assert.equal(syncBatch[i].toString('hex'), plainTexts[i].toString('hex'), 'ERROR : synchronous and asynchronous decryptBatch results are not the same');
+	}
+	log('Asynchronous RSA batch decryption succeeded');
+});
+multiPrimeKeyRing.clear();
+multiPrimeKeyRing2.clear();
+
 log('\n### DSA ###');
 var dsaMessage = 'message to be signed by DSA';
 log('Message to be signed: ' + dsaMessage);
@@ -127,6 +378,179 @@ log('DSA signature is valid');
 dsaKeyRing.clear();
 dsaKeyRing2.clear();
 
+log('\n### MultiKeyRing ###');
+var multiKeyRing = new cryptopp.MultiKeyRing();
+//Key IDs don't change with save/load, and loading a key twice doesn't add it twice
+var multiEcdsaPubKey = multiKeyRing.load('./ecdsaKeyRing.key');
+assert.equal(multiEcdsaPubKey.keyId.length, 32, 'ERROR : invalid key ID length');
+assert.equal(multiKeyRing.load('./ecdsaKeyRing.key').keyId, multiEcdsaPubKey.keyId, 'ERROR : the same key has two key IDs');
+var multiEcdhPubKey = multiKeyRing.createKeyPair('ecdh', {curveName: 'secp256r1', compressed: true});
+var multiX25519PubKey = multiKeyRing.createKeyPair('x25519');
+var multiEciesPubKeys = [];
+for (var i = 0; i < 20; i++) multiEciesPubKeys.push(multiKeyRing.createKeyPair('ecies', 'secp256k1'));
+assert.equal(multiKeyRing.size(), 23, 'ERROR : invalid number of keys in the MultiKeyRing');
+assert.deepEqual(multiKeyRing.keyIds().slice(0, 2), [multiEcdsaPubKey.keyId, multiEcdhPubKey.keyId], 'ERROR : key IDs are not in insertion order');
+var multiSignature = multiKeyRing.sign(multiEcdsaPubKey.keyId, ecdsaMessage, undefined, 'sha256');
+assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, multiSignature, ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : MultiKeyRing ECDSA signature seems invalid');
+multiEciesPubKeys.forEach(function(pubKey, i){
+	var cipherText = cryptopp.ecies.prime.encrypt('Message ' + i, pubKey.publicKey, 'secp256k1');
+	assert.equal(multiKeyRing.decrypt(pubKey.keyId, cipherText), 'Message ' + i, 'ERROR : MultiKeyRing ECIES decryption failed');
+});
+var multiEcdhPeer = new cryptopp.KeyRing('./ecdhKeyRing.key');
+assert.equal(multiKeyRing.agree(multiEcdhPubKey.keyId, ecdhPubKey), multiEcdhPeer.agree(multiEcdhPubKey), 'ERROR : MultiKeyRing ECDH shared secrets are different');
+multiEcdhPeer.clear();
+assert.deepEqual(multiKeyRing.publicKeyInfo(multiX25519PubKey.keyId), multiX25519PubKey, 'ERROR : MultiKeyRing public key info is not the same');
+//Saved keys can be loaded by a KeyRing
+multiKeyRing.save(multiEcdhPubKey.keyId, './multiEcdhKeyRing.key');
+var multiEcdhKeyRing = new cryptopp.KeyRing();
+assert.equal(multiEcdhKeyRing.load('./multiEcdhKeyRing.key').publicKey, multiEcdhPubKey.publicKey, 'ERROR : the saved MultiKeyRing key is not the same');
+multiEcdhKeyRing.clear();
+assert.equal(multiKeyRing.remove(multiEciesPubKeys[3].keyId), true, 'ERROR : the key wasn\'t removed');
+assert.equal(multiKeyRing.remove(multiEciesPubKeys[3].keyId), false, 'ERROR : the key was removed twice');
+assert.throws(function(){
+	multiKeyRing.decrypt(multiEciesPubKeys[3].keyId, cryptopp.ecies.prime.encrypt('Message', multiEciesPubKeys[3].publicKey, 'secp256k1'));
+}, TypeError, 'ERROR : a removed key was used');
+//The keys after the removed one are still found
+assert.equal(multiKeyRing.decrypt(multiEciesPubKeys[19].keyId, cryptopp.ecies.prime.encrypt('Message', multiEciesPubKeys[19].publicKey, 'secp256k1')), 'Message', 'ERROR : MultiKeyRing ECIES decryption failed after a removal');
+assert.equal(multiKeyRing.size(), 22, 'ERROR : invalid number of keys in the MultiKeyRing');
+//Key store files, plain and encrypted
+multiKeyRing.saveStore('./multiKeyRing.store');
+multiKeyRing.saveStore('./multiKeyRingEncrypted.store', 'store passphrase');
+var multiKeyIds = multiKeyRing.keyIds().slice().sort();
+multiKeyRing.clear();
+['./multiKeyRing.store', './multiKeyRingEncrypted.store'].forEach(function(storeFile, encrypted){
+	var storeKeyRing = new cryptopp.MultiKeyRing();
+	assert.equal(storeKeyRing.openStore(storeFile, encrypted ? 'store passphrase' : undefined), 22, 'ERROR : invalid number of keys in the key store');
+	assert.deepEqual(storeKeyRing.keyIds(), multiKeyIds, 'ERROR : the key store IDs are not the same');
+	assert.throws(function(){
+		storeKeyRing.openStore(storeFile);
+	}, TypeError, 'ERROR : a key store was opened on a non-empty MultiKeyRing');
+	var storeSignature = storeKeyRing.sign(multiEcdsaPubKey.keyId, ecdsaMessage, undefined, 'sha256');
+	assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, storeSignature, ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : key store ECDSA signature seems invalid');
+	assert.equal(storeKeyRing.decrypt(multiEciesPubKeys[19].keyId, cryptopp.ecies.prime.encrypt('Message', multiEciesPubKeys[19].publicKey, 'secp256k1')), 'Message', 'ERROR : key store ECIES decryption failed');
+	assert.deepEqual(storeKeyRing.publicKeyInfo(multiX25519PubKey.keyId), multiX25519PubKey, 'ERROR : key store public key info is not the same');
+	assert.throws(function(){
+		storeKeyRing.publicKeyInfo(multiEciesPubKeys[3].keyId);
+	}, TypeError, 'ERROR : a removed key was saved in the key store');
+	//Keys of the store can be hidden, and keys added next to them
+	assert.equal(storeKeyRing.remove(multiEcdsaPubKey.keyId), true, 'ERROR : the key store key wasn\'t removed');
+	assert.equal(storeKeyRing.remove(multiEcdsaPubKey.keyId), false, 'ERROR : the key store key was removed twice');
+	var storeAddedPubKey = storeKeyRing.createKeyPair('ecdsa', 'secp256r1');
+	assert.equal(storeKeyRing.size(), 22, 'ERROR : invalid number of keys in the MultiKeyRing');
+	assert.equal(storeKeyRing.keyIds().indexOf(multiEcdsaPubKey.keyId), -1, 'ERROR : a removed key store key is still listed');
+	assert.equal(storeKeyRing.keyIds()[21], storeAddedPubKey.keyId, 'ERROR : added keys are not listed after the key store keys');
+	storeKeyRing.clear();
+});
+assert.throws(function(){
+	new cryptopp.MultiKeyRing().openStore('./multiKeyRingEncrypted.store', 'wrong passphrase');
+}, TypeError, 'ERROR : a key store was opened with a wrong passphrase');
+assert.throws(function(){
+	new cryptopp.MultiKeyRing().openStore('./ecdsaKeyRing.key');
+}, TypeError, 'ERROR : a key file was opened as a key store');
+//Shared key stores : written once, then attached read-only by other key rings (cluster workers)
+var sharedStoreName = 'node-cryptopp-test-' + process.pid;
+var primaryKeyRing = new cryptopp.MultiKeyRing();
+primaryKeyRing.openStore('./multiKeyRing.store');
+assert.equal(primaryKeyRing.shareStore(sharedStoreName, 'shared passphrase'), 22, 'ERROR : invalid number of keys in the shared key store');
+primaryKeyRing.clear();
+var workerKeyRing = new cryptopp.MultiKeyRing();
+assert.throws(function(){
+	workerKeyRing.attachStore(sharedStoreName, 'wrong passphrase');
+}, TypeError, 'ERROR : a shared key store was attached with a wrong passphrase');
+assert.equal(workerKeyRing.attachStore(sharedStoreName, 'shared passphrase'), 22, 'ERROR : invalid number of keys in the attached key store');
+assert.deepEqual(workerKeyRing.keyIds(), multiKeyIds, 'ERROR : the shared key store IDs are not the same');
+var sharedSignature = workerKeyRing.sign(multiEcdsaPubKey.keyId, ecdsaMessage, undefined, 'sha256');
+assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, sharedSignature, ecdsaPubKey.publicKey, ecdsaPubKey.curveName, 'sha256'), true, 'ERROR : shared key store ECDSA signature seems invalid');
+//Removing the name doesn't take the store away from the key rings that have it attached
+workerKeyRing.unshareStore(sharedStoreName);
+assert.deepEqual(workerKeyRing.publicKeyInfo(multiX25519PubKey.keyId), multiX25519PubKey, 'ERROR : the attached key store is gone once unshared');
+workerKeyRing.clear();
+assert.throws(function(){
+	workerKeyRing.attachStore(sharedStoreName);
+}, TypeError, 'ERROR : an unshared key store was attached');
+//A damaged record (the last byte of the file being the checksum of the last record, the one with the highest ID) is a TypeError
+var damagedStore = fs.readFileSync('./multiKeyRing.store');
+damagedStore[damagedStore.length - 1] ^= 0xff;
+fs.writeFileSync('./multiKeyRingDamaged.store', damagedStore);
+var damagedKeyRing = new cryptopp.MultiKeyRing();
+assert.equal(damagedKeyRing.openStore('./multiKeyRingDamaged.store'), 22, 'ERROR : invalid number of keys in the damaged key store');
+assert.throws(function(){
+	damagedKeyRing.publicKeyInfo(multiKeyIds[21]);
+}, TypeError, 'ERROR : a damaged key store record was decoded');
+assert.equal(damagedKeyRing.publicKeyInfo(multiKeyIds[0]).keyId, multiKeyIds[0], 'ERROR : the other records of a damaged key store can\'t be used');
+damagedKeyRing.clear();
+fs.unlinkSync('./multiKeyRingDamaged.store');
+fs.unlinkSync('./multiKeyRing.store');
+fs.unlinkSync('./multiKeyRingEncrypted.store');
+multiKeyRing.clear();
+assert.equal(multiKeyRing.size(), 0, 'ERROR : the MultiKeyRing wasn\'t cleared');
+
+log('\n### Asynchronous load and save ###');
+var asyncKeyRing = new cryptopp.KeyRing();
+var asyncPubKey = asyncKeyRing.createKeyPair('ecdsa', 'secp256r1');
+assert.throws(function(){
+	asyncKeyRing.save('./missingDirectory/asyncKeyRing.key');
+}, Error, 'ERROR : saving to a missing directory didn\'t throw');
+asyncKeyRing.save('./missingDirectory/asyncKeyRing.key', function(err){
+	assert.ok(err instanceof Error, 'ERROR : saving to a missing directory didn\'t give an error');
+});
+asyncKeyRing.save('./asyncKeyRing.key', 'passphrase', function(err){
+	assert.equal(err, undefined, 'ERROR : the key file couldn\'t be saved asynchronously');
+	//The key is written to a temporary file, renamed once written
+	assert.deepEqual(fs.readdirSync('.').filter(function(name){ return name.indexOf('asyncKeyRing.key.') == 0; }), [], 'ERROR : a temporary key file was left behind');
+	asyncKeyRing.clear();
+	asyncKeyRing.load('./asyncKeyRing.key', false, 'wrong passphrase', function(pubKey, err){
+		assert.equal(pubKey, undefined, 'ERROR : the encrypted key file has been loaded with a wrong passphrase');
+		assert.ok(err instanceof TypeError, 'ERROR : loading with a wrong passphrase didn\'t give an error');
+		asyncKeyRing.load('./asyncKeyRing.key', false, 'passphrase', function(pubKey, err){
+			assert.equal(err, undefined, 'ERROR : the key file couldn\'t be loaded asynchronously');
+			assert.deepEqual(pubKey, asyncPubKey, 'ERROR : the asynchronously loaded key is not the same');
+			var asyncSignature = asyncKeyRing.sign(ecdsaMessage, undefined, 'sha256');
+			assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, asyncSignature, asyncPubKey.publicKey, asyncPubKey.curveName, 'sha256'), true, 'ERROR : the signature made with the asynchronously loaded key seems invalid');
+			asyncKeyRing.clear();
+			//Key files loaded in parallel into a MultiKeyRing
+			var asyncMultiKeyRing = new cryptopp.MultiKeyRing();
+			var asyncKeyFiles = [['./asyncKeyRing.key', false, 'passphrase'], ['./ecdhKeyRing.key'], ['./eciesKeyRing.key']], pendingLoads = asyncKeyFiles.length;
+			asyncKeyFiles.forEach(function(loadArgs){
+				asyncMultiKeyRing.load.apply(asyncMultiKeyRing, loadArgs.concat([function(pubKey, err){
+					assert.equal(err, undefined, 'ERROR : the key file couldn\'t be loaded asynchronously in the MultiKeyRing');
+					assert.equal(pubKey.keyId.length, 32, 'ERROR : invalid key ID length');
+					if (--pendingLoads > 0) return;
+					assert.equal(asyncMultiKeyRing.size(), asyncKeyFiles.length, 'ERROR : invalid number of keys in the MultiKeyRing');
+					asyncMultiKeyRing.clear();
+					fs.unlinkSync('./asyncKeyRing.key');
+					log('Asynchronous load and save : OK');
+					watchedKeyRingTest();
+				}]));
+			});
+		});
+	});
+});
+
+//Watched key files are loaded again when they are replaced
+function watchedKeyRingTest(){
+	var rotatingKeyRing = new cryptopp.KeyRing();
+	var firstPubKey = rotatingKeyRing.createKeyPair('ecdsa', 'secp256r1', './watchedKeyRing.key', 'passphrase');
+	var secondPubKey = rotatingKeyRing.createKeyPair('ecdsa', 'secp256r1');
+	assert.throws(function(){
+		new cryptopp.KeyRing(undefined, {watch: true});
+	}, TypeError, 'ERROR : a key ring without key file is watched');
+	var watchedKeyRing = new cryptopp.KeyRing('./watchedKeyRing.key', 'passphrase', {watch: true, onReload: function(pubKey, err){
+		assert.equal(err, undefined, 'ERROR : the watched key file couldn\'t be reloaded');
+		assert.deepEqual(pubKey, secondPubKey, 'ERROR : the reloaded key is not the new one');
+		assert.deepEqual(watchedKeyRing.publicKeyInfo(), secondPubKey, 'ERROR : the reloaded key wasn\'t swapped in');
+		var rotatedSignature = watchedKeyRing.sign(ecdsaMessage, undefined, 'sha256');
+		assert.equal(cryptopp.ecdsa.prime.verify(ecdsaMessage, rotatedSignature, secondPubKey.publicKey, secondPubKey.curveName, 'sha256'), true, 'ERROR : the signature made with the reloaded key seems invalid');
+		watchedKeyRing.clear();
+		rotatingKeyRing.clear();
+		fs.unlinkSync('./watchedKeyRing.key');
+		log('Watched key file : OK');
+	}});
+	assert.deepEqual(watchedKeyRing.publicKeyInfo(), firstPubKey, 'ERROR : the watched key file wasn\'t loaded');
+	//Replaced atomically : the temporary file next to it doesn't trigger a reload
+	rotatingKeyRing.save('./watchedKeyRing.key', 'passphrase');
+}
+
 log('--------------------------');
 log('End of KeyRing test script');
 log('--------------------------');
@@ -1,11 +1,13 @@
 //Std imports
 #include <string>
+#include <cstring>
 #include <iostream>
 #include <exception>
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 //Crypto++ imports
 #include <cryptopp/base64.h>
@@ -29,6 +31,7 @@ using CryptoPP::PK_DecryptorFilter;
 #include <cryptopp/sha.h>
 using CryptoPP::SHA1;
 using CryptoPP::SHA256;
+using CryptoPP::SHA512;
 
 #include <cryptopp/eccrypto.h>
 using CryptoPP::ECP;
@@ -67,44 +70,70 @@ using CryptoPP::OID;
 #include <cryptopp/secblock.h>
 using CryptoPP::SecByteBlock;
 
-#include <cryptopp/pwdbased.h>
-using CryptoPP::PKCS5_PBKDF2_HMAC;
-
 #include <cryptopp/aes.h>
 using CryptoPP::AES;
 
+#include <cryptopp/crc.h>
+using CryptoPP::CRC32;
+
 #include <cryptopp/modes.h>
 using CryptoPP::CFB_Mode;
 
 //Node and class headers import
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <node.h>
+#include <node_buffer.h>
+#include <uv.h>
 #include "keyring.h"
+#include "threadpool.h"
+#include "rfc6979.h"
+#include "ecbatch.h"
+#include "fastec.h"
+#include "fastec2n.h"
+#include "ecladder.h"
+#include "curve25519.h"
+#include "eciesaead.h"
+#include "chacha20poly1305.h"
+#include "hkdf.h"
+#include "session.h"
+#include "ecpoint.h"
+#include "keystore.h"
+#include "kekcache.h"
+#include "secarena.h"
 
 using namespace v8;
 using namespace std;
 
 Persistent<Function> KeyRing::constructor;
 
-KeyRing::KeyRing(string filename, string passphrase) : filename_(filename), keyPair(0){
+KeyRing::KeyRing(string filename, string passphrase) : filename_(filename), keyPair(0), noncePool_(0), noncePoolSize_(64), noncePoolThreshold_(16), useNoncePool_(false), watch_(0){
 	//If filename is not null, try to load the key at the given filename
 	if (filename != ""){
 		if (!doesFileExist(filename)){
 			//Throw a V8 error, I don't know how
 			return;
 		}
-		if (passphrase != ""){
-			loadKeyPair(filename, false, passphrase);
-		} else {
-			loadKeyPair(filename);
+		try {
+			if (passphrase != ""){
+				keyPair = loadKeyPair(filename, false, passphrase);
+			} else {
+				keyPair = loadKeyPair(filename);
+			}
+		} catch (runtime_error* e){
+			//Wrong passphrase : no key is loaded, same as a missing file
+			delete e;
 		}
 	}
 }
 
 KeyRing::~KeyRing(){
-	if (keyPair != 0){
-		delete keyPair;
-		keyPair = 0;
-	}
+	stopWatching();
+	deleteKeyPair(keyPair);
+	keyPair = 0;
+	NoncePool::Release(noncePool_);
+	noncePool_ = 0;
 }
 
 void KeyRing::Init(Handle<Object> exports){
@@ -114,15 +143,22 @@ void KeyRing::Init(Handle<Object> exports){
 	tpl->InstanceTemplate()->SetInternalFieldCount(2);
 	//Prototype
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(Decrypt)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("decryptBatch"), FunctionTemplate::New(DecryptBatch)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("sign"), FunctionTemplate::New(Sign)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("signBatch"), FunctionTemplate::New(SignBatch)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("agree"), FunctionTemplate::New(Agree)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("openSession"), FunctionTemplate::New(OpenSession)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("publicKeyInfo"), FunctionTemplate::New(PublicKeyInfo)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("createKeyPair"), FunctionTemplate::New(CreateKeyPair)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("unwatch"), FunctionTemplate::New(Unwatch)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("load"), FunctionTemplate::New(Load)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("save"), FunctionTemplate::New(Save)->GetFunction());
 	tpl->PrototypeTemplate()->Set(String::NewSymbol("clear"), FunctionTemplate::New(Clear)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("enableNoncePool"), FunctionTemplate::New(EnableNoncePool)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("disableNoncePool"), FunctionTemplate::New(DisableNoncePool)->GetFunction());
 	constructor = Persistent<Function>::New(tpl->GetFunction());
 	exports->Set(String::NewSymbol("KeyRing"), constructor);
+	KeySession::Init();
 }
 
 
@@ -134,42 +170,52 @@ Handle<Value> KeyRing::New(const Arguments& args){
 	HandleScope scope;
 	if (args.IsConstructCall()){
 		//Invoked as a constructor
-		if (args.Length() > 2){
+		if (args.Length() > 3){
 			ThrowException(Exception::TypeError(String::New("Invalid number of arguments on KeyRing constructor call")));
 			return scope.Close(Undefined());
 		}
-		string filename;
-		if (args[0]->IsUndefined()){
-			filename = "";
-		} else {
+		//The options object is the last parameter
+		Local<Object> options;
+		int paramCount = args.Length();
+		if (paramCount >= 2 && args[paramCount - 1]->IsObject()){
+			options = args[paramCount - 1]->ToObject();
+			paramCount--;
+		}
+		string filename, passphrase;
+		if (!args[0]->IsUndefined()){
 			String::Utf8Value filenameVal(args[0]->ToString());
 			filename = string(*filenameVal);
 		}
-		if (args.Length() == 2){
+		if (paramCount >= 2 && !args[1]->IsUndefined()){
 			String::Utf8Value passphraseVal(args[1]->ToString());
-			string passphrase(*passphraseVal);
-			KeyRing* newInstance = new KeyRing(filename, passphrase);
-			newInstance->Wrap(args.This());
-		} else {
-			KeyRing* newInstance = new KeyRing(filename);
-			newInstance->Wrap(args.This());
+			passphrase = string(*passphraseVal);
+		}
+		const bool watch = !options.IsEmpty() && options->Get(String::New("watch"))->BooleanValue();
+		Local<Value> onReload = options.IsEmpty() ? Local<Value>::New(Undefined()) : options->Get(String::New("onReload"));
+		if (watch && filename == ""){
+			ThrowException(Exception::TypeError(String::New("A key file must be given to be watched")));
+			return scope.Close(Undefined());
+		}
+		if (!(onReload->IsUndefined() || onReload->IsFunction())){
+			ThrowException(Exception::TypeError(String::New("onReload must be a function")));
+			return scope.Close(Undefined());
+		}
+		KeyRing* newInstance = new KeyRing(filename, passphrase);
+		newInstance->Wrap(args.This());
+		if (watch && !newInstance->startWatching(passphrase, onReload)){
+			ThrowException(Exception::TypeError(String::New("The key file's directory can't be watched")));
+			return scope.Close(Undefined());
 		}
 		return args.This();
 	} else {
 		//Invoked as a plain function, turn into construct call
-		if (args.Length() > 2){
+		if (args.Length() > 3){
 			ThrowException(Exception::TypeError(String::New("Invalid number of arguments on KeyRing constructor call")));
 			return scope.Close(Undefined());
 		}
-		if (args.Length() == 1){
-			Local<Value> argv[1] = { args[0] };
-			return scope.Close(constructor->NewInstance(1, argv));
-		} else if (args.Length() == 2){
-			Local<Value> argv[2] = { args[0], args[1] };
-			return scope.Close(constructor->NewInstance(2, argv));
-		} else {
-			return scope.Close(constructor->NewInstance());
-		}
+		Local<Value> argv[3];
+		for (int i = 0; i < args.Length(); i++) argv[i] = args[i];
+		return scope.Close(constructor->NewInstance(args.Length(), argv));
 	}
 }
 
@@ -223,22 +269,61 @@ Handle<Value> KeyRing::Decrypt(const Arguments& args){
 		cipher = strBase64Decode(cipher);
 	}
 	if (keyType == "rsa"){
-		InvertibleRSAFunction privateParams;
-		privateParams.Initialize(HexStrToInteger(instance->keyPair->at("modulus")), HexStrToInteger(instance->keyPair->at("publicExponent")), HexStrToInteger(instance->keyPair->at("privateExponent")));
-		RSA::PrivateKey privateKey(privateParams);
-		RSAES_OAEP_SHA_Decryptor decryptor(privateKey);
+		InvertibleMultiPrimeRSAFunction privateParams;
+		getRSAPrivateKey(instance->keyPair, privateParams);
+		MultiPrimeRSAES_OAEP_SHA_Decryptor decryptor(privateParams);
 		StringSource(cipher, true, new PK_DecryptorFilter(prng, decryptor, new StringSink(plaintext)));
-	} else {
-		OID curve = getPCurveFromName(instance->keyPair->at("curveName"));
-		ECIES<ECP>::Decryptor d;
-		d.AccessKey().AccessGroupParameters().Initialize(curve);
-		d.AccessKey().SetPrivateExponent(HexStrToInteger(instance->keyPair->at("privateKey")));
-		try {
-			StringSource(cipher, true, new PK_DecryptorFilter(prng, d, new StringSink(plaintext)));
-		} catch (CryptoPP::Exception const& ex){
+	} else if (isBinaryCurve(instance->keyPair->at("curveName"))){
+		OID curve = getBCurveFromName(instance->keyPair->at("curveName"));
+		const CryptoPP::Integer privateExponent = HexStrToInteger(instance->keyPair->at("privateKey"));
+		//Ciphertexts encrypted with the compressed option start with a compressed point
+		if (cipher.size() > 0 && (cipher[0] == 0x02 || cipher[0] == 0x03) && !ECPoint_DecompressPrefixB(curve, cipher)){
 			ThrowException(Exception::TypeError(String::New("Crypto error")));
 			return scope.Close(Undefined());
 		}
+		if (!FastECIES_Decrypt(FastEC2N::For(curve), privateExponent, cipher, plaintext)){
+			ECIES<EC2N>::Decryptor d;
+			d.AccessKey().AccessGroupParameters().Initialize(curve);
+			d.AccessKey().SetPrivateExponent(privateExponent);
+			try {
+				StringSource(cipher, true, new PK_DecryptorFilter(prng, d, new StringSink(plaintext)));
+			} catch (CryptoPP::Exception const& ex){
+				ThrowException(Exception::TypeError(String::New("Crypto error")));
+				return scope.Close(Undefined());
+			}
+		}
+	} else {
+		OID curve = getPCurveFromName(instance->keyPair->at("curveName"));
+		const CryptoPP::Integer privateExponent = HexStrToInteger(instance->keyPair->at("privateKey"));
+		//ChaCha20-Poly1305 ciphertexts (ecies.prime.encrypt with the "chacha20-poly1305" DEM) start with a compressed point, as do "xor-hmac" ones
+		//encrypted with the compressed option : these are decrypted as the latter, once the point is decompressed, when they don't authenticate as the former
+		bool done = false;
+		if (ECIES_IsAEADCipherText(cipher)){
+			done = ECIES_AEADDecrypt(curve, privateExponent, cipher, plaintext);
+			if (!done && !ECPoint_DecompressPrefixP(curve, cipher)){
+				ThrowException(Exception::TypeError(String::New("Crypto error")));
+				return scope.Close(Undefined());
+			}
+		}
+		if (!done){
+			if (ECIES_IsMultiCipherText(cipher)){
+				//Envelope from ecies.prime.encryptMulti : fails as well when none of its keys is wrapped for this key pair
+				if (!ECIES_MultiDecrypt(curve, privateExponent, cipher, plaintext)){
+					ThrowException(Exception::TypeError(String::New("Crypto error")));
+					return scope.Close(Undefined());
+				}
+			} else if (!FastECIES_Decrypt(FastEC::For(curve), privateExponent, cipher, plaintext)){
+				ECIES<ECP>::Decryptor d;
+				d.AccessKey().AccessGroupParameters().Initialize(curve);
+				d.AccessKey().SetPrivateExponent(privateExponent);
+				try {
+					StringSource(cipher, true, new PK_DecryptorFilter(prng, d, new StringSink(plaintext)));
+				} catch (CryptoPP::Exception const& ex){
+					ThrowException(Exception::TypeError(String::New("Crypto error")));
+					return scope.Close(Undefined());
+				}
+			}
+		}
 	}
 	result = String::New(plaintext.c_str());
 	if (args.Length() < 3){
@@ -253,9 +338,167 @@ Handle<Value> KeyRing::Decrypt(const Arguments& args){
 	}
 }
 
+/*
+* RSA batch decryption on the thread pool : the ciphertexts are split evenly into jobs sharing the task's decryptor.
+* The task has its own copy of the key, so the KeyRing can be cleared meanwhile
+*/
+struct DecryptBatchTask {
+	MultiPrimeRSAES_OAEP_SHA_Decryptor decryptor;
+	vector<string> cipherTexts, plainTexts, errors;
+	//Jobs not done yet
+	size_t pending;
+	Persistent<Function> callback;
+};
+
+struct DecryptBatchJob {
+	uv_work_t request;
+	DecryptBatchTask* task;
+	size_t first, count;
+};
+
+//plainTexts (Buffers, as wrapped keys are binary) and errors arrays : null where a ciphertext couldn't be decrypted, and where it could, respectively. The task's plaintexts are wiped
+static void decryptBatchResults(DecryptBatchTask* task, Local<Array>& plainTexts, Local<Array>& errors){
+	plainTexts = Array::New(task->cipherTexts.size());
+	errors = Array::New(task->cipherTexts.size());
+	for (unsigned int i = 0; i < task->cipherTexts.size(); i++){
+		if (task->errors[i] == ""){
+			string& plainText = task->plainTexts[i];
+			plainTexts->Set(i, Local<Object>::New(node::Buffer::New(plainText.data(), plainText.size())->handle_));
+			if (!plainText.empty()) CryptoPP::SecureWipeArray((byte*) &plainText[0], plainText.size());
+			errors->Set(i, Null());
+		} else {
+			plainTexts->Set(i, Null());
+			errors->Set(i, Exception::Error(String::New(task->errors[i].c_str())));
+		}
+	}
+}
+
+static void DecryptBatchWork(uv_work_t* req){
+	DecryptBatchJob* job = static_cast<DecryptBatchJob*>(req->data);
+	DecryptBatchTask* task = job->task;
+	MultiPrimeRSA_DecryptBatch(task->decryptor, task->cipherTexts, task->plainTexts, task->errors, job->first, job->count);
+}
+
+//Back on the main thread. The last job to finish calls the callback
+static void DecryptBatchDone(uv_work_t* req, int status){
+	HandleScope scope;
+	DecryptBatchJob* job = static_cast<DecryptBatchJob*>(req->data);
+	DecryptBatchTask* task = job->task;
+	delete job;
+	if (--task->pending > 0) return;
+	Local<Array> plainTexts, errors;
+	decryptBatchResults(task, plainTexts, errors);
+	Local<Function> callback = Local<Function>::New(task->callback);
+	task->callback.Dispose();
+	delete task;
+	const unsigned argc = 2;
+	Local<Value> argv[argc] = { plainTexts, errors };
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+/*
+* Signature :
+* Array cipherTexts, String encoding (defaults to hex), Function callback (optional)
+* For RSA key pairs. With a callback, the ciphertexts are decrypted on the thread pool and the callback receives (plainTexts, errors);
+* without one, they are decrypted synchronously and plainTexts is returned (errors being thrown away)
+*/
+Handle<Value> KeyRing::DecryptBatch(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 3)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. Please check the module's documentation")));
+		return scope.Close(Undefined());
+	}
+	if (!args[0]->IsArray()){
+		ThrowException(Exception::TypeError(String::New("cipherTexts must be an array")));
+		return scope.Close(Undefined());
+	}
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	if (instance->keyPair == 0){
+		ThrowException(Exception::TypeError(String::New("No key has been loaded in the keyring. Either load a key on instanciation or by calling the Load() method")));
+		return scope.Close(Undefined());
+	}
+	if (instance->keyPair->at("keyType") != "rsa"){
+		ThrowException(Exception::TypeError(String::New("Batch decryption is only available for RSA key pairs")));
+		return scope.Close(Undefined());
+	}
+	string encoding = "";
+	if (args.Length() >= 2 && !args[1]->IsUndefined() && !args[1]->IsFunction()){
+		String::Utf8Value encodingVal(args[1]->ToString());
+		encoding = string(*encodingVal);
+		if (!(encoding == "hex" || encoding == "base64")){
+			ThrowException(Exception::TypeError(String::New("Unknown encoding. Valid values are \"hex\" and \"base64\"")));
+			return scope.Close(Undefined());
+		}
+	}
+	//The callback can take the place of encoding
+	Local<Value> callbackVal = Local<Value>::New(Undefined());
+	if (args.Length() == 3) callbackVal = args[2];
+	else if (args.Length() == 2 && args[1]->IsFunction()) callbackVal = args[1];
+	if (!(callbackVal->IsUndefined() || callbackVal->IsFunction())){
+		ThrowException(Exception::TypeError(String::New("callback must be a function")));
+		return scope.Close(Undefined());
+	}
+	Local<Array> cipherTextsArray = Local<Array>::Cast(args[0]);
+	DecryptBatchTask* task = new DecryptBatchTask();
+	task->cipherTexts.resize(cipherTextsArray->Length());
+	task->plainTexts.resize(cipherTextsArray->Length());
+	task->errors.resize(cipherTextsArray->Length());
+	for (unsigned int i = 0; i < cipherTextsArray->Length(); i++){
+		String::Utf8Value cipherTextVal(cipherTextsArray->Get(i)->ToString());
+		if (encoding == "hex" || encoding == "") task->cipherTexts[i] = strHexDecode(string(*cipherTextVal));
+		else task->cipherTexts[i] = strBase64Decode(string(*cipherTextVal));
+	}
+	//The key is parsed (and, for two-prime keys, factored) once for the whole batch
+	try {
+		InvertibleMultiPrimeRSAFunction privateParams;
+		getRSAPrivateKey(instance->keyPair, privateParams);
+		task->decryptor.AccessKey() = privateParams;
+	} catch (CryptoPP::Exception const& e){
+		delete task;
+		ThrowException(Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	if (!callbackVal->IsFunction()){
+		MultiPrimeRSA_DecryptBatch(task->decryptor, task->cipherTexts, task->plainTexts, task->errors, 0, task->cipherTexts.size());
+		Local<Array> plainTexts, errors;
+		decryptBatchResults(task, plainTexts, errors);
+		delete task;
+		return scope.Close(plainTexts);
+	}
+	task->callback = Persistent<Function>::New(Local<Function>::Cast(callbackVal));
+	const size_t count = task->cipherTexts.size(), jobs = count == 0 ? 1 : (count < ThreadPoolSize() ? count : ThreadPoolSize());
+	task->pending = jobs;
+	for (size_t i = 0, first = 0; i < jobs; i++){
+		DecryptBatchJob* job = new DecryptBatchJob();
+		job->request.data = job;
+		job->task = task;
+		job->first = first;
+		job->count = count / jobs + (i < count % jobs ? 1 : 0);
+		first += job->count;
+		uv_queue_work(uv_default_loop(), &job->request, DecryptBatchWork, DecryptBatchDone);
+	}
+	return scope.Close(Undefined());
+}
+
+/*
+* ECDSA signature on a binary curve : with FastEC2N when it supports the curve, otherwise with Crypto++ (which can't sign deterministically).
+* Returns false if deterministic is set and the curve isn't supported by FastEC2N
+*/
+template <class H>
+static bool binaryCurveSign(OID const& curve, CryptoPP::Integer const& privateExponent, string const& message, bool deterministic, string& signature){
+	if (FastECDSA_Sign<H>(FastEC2N::For(curve), privateExponent, message, deterministic, signature)) return true;
+	if (deterministic) return false;
+	AutoSeededRandomPool prng;
+	typename ECDSA<EC2N, H>::PrivateKey privateKey;
+	privateKey.Initialize(curve, privateExponent);
+	StringSource(message, true, new SignerFilter(prng, typename ECDSA<EC2N, H>::Signer(privateKey), new StringSink(signature)));
+	return true;
+}
+
 /*
 * Signature :
-* String message, String signatureEncoding (defaults to hex), String hashFunctionName (either "sha1" or "sha256", defaults to "sha1"), Function callback (optional)
+* String message, String signatureEncoding (defaults to hex), String hashFunctionName (either "sha1" or "sha256", defaults to "sha1") or Object options, Function callback (optional)
+* options : {hashName, deterministic}. When deterministic is true, ECDSA nonces are derived as in RFC 6979
 */
 Handle<Value> KeyRing::Sign(const Arguments& args){
 	HandleScope scope;
@@ -272,7 +515,7 @@ Handle<Value> KeyRing::Sign(const Arguments& args){
 	}
 	//Checking the key type
 	string keyType = instance->keyPair->at("keyType");
-	if (!(keyType == "rsa" || keyType == "dsa" || keyType == "ecdsa" || keyType == "ecies")){
+	if (!(keyType == "rsa" || keyType == "dsa" || keyType == "ecdsa" || keyType == "ecies" || keyType == "ed25519")){
 		ThrowException(Exception::TypeError(String::New("The key pair loaded is one of a signature algorithm")));
 		return scope.Close(Undefined());
 	}
@@ -289,9 +532,19 @@ Handle<Value> KeyRing::Sign(const Arguments& args){
 			return scope.Close(Undefined());
 		}
 	}
+	bool deterministic = false;
 	if (args.Length() >= 3 && !args[2]->IsUndefined()){
-		String::Utf8Value hashFunctionNameVal(args[2]->ToString());
-		hashFunctionName = string(*hashFunctionNameVal);
+		if (args[2]->IsObject() && !args[2]->IsFunction()){
+			Local<Object> optionsObj = Local<Object>::Cast(args[2]);
+			if (optionsObj->Has(String::NewSymbol("hashName")) && !optionsObj->Get(String::NewSymbol("hashName"))->IsUndefined()){
+				String::Utf8Value hashFunctionNameVal(optionsObj->Get(String::NewSymbol("hashName"))->ToString());
+				hashFunctionName = string(*hashFunctionNameVal);
+			}
+			deterministic = optionsObj->Get(String::NewSymbol("deterministic"))->BooleanValue();
+		} else {
+			String::Utf8Value hashFunctionNameVal(args[2]->ToString());
+			hashFunctionName = string(*hashFunctionNameVal);
+		}
 		if (!(hashFunctionName == "sha1" || hashFunctionName == "sha256")){
 			ThrowException(Exception::TypeError(String::New("hashFunction must be either \"sha1\" or \"sha256\"")));
 			return scope.Close(Undefined());
@@ -302,38 +555,70 @@ Handle<Value> KeyRing::Sign(const Arguments& args){
 			return scope.Close(Undefined());
 		}
 	}
+	//Ed25519 signatures are always deterministic, and hashed with SHA-512 whatever hashName is
+	if (deterministic && !(keyType == "ecdsa" || keyType == "ecies" || keyType == "ed25519")){
+		ThrowException(Exception::TypeError(String::New("Deterministic signatures are only available for ECDSA")));
+		return scope.Close(Undefined());
+	}
 	Local<Value> result = Local<Value>::New(Undefined());
-	AutoSeededRandomPool prng;
 	if (keyType == "rsa"){
-		InvertibleRSAFunction privateParams;
-		privateParams.Initialize(HexStrToInteger(instance->keyPair->at("modulus")), HexStrToInteger(instance->keyPair->at("publicExponent")), HexStrToInteger(instance->keyPair->at("privateExponent")));
-		RSA::PrivateKey privateKey(privateParams);
+		AutoSeededRandomPool prng;
+		InvertibleMultiPrimeRSAFunction privateParams;
+		getRSAPrivateKey(instance->keyPair, privateParams);
 		if (hashFunctionName == "sha1"){
-			RSASS<PSS, SHA1>::Signer signer(privateKey);
+			MultiPrimeRSASS_PSS<SHA1>::Signer signer(privateParams);
 			StringSource(message, true, new SignerFilter(prng, signer, new StringSink(signature)));
 		} else if (hashFunctionName == "sha256") {
-			RSASS<PSS, SHA256>::Signer signer(privateKey);
+			MultiPrimeRSASS_PSS<SHA256>::Signer signer(privateParams);
 			StringSource(message, true, new SignerFilter(prng, signer, new StringSink(signature)));
 		} else {
 			ThrowException(Exception::TypeError(String::New("Internal error : unknown hash function")));
 			return scope.Close(Undefined());
 		}
 	} else if (keyType == "dsa"){
+		AutoSeededRandomPool prng;
 		DSA::PrivateKey privateKey;
 		privateKey.Initialize(HexStrToInteger(instance->keyPair->at("primeField")), HexStrToInteger(instance->keyPair->at("divider")), HexStrToInteger(instance->keyPair->at("base")), HexStrToInteger(instance->keyPair->at("privateExponent")));
 		DSA::Signer signer(privateKey);
 		StringSource(message, true, new SignerFilter(prng, signer, new StringSink(signature)));
+	} else if (keyType == "ed25519"){
+		const string privateKeyStr = strHexDecode(instance->keyPair->at("privateKey"));
+		const SecByteBlock privateKey((const byte*) privateKeyStr.data(), privateKeyStr.size());
+		if (!Ed25519_Sign(privateKey, message, signature)){
+			ThrowException(Exception::TypeError(String::New("Invalid Ed25519 private key")));
+			return scope.Close(Undefined());
+		}
+	} else if (isBinaryCurve(instance->keyPair->at("curveName"))){
+		OID curve = getBCurveFromName(instance->keyPair->at("curveName"));
+		const CryptoPP::Integer privateExponent = HexStrToInteger(instance->keyPair->at("privateKey"));
+		if (!(hashFunctionName == "sha1" ? binaryCurveSign<SHA1>(curve, privateExponent, message, deterministic, signature) : binaryCurveSign<SHA256>(curve, privateExponent, message, deterministic, signature))){
+			ThrowException(Exception::TypeError(String::New("Deterministic signatures aren't available on this curve")));
+			return scope.Close(Undefined());
+		}
 	} else { //ECDSA / ECIES key pair case
 		OID curve = getPCurveFromName(instance->keyPair->at("curveName"));
-		if (hashFunctionName == "sha1"){
+		const DL_GroupParameters_EC<ECP> params(curve);
+		const CryptoPP::Integer privateExponent = HexStrToInteger(instance->keyPair->at("privateKey"));
+		NoncePool* pool = deterministic ? 0 : instance->getNoncePool();
+		FastEC const* fast = FastEC::For(curve);
+		if (pool != 0 && (hashFunctionName == "sha1" ? pool->Sign<SHA1>(privateExponent, message, signature) : pool->Sign<SHA256>(privateExponent, message, signature))){
+			//Signed with a precomputed nonce
+		} else if (hashFunctionName == "sha1" && FastECDSA_Sign<SHA1>(fast, privateExponent, message, deterministic, signature)){
+			//Signed with the dedicated implementation of the curve
+		} else if (hashFunctionName == "sha256" && FastECDSA_Sign<SHA256>(fast, privateExponent, message, deterministic, signature)){
+			//Idem
+		} else if (deterministic){
+			if (hashFunctionName == "sha1") signature = ECDSA_DeterministicSign<SHA1>(params, privateExponent, message);
+			else signature = ECDSA_DeterministicSign<SHA256>(params, privateExponent, message);
+		} else if (hashFunctionName == "sha1"){
+			AutoSeededRandomPool prng;
 			ECDSA<ECP, SHA1>::PrivateKey privateKey;
-			privateKey.Initialize(prng, curve);
-			privateKey.SetPrivateExponent(HexStrToInteger(instance->keyPair->at("privateKey")));
+			privateKey.Initialize(params, privateExponent);
 			StringSource(message, true, new SignerFilter(prng, ECDSA<ECP, SHA1>::Signer(privateKey), new StringSink(signature)));
 		} else if (hashFunctionName == "sha256"){
+			AutoSeededRandomPool prng;
 			ECDSA<ECP, SHA256>::PrivateKey privateKey;
-			privateKey.Initialize(prng, curve);
-			privateKey.SetPrivateExponent(HexStrToInteger(instance->keyPair->at("privateKey")));
+			privateKey.Initialize(params, privateExponent);
 			StringSource(message, true, new SignerFilter(prng, ECDSA<ECP, SHA256>::Signer(privateKey), new StringSink(signature)));
 		} else {
 			ThrowException(Exception::TypeError(String::New("Internal error : unknown hash function")));
@@ -362,57 +647,121 @@ Handle<Value> KeyRing::Sign(const Arguments& args){
 }
 
 /*
-* Signature
-* Object pubKeyInfo, Function callback (optional)
+* Batch signature, for ECDSA / ECIES key pairs
+* Array messages, String encoding (optional), String hashName | Object options (optional), Function callback (optional)
+* The signatures are returned (or passed to the callback) as an array, in the same order as the messages
 */
-Handle<Value> KeyRing::Agree(const Arguments& args){
+Handle<Value> KeyRing::SignBatch(const Arguments& args){
 	HandleScope scope;
-	if (!(args.Length() == 1 || args.Length() == 2)){
+	//Checking the number of parameters
+	if (!(args.Length() >= 1 && args.Length() <= 4)){
 		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. Please check the module's documentation")));
 		return scope.Close(Undefined());
 	}
+	if (!args[0]->IsArray()){
+		ThrowException(Exception::TypeError(String::New("messages must be an array")));
+		return scope.Close(Undefined());
+	}
+	//Checking that a key pair is loaded
 	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
 	if (instance->keyPair == 0){
 		ThrowException(Exception::TypeError(String::New("No key has been loaded in the keyring. Either load a key on instanciation or by calling the Load() method")));
 		return scope.Close(Undefined());
 	}
+	//Checking the key type
 	string keyType = instance->keyPair->at("keyType");
-	if (keyType != "ecdh"){
-		ThrowException(Exception::TypeError(String::New("The \"agree\" method is for a key agreement algorithm. The only one supported here is ECDH.")));
+	if (!(keyType == "ecdsa" || keyType == "ecies")){
+		ThrowException(Exception::TypeError(String::New("Batch signatures are only available for ECDSA key pairs")));
 		return scope.Close(Undefined());
 	}
-	string secretStr;
-	Local<Value> result = Local<Value>::New(Undefined());
-	//Casting the pubKey parameter and checking that curves are the same
-	Local<Object> pubKeyObj;
-	pubKeyObj = Local<Object>::Cast(args[0]);
-	String::Utf8Value counterpartCurveVal(pubKeyObj->Get(String::NewSymbol("curveName")));
-	String::Utf8Value counterpartPubKeyVal(pubKeyObj->Get(String::NewSymbol("publicKey")));
-	string counterpartCurve(*counterpartCurveVal);
-	string counterpartPubKey(*counterpartPubKeyVal);
-	/*if (pubKeyObj->Has(String::NewSymbol("encoding"))){
-		string counterpartEncoding = pubKeyObj->Get(String::NewSymbol("encoding"));
-		if (counterpartEncoding == "hex"){
-
-		} else if (counterpartEncoding == "base64"){
-
+	//Casting the parameters
+	Local<Array> messagesArray = Local<Array>::Cast(args[0]);
+	string encoding = "", hashFunctionName = "sha1";
+	if (args.Length() >= 2 && !args[1]->IsUndefined()){
+		String::Utf8Value encodingVal(args[1]->ToString());
+		encoding = string(*encodingVal);
+		//Checking that the encoding parameter is valid
+		if (!(encoding == "hex" || encoding == "base64")){
+			ThrowException(Exception::TypeError(String::New("Invalid encoding. It must be either \"hex\" or \"base64\".")));
+			return scope.Close(Undefined());
+		}
+	}
+	bool deterministic = false;
+	if (args.Length() >= 3 && !args[2]->IsUndefined()){
+		if (args[2]->IsObject() && !args[2]->IsFunction()){
+			Local<Object> optionsObj = Local<Object>::Cast(args[2]);
+			if (optionsObj->Has(String::NewSymbol("hashName")) && !optionsObj->Get(String::NewSymbol("hashName"))->IsUndefined()){
+				String::Utf8Value hashFunctionNameVal(optionsObj->Get(String::NewSymbol("hashName"))->ToString());
+				hashFunctionName = string(*hashFunctionNameVal);
+			}
+			deterministic = optionsObj->Get(String::NewSymbol("deterministic"))->BooleanValue();
 		} else {
-			ThrowException(Exception::TypeError(String::New("")));
+			String::Utf8Value hashFunctionNameVal(args[2]->ToString());
+			hashFunctionName = string(*hashFunctionNameVal);
+		}
+		if (!(hashFunctionName == "sha1" || hashFunctionName == "sha256")){
+			ThrowException(Exception::TypeError(String::New("hashFunction must be either \"sha1\" or \"sha256\"")));
+			return scope.Close(Undefined());
+		}
+	}
+	vector<string> messages(messagesArray->Length());
+	for (unsigned int i = 0; i < messagesArray->Length(); i++){
+		String::Utf8Value messageVal(messagesArray->Get(i)->ToString());
+		messages[i] = string(*messageVal);
+	}
+	string curveName = instance->keyPair->at("curveName");
+	const CryptoPP::Integer privateExponent = HexStrToInteger(instance->keyPair->at("privateKey"));
+	vector<string> signatures;
+	if (isBinaryCurve(curveName)){
+		//No batch inversion on binary curves : the messages are signed one by one
+		OID curve = getBCurveFromName(curveName);
+		signatures.resize(messages.size());
+		for (size_t i = 0; i < messages.size(); i++){
+			if (!(hashFunctionName == "sha1" ? binaryCurveSign<SHA1>(curve, privateExponent, messages[i], deterministic, signatures[i]) : binaryCurveSign<SHA256>(curve, privateExponent, messages[i], deterministic, signatures[i]))){
+				ThrowException(Exception::TypeError(String::New("Deterministic signatures aren't available on this curve")));
+				return scope.Close(Undefined());
+			}
 		}
 	} else {
-		counterpartPubKey =
-	}*/
-	if (counterpartCurve != instance->keyPair->at("curveName")){
-		ThrowException(Exception::TypeError(String::New("curves are not the same")));
+		OID curve = getPCurveFromName(curveName);
+		const DL_GroupParameters_EC<ECP> params(curve);
+		if (hashFunctionName == "sha1") signatures = ECDSA_BatchSign<SHA1>(params, curveName, privateExponent, messages, deterministic);
+		else signatures = ECDSA_BatchSign<SHA256>(params, curveName, privateExponent, messages, deterministic);
+	}
+	Local<Array> result = Array::New(signatures.size());
+	for (unsigned int i = 0; i < signatures.size(); i++){
+		if (encoding == "hex" || encoding == "") signatures[i] = strHexEncode(signatures[i]);
+		else signatures[i] = strBase64Encode(signatures[i]);
+		result->Set(i, String::New(signatures[i].c_str()));
+	}
+	if (args.Length() < 4){
+		return scope.Close(result);
+	} else {
+		if (args[3]->IsUndefined()) return scope.Close(result);
+		Local<Function> callback = Local<Function>::Cast(args[3]);
+		const unsigned argc = 1;
+		Local<Value> argv[argc] = { Local<Value>::New(result) };
+		callback->Call(Context::GetCurrent()->Global(), argc, argv);
+		return scope.Close(Undefined());
+	}
+}
+
+/*
+* Signature
+* Object pubKeyInfo, Function callback (optional)
+*/
+Handle<Value> KeyRing::Agree(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() == 1 || args.Length() == 2)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. Please check the module's documentation")));
 		return scope.Close(Undefined());
 	}
-	OID curve = getPCurveFromName(instance->keyPair->at("curveName"));
-	ECDH<ECP>::Domain dhDomain(curve);
-	SecByteBlock privateKey = HexStrToSecByteBlock(instance->keyPair->at("privateKey"));
-	SecByteBlock publicKey = HexStrToSecByteBlock(counterpartPubKey);
-	SecByteBlock secret(dhDomain.AgreedValueLength());
-	dhDomain.Agree(secret, privateKey, publicKey);
-	result = String::New(SecByteBlockToHexStr(secret).c_str());
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	SecByteBlock secret;
+	string counterpartPubKey;
+	if (!instance->agreedSecret(Local<Object>::Cast(args[0]), secret, counterpartPubKey)) return scope.Close(Undefined());
+	//Fixed-length encoding : leading zero bytes are part of the secret
+	Local<Value> result = String::New(bufferHexEncode(secret.BytePtr(), secret.SizeInBytes()).c_str());
 	if (args.Length() == 1){
 		return scope.Close(result);
 	} else {
@@ -425,6 +774,163 @@ Handle<Value> KeyRing::Agree(const Arguments& args){
 	}
 }
 
+//ECDH with Crypto++, for the curves that FastEC / FastEC2N don't support
+template <class EC>
+static bool cryptoppAgree(OID const& curve, SecByteBlock privateKey, SecByteBlock const& publicKey, SecByteBlock& secret){
+	typename ECDH<EC>::Domain dhDomain(curve);
+	//The hex private key loses its leading zero bytes; Crypto++ reads exactly PrivateKeyLength() bytes
+	if (privateKey.size() < dhDomain.PrivateKeyLength()){
+		SecByteBlock padded(dhDomain.PrivateKeyLength());
+		memset(padded.BytePtr(), 0, padded.size() - privateKey.size());
+		memcpy(padded.BytePtr() + padded.size() - privateKey.size(), privateKey.BytePtr(), privateKey.size());
+		privateKey.swap(padded);
+	}
+	secret.New(dhDomain.AgreedValueLength());
+	return publicKey.size() == dhDomain.PublicKeyLength() && dhDomain.Agree(secret, privateKey, publicKey);
+}
+
+bool KeyRing::agreedSecret(Local<Object> pubKeyObj, SecByteBlock& secret, string& peerPublicKey){
+	if (keyPair == 0){
+		ThrowException(Exception::TypeError(String::New("No key has been loaded in the keyring. Either load a key on instanciation or by calling the Load() method")));
+		return false;
+	}
+	string keyType = keyPair->at("keyType");
+	if (!(keyType == "ecdh" || keyType == "x25519")){
+		ThrowException(Exception::TypeError(String::New("The \"agree\" method is for a key agreement algorithm. The ones supported here are ECDH and X25519.")));
+		return false;
+	}
+	//Casting the pubKey parameter and checking that curves are the same
+	String::Utf8Value counterpartCurveVal(pubKeyObj->Get(String::NewSymbol("curveName")));
+	String::Utf8Value counterpartPubKeyVal(pubKeyObj->Get(String::NewSymbol("publicKey")));
+	string counterpartCurve(*counterpartCurveVal);
+	peerPublicKey = strHexDecode(string(*counterpartPubKeyVal));
+	if (keyType == "x25519"){
+		//X25519 keys have a fixed length : they are hex encoded byte arrays rather than integers
+		const string privateKeyStr = strHexDecode(keyPair->at("privateKey"));
+		if (peerPublicKey.length() != CURVE25519_KEY_LENGTH){
+			ThrowException(Exception::TypeError(String::New("Invalid X25519 public key")));
+			return false;
+		}
+		const SecByteBlock privateKey((const byte*) privateKeyStr.data(), privateKeyStr.size()), publicKey((const byte*) peerPublicKey.data(), peerPublicKey.size());
+		if (!X25519_Agree(privateKey, publicKey, secret)){
+			ThrowException(Exception::TypeError(String::New("Invalid X25519 public key")));
+			return false;
+		}
+		return true;
+	}
+	if (counterpartCurve != keyPair->at("curveName")){
+		ThrowException(Exception::TypeError(String::New("curves are not the same")));
+		return false;
+	}
+	const bool binary = isBinaryCurve(keyPair->at("curveName"));
+	OID curve = binary ? getBCurveFromName(keyPair->at("curveName")) : getPCurveFromName(keyPair->at("curveName"));
+	//On prime curves, the x-only ladder takes compressed and x-only keys as they are. Otherwise compressed keys are decompressed, Crypto++ taking uncompressed ones
+	ECLadder const* ladder = binary ? 0 : ECLadder::For(curve);
+	if (ladder == 0 && peerPublicKey.size() > 0 && (peerPublicKey[0] == 0x02 || peerPublicKey[0] == 0x03)
+		&& !(binary ? ECPoint_DecompressB(curve, string(peerPublicKey), peerPublicKey) : ECPoint_DecompressP(curve, string(peerPublicKey), peerPublicKey))){
+		ThrowException(Exception::TypeError(String::New("Invalid ECDH public key")));
+		return false;
+	}
+	SecByteBlock privateKey = HexStrToSecByteBlock(keyPair->at("privateKey"));
+	const SecByteBlock publicKey((const byte*) peerPublicKey.data(), peerPublicKey.size());
+	bool agreed;
+	if (binary) agreed = FastECDH_Agree(FastEC2N::For(curve), privateKey, publicKey, secret) || cryptoppAgree<EC2N>(curve, privateKey, publicKey, secret);
+	//FastEC is still the fastest on uncompressed secp256k1 keys (GLV endomorphism)
+	else if (ladder != 0) agreed = FastECDH_Agree(FastEC::For(curve), privateKey, publicKey, secret) || ladder->Agree(privateKey, publicKey, secret);
+	else agreed = FastECDH_Agree(FastEC::For(curve), privateKey, publicKey, secret) || cryptoppAgree<ECP>(curve, privateKey, publicKey, secret);
+	if (!agreed){
+		ThrowException(Exception::TypeError(String::New("Invalid ECDH public key")));
+		return false;
+	}
+	return true;
+}
+
+/*
+* Signature :
+* Object pubKey (same as for agree), Object options (optional), Function callback (optional)
+* options : {kdf : "hkdf-sha256" (default) or "hkdf-sha512", aead : "aes-gcm" (default), "aes-ccm" or "chacha20-poly1305", salt : Buffer, info : Buffer}
+* Returns a session object (see session.h), with encrypt(), decrypt() and close() methods. Both parties must use the same options
+*/
+Handle<Value> KeyRing::OpenSession(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 3)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. Please check the module's documentation")));
+		return scope.Close(Undefined());
+	}
+	if (!args[0]->IsObject()){
+		ThrowException(Exception::TypeError(String::New("pubKey must be an object")));
+		return scope.Close(Undefined());
+	}
+	string kdf = "hkdf-sha256", aeadName = "aes-gcm", salt = "", info = "";
+	if (args.Length() >= 2 && !args[1]->IsUndefined() && !args[1]->IsFunction()){
+		if (!args[1]->IsObject()){
+			ThrowException(Exception::TypeError(String::New("options must be an object")));
+			return scope.Close(Undefined());
+		}
+		Local<Object> optionsObj = Local<Object>::Cast(args[1]);
+		Local<Value> kdfVal = optionsObj->Get(String::NewSymbol("kdf")), aeadVal = optionsObj->Get(String::NewSymbol("aead"));
+		Local<Value> saltVal = optionsObj->Get(String::NewSymbol("salt")), infoVal = optionsObj->Get(String::NewSymbol("info"));
+		if (!kdfVal->IsUndefined()){
+			String::Utf8Value kdfStr(kdfVal->ToString());
+			kdf = string(*kdfStr);
+		}
+		if (!aeadVal->IsUndefined()){
+			String::Utf8Value aeadStr(aeadVal->ToString());
+			aeadName = string(*aeadStr);
+		}
+		if (!(saltVal->IsUndefined() || node::Buffer::HasInstance(saltVal)) || !(infoVal->IsUndefined() || node::Buffer::HasInstance(infoVal))){
+			ThrowException(Exception::TypeError(String::New("salt and info must be Buffers")));
+			return scope.Close(Undefined());
+		}
+		if (!saltVal->IsUndefined()) salt = string(node::Buffer::Data(saltVal->ToObject()), node::Buffer::Length(saltVal->ToObject()));
+		if (!infoVal->IsUndefined()) info = string(node::Buffer::Data(infoVal->ToObject()), node::Buffer::Length(infoVal->ToObject()));
+	}
+	if (!(kdf == "hkdf-sha256" || kdf == "hkdf-sha512")){
+		ThrowException(Exception::TypeError(String::New("Unknown KDF. Possible values are \"hkdf-sha256\" and \"hkdf-sha512\"")));
+		return scope.Close(Undefined());
+	}
+	AEADAlgorithm algorithm;
+	if (!AEAD_GetAlgorithm(aeadName, algorithm)){
+		ThrowException(Exception::TypeError(String::New("Unknown AEAD algorithm. Possible values are \"aes-gcm\", \"aes-ccm\" and \"chacha20-poly1305\"")));
+		return scope.Close(Undefined());
+	}
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	SecByteBlock secret;
+	string peerPublicKey;
+	if (!instance->agreedSecret(Local<Object>::Cast(args[0]), secret, peerPublicKey)) return scope.Close(Undefined());
+	//The algorithm is part of the derivation, so that a key is never shared by two algorithms
+	info = "node-cryptopp session " + aeadName + string(1, '\0') + info;
+	SecByteBlock keyMaterial(SESSION_KEY_MATERIAL_LENGTH);
+	if (kdf == "hkdf-sha256") HKDF_DeriveKey<SHA256>(keyMaterial.BytePtr(), keyMaterial.size(), secret.BytePtr(), secret.size(), (const byte*) salt.data(), salt.size(), (const byte*) info.data(), info.size());
+	else HKDF_DeriveKey<SHA512>(keyMaterial.BytePtr(), keyMaterial.size(), secret.BytePtr(), secret.size(), (const byte*) salt.data(), salt.size(), (const byte*) info.data(), info.size());
+	string publicKey = strHexDecode(instance->keyPair->at("publicKey"));
+	if (instance->keyPair->at("keyType") == "ecdh"){
+		const string curveName = instance->keyPair->at("curveName");
+		if (isBinaryCurve(curveName)) ECPoint_DecompressB(getBCurveFromName(curveName), string(publicKey), publicKey);
+		else {
+			//Both keys are compared uncompressed. An x-only peer key is read with an even y : distinct keys have distinct x coordinates, which decide the order
+			const OID curve = getPCurveFromName(curveName);
+			ECPoint_DecompressP(curve, string(publicKey), publicKey);
+			if (peerPublicKey.size() + 1 == DL_GroupParameters_EC<ECP>(curve).GetCurve().EncodedPointSize(true)) peerPublicKey.insert(0, 1, '\x02');
+			if (peerPublicKey.size() > 0 && peerPublicKey[0] != 0x04) ECPoint_DecompressP(curve, string(peerPublicKey), peerPublicKey);
+		}
+	}
+	const bool sendsWithFirstKey = publicKey < peerPublicKey;
+	Local<Value> result;
+	try {
+		result = Local<Object>::New(KeySession::Create(algorithm, keyMaterial, sendsWithFirstKey));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	if (args.Length() < 2 || !args[args.Length() - 1]->IsFunction()) return scope.Close(result);
+	Local<Function> callback = Local<Function>::Cast(args[args.Length() - 1]);
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { result };
+	callback->Call(Context::GetCurrent()->Global(), argc, argv);
+	return scope.Close(Undefined());
+}
+
 // Function callback (optional)
 Handle<Value> KeyRing::PublicKeyInfo(const Arguments& args){
 	HandleScope scope;
@@ -449,14 +955,48 @@ Handle<Value> KeyRing::PublicKeyInfo(const Arguments& args){
 	}
 }
 
+//keyOptions of the EC key types : the curve name, or {curveName, compressed}. With compressed, the public key is kept (and saved) as a compressed point
+static string ecKeyOptions(Local<Value> keyOptions, bool& compressed){
+	compressed = false;
+	if (!keyOptions->IsObject()){
+		String::AsciiValue curveNameVal(keyOptions->ToString());
+		return string(*curveNameVal);
+	}
+	Local<Object> optionsObj = Local<Object>::Cast(keyOptions);
+	compressed = optionsObj->Get(String::NewSymbol("compressed"))->BooleanValue();
+	String::AsciiValue curveNameVal(optionsObj->Get(String::NewSymbol("curveName"))->ToString());
+	return string(*curveNameVal);
+}
+
+//Generated with FastEC2N when it supports the curve, otherwise with Crypto++
+void KeyRing::binaryCurveKeyPair(OID const& curve, string const& curveName, string const& keyType, bool compressed, map<string, string>* keyPair){
+	AutoSeededRandomPool prng;
+	CryptoPP::Integer privateExponent;
+	EC2NPoint publicPoint;
+	if (!FastEC_GenerateKeyPair(FastEC2N::For(curve), prng, privateExponent, publicPoint)){
+		ECDSA<EC2N, SHA256>::PrivateKey privateKey;
+		ECDSA<EC2N, SHA256>::PublicKey publicKey;
+		privateKey.Initialize(prng, curve);
+		privateKey.MakePublicKey(publicKey);
+		privateExponent = privateKey.GetPrivateExponent();
+		publicPoint = publicKey.GetPublicElement();
+	}
+	keyPair->insert(make_pair("keyType", keyType));
+	keyPair->insert(make_pair("curveName", curveName));
+	keyPair->insert(make_pair("publicKeyX", PolynomialMod2ToHexStr(publicPoint.x)));
+	keyPair->insert(make_pair("publicKeyY", PolynomialMod2ToHexStr(publicPoint.y)));
+	keyPair->insert(make_pair("privateKey", IntegerToHexStr(privateExponent)));
+	if (compressed) keyPair->insert(make_pair("publicKey", strHexEncode(ECPoint_EncodeB(curve, publicPoint, true))));
+}
+
 /*
 * Signature
-* String keyType, Number/String keyOptions, String filename [optional], String passphrase [optional], Function callback [optional]
+* String keyType, Number/String/Object keyOptions, String filename [optional], String passphrase [optional], Function callback [optional]
 */
 Handle<Value> KeyRing::CreateKeyPair(const Arguments& args){
 	HandleScope scope;
 	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
-	if (args.Length() < 2){
+	if (args.Length() < 1){
 		//"Invalid number of parameters. Please check the module's documentation"
 		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. You must at least specify the key type and related paremters like key size or curve name")));
 		return scope.Close(Undefined());
@@ -464,34 +1004,60 @@ Handle<Value> KeyRing::CreateKeyPair(const Arguments& args){
 	String::Utf8Value algoTypeVal(args[0]->ToString());
 	std::string algoType(*algoTypeVal);
 	//Checking that the key type is supported, otherwise throw an exception
-	if (!(algoType == "rsa" || algoType == "dsa" || algoType == "ecdsa" || algoType == "ecies" || algoType == "ecdh")){
+	if (!(algoType == "rsa" || algoType == "dsa" || algoType == "ecdsa" || algoType == "ecies" || algoType == "ecdh" || algoType == "x25519" || algoType == "ed25519")){
 		ThrowException(Exception::TypeError(String::New("Invalid algo type.")));
 		return scope.Close(Undefined());
 	}
+	//X25519 and Ed25519 have no key option
+	if (args.Length() < 2 && !(algoType == "x25519" || algoType == "ed25519")){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. You must at least specify the key type and related paremters like key size or curve name")));
+		return scope.Close(Undefined());
+	}
 	//Instanciating a new key map object
 	map<string, string>* newKeyPair = new map<string, string>();
-	if (instance->keyPair != 0){ //Delete the last key map, if there is one
-		delete instance->keyPair;
-		instance->keyPair = 0;
-	}
+	//Wipe and delete the last key map, if there is one
+	deleteKeyPair(instance->keyPair);
+	instance->keyPair = 0;
 	instance->keyPair = newKeyPair;
 	//Declaring the public key object
 	if (algoType == "rsa"){
-		Local<v8::Integer> keySizeVal = Local<v8::Integer>::Cast(args[1]);
-		int keySize = keySizeVal->Value();
+		//algoOptions : the key size, or {keySize, primes} for a multi-prime key
+		int keySize, primeCount = 2;
+		if (args[1]->IsObject()){
+			Local<Object> rsaOptions = Local<Object>::Cast(args[1]);
+			keySize = rsaOptions->Get(String::NewSymbol("keySize"))->Int32Value();
+			Local<Value> primeCountVal = rsaOptions->Get(String::NewSymbol("primes"));
+			if (!primeCountVal->IsUndefined()) primeCount = primeCountVal->Int32Value();
+		} else {
+			Local<v8::Integer> keySizeVal = Local<v8::Integer>::Cast(args[1]);
+			keySize = keySizeVal->Value();
+		}
 		if (!(keySize >= 1024 && keySize <= 16384)){
 			ThrowException(v8::Exception::TypeError(String::New("Invalid key size. Must be between 1024 and 16384 bits")));
 			return scope.Close(Undefined());
 		}
+		if (!(primeCount >= 2 && (unsigned int) primeCount <= InvertibleMultiPrimeRSAFunction::MaxPrimes(keySize))){
+			ThrowException(v8::Exception::TypeError(String::New("Invalid number of primes. Must be 2 below 1024 bits, up to 3 below 4096 bits, up to 4 below 8192 bits, up to 5 otherwise")));
+			return scope.Close(Undefined());
+		}
 		//Generating the key pair
 		AutoSeededRandomPool prng;
-		InvertibleRSAFunction keyPairParams;
-		keyPairParams.GenerateRandomWithKeySize(prng, keySize);
+		InvertibleMultiPrimeRSAFunction keyPairParams;
+		keyPairParams.GenerateRandomWithPrimes(prng, keySize, primeCount);
 		//Build the key map
 		newKeyPair->insert(make_pair("keyType", "rsa"));
 		newKeyPair->insert(make_pair("modulus", IntegerToHexStr(keyPairParams.GetModulus())));
 		newKeyPair->insert(make_pair("publicExponent", IntegerToHexStr(keyPairParams.GetPublicExponent())));
 		newKeyPair->insert(make_pair("privateExponent", IntegerToHexStr(keyPairParams.GetPrivateExponent())));
+		//Two-prime keys don't keep their primes (they are recovered from the private exponent)
+		if (primeCount > 2){
+			string primes = "";
+			for (size_t i = 0; i < keyPairParams.GetPrimes().size(); i++){
+				if (i > 0) primes += ",";
+				primes += IntegerToHexStr(keyPairParams.GetPrimes()[i]);
+			}
+			newKeyPair->insert(make_pair("primes", primes));
+		}
 	} else if (algoType == "dsa"){
 		Local<v8::Integer> keySizeVal = Local<v8::Integer>::Cast(args[1]);
 		int keySize = keySizeVal->Value();
@@ -514,99 +1080,141 @@ Handle<Value> KeyRing::CreateKeyPair(const Arguments& args){
 		newKeyPair->insert(make_pair("publicElement", IntegerToHexStr(publicKey.GetPublicElement())));
 	} else if (algoType == "ecies"){
 		//Getting curve name and checking validity
-		String::AsciiValue curveNameVal(args[1]->ToString());
-		std::string curveName(*curveNameVal);
-		if (curveName.find("sect") == 0){
-			ThrowException(Exception::TypeError(String::New("Binary curves are not supported yet. Please use prime curves.")));
-			return scope.Close(Undefined());
-		}
+		bool compressed;
+		std::string curveName = ecKeyOptions(args[1], compressed);
+		const bool binary = isBinaryCurve(curveName);
 		OID curve;
 		try {
-			curve = getPCurveFromName(curveName);
+			curve = binary ? getBCurveFromName(curveName) : getPCurveFromName(curveName);
 		} catch (runtime_error* e){
 			ThrowException(Exception::TypeError(String::New("Unknown curve")));
 			return scope.Close(Undefined());
 		}
-		//Generating the key pair
-		AutoSeededRandomPool prng;
-		ECIES<ECP>::Decryptor d(prng, curve);
-		CryptoPP::Integer privateKey = d.GetKey().GetPrivateExponent();
-		const DL_GroupParameters_EC<ECP>& params = d.GetKey().GetGroupParameters();
-		const DL_FixedBasePrecomputation<ECPPoint>& bpc = params.GetBasePrecomputation();
-		const ECPPoint publicKey = bpc.Exponentiate(params.GetGroupPrecomputation(), d.GetKey().GetPrivateExponent());
-		//Building the key map
-		newKeyPair->insert(make_pair("keyType", "ecies"));
-		newKeyPair->insert(make_pair("curveName", curveName));
-		newKeyPair->insert(make_pair("publicKeyX", IntegerToHexStr(publicKey.x)));
-		newKeyPair->insert(make_pair("publicKeyY", IntegerToHexStr(publicKey.y)));
-		newKeyPair->insert(make_pair("privateKey", IntegerToHexStr(privateKey)));
+		if (binary){
+			binaryCurveKeyPair(curve, curveName, "ecies", compressed, newKeyPair);
+		} else {
+			//Generating the key pair
+			AutoSeededRandomPool prng;
+			ECIES<ECP>::Decryptor d(prng, curve);
+			CryptoPP::Integer privateKey = d.GetKey().GetPrivateExponent();
+			const DL_GroupParameters_EC<ECP>& params = d.GetKey().GetGroupParameters();
+			const DL_FixedBasePrecomputation<ECPPoint>& bpc = params.GetBasePrecomputation();
+			const ECPPoint publicKey = bpc.Exponentiate(params.GetGroupPrecomputation(), d.GetKey().GetPrivateExponent());
+			//Building the key map
+			newKeyPair->insert(make_pair("keyType", "ecies"));
+			newKeyPair->insert(make_pair("curveName", curveName));
+			newKeyPair->insert(make_pair("publicKeyX", IntegerToHexStr(publicKey.x)));
+			newKeyPair->insert(make_pair("publicKeyY", IntegerToHexStr(publicKey.y)));
+			newKeyPair->insert(make_pair("privateKey", IntegerToHexStr(privateKey)));
+			if (compressed) newKeyPair->insert(make_pair("publicKey", strHexEncode(ECPoint_EncodeP(curve, publicKey, true))));
+		}
 	} else if (algoType == "ecdsa"){
 		//Getting curve name and checking validity
-		String::AsciiValue curveNameVal(args[1]->ToString());
-		std::string curveName(*curveNameVal);
-		if (curveName.find("sect") == 0){
-			ThrowException(Exception::TypeError(String::New("Binary curves are not supported yet. Please use prime curves.")));
-			return scope.Close(Undefined());
-		}
+		bool compressed;
+		std::string curveName = ecKeyOptions(args[1], compressed);
+		const bool binary = isBinaryCurve(curveName);
 		OID curve;
 		try {
-			curve = getPCurveFromName(curveName);
+			curve = binary ? getBCurveFromName(curveName) : getPCurveFromName(curveName);
 		} catch (runtime_error* e){
 			ThrowException(Exception::TypeError(String::New("Unknown curve")));
 			return scope.Close(Undefined());
 		}
-		//Generating the key pair
-		AutoSeededRandomPool prng;
-		ECDSA<ECP, SHA256>::PrivateKey privateKey;
-		ECDSA<ECP, SHA256>::PublicKey publicKey;
-		privateKey.Initialize(prng, curve);
-		privateKey.MakePublicKey(publicKey);
-		const ECPPoint publicPoint(publicKey.GetPublicElement());
-		//Building the key map
-		newKeyPair->insert(make_pair("keyType", "ecdsa"));
-		newKeyPair->insert(make_pair("curveName", curveName));
-		newKeyPair->insert(make_pair("publicKeyX", IntegerToHexStr(publicPoint.x)));
-		newKeyPair->insert(make_pair("publicKeyY", IntegerToHexStr(publicPoint.y)));
-		newKeyPair->insert(make_pair("privateKey", IntegerToHexStr(privateKey.GetPrivateExponent())));
+		if (binary){
+			binaryCurveKeyPair(curve, curveName, "ecdsa", compressed, newKeyPair);
+		} else {
+			//Generating the key pair
+			AutoSeededRandomPool prng;
+			ECDSA<ECP, SHA256>::PrivateKey privateKey;
+			ECDSA<ECP, SHA256>::PublicKey publicKey;
+			privateKey.Initialize(prng, curve);
+			privateKey.MakePublicKey(publicKey);
+			const ECPPoint publicPoint(publicKey.GetPublicElement());
+			//Building the key map
+			newKeyPair->insert(make_pair("keyType", "ecdsa"));
+			newKeyPair->insert(make_pair("curveName", curveName));
+			newKeyPair->insert(make_pair("publicKeyX", IntegerToHexStr(publicPoint.x)));
+			newKeyPair->insert(make_pair("publicKeyY", IntegerToHexStr(publicPoint.y)));
+			newKeyPair->insert(make_pair("privateKey", IntegerToHexStr(privateKey.GetPrivateExponent())));
+			if (compressed) newKeyPair->insert(make_pair("publicKey", strHexEncode(ECPoint_EncodeP(curve, publicPoint, true))));
+		}
 	} else if (algoType == "ecdh"){
 		//Getting curve name and checking validity
-		String::AsciiValue curveNameVal(args[1]->ToString());
-		std::string curveName(*curveNameVal);
-		if (curveName.find("sect") == 0){
-			ThrowException(Exception::TypeError(String::New("Binary curves are not supported yet. Please use prime curves.")));
-			return scope.Close(Undefined());
-		}
+		bool compressed;
+		std::string curveName = ecKeyOptions(args[1], compressed);
+		const bool binary = isBinaryCurve(curveName);
 		OID curve;
 		try {
-			curve = getPCurveFromName(curveName);
+			curve = binary ? getBCurveFromName(curveName) : getPCurveFromName(curveName);
 		} catch (runtime_error* e){
 			ThrowException(Exception::TypeError(String::New("Unknown curve")));
 			return scope.Close(Undefined());
 		}
 		//Generating key pair
 		AutoSeededX917RNG<AES> prng;
-		ECDH<ECP>::Domain dhDomain(curve);
-		SecByteBlock privKey(dhDomain.PrivateKeyLength()), publicKey(dhDomain.PublicKeyLength());
-		dhDomain.GenerateKeyPair(prng, privKey, publicKey);
+		SecByteBlock privKey, publicKey;
+		if (!binary){
+			ECDH<ECP>::Domain dhDomain(curve);
+			privKey.New(dhDomain.PrivateKeyLength());
+			publicKey.New(dhDomain.PublicKeyLength());
+			dhDomain.GenerateKeyPair(prng, privKey, publicKey);
+		} else if (!FastECDH_GenerateKeyPair(FastEC2N::For(curve), prng, privKey, publicKey)){
+			ECDH<EC2N>::Domain dhDomain(curve);
+			privKey.New(dhDomain.PrivateKeyLength());
+			publicKey.New(dhDomain.PublicKeyLength());
+			dhDomain.GenerateKeyPair(prng, privKey, publicKey);
+		}
+		string publicKeyStr((const char*) publicKey.BytePtr(), publicKey.size());
+		if (compressed){
+			if (binary) ECPoint_CompressPrefixB(curve, publicKeyStr);
+			else ECPoint_CompressPrefixP(curve, publicKeyStr);
+		}
 		//Building the key map
 		newKeyPair->insert(make_pair("keyType", "ecdh"));
 		newKeyPair->insert(make_pair("curveName", curveName));
 		newKeyPair->insert(make_pair("privateKey", SecByteBlockToHexStr(privKey)));
-		newKeyPair->insert(make_pair("publicKey", SecByteBlockToHexStr(publicKey)));
-	}
-	//Saving the key if asked by the user
-	if (args.Length() == 3){
-		String::Utf8Value filenameVal(args[2]->ToString());
-		string filename(*filenameVal);
-		saveKeyPair(filename, newKeyPair);
-		instance->filename_ = filename;
-	} else if (args.Length() == 4){
-		String::Utf8Value filenameVal(args[2]->ToString());
-		String::Utf8Value passphraseVal(args[3]->ToString());
-		string filename(*filenameVal), passphrase(*passphraseVal);
-		saveKeyPair(filename, newKeyPair, passphrase);
-		instance->filename_ = filename;
+		newKeyPair->insert(make_pair("publicKey", strHexEncode(publicKeyStr)));
+	} else if (algoType == "x25519"){
+		//Generating key pair
+		AutoSeededRandomPool prng;
+		SecByteBlock privateKey, publicKey;
+		X25519_GenerateKeyPair(prng, privateKey, publicKey);
+		//Building the key map
+		newKeyPair->insert(make_pair("keyType", "x25519"));
+		newKeyPair->insert(make_pair("privateKey", bufferHexEncode(privateKey.BytePtr(), privateKey.SizeInBytes())));
+		newKeyPair->insert(make_pair("publicKey", bufferHexEncode(publicKey.BytePtr(), publicKey.SizeInBytes())));
+	} else if (algoType == "ed25519"){
+		//Generating key pair
+		AutoSeededRandomPool prng;
+		SecByteBlock privateKey;
+		string publicKey;
+		Ed25519_GenerateKeyPair(prng, privateKey, publicKey);
+		//Building the key map
+		newKeyPair->insert(make_pair("keyType", "ed25519"));
+		newKeyPair->insert(make_pair("privateKey", bufferHexEncode(privateKey.BytePtr(), privateKey.SizeInBytes())));
+		newKeyPair->insert(make_pair("publicKey", strHexEncode(publicKey)));
 	}
+	//Saving the key if asked by the user. The key stays loaded if the file can't be written
+	try {
+		if (args.Length() == 3){
+			String::Utf8Value filenameVal(args[2]->ToString());
+			string filename(*filenameVal);
+			saveKeyPair(filename, newKeyPair);
+			instance->filename_ = filename;
+		} else if (args.Length() == 4){
+			String::Utf8Value filenameVal(args[2]->ToString());
+			String::Utf8Value passphraseVal(args[3]->ToString());
+			string filename(*filenameVal), passphrase(*passphraseVal);
+			saveKeyPair(filename, newKeyPair, passphrase);
+			instance->filename_ = filename;
+		}
+	} catch (runtime_error* e){
+		ThrowException(Exception::Error(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	//Warming up the nonce pool for the new key, if enabled
+	instance->getNoncePool();
 	//Building public key info object
 	Local<Object> pubKey = instance->PPublicKeyInfo();
 	if (args.Length() < 5){
@@ -646,10 +1254,15 @@ Local<Object> KeyRing::PPublicKeyInfo(){
 			if (!(keyPair->count(params[i]) > 0)) throw new runtime_error(params[i] + " parameters is missing from " + keyType + " key pair");
 		}
 		pubKeyObj->Set(String::NewSymbol("curveName"), String::New(keyPair->at("curveName").c_str()));
-		Local<Object> publicPoint = Object::New();
-		publicPoint->Set(String::NewSymbol("x"), String::New(keyPair->at("publicKeyX").c_str()));
-		publicPoint->Set(String::NewSymbol("y"), String::New(keyPair->at("publicKeyY").c_str()));
-		pubKeyObj->Set(String::NewSymbol("publicKey"), publicPoint);
+		//Key pairs created or saved with compressed public keys give them the same way
+		if (keyPair->count("publicKey") > 0){
+			pubKeyObj->Set(String::NewSymbol("publicKey"), String::New(keyPair->at("publicKey").c_str()));
+		} else {
+			Local<Object> publicPoint = Object::New();
+			publicPoint->Set(String::NewSymbol("x"), String::New(keyPair->at("publicKeyX").c_str()));
+			publicPoint->Set(String::NewSymbol("y"), String::New(keyPair->at("publicKeyY").c_str()));
+			pubKeyObj->Set(String::NewSymbol("publicKey"), publicPoint);
+		}
 	/*} else if (keyType == "ecdsa"){
 		string params[] = {"curveName", "publicKeyX", "publicKeyY"};
 		for (int i = 0; i < 3; i++){
@@ -662,63 +1275,194 @@ Local<Object> KeyRing::PPublicKeyInfo(){
 			if (!(keyPair->count(params[i]) > 0)) throw new runtime_error(params[i] + " parameter is missing from " + keyType + " key pair");
 			pubKeyObj->Set(String::NewSymbol(params[i].c_str()), String::New(keyPair->at(params[i]).c_str()));
 		}
+	} else if (keyType == "x25519" || keyType == "ed25519"){
+		if (!(keyPair->count("publicKey") > 0)) throw new runtime_error("publicKey parameter is missing from " + keyType + " key pair");
+		pubKeyObj->Set(String::NewSymbol("publicKey"), String::New(keyPair->at("publicKey").c_str()));
 	} else throw new runtime_error("Internal error. Unknown key type");
 	return pubKeyObj;
 }
 
+/*
+* Asynchronous load() and save() : the file is read (or written) and decrypted (or encrypted) on the thread pool.
+* The KeyRing object is kept alive until the load is done; the key map to save is a copy, so the KeyRing can be cleared meanwhile
+*/
+struct KeyFileTask {
+	uv_work_t request;
+	string filename, passphrase, error;
+	bool legacy;
+	//Reload of a watched key file
+	bool reload;
+	//KDF cost of encrypted files being saved
+	unsigned int pbkdfIterations;
+	KDFHash hash;
+	//Loaded key map, or key map to save (wiped and deleted when saved)
+	map<string, string>* keyPair;
+	Persistent<Object> keyRing;
+	Persistent<Function> callback;
+};
+
+void KeyRing::queueLoad(Handle<Object> keyRing, string const& filename, bool legacy, string const& passphrase, Local<Function> callback, bool reload){
+	KeyFileTask* task = new KeyFileTask();
+	task->request.data = task;
+	task->filename = filename;
+	task->passphrase = passphrase;
+	task->legacy = legacy;
+	task->reload = reload;
+	task->keyPair = 0;
+	task->keyRing = Persistent<Object>::New(keyRing);
+	task->callback = Persistent<Function>::New(callback);
+	uv_queue_work(uv_default_loop(), &task->request, LoadWork, LoadDone);
+}
+
+void KeyRing::LoadWork(uv_work_t* req){
+	KeyFileTask* task = static_cast<KeyFileTask*>(req->data);
+	try {
+		task->keyPair = loadKeyPair(task->filename, task->legacy, task->passphrase);
+	} catch (runtime_error* e){
+		task->error = e->what();
+		delete e;
+	} catch (CryptoPP::Exception const& e){
+		task->error = e.what();
+	}
+	if (!task->passphrase.empty()) memset(&task->passphrase[0], 0, task->passphrase.size());
+}
+
+//Back on the main thread : the key map is handed to the KeyRing, and the callback receives (pubKey) or (undefined, error)
+void KeyRing::LoadDone(uv_work_t* req, int status){
+	HandleScope scope;
+	KeyFileTask* task = static_cast<KeyFileTask*>(req->data);
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(task->keyRing);
+	//The key ring stopped watching the file meanwhile (unwatch() or clear()) : the reloaded key is dropped, without calling onReload
+	if (task->reload && instance->watch_ == 0){
+		deleteKeyPair(task->keyPair);
+		task->keyRing.Dispose();
+		task->callback.Dispose();
+		delete task;
+		return;
+	}
+	Local<Function> callback = Local<Function>::New(task->callback);
+	Local<Value> pubKey = Local<Value>::New(Undefined()), error = Local<Value>::New(Undefined());
+	if (task->keyPair != 0){
+		try {
+			pubKey = instance->loadedKeyPair(task->keyPair);
+		} catch (runtime_error* e){
+			task->error = e->what();
+			delete e;
+		}
+	}
+	if (task->error != "") error = Exception::TypeError(String::New(task->error.c_str()));
+	const bool reload = task->reload;
+	task->keyRing.Dispose();
+	task->callback.Dispose();
+	delete task;
+	//The file changed again while it was being loaded
+	if (reload && instance->watch_ != 0){
+		instance->watch_->loading = false;
+		if (instance->watch_->pending) instance->reloadKeyPair();
+	}
+	if (callback.IsEmpty()) return;
+	const unsigned argc = 2;
+	Local<Value> argv[argc] = { pubKey, error };
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+Local<Object> KeyRing::loadedKeyPair(map<string, string>* loaded){
+	deleteKeyPair(keyPair);
+	keyPair = loaded;
+	getNoncePool();
+	return PPublicKeyInfo();
+}
+
+void KeyRing::queueSave(string const& filename, map<string, string>* keyPair, string const& passphrase, unsigned int pbkdfIterations, KDFHash hash, Local<Function> callback){
+	KeyFileTask* task = new KeyFileTask();
+	task->request.data = task;
+	task->filename = filename;
+	task->passphrase = passphrase;
+	task->legacy = false;
+	task->reload = false;
+	task->pbkdfIterations = pbkdfIterations;
+	task->hash = hash;
+	task->keyPair = keyPair;
+	task->callback = Persistent<Function>::New(callback);
+	uv_queue_work(uv_default_loop(), &task->request, SaveWork, SaveDone);
+}
+
+void KeyRing::SaveWork(uv_work_t* req){
+	KeyFileTask* task = static_cast<KeyFileTask*>(req->data);
+	try {
+		saveKeyPair(task->filename, task->keyPair, task->passphrase, task->pbkdfIterations, task->hash);
+	} catch (runtime_error* e){
+		task->error = e->what();
+		delete e;
+	}
+	deleteKeyPair(task->keyPair);
+	task->keyPair = 0;
+	if (!task->passphrase.empty()) memset(&task->passphrase[0], 0, task->passphrase.size());
+}
+
+//Back on the main thread. The callback receives an error if the file couldn't be written
+void KeyRing::SaveDone(uv_work_t* req, int status){
+	HandleScope scope;
+	KeyFileTask* task = static_cast<KeyFileTask*>(req->data);
+	Local<Function> callback = Local<Function>::New(task->callback);
+	Local<Value> error = Local<Value>::New(Undefined());
+	if (task->error != "") error = Exception::Error(String::New(task->error.c_str()));
+	task->callback.Dispose();
+	delete task;
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { error };
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
 /*
 * Signature
-* String filename, Boolean legacy, String passphrase, Function callback [freaking optional]
+* String filename, Boolean legacy [optional], String passphrase [optional], Function callback [optional]
+* Without a callback, the key is loaded synchronously and its public key info is returned. With a callback (the last parameter), the file
+* is read and decoded on the thread pool, then the callback receives the public key info, or (undefined, error)
 */
 Handle<Value> KeyRing::Load(const Arguments& args){
 	HandleScope scope;
 	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
-	if (args.Length() >= 1 && args.Length() <= 4){
-		String::Utf8Value filenameVal(args[0]->ToString());
-		string filename(*filenameVal);
-		if (!doesFileExist(filename)){
-			ThrowException(v8::Exception::TypeError(String::New("The given file doesn't exist.")));
-			return scope.Close(Undefined());
-		}
-		//If I put a try block here, what kind of exceptions should I catch. I simply don't get it.
-		bool isLegacy = false;
-		string passphrase = "";
-		if (args.Length() >= 2){
-			bool isLegacyVal = args[1]->BooleanValue();
-			isLegacy = isLegacyVal;
-		}
-		if (args.Length() >= 3){
-			String::Utf8Value passphraseVal(args[2]->ToString());
-			passphrase = string(*passphraseVal);
-		}
-		/*if (args.Length() == 1){ //If no passphrase is given
-			instance->keyPair = loadKeyPair(filename);
-		} else { //If a passphrase is given
-			String::Utf8Value passphraseVal(args[1]->ToString());
-			string passphrase(*passphraseVal);
-			instance->keyPair = loadKeyPair(filename, passphrase);
-		}*/
-		instance->keyPair = loadKeyPair(filename, isLegacy, passphrase);
-		Local<Object> pubKey = instance->PPublicKeyInfo();
-		if (args.Length() < 4){
-			return scope.Close(pubKey);
-		} else {
-			if (args[2]->IsUndefined()) return scope.Close(pubKey);
-			Local<Function> callback = Local<Function>::Cast(args[2]);
-			const unsigned argc = 1;
-			Local<Value> argv[argc] = { Local<Value>::New (pubKey) };
-			callback->Call(Context::GetCurrent()->Global(), argc, argv);
-			return scope.Close(Undefined());
-		}
-	} else {
+	if (!(args.Length() >= 1 && args.Length() <= 4)){
 		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
 		return scope.Close(Undefined());
 	}
+	String::Utf8Value filenameVal(args[0]->ToString());
+	string filename(*filenameVal);
+	if (!doesFileExist(filename)){
+		ThrowException(v8::Exception::TypeError(String::New("The given file doesn't exist.")));
+		return scope.Close(Undefined());
+	}
+	const int callbackIndex = args.Length() >= 2 && args[args.Length() - 1]->IsFunction() ? args.Length() - 1 : -1;
+	bool isLegacy = false;
+	string passphrase = "";
+	if (args.Length() >= 2 && callbackIndex != 1) isLegacy = args[1]->BooleanValue();
+	if (args.Length() >= 3 && callbackIndex != 2 && !args[2]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[2]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	if (callbackIndex != -1){
+		queueLoad(args.This(), filename, isLegacy, passphrase, Local<Function>::Cast(args[callbackIndex]));
+		return scope.Close(Undefined());
+	}
+	Local<Object> pubKey;
+	try {
+		pubKey = instance->loadedKeyPair(loadKeyPair(filename, isLegacy, passphrase));
+	} catch (runtime_error* e){
+		//Wrong passphrase or altered file
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	return scope.Close(pubKey);
 }
 
 /*
 * Signature
-* String filename, String passphrase [optional], Function callback [optional]
+* String filename, String passphrase [optional], Object options [optional], Function callback [optional]
+* options : KDF cost of encrypted files, {iterations: Number, kdf: "sha1" | "sha256" | "sha512"}. PBKDF2-HMAC-SHA256 with 8192 iterations by default
+* The file is written next to filename, synced, then renamed over it. With a callback (the last parameter), the key pair is saved on the
+* thread pool, and the callback receives an error if the file couldn't be written; without one, the error is thrown
 */
 Handle<Value> KeyRing::Save(const Arguments& args){
 	HandleScope scope;
@@ -727,68 +1471,306 @@ Handle<Value> KeyRing::Save(const Arguments& args){
 		ThrowException(Exception::TypeError(String::New("No key has been loaded in the keyring. Either load a key on instanciation or by calling the Load() method")));
 		return scope.Close(Undefined());
 	}
-	if (args.Length() >= 1 && args.Length() <= 3){
-		String::Utf8Value filenameVal(args[0]->ToString());
-		std::string filename(*filenameVal);
-		if (args.Length() == 1){
-			saveKeyPair(filename, instance->keyPair);
-		} else {
-			String::Utf8Value passphraseVal(args[1]->ToString());
-			std::string passphrase(*passphraseVal);
-			saveKeyPair(filename, instance->keyPair, passphrase);
-		}
-		//a callback is given, then call it |||| Screw the callback hell
-		if (args.Length() == 3 && !args[2]->IsUndefined()){
-			Local<Function> callback = Local<Function>::Cast(args[2]);
-			const unsigned argc = 0;
-			Local<Value> argv[argc];
-			callback->Call(Context::GetCurrent()->Global(), argc, argv);
-		}
-		return scope.Close(Undefined());
-	} else {
+	if (!(args.Length() >= 1 && args.Length() <= 4)){
 		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
 		return scope.Close(Undefined());
 	}
+	String::Utf8Value filenameVal(args[0]->ToString());
+	std::string filename(*filenameVal), passphrase = "";
+	const int callbackIndex = args.Length() >= 2 && args[args.Length() - 1]->IsFunction() ? args.Length() - 1 : -1;
+	if (args.Length() >= 2 && callbackIndex != 1 && !args[1]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[1]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	unsigned int pbkdfIterations = KEYFILE_DEFAULT_PBKDF_ITERATIONS;
+	KDFHash hash = KEYFILE_DEFAULT_KDF;
+	if (args.Length() >= 3 && callbackIndex != 2 && !getSaveOptions(args[2], pbkdfIterations, hash)) return scope.Close(Undefined());
+	if (callbackIndex != -1){
+		queueSave(filename, new map<string, string>(*instance->keyPair), passphrase, pbkdfIterations, hash, Local<Function>::Cast(args[callbackIndex]));
+		return scope.Close(Undefined());
+	}
+	try {
+		saveKeyPair(filename, instance->keyPair, passphrase, pbkdfIterations, hash);
+	} catch (runtime_error* e){
+		ThrowException(Exception::Error(String::New(e->what())));
+		delete e;
+	}
+	return scope.Close(Undefined());
+}
+
+bool KeyRing::getSaveOptions(Local<Value> options, unsigned int& pbkdfIterations, KDFHash& hash){
+	if (options->IsUndefined()) return true;
+	if (!options->IsObject()){
+		ThrowException(Exception::TypeError(String::New("options must be an object")));
+		return false;
+	}
+	Local<Object> optionsObj = options->ToObject();
+	Local<Value> iterationsVal = optionsObj->Get(String::New("iterations"));
+	if (!iterationsVal->IsUndefined()){
+		if (!iterationsVal->IsNumber() || iterationsVal->NumberValue() < 1 || iterationsVal->NumberValue() > 4294967295.0 || iterationsVal->NumberValue() != iterationsVal->IntegerValue()){
+			ThrowException(Exception::TypeError(String::New("iterations must be a positive integer")));
+			return false;
+		}
+		pbkdfIterations = (unsigned int) iterationsVal->IntegerValue();
+	}
+	Local<Value> kdfVal = optionsObj->Get(String::New("kdf"));
+	if (!kdfVal->IsUndefined()){
+		String::Utf8Value kdfName(kdfVal->ToString());
+		if (!KDF_GetHash(string(*kdfName), hash)){
+			ThrowException(Exception::TypeError(String::New("Invalid kdf. Possible values are \"sha1\", \"sha256\" and \"sha512\"")));
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+* Watched key files (watch option) : the directory of the file is watched (inotify on Linux, through libuv), so that a file that is replaced
+* (renamed over, as save() does) is seen like a file that is modified in place. On a change, the file is loaded again on the thread pool, as
+* load() does with a callback, and the new key replaces the current one on the main thread, between two calls : JS calls are made on the main
+* thread, and batches that run on the thread pool have their own copy of the key, so nothing needs to be locked. A file that can't be loaded
+* (being written, wrong passphrase...) leaves the current key in place. Changes that happen during a load trigger a single reload once it's done
+*/
+struct KeyFileWatch {
+	uv_fs_event_t handle;
+	KeyRing* keyRing;
+	//File name, without its directory, as given to the event callback
+	string basename, passphrase;
+	bool loading, pending;
+	Persistent<Function> onReload;
+};
+
+bool KeyRing::startWatching(string const& passphrase, Local<Value> onReload){
+	const size_t slash = filename_.rfind('/');
+	const string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename_.substr(0, slash));
+	KeyFileWatch* watch = new KeyFileWatch();
+	watch->handle.data = watch;
+	watch->keyRing = this;
+	watch->basename = slash == string::npos ? filename_ : filename_.substr(slash + 1);
+	watch->passphrase = passphrase;
+	watch->loading = false;
+	watch->pending = false;
+	if (onReload->IsFunction()) watch->onReload = Persistent<Function>::New(Local<Function>::Cast(onReload));
+	if (uv_fs_event_init(uv_default_loop(), &watch->handle, directory.c_str(), WatchEvent, 0) != 0){
+		watch->onReload.Dispose();
+		delete watch;
+		return false;
+	}
+	//Watching doesn't keep the process running
+	uv_unref((uv_handle_t*) &watch->handle);
+	watch_ = watch;
+	return true;
+}
+
+static void watchClosed(uv_handle_t* handle){
+	KeyFileWatch* watch = static_cast<KeyFileWatch*>(handle->data);
+	if (!watch->passphrase.empty()) memset(&watch->passphrase[0], 0, watch->passphrase.size());
+	watch->onReload.Dispose();
+	delete watch;
+}
+
+void KeyRing::stopWatching(){
+	if (watch_ == 0) return;
+	watch_->keyRing = 0;
+	uv_close((uv_handle_t*) &watch_->handle, watchClosed);
+	watch_ = 0;
+}
+
+void KeyRing::WatchEvent(uv_fs_event_t* handle, const char* filename, int events, int status){
+	KeyFileWatch* watch = static_cast<KeyFileWatch*>(handle->data);
+	if (status != 0 || watch->keyRing == 0) return;
+	//Events on other files of the directory (including the temporary files of save())
+	if (filename == 0 || watch->basename != filename) return;
+	watch->keyRing->reloadKeyPair();
+}
+
+void KeyRing::reloadKeyPair(){
+	if (watch_->loading){
+		watch_->pending = true;
+		return;
+	}
+	//Removed, or not renamed into place yet
+	if (!doesFileExist(filename_)) return;
+	watch_->loading = true;
+	watch_->pending = false;
+	HandleScope scope;
+	queueLoad(handle_, filename_, false, watch_->passphrase, Local<Function>::New(watch_->onReload), true);
+}
+
+//No params. Stops watching the key file
+Handle<Value> KeyRing::Unwatch(const Arguments& args){
+	HandleScope scope;
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	instance->stopWatching();
+	return scope.Close(Undefined());
 }
 
 //No params
 Handle<Value> KeyRing::Clear(const Arguments& args){
 	HandleScope scope;
 	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
-	if (instance->keyPair != 0){
-		delete instance->keyPair;
-		instance->keyPair = 0;
+	instance->stopWatching();
+	deleteKeyPair(instance->keyPair);
+	instance->keyPair = 0;
+	NoncePool::Release(instance->noncePool_);
+	instance->noncePool_ = 0;
+	return scope.Close(Undefined());
+}
+
+/*
+* Signature
+* Object options [optional] : {size, refillThreshold}
+* Precomputes ECDSA nonces in the background, so that ECDSA/ECIES signatures only cost a few modular multiplications on the JS thread
+*/
+Handle<Value> KeyRing::EnableNoncePool(const Arguments& args){
+	HandleScope scope;
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	if (args.Length() > 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	unsigned int size = instance->noncePoolSize_, refillThreshold = instance->noncePoolThreshold_;
+	if (args.Length() == 1 && !args[0]->IsUndefined()){
+		if (!args[0]->IsObject()){
+			ThrowException(Exception::TypeError(String::New("options must be an object")));
+			return scope.Close(Undefined());
+		}
+		Local<Object> optionsObj = Local<Object>::Cast(args[0]);
+		if (optionsObj->Has(String::NewSymbol("size"))) size = optionsObj->Get(String::NewSymbol("size"))->Uint32Value();
+		if (optionsObj->Has(String::NewSymbol("refillThreshold"))) refillThreshold = optionsObj->Get(String::NewSymbol("refillThreshold"))->Uint32Value();
+	}
+	if (size == 0 || size > 65536){
+		ThrowException(Exception::RangeError(String::New("The nonce pool size must be between 1 and 65536")));
+		return scope.Close(Undefined());
+	}
+	if (refillThreshold >= size){
+		ThrowException(Exception::RangeError(String::New("refillThreshold must be lower than the pool size")));
+		return scope.Close(Undefined());
 	}
+	instance->noncePoolSize_ = size;
+	instance->noncePoolThreshold_ = refillThreshold;
+	instance->useNoncePool_ = true;
+	//Dropping the current pool, in case its settings changed. It'll be rebuilt and filled right away if an EC key is loaded
+	NoncePool::Release(instance->noncePool_);
+	instance->noncePool_ = 0;
+	instance->getNoncePool();
 	return scope.Close(Undefined());
 }
 
+//No params
+Handle<Value> KeyRing::DisableNoncePool(const Arguments& args){
+	HandleScope scope;
+	KeyRing* instance = ObjectWrap::Unwrap<KeyRing>(args.This());
+	instance->useNoncePool_ = false;
+	NoncePool::Release(instance->noncePool_);
+	instance->noncePool_ = 0;
+	return scope.Close(Undefined());
+}
+
+//Returns the nonce pool for the loaded EC key, (re)building it if the curve changed. Returns 0 if the pool is disabled or can't be used
+NoncePool* KeyRing::getNoncePool(){
+	if (!useNoncePool_ || keyPair == 0) return 0;
+	string keyType = keyPair->at("keyType");
+	if (!(keyType == "ecdsa" || keyType == "ecies")) return 0;
+	string curveName = keyPair->at("curveName");
+	//Nonce pools are for prime curves only
+	if (isBinaryCurve(curveName)) return 0;
+	if (noncePool_ != 0 && noncePool_->CurveName() == curveName) return noncePool_;
+	NoncePool::Release(noncePool_);
+	noncePool_ = new NoncePool(curveName, getPCurveFromName(curveName), noncePoolSize_, noncePoolThreshold_);
+	return noncePool_;
+}
+
 map<string, string>* KeyRing::loadKeyPair(string const& filename, bool legacy, string passphrase){
 	string fileContent;
 	if (passphrase != ""){ //If passphrase is defined, then decrypt file
 		fileContent = decryptFile(filename, passphrase);
-	} else {
+	} else if (legacy){
 		std::fstream file(filename.c_str(), ios::in);
 		std::getline(file, fileContent);
-		if (legacy) fileContent = strHexDecode(fileContent);
+		fileContent = strHexDecode(fileContent);
+	} else {
+		//Read at once : version 3 files are binary, and may contain line breaks
+		fileContent = readFile(filename);
 	}
 	map<string, string>* keyPair;
 	if (legacy) keyPair = decodeBufferLegacy(fileContent);
 	else keyPair = decodeBuffer(fileContent);
+	if (!fileContent.empty()) memset(&fileContent[0], 0, fileContent.size());
 	return keyPair;
 }
 
-bool KeyRing::saveKeyPair(string const& filename, map<string, string>* keyPair, string passphrase){
+bool KeyRing::saveKeyPair(string const& filename, map<string, string>* keyPair, string passphrase, unsigned int pbkdfIterations, KDFHash hash){
 	std::string buffer = encodeBuffer(keyPair);
-	if (passphrase != ""){
-		encryptFile(filename, buffer, passphrase);
-	} else {
-		std::fstream file(filename.c_str(), std::ios::out | std::ios::trunc);
-		file << buffer;
-		file.close();
+	try {
+		if (passphrase != ""){
+			encryptFile(filename, buffer, passphrase, pbkdfIterations, hash);
+		} else {
+			writeFileAtomically(filename, buffer);
+		}
+	} catch (runtime_error* e){
+		memset(&buffer[0], 0, buffer.size());
+		throw;
 	}
+	memset(&buffer[0], 0, buffer.size());
 	return true;
 }
 
+string KeyRing::readFile(string const& filename){
+	std::ifstream file(filename.c_str(), ios::in | ios::binary);
+	if (!file.is_open()) throw new runtime_error("Can't read the key file");
+	string content;
+	file.seekg(0, ios::end);
+	const streamoff fileLength = file.tellg();
+	if (fileLength > 0){
+		content.resize((size_t) fileLength);
+		file.seekg(0, ios::beg);
+		file.read(&content[0], fileLength);
+		if (file.gcount() != fileLength) throw new runtime_error("Can't read the key file");
+	}
+	return content;
+}
+
+void KeyRing::writeFileAtomically(string const& filename, string const& content){
+	//Only readable by its owner
+	string temporary = filename + ".XXXXXX";
+	const int fd = mkstemp(&temporary[0]);
+	if (fd < 0) throw new runtime_error("The key file can't be written");
+	bool written = true;
+	const char* data = content.data();
+	size_t remaining = content.size();
+	while (written && remaining > 0){
+		const ssize_t count = write(fd, data, remaining);
+		written = count > 0;
+		if (written){
+			data += count;
+			remaining -= (size_t) count;
+		}
+	}
+	written = fsync(fd) == 0 && written;
+	written = close(fd) == 0 && written;
+	if (!written || rename(temporary.c_str(), filename.c_str()) != 0){
+		unlink(temporary.c_str());
+		throw new runtime_error("The key file can't be written");
+	}
+	//Syncing the directory too, for the rename to outlive a crash
+	const size_t slash = filename.rfind('/');
+	const string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+	const int directoryFd = open(directory.c_str(), O_RDONLY);
+	if (directoryFd >= 0){
+		fsync(directoryFd);
+		close(directoryFd);
+	}
+}
+
+void KeyRing::deleteKeyPair(map<string, string>* keyPair){
+	if (keyPair == 0) return;
+	for (map<string, string>::iterator it = keyPair->begin(); it != keyPair->end(); it++){
+		if (!it->second.empty()) memset(&it->second[0], 0, it->second.size());
+	}
+	delete keyPair;
+}
+
 bool KeyRing::doesFileExist(std::string const& filename){
 	std::fstream file(filename.c_str(), std::ios::in);
 	bool isGood = file.good();
@@ -796,7 +1778,224 @@ bool KeyRing::doesFileExist(std::string const& filename){
 	return isGood;
 }
 
+/*
+* Key buffer, version 3 (written by encodeBuffer) :
+* magic "NCK" || version, 3 (1 byte) || key type (1 byte, same codes as the previous format) || curveID (1 byte, 0 for keys without a curve) ||
+* number of fields (1 byte) || for each field, its length (2 bytes, big endian) and its value, raw big endian bytes || CRC-32 of the preceding bytes (4 bytes)
+* Values are the key map's hex entries, decoded. The fields of each key type are listed by keyBufferFields; multi-prime RSA keys have their primes
+* as extra fields. Decoding checks the CRC, then walks the fields with bounds checks, hex encoding each one straight into the key map's entry
+*/
+static const byte KEYBUFFER_V3_MAGIC[4] = {'N', 'C', 'K', 0x03};
+static const size_t KEYBUFFER_V3_HEADER_LENGTH = 7;
+static const size_t KEYBUFFER_V3_CRC_LENGTH = 4;
+
+static const char* const KEYBUFFER_EC_FIELDS[] = {"publicKeyX", "publicKeyY", "privateKey"};
+static const char* const KEYBUFFER_RSA_FIELDS[] = {"modulus", "publicExponent", "privateExponent"};
+static const char* const KEYBUFFER_DSA_FIELDS[] = {"primeField", "divider", "base", "publicElement", "privateExponent"};
+static const char* const KEYBUFFER_PUBLICKEY_FIELDS[] = {"publicKey", "privateKey"};
+
+//Fields of the key type (primes aside), and whether the key type has a curveID. Returns 0 for unknown key types
+static const char* const* keyBufferFields(byte keyType, size_t& count, bool& hasCurve){
+	switch (keyType){
+		case 0x00: case 0x04: //ECDSA / ECIES
+			count = 3; hasCurve = true; return KEYBUFFER_EC_FIELDS;
+		case 0x08: case 0x09: //ECDSA / ECIES, with a compressed public key
+		case 0x03: //ECDH
+			count = 2; hasCurve = true; return KEYBUFFER_PUBLICKEY_FIELDS;
+		case 0x01: case 0x07: //RSA / multi-prime RSA
+			count = 3; hasCurve = false; return KEYBUFFER_RSA_FIELDS;
+		case 0x02: //DSA
+			count = 5; hasCurve = false; return KEYBUFFER_DSA_FIELDS;
+		case 0x05: case 0x06: //X25519 / Ed25519
+			count = 2; hasCurve = false; return KEYBUFFER_PUBLICKEY_FIELDS;
+		default:
+			return 0;
+	}
+}
+
+static int hexNibble(char c){
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+//Writes the (hex.size() + 1) / 2 bytes of hex to out, an odd number of digits having a leading zero. Throws a runtime_error* on a non-hex digit
+static void keyBufferHexDecode(string const& hex, byte* out){
+	size_t i = 0;
+	if (hex.size() % 2 == 1){
+		const int low = hexNibble(hex[0]);
+		if (low < 0) throw new runtime_error("Invalid hex value in key pair");
+		*out++ = (byte) low;
+		i = 1;
+	}
+	for (; i < hex.size(); i += 2){
+		const int high = hexNibble(hex[i]), low = hexNibble(hex[i + 1]);
+		if (high < 0 || low < 0) throw new runtime_error("Invalid hex value in key pair");
+		*out++ = (byte) ((high << 4) | low);
+	}
+}
+
+//Upper case, as HexEncoder's
+static void keyBufferHexEncode(const byte* in, size_t length, char* out){
+	static const char digits[] = "0123456789ABCDEF";
+	for (size_t i = 0; i < length; i++){
+		*out++ = digits[in[i] >> 4];
+		*out++ = digits[in[i] & 0x0F];
+	}
+}
+
+string KeyRing::encodeBuffer(map<string, string>* keyPair){
+	if (!(keyPair->count("keyType") > 0)) throw new runtime_error("keyType not found");
+	const string keyType = keyPair->at("keyType");
+	byte keyTypeCode;
+	if (keyType == "ecdsa" || keyType == "ecies"){
+		const bool compressed = keyPair->count("publicKey") > 0;
+		if (keyType == "ecdsa") keyTypeCode = compressed ? 0x08 : 0x00;
+		else keyTypeCode = compressed ? 0x09 : 0x04;
+	} else if (keyType == "rsa") keyTypeCode = keyPair->count("primes") > 0 ? 0x07 : 0x01;
+	else if (keyType == "dsa") keyTypeCode = 0x02;
+	else if (keyType == "ecdh") keyTypeCode = 0x03;
+	else if (keyType == "x25519") keyTypeCode = 0x05;
+	else if (keyType == "ed25519") keyTypeCode = 0x06;
+	else throw new runtime_error("Unknown key type");
+	size_t fieldCount;
+	bool hasCurve;
+	const char* const* fieldNames = keyBufferFields(keyTypeCode, fieldCount, hasCurve);
+	//Checking key pair integrality. The values are the map's strings, and the primes
+	vector<string const*> values;
+	for (size_t i = 0; i < fieldCount; i++){
+		if (!keyPair->count(fieldNames[i])) throw new runtime_error(string("Missing parameter : ") + fieldNames[i]);
+		values.push_back(&keyPair->at(fieldNames[i]));
+	}
+	//ECDSA / ECIES keys with a compressed public key still have their coordinates in the key map
+	if (keyTypeCode == 0x08 || keyTypeCode == 0x09){
+		if (!keyPair->count("publicKeyX") || !keyPair->count("publicKeyY")) throw new runtime_error("Missing parameter : publicKeyX");
+	}
+	byte curveID = 0;
+	if (hasCurve){
+		if (!keyPair->count("curveName")) throw new runtime_error("Missing parameter : curveName");
+		curveID = (byte) getCurveID(keyPair->at("curveName"));
+	}
+	vector<string> primes;
+	if (keyTypeCode == 0x07){
+		stringstream primesStream(keyPair->at("primes"));
+		string prime;
+		while (getline(primesStream, prime, ',')) primes.push_back(prime);
+		for (size_t i = 0; i < primes.size(); i++) values.push_back(&primes[i]);
+	}
+	if (values.size() > 0xFF) throw new runtime_error("Too many primes in the key pair");
+	//Single allocation : the length is known beforehand
+	size_t length = KEYBUFFER_V3_HEADER_LENGTH + KEYBUFFER_V3_CRC_LENGTH;
+	for (size_t i = 0; i < values.size(); i++){
+		const size_t valueLength = (values[i]->size() + 1) / 2;
+		if (valueLength > 0xFFFF) throw new runtime_error("Key pair value too long");
+		length += 2 + valueLength;
+	}
+	string buffer(length, '\0');
+	byte* out = (byte*) &buffer[0];
+	memcpy(out, KEYBUFFER_V3_MAGIC, sizeof(KEYBUFFER_V3_MAGIC));
+	out[4] = keyTypeCode;
+	out[5] = curveID;
+	out[6] = (byte) values.size();
+	out += KEYBUFFER_V3_HEADER_LENGTH;
+	for (size_t i = 0; i < values.size(); i++){
+		const size_t valueLength = (values[i]->size() + 1) / 2;
+		out[0] = (byte) (valueLength >> 8);
+		out[1] = (byte) valueLength;
+		keyBufferHexDecode(*values[i], out + 2);
+		out += 2 + valueLength;
+	}
+	CRC32 crc;
+	crc.Update((const byte*) buffer.data(), length - KEYBUFFER_V3_CRC_LENGTH);
+	crc.Final(out);
+	return buffer;
+}
+
+void KeyRing::decompressKeyPair(map<string, string>* keyPair){
+	const string curveName = keyPair->at("curveName"), publicKey = keyPair->at("publicKey");
+	string publicX, publicY;
+	if (isBinaryCurve(curveName)){
+		EC2NPoint publicPoint;
+		if (!ECPoint_DecodeB(getBCurveFromName(curveName), strHexDecode(publicKey), publicPoint)) throw new runtime_error("Invalid compressed public key");
+		publicX = PolynomialMod2ToHexStr(publicPoint.x);
+		publicY = PolynomialMod2ToHexStr(publicPoint.y);
+	} else {
+		ECPPoint publicPoint;
+		if (!ECPoint_DecodeP(getPCurveFromName(curveName), strHexDecode(publicKey), publicPoint)) throw new runtime_error("Invalid compressed public key");
+		publicX = IntegerToHexStr(publicPoint.x);
+		publicY = IntegerToHexStr(publicPoint.y);
+	}
+	(*keyPair)["publicKeyX"] = publicX;
+	(*keyPair)["publicKeyY"] = publicY;
+}
+
+map<string, string>* KeyRing::decodeBufferV3(string const& fileBuffer){
+	const byte* in = (const byte*) fileBuffer.data();
+	if (fileBuffer.size() < KEYBUFFER_V3_HEADER_LENGTH + KEYBUFFER_V3_CRC_LENGTH || memcmp(in, KEYBUFFER_V3_MAGIC, sizeof(KEYBUFFER_V3_MAGIC)) != 0) throw new runtime_error("Invalid key file");
+	const byte* end = in + fileBuffer.size() - KEYBUFFER_V3_CRC_LENGTH;
+	byte checksum[KEYBUFFER_V3_CRC_LENGTH];
+	CRC32 crc;
+	crc.Update(in, end - in);
+	crc.Final(checksum);
+	if (memcmp(checksum, end, sizeof(checksum)) != 0) throw new runtime_error("The key file is damaged (invalid checksum)");
+	const byte keyTypeCode = in[4], curveID = in[5];
+	const size_t valueCount = in[6];
+	size_t fieldCount;
+	bool hasCurve;
+	const char* const* fieldNames = keyBufferFields(keyTypeCode, fieldCount, hasCurve);
+	if (fieldNames == 0) throw new runtime_error("Unknown key type");
+	//Multi-prime RSA keys have at least 3 primes
+	if (keyTypeCode == 0x07 ? valueCount < fieldCount + 3 : valueCount != fieldCount) throw new runtime_error("Invalid key file");
+	//Bounds are checked before anything is allocated
+	const byte* p = in + KEYBUFFER_V3_HEADER_LENGTH;
+	for (size_t i = 0; i < valueCount; i++){
+		if (end - p < 2) throw new runtime_error("Invalid key file");
+		const size_t valueLength = ((size_t) p[0] << 8) | p[1];
+		if ((size_t) (end - p - 2) < valueLength) throw new runtime_error("Invalid key file");
+		p += 2 + valueLength;
+	}
+	if (p != end) throw new runtime_error("Invalid key file");
+	const string curveName = hasCurve ? getCurveName((char) curveID) : "";
+	map<string, string>* keyPair = new map<string, string>();
+	switch (keyTypeCode){
+		case 0x00: case 0x08: keyPair->insert(make_pair("keyType", "ecdsa")); break;
+		case 0x04: case 0x09: keyPair->insert(make_pair("keyType", "ecies")); break;
+		case 0x01: case 0x07: keyPair->insert(make_pair("keyType", "rsa")); break;
+		case 0x02: keyPair->insert(make_pair("keyType", "dsa")); break;
+		case 0x03: keyPair->insert(make_pair("keyType", "ecdh")); break;
+		case 0x05: keyPair->insert(make_pair("keyType", "x25519")); break;
+		case 0x06: keyPair->insert(make_pair("keyType", "ed25519")); break;
+	}
+	if (hasCurve) keyPair->insert(make_pair("curveName", curveName));
+	p = in + KEYBUFFER_V3_HEADER_LENGTH;
+	for (size_t i = 0; i < valueCount; i++){
+		const size_t valueLength = ((size_t) p[0] << 8) | p[1];
+		p += 2;
+		//The hex is written in place. The primes are joined with commas
+		string& value = (*keyPair)[i < fieldCount ? fieldNames[i] : "primes"];
+		if (i > fieldCount) value.push_back(',');
+		const size_t offset = value.size();
+		if (valueLength > 0){
+			value.resize(offset + 2 * valueLength);
+			keyBufferHexEncode(p, valueLength, &value[offset]);
+		}
+		p += valueLength;
+	}
+	//The coordinates are still needed by the signature and decryption methods
+	if (keyTypeCode == 0x08 || keyTypeCode == 0x09){
+		try {
+			decompressKeyPair(keyPair);
+		} catch (runtime_error* e){
+			deleteKeyPair(keyPair);
+			throw e;
+		}
+	}
+	return keyPair;
+}
+
 map<string, string>* KeyRing::decodeBuffer(string const& fileBuffer){
+	if (fileBuffer.size() >= sizeof(KEYBUFFER_V3_MAGIC) && memcmp(fileBuffer.data(), KEYBUFFER_V3_MAGIC, sizeof(KEYBUFFER_V3_MAGIC)) == 0) return decodeBufferV3(fileBuffer);
 	map<string, string>* keyPair;
 	stringstream file(fileBuffer);
 	stringbuf* buffer = file.rdbuf();
@@ -828,7 +2027,35 @@ map<string, string>* KeyRing::decodeBuffer(string const& fileBuffer){
 		keyPair->insert(make_pair("publicKeyX", publicX));
 		keyPair->insert(make_pair("publicKeyY", publicY));
 		keyPair->insert(make_pair("privateKey", privateKey));
-	} else if (keyType == 0x01){ //RSA keys
+	} else if (keyType == 0x08 || keyType == 0x09){ //ECDSA / ECIES keys, with a compressed public key
+		char curveID = buffer->sbumpc();
+		string curveName = getCurveName(curveID);
+		unsigned short publicKeyLength, privateKeyLength;
+		string publicKey = "", privateKey = "";
+		publicKeyLength = ((unsigned short) buffer->sbumpc()) << 8;
+		publicKeyLength += (unsigned short) buffer->sbumpc();
+		for (int i = 0; i < publicKeyLength; i++){
+			publicKey += (char) buffer->sbumpc();
+		}
+		privateKeyLength = ((unsigned short) buffer->sbumpc()) << 8;
+		privateKeyLength += (unsigned short) buffer->sbumpc();
+		for (int i = 0; i < privateKeyLength; i++){
+			privateKey += (char) buffer->sbumpc();
+		}
+		keyPair = new map<string, string>();
+		if (keyType == 0x08) keyPair->insert(make_pair("keyType", "ecdsa"));
+		else keyPair->insert(make_pair("keyType", "ecies"));
+		keyPair->insert(make_pair("curveName", curveName));
+		keyPair->insert(make_pair("publicKey", publicKey));
+		keyPair->insert(make_pair("privateKey", privateKey));
+		//The coordinates are still needed by the signature and decryption methods
+		try {
+			decompressKeyPair(keyPair);
+		} catch (runtime_error* e){
+			deleteKeyPair(keyPair);
+			throw e;
+		}
+	} else if (keyType == 0x01 || keyType == 0x07){ //RSA / multi-prime RSA keys
 		unsigned short modulusLength, publicExpLength, privateExpLength;
 		string modulus = "", publicExponent = "", privateExponent = "";
 		modulusLength = ((unsigned short) buffer->sbumpc()) << 8;
@@ -851,6 +2078,20 @@ map<string, string>* KeyRing::decodeBuffer(string const& fileBuffer){
 		keyPair->insert(make_pair("modulus", modulus));
 		keyPair->insert(make_pair("publicExponent", publicExponent));
 		keyPair->insert(make_pair("privateExponent", privateExponent));
+		//Multi-prime RSA keys : followed by the number of primes and the primes
+		if (keyType == 0x07){
+			unsigned char primeCount = (unsigned char) buffer->sbumpc();
+			string primes = "";
+			for (int i = 0; i < primeCount; i++){
+				unsigned short primeLength = ((unsigned short) buffer->sbumpc()) << 8;
+				primeLength += (unsigned short) buffer->sbumpc();
+				if (i > 0) primes += ",";
+				for (int j = 0; j < primeLength; j++){
+					primes += (char) buffer->sbumpc();
+				}
+			}
+			keyPair->insert(make_pair("primes", primes));
+		}
 	} else if (keyType == 0x02){ //DSA keys
 		unsigned short primeFieldLength, dividerLength, baseLength, publicElementLength, privateExponentLength;
 		string primeField = "", divider = "", base = "", publicElement = "", privateExponent = "";
@@ -906,6 +2147,24 @@ map<string, string>* KeyRing::decodeBuffer(string const& fileBuffer){
 		keyPair->insert(make_pair("curveName", curveName));
 		keyPair->insert(make_pair("publicKey", publicKey));
 		keyPair->insert(make_pair("privateKey", privateKey));
+	} else if (keyType == 0x05 || keyType == 0x06){ //X25519 / Ed25519 keys
+		unsigned short publicKeyLength, privateKeyLength;
+		string publicKey = "", privateKey = "";
+		publicKeyLength = ((unsigned short) buffer->sbumpc()) << 8;
+		publicKeyLength += (unsigned short) buffer->sbumpc();
+		for (int i = 0; i < publicKeyLength; i++){
+			publicKey += (char) buffer->sbumpc();
+		}
+		privateKeyLength = ((unsigned short) buffer->sbumpc()) << 8;
+		privateKeyLength += (unsigned short) buffer->sbumpc();
+		for (int i = 0; i < privateKeyLength; i++){
+			privateKey += (char) buffer->sbumpc();
+		}
+		keyPair = new map<string, string>();
+		if (keyType == 0x05) keyPair->insert(make_pair("keyType", "x25519"));
+		else keyPair->insert(make_pair("keyType", "ed25519"));
+		keyPair->insert(make_pair("publicKey", publicKey));
+		keyPair->insert(make_pair("privateKey", privateKey));
 	} else throw new runtime_error("Unknown key type");
 	return keyPair;
 }
@@ -1032,110 +2291,63 @@ map<string, string>* KeyRing::decodeBufferLegacy(string const& fileBuffer){
 	return keyPair;
 }
 
-string KeyRing::encodeBuffer(map<string, string>* keyPair){
-	stringstream buffer;
-	if (!(keyPair->count("keyType") > 0)) throw new runtime_error("keyType not found");
-	string keyType = keyPair->at("keyType");
-	if (keyType == "ecdsa" || keyType == "ecies"){
-		//Checking key pair integrality
-		string params[] = {"curveName", "publicKeyX", "publicKeyY", "privateKey"};
-		for (int i = 0; i < 4; i++){
-			if (!keyPair->count(params[i])) throw new runtime_error("Missing parameter : " + params[i]);
-		}
-		//Writing key type
-		if (keyType == "ecdsa"){
-			buffer << (char) 0x00;
-		} else {
-			buffer << (char) 0x04;
-		}
-		//Writing the curveID
-		char curveID = getCurveID(keyPair->at("curveName"));
-		buffer << curveID;
-		string publicX = keyPair->at("publicKeyX"), publicY = keyPair->at("publicKeyY"), privateKey = keyPair->at("privateKey");
-		//if (publicX.length() > ) //Checking lengths...
-		//Writing publicKey.x
-		buffer << (unsigned char) (publicX.length() >> 8);
-		buffer << (unsigned char) publicX.length();
-		buffer << publicX;
-		//Writing publicKey.y
-		buffer << (unsigned char) (publicY.length() >> 8);
-		buffer << (unsigned char) publicY.length();
-		buffer << publicY;
-		//Writing privateKey
-		buffer << (unsigned char) (privateKey.length() >> 8);
-		buffer << (unsigned char) privateKey.length();
-		buffer << privateKey;
-	} else if (keyType == "rsa"){
-		//Checking key pair integrality
-		string params[] = {"modulus", "publicExponent", "privateExponent"};
-		for (int i = 0; i < 3; i++){
-			if (!keyPair->count(params[i])) throw new runtime_error("Missing parameter : " + params[i]);
-		}
-		//Writing the key type
-		buffer << (char) 0x01;
-		string modulus = keyPair->at("modulus"), publicExponent = keyPair->at("publicExponent"), privateExponent = keyPair->at("privateExponent");
-		//Writing the modulus
-		buffer << (unsigned char) (modulus.length() >> 8);
-		buffer << (unsigned char) modulus.length();
-		buffer << modulus;
-		//Writing the public exponent
-		buffer << (unsigned char) (publicExponent.length() >> 8);
-		buffer << (unsigned char) publicExponent.length();
-		buffer << publicExponent;
-		//Writing the private exponent
-		buffer << (unsigned char) (privateExponent.length() >> 8);
-		buffer << (unsigned char) privateExponent.length();
-		buffer << privateExponent;
+string KeyRing::getKeyId(map<string, string>* keyPair){
+	const string keyType = keyPair->at("keyType");
+	vector<string> params;
+	if (keyType == "rsa"){
+		params.push_back("modulus");
+		params.push_back("publicExponent");
 	} else if (keyType == "dsa"){
-		//Checking key pair integrality
-		string params[] = {"primeField", "divider", "base", "publicElement", "privateExponent"};
-		for (int i = 0; i < 5; i++){
-			if (!(keyPair->count(params[i]) > 0)) throw new runtime_error("Missing parameter : " + params[i]);
-		}
-		//Writing the key type
-		buffer << (char) 0x02;
-		string primeField = keyPair->at("primeField"), divider = keyPair->at("divider"), base = keyPair->at("base"), publicElement = keyPair->at("publicElement"), privateExponent = keyPair->at("privateExponent");
-		//Writing the primeField
-		buffer << (unsigned char) (primeField.length() >> 8);
-		buffer << (unsigned char) primeField.length();
-		buffer << primeField;
-		//Writing the divider
-		buffer << (unsigned char) (divider.length() >> 8);
-		buffer << (unsigned char) divider.length();
-		buffer << divider;
-		//Writing the base
-		buffer << (unsigned char) (base.length() >> 8);
-		buffer << (unsigned char) base.length();
-		buffer << base;
-		//Writing the publicElement
-		buffer << (unsigned char) (publicElement.length() >> 8);
-		buffer << (unsigned char) publicElement.length();
-		buffer << publicElement;
-		//Writing the privateExponent
-		buffer << (unsigned char) (privateExponent.length() >> 8);
-		buffer << (unsigned char) privateExponent.length();
-		buffer << privateExponent;
+		params.push_back("primeField");
+		params.push_back("divider");
+		params.push_back("base");
+		params.push_back("publicElement");
+	} else if (keyType == "ecies" || keyType == "ecdsa"){
+		//Whether the public key is kept compressed or not, x and y are there
+		params.push_back("curveName");
+		params.push_back("publicKeyX");
+		params.push_back("publicKeyY");
 	} else if (keyType == "ecdh"){
-		string params[] = {"curveName", "publicKey", "privateKey"};
-		for (int i = 0; i < 3; i++){
-			if (!keyPair->count(params[i])) throw new runtime_error("Missing parameter : " + params[i]);
-		}
-		//Writing the key type
-		buffer << (char) 0x03;
-		string curveName = keyPair->at("curveName"), publicKey = keyPair->at("publicKey"), privateKey = keyPair->at("privateKey");
-		//Writing curveID
-		char curveID = getCurveID(curveName);
-		buffer << curveID;
-		//Writing the public key
-		buffer << (unsigned char) (publicKey.length() >> 8);
-		buffer << (unsigned char) publicKey.length();
-		buffer << publicKey;
-		//Writing the private key
-		buffer << (unsigned char) (privateKey.length() >> 8);
-		buffer << (unsigned char) privateKey.length();
-		buffer << privateKey;
+		params.push_back("curveName");
+		params.push_back("publicKey");
+	} else if (keyType == "x25519" || keyType == "ed25519"){
+		params.push_back("publicKey");
 	} else throw new runtime_error("Unknown key type");
-	return buffer.str();
+	SHA256 hash;
+	hash.Update((const byte*) keyType.data(), keyType.size() + 1);
+	for (size_t i = 0; i < params.size(); i++){
+		if (keyPair->count(params[i]) == 0) throw new runtime_error(params[i] + " parameter is missing from " + keyType + " key pair");
+		string value = keyPair->at(params[i]);
+		if (params[i] != "curveName"){
+			//Hashing the bytes rather than the hex string, without leading zero bytes : they depend on where the key comes from
+			value = strHexDecode(value);
+			//Compressed ECDH public keys have the same ID as uncompressed ones
+			if (keyType == "ecdh" && value.size() > 0 && value[0] != 0x04){
+				const string curveName = keyPair->at("curveName");
+				if (isBinaryCurve(curveName)) ECPoint_DecompressB(getBCurveFromName(curveName), string(value), value);
+				else ECPoint_DecompressP(getPCurveFromName(curveName), string(value), value);
+			}
+			const size_t first = value.find_first_not_of('\0');
+			value.erase(0, first == string::npos ? value.size() : first);
+		}
+		//Length prefixed, values being binary
+		const byte length[4] = {(byte) (value.size() >> 24), (byte) (value.size() >> 16), (byte) (value.size() >> 8), (byte) value.size()};
+		hash.Update(length, sizeof(length));
+		hash.Update((const byte*) value.data(), value.size());
+	}
+	byte digest[SHA256::DIGESTSIZE];
+	hash.Final(digest);
+	return string((const char*) digest, KEYSTORE_ID_LENGTH);
+}
+
+void KeyRing::getRSAPrivateKey(map<string, string>* keyPair, InvertibleMultiPrimeRSAFunction& privateParams){
+	vector<CryptoPP::Integer> primes;
+	if (keyPair->count("primes") > 0){
+		stringstream primesStream(keyPair->at("primes"));
+		string prime;
+		while (getline(primesStream, prime, ',')) primes.push_back(HexStrToInteger(prime));
+	}
+	privateParams.Initialize(HexStrToInteger(keyPair->at("modulus")), HexStrToInteger(keyPair->at("publicExponent")), HexStrToInteger(keyPair->at("privateExponent")), primes);
 }
 
 char KeyRing::getCurveID(string curveName){
@@ -1166,7 +2378,7 @@ char KeyRing::getCurveID(string curveName){
     else if (curveName == "sect193r2") return 0x88;
     else if (curveName == "sect233r1") return 0x89;
     else if (curveName == "sect233k1") return 0x8A;
-    else if (curveName == "sect239r1") return 0x8B;
+    else if (curveName == "sect239k1") return 0x8B;
     else if (curveName == "sect283r1") return 0x8C;
     else if (curveName == "sect283k1") return 0x8D;
     else if (curveName == "sect409r1") return 0x8E;
@@ -1176,7 +2388,9 @@ char KeyRing::getCurveID(string curveName){
     else throw new runtime_error("Unknown curve name");
 }
 
-string KeyRing::getCurveName(char curveID){
+string KeyRing::getCurveName(char id){
+    //Binary curves IDs are above 0x7F : compared as unsigned, char being signed on most platforms
+    const unsigned char curveID = (unsigned char) id;
     //Prime curves
     if (curveID == 0x01) return "secp112r1";
     else if (curveID == 0x02) return "secp112r2";
@@ -1204,7 +2418,7 @@ string KeyRing::getCurveName(char curveID){
     else if (curveID == 0x88) return "sect193r2";
     else if (curveID == 0x89) return "sect233r1";
     else if (curveID == 0x8A) return "sect233k1";
-    else if (curveID == 0x8B) return "sect239r1";
+    else if (curveID == 0x8B) return "sect239k1";
     else if (curveID == 0x8C) return "sect283r1";
     else if (curveID == 0x8D) return "sect283k1";
     else if (curveID == 0x8E) return "sect409r1";
@@ -1288,6 +2502,10 @@ OID KeyRing::getBCurveFromName(std::string curveName){
     } else ThrowException(v8::Exception::TypeError(String::New("Invalid binary curve name")));
 }
 
+bool KeyRing::isBinaryCurve(std::string const& curveName){
+	return curveName.find("sect") == 0;
+}
+
 std::string KeyRing::bufferHexEncode(byte buffer[], unsigned int size){
 	std::string encoded;
 	StringSource(buffer, size, true, new HexEncoder(new StringSink(encoded)));
@@ -1311,19 +2529,25 @@ std::string KeyRing::strHexDecode(std::string const& e){
 }
 
 std::string KeyRing::IntegerToHexStr(CryptoPP::Integer const& i){
-	byte bigEndian[i.MinEncodedSize()];
-	i.Encode(bigEndian, sizeof(bigEndian));
-	return bufferHexEncode(bigEndian, sizeof(bigEndian));
+	ArenaByteBlock bigEndian(i.MinEncodedSize());
+	i.Encode(bigEndian, bigEndian.size());
+	return bufferHexEncode(bigEndian, bigEndian.size());
 }
 
 CryptoPP::Integer KeyRing::HexStrToInteger(std::string const& hexStr){
-	byte buffer[hexStr.size() / 2];
-	bufferHexDecode(hexStr, buffer, sizeof(buffer));
+	ArenaByteBlock buffer(hexStr.size() / 2);
+	bufferHexDecode(hexStr, buffer, buffer.size());
 	CryptoPP::Integer i;
-	i.Decode(buffer, sizeof(buffer));
+	i.Decode(buffer, buffer.size());
 	return i;
 }
 
+std::string KeyRing::PolynomialMod2ToHexStr(CryptoPP::PolynomialMod2 const& p){
+	ArenaByteBlock bigEndian(p.MinEncodedSize());
+	p.Encode(bigEndian, bigEndian.size());
+	return bufferHexEncode(bigEndian, bigEndian.size());
+}
+
 std::string KeyRing::SecByteBlockToHexStr(SecByteBlock const& array){
     CryptoPP::Integer val;
     val.Decode(array.BytePtr(), array.SizeInBytes());
@@ -1349,74 +2573,113 @@ string KeyRing::strBase64Decode(string const& e){
 	return decoded;
 }
 
-void KeyRing::encryptFile(std::string const& filename, std::string content, std::string const& passphrase, unsigned int pbkdfIterations, int aesKeySize){
-	if (!(aesKeySize == 256 || aesKeySize == 192 || aesKeySize == 128)) throw new runtime_error("AES key size must be either 128, 192 or 256");
-	aesKeySize /= 8;
+/*
+* Encrypted key files. Integers are big endian.
+* Header (KEYFILE_HEADER_LENGTH bytes) : magic "NCKE" (4 bytes) || version, 1 (1 byte) || KDF (1 byte) || cipher, 0x01 : ChaCha20-Poly1305 (1 byte) ||
+*	zero byte || KDF iterations (4 bytes) || salt (16 bytes) || nonce (12 bytes)
+* Then the encrypted key pair buffer (see encodeBuffer), followed by the tag (16 bytes). The header is authenticated as associated data
+*/
+static const byte KEYFILE_MAGIC[4] = {'N', 'C', 'K', 'E'};
+static const byte KEYFILE_VERSION = 0x01;
+static const byte KEYFILE_CIPHER_CHACHA20POLY1305 = 0x01;
+static const size_t KEYFILE_HEADER_LENGTH = 12 + KEKCACHE_SALT_LENGTH + CHACHA20POLY1305_NONCE_LENGTH;
+
+//KDF byte of the header : 0x01, 0x02 and 0x03 for PBKDF2-HMAC-SHA1, SHA256 and SHA512
+static byte keyFileKDFId(KDFHash hash){
+	if (hash == KDF_SHA1) return 0x01;
+	if (hash == KDF_SHA256) return 0x02;
+	return 0x03;
+}
+
+static bool keyFileKDFHash(byte id, KDFHash& hash){
+	if (id == 0x01) hash = KDF_SHA1;
+	else if (id == 0x02) hash = KDF_SHA256;
+	else if (id == 0x03) hash = KDF_SHA512;
+	else return false;
+	return true;
+}
+
+void KeyRing::encryptFile(std::string const& filename, std::string const& content, std::string const& passphrase, unsigned int pbkdfIterations, KDFHash hash){
+	if (pbkdfIterations == 0) throw new runtime_error("Invalid number of iterations");
+	string file(KEYFILE_HEADER_LENGTH + content.size() + CHACHA20POLY1305_TAG_LENGTH, '\0');
+	byte* header = (byte*) &file[0];
+	memcpy(header, KEYFILE_MAGIC, sizeof(KEYFILE_MAGIC));
+	header[4] = KEYFILE_VERSION;
+	header[5] = keyFileKDFId(hash);
+	header[6] = KEYFILE_CIPHER_CHACHA20POLY1305;
+	for (int i = 0; i < 4; i++) header[8 + i] = (byte) (pbkdfIterations >> (24 - 8 * i));
+	byte* salt = header + 12;
+	byte* nonce = salt + KEKCACHE_SALT_LENGTH;
 	AutoSeededRandomPool prng;
-	//Generating pbkdf salt
-	//cout << "Generating salt" << endl;
-	byte salt[16];
-	prng.GenerateBlock(salt, sizeof(salt));
-	//Copying passphrase to byte array
-	//cout << "Copying passphrase to array" << endl;
-	byte passphraseArray[passphrase.size()];
-	for (int i = 0; i < sizeof(passphraseArray); i++){
-		passphraseArray[i] = passphrase[i];
-	}
-	//Calculating key
-	//cout << "Calculating key" << endl;
-	byte key[aesKeySize];
-	PKCS5_PBKDF2_HMAC<SHA1> derivation;
-	derivation.DeriveKey(key, sizeof(key), 0, passphraseArray, sizeof(passphraseArray), salt, sizeof(salt), pbkdfIterations);
-	//Generating an IV
-	byte iv[AES::BLOCKSIZE];
-	prng.GenerateBlock(iv, sizeof(iv));
-	//Encrypt content
-	//cout << "Initializing encryptor" << endl;
-	CFB_Mode<AES>::Encryption e;
-	e.SetKeyWithIV(key, sizeof(key), iv);
-	string encrypted;
-	//cout << "Encrypting the buffer" << endl;
-	StringSource(content, true, new StreamTransformationFilter(e, new StringSink(encrypted)));
-	//Opening file and writing content
-	//cout << "Writing file" << endl;
-	fstream file(filename.c_str(), ios::out | ios::trunc);
-	file << bufferHexEncode(salt, sizeof(salt));
-	file << std::endl;
-	file << bufferHexEncode(iv, sizeof(iv));
-	file << std::endl;
-	file << strHexEncode(encrypted);
-	file.close();
+	byte key[KEKCACHE_KEY_LENGTH];
+	//Reusing the salt of a cached key of the passphrase, if there's one : the file then opens without a derivation
+	if (!KEKCache_Find(hash, pbkdfIterations, passphrase, salt, key)){
+		prng.GenerateBlock(salt, KEKCACHE_SALT_LENGTH);
+		KEKCache_Derive(hash, pbkdfIterations, passphrase, salt, key);
+		KEKCache_Store(hash, pbkdfIterations, passphrase, salt, key);
+	}
+	prng.GenerateBlock(nonce, CHACHA20POLY1305_NONCE_LENGTH);
+	ChaCha20Poly1305_Encrypt(key, nonce, header, KEYFILE_HEADER_LENGTH, (const byte*) content.data(), content.size(), header + KEYFILE_HEADER_LENGTH);
+	CryptoPP::SecureWipeArray(key, sizeof(key));
+	writeFileAtomically(filename, file);
 }
 
-std::string KeyRing::decryptFile(std::string const& filename, std::string const& passphrase, unsigned int pbkdfIterations, int aesKeySize){
-	//Checking whether aes key size is valid or not
-	if (!(aesKeySize == 256 || aesKeySize == 192 || aesKeySize == 128)) throw new runtime_error("Invalid key size. Must be either 128, 192 or 256 bits");
-	aesKeySize /= 8;
-	//Copying passphrase to an array
-	byte passphraseArray[passphrase.size()];
-	for (int i = 0; i < sizeof(passphraseArray); i++){
-		passphraseArray[i] = passphrase[i];
+std::string KeyRing::decryptFile(std::string const& filename, std::string const& passphrase){
+	string file = readFile(filename);
+	if (file.size() < sizeof(KEYFILE_MAGIC) || memcmp(file.data(), KEYFILE_MAGIC, sizeof(KEYFILE_MAGIC)) != 0) return decryptHexFile(file, passphrase);
+	if (file.size() < KEYFILE_HEADER_LENGTH + CHACHA20POLY1305_TAG_LENGTH) throw new runtime_error("Invalid key file");
+	const byte* header = (const byte*) file.data();
+	KDFHash hash;
+	if (header[4] != KEYFILE_VERSION || header[6] != KEYFILE_CIPHER_CHACHA20POLY1305 || header[7] != 0) throw new runtime_error("Unsupported key file version");
+	if (!keyFileKDFHash(header[5], hash)) throw new runtime_error("Unsupported key file version");
+	unsigned int pbkdfIterations = 0;
+	for (int i = 0; i < 4; i++) pbkdfIterations = (pbkdfIterations << 8) | header[8 + i];
+	if (pbkdfIterations == 0) throw new runtime_error("Invalid key file");
+	const byte* salt = header + 12;
+	const byte* nonce = salt + KEKCACHE_SALT_LENGTH;
+	byte key[KEKCACHE_KEY_LENGTH];
+	const bool cached = KEKCache_Derive(hash, pbkdfIterations, passphrase, salt, key);
+	string decrypted(file.size() - KEYFILE_HEADER_LENGTH - CHACHA20POLY1305_TAG_LENGTH, '\0');
+	const bool valid = ChaCha20Poly1305_Decrypt(key, nonce, header, KEYFILE_HEADER_LENGTH, header + KEYFILE_HEADER_LENGTH, file.size() - KEYFILE_HEADER_LENGTH, decrypted.size() > 0 ? (byte*) &decrypted[0] : 0);
+	//Only keys that open the file are cached : a wrong passphrase doesn't take the place of a valid key
+	if (valid && !cached) KEKCache_Store(hash, pbkdfIterations, passphrase, salt, key);
+	CryptoPP::SecureWipeArray(key, sizeof(key));
+	if (!valid){
+		if (!decrypted.empty()) memset(&decrypted[0], 0, decrypted.size());
+		throw new runtime_error("Invalid passphrase, or the key file has been modified");
 	}
-	//Opening file, reading pbkdf and AES iv
-	fstream file(filename.c_str(), ios::in);
+	return decrypted;
+}
+
+//Files written by previous versions : 3 lines of hex (PBKDF2-HMAC-SHA1 salt, nonce or IV, encrypted content)
+std::string KeyRing::decryptHexFile(std::string const& fileContent, std::string const& passphrase){
+	const unsigned int pbkdfIterations = 8192;
+	istringstream file(fileContent);
 	string saltStr, ivStr, encryptedStr;
 	getline(file, saltStr);
 	getline(file, ivStr);
 	getline(file, encryptedStr);
-	file.close();
-	//Decodign hex of salt, iv and encrypted content
-	byte iv[ivStr.size() / 2], salt[saltStr.size() / 2];
-	bufferHexDecode(saltStr, salt, sizeof(salt));
-	bufferHexDecode(ivStr, iv, sizeof(iv));
+	//Decoding hex of salt, iv and encrypted content
+	const string salt = strHexDecode(saltStr), iv = strHexDecode(ivStr);
 	encryptedStr = strHexDecode(encryptedStr);
-	//Calculating key
-	byte key[aesKeySize];
-	PKCS5_PBKDF2_HMAC<SHA1> derivation;
-	derivation.DeriveKey(key, sizeof(key), 0, passphraseArray, sizeof(passphraseArray), salt, sizeof(salt), pbkdfIterations);
-	//Decrypting content
+	//Files with a ChaCha20-Poly1305 nonce; older ones have an AES-CFB IV (16 bytes)
+	if (iv.size() == CHACHA20POLY1305_NONCE_LENGTH){
+		if (encryptedStr.size() < CHACHA20POLY1305_TAG_LENGTH) throw new runtime_error("Invalid key file");
+		byte key[CHACHA20POLY1305_KEY_LENGTH];
+		KDF_PBKDF2(KDF_SHA1, (const byte*) passphrase.data(), passphrase.size(), (const byte*) salt.data(), salt.size(), pbkdfIterations, key, sizeof(key));
+		string decrypted(encryptedStr.size() - CHACHA20POLY1305_TAG_LENGTH, '\0');
+		const bool valid = ChaCha20Poly1305_Decrypt(key, (const byte*) iv.data(), (const byte*) salt.data(), salt.size(), (const byte*) encryptedStr.data(), encryptedStr.size(), decrypted.size() > 0 ? (byte*) &decrypted[0] : 0);
+		CryptoPP::SecureWipeArray(key, sizeof(key));
+		if (!valid) throw new runtime_error("Invalid passphrase, or the key file has been modified");
+		return decrypted;
+	}
+	if (iv.size() != AES::BLOCKSIZE) throw new runtime_error("Invalid key file");
+	//AES-256-CFB
+	byte key[32];
+	KDF_PBKDF2(KDF_SHA1, (const byte*) passphrase.data(), passphrase.size(), (const byte*) salt.data(), salt.size(), pbkdfIterations, key, sizeof(key));
 	CFB_Mode<AES>::Decryption d;
-	d.SetKeyWithIV(key, sizeof(key), iv);
+	d.SetKeyWithIV(key, sizeof(key), (const byte*) iv.data());
+	CryptoPP::SecureWipeArray(key, sizeof(key));
 	string decrypted;
 	StringSource(encryptedStr, true, new StreamTransformationFilter(d, new StringSink(decrypted)));
 	return decrypted;
@@ -9,31 +9,89 @@ using CryptoPP::SecByteBlock;
 #include <cryptopp/cryptlib.h>
 #include <cryptopp/integer.h>
 using CryptoPP::Integer;
+#include <cryptopp/gf2n.h>
 #include <cryptopp/asn.h>
 using CryptoPP::OID;
 
 #include <node.h>
 
+#include "noncepool.h"
+#include "multiprimersa.h"
+#include "kdf.h"
+
+//PBKDF2 cost of encrypted key files, unless save() is given other options
+static const unsigned int KEYFILE_DEFAULT_PBKDF_ITERATIONS = 8192;
+static const KDFHash KEYFILE_DEFAULT_KDF = KDF_SHA256;
+
+//Watch of a key file (see KeyRing::startWatching)
+struct KeyFileWatch;
+
 class KeyRing : public node::ObjectWrap{
 
 public:
 	static void Init(v8::Handle<v8::Object> exports);
 
-private:
+//MultiKeyRing (multikeyring.h) runs these methods on the key it decodes for each call
+protected:
 	explicit KeyRing(std::string filename = "", std::string passphrase = "");
 	~KeyRing();
 	//Internal attributes
 	std::map<std::string, std::string>* keyPair;
 	std::string filename_;
+	//Precomputed ECDSA nonces, when enabled through enableNoncePool()
+	NoncePool* noncePool_;
+	unsigned int noncePoolSize_, noncePoolThreshold_;
+	bool useNoncePool_;
+	NoncePool* getNoncePool();
+	//Watch of filename_, when constructed with the watch option, or 0
+	KeyFileWatch* watch_;
+	//Watches filename_'s directory, to reload the key when the file changes. onReload (or undefined) receives load()'s callback arguments. Returns false if the directory can't be watched
+	bool startWatching(std::string const& passphrase, v8::Local<v8::Value> onReload);
+	void stopWatching();
+	//Loads filename_ on the thread pool, unless a load is running (it is then loaded again once done)
+	void reloadKeyPair();
+	static void WatchEvent(uv_fs_event_t* handle, const char* filename, int events, int status);
+	//ECDH / X25519 shared secret with the given public key object, and the decoded public key. Throws a TypeError and returns false if the key isn't valid
+	bool agreedSecret(v8::Local<v8::Object> pubKeyObj, SecByteBlock& secret, std::string& peerPublicKey);
+	//RSA private key of the key map. Multi-prime keys have their primes in the "primes" entry (hex encoded, separated by commas)
+	static void getRSAPrivateKey(std::map<std::string, std::string>* keyPair, InvertibleMultiPrimeRSAFunction& privateParams);
+	//ECIES / ECDSA key map on a binary curve (both key types have the same entries)
+	static void binaryCurveKeyPair(OID const& curve, std::string const& curveName, std::string const& keyType, bool compressed, std::map<std::string, std::string>* keyPair);
 	/*
 	* Internal methods
 	*/
+	//Both throw a runtime_error* if the file can't be decoded (or decrypted), or written
 	static std::map<std::string, std::string>* loadKeyPair(std::string const& filename, bool legacy = false, std::string passphrase = "");
-	static bool saveKeyPair(std::string const& filename, std::map<std::string, std::string>* keyPair, std::string passphrase = "");
-	//Encode/Decoding the file buffer
+	static bool saveKeyPair(std::string const& filename, std::map<std::string, std::string>* keyPair, std::string passphrase = "", unsigned int pbkdfIterations = KEYFILE_DEFAULT_PBKDF_ITERATIONS, KDFHash hash = KEYFILE_DEFAULT_KDF);
+	//Reads a whole file, in binary mode. Throws a runtime_error* if it can't be read
+	static std::string readFile(std::string const& filename);
+	//Reads the options object of save() : iterations (number) and kdf ("sha1", "sha256" or "sha512"). Throws a TypeError and returns false if an option is invalid
+	static bool getSaveOptions(v8::Local<v8::Value> options, unsigned int& pbkdfIterations, KDFHash& hash);
+	//Writes a temporary file next to filename, syncs it, then renames it over filename. Throws a runtime_error* if it fails, filename being left as it was
+	static void writeFileAtomically(std::string const& filename, std::string const& content);
+	//Wipes the key map's values, then deletes it
+	static void deleteKeyPair(std::map<std::string, std::string>* keyPair);
+	/*
+	* Asynchronous load() / save() : the file is read and decoded, or encoded and written, on the thread pool. queueLoad keeps the KeyRing object
+	* until the key is handed to loadedKeyPair; queueSave takes the key map, and wipes and deletes it once saved. The callback of queueLoad can be empty
+	*/
+	static void queueLoad(v8::Handle<v8::Object> keyRing, std::string const& filename, bool legacy, std::string const& passphrase, v8::Local<v8::Function> callback, bool reload = false);
+	static void queueSave(std::string const& filename, std::map<std::string, std::string>* keyPair, std::string const& passphrase, unsigned int pbkdfIterations, KDFHash hash, v8::Local<v8::Function> callback);
+	static void LoadWork(uv_work_t* req);
+	static void LoadDone(uv_work_t* req, int status);
+	static void SaveWork(uv_work_t* req);
+	static void SaveDone(uv_work_t* req, int status);
+	//Takes a loaded key map, and returns its public key info (see load()). MultiKeyRing adds the key instead of replacing keyPair. Throws a runtime_error*
+	virtual v8::Local<v8::Object> loadedKeyPair(std::map<std::string, std::string>* loaded);
+	//Encode/Decoding the file buffer. encodeBuffer writes version 3 buffers; decodeBuffer reads them, and the previous format's
 	static std::map<std::string, std::string>* decodeBuffer(std::string const& fileBuffer);
+	static std::map<std::string, std::string>* decodeBufferV3(std::string const& fileBuffer);
 	static std::map<std::string, std::string>* decodeBufferLegacy(std::string const& fileBuffer);
 	static std::string encodeBuffer(std::map<std::string, std::string>* keyPair);
+	//Sets publicKeyX and publicKeyY from the compressed publicKey of an ECDSA / ECIES key map. Throws a runtime_error* if the point is invalid
+	static void decompressKeyPair(std::map<std::string, std::string>* keyPair);
+	//KEYSTORE_ID_LENGTH bytes fingerprint of the key type and public key. Throws a runtime_error* if an entry is missing
+	static std::string getKeyId(std::map<std::string, std::string>* keyPair);
 	//char / curveName conversions
 	static char getCurveID(std::string curveName);
 	static std::string getCurveName(char curveID);
@@ -44,18 +102,24 @@ private:
 	static std::string strHexDecode(std::string const& e);
 	static std::string IntegerToHexStr(CryptoPP::Integer const& i);
 	static CryptoPP::Integer HexStrToInteger(std::string const& hexStr);
+	//Binary curve point coordinates
+	static std::string PolynomialMod2ToHexStr(CryptoPP::PolynomialMod2 const& p);
 	static std::string SecByteBlockToHexStr(SecByteBlock const& array);
 	static SecByteBlock HexStrToSecByteBlock(std::string const& hexStr);
 	//String <-> Base64 conversions
 	static std::string strBase64Encode(std::string const& s);
 	static std::string strBase64Decode(std::string const& e);
-	//PBKDF2 / AES file encryption / decryption
-	static void encryptFile(std::string const& filename, std::string content, std::string const& passphrase, unsigned int pbkdfIterations = 8192, int aesKeySize = 256);
-	static std::string decryptFile(std::string const& filename, std::string const& passphrase, unsigned int pbkdfIterations = 8192, int aesKeySize = 256);
+	//PBKDF2 / ChaCha20-Poly1305 file encryption / decryption (binary format, see encryptFile). Keys are derived through the key cache (kekcache.h)
+	static void encryptFile(std::string const& filename, std::string const& content, std::string const& passphrase, unsigned int pbkdfIterations = KEYFILE_DEFAULT_PBKDF_ITERATIONS, KDFHash hash = KEYFILE_DEFAULT_KDF);
+	static std::string decryptFile(std::string const& filename, std::string const& passphrase);
+	//Hex files written by previous versions : ChaCha20-Poly1305, or AES-CFB (unauthenticated) before it, with PBKDF2-HMAC-SHA1
+	static std::string decryptHexFile(std::string const& fileContent, std::string const& passphrase);
 	static bool doesFileExist(std::string const& filename);
 	//curveName -> curveOID conversion
 	static OID getPCurveFromName(std::string curveName);
 	static OID getBCurveFromName(std::string curveName);
+	//Whether curveName is one of the binary (sect*) curves
+	static bool isBinaryCurve(std::string const& curveName);
 
 	//private PubKeyInfo object constructor
 	v8::Local<v8::Object> PPublicKeyInfo();
@@ -63,13 +127,19 @@ private:
 	//JS Methods
 	static v8::Handle<v8::Value> New(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Decrypt(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DecryptBatch(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Sign(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SignBatch(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Agree(const v8::Arguments& args);
+	static v8::Handle<v8::Value> OpenSession(const v8::Arguments& args);
 	static v8::Handle<v8::Value> PublicKeyInfo(const v8::Arguments& args);
 	static v8::Handle<v8::Value> CreateKeyPair(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Load(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Save(const v8::Arguments& args);
 	static v8::Handle<v8::Value> Clear(const v8::Arguments& args);
+	static v8::Handle<v8::Value> EnableNoncePool(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DisableNoncePool(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Unwatch(const v8::Arguments& args);
 	static v8::Persistent<v8::Function> constructor;
 };
 
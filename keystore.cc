@@ -0,0 +1,397 @@
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cryptopp/misc.h>
+#include <cryptopp/sha.h>
+using CryptoPP::SHA256;
+#include <cryptopp/pwdbased.h>
+using CryptoPP::PKCS5_PBKDF2_HMAC;
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+#include "keystore.h"
+#include "chacha20poly1305.h"
+
+using namespace std;
+
+//Smallest index : slots are added 16 at a time at first
+static const size_t KEYSTORE_MIN_SLOTS = 16;
+
+KeyStore::KeyStore() : used_(0){
+	slots_.assign(KEYSTORE_MIN_SLOTS, 0);
+}
+
+string KeyStore::IdAt(size_t i) const {
+	return string((const char*) data_.BytePtr() + entries_.at(i).offset, KEYSTORE_ID_LENGTH);
+}
+
+bool KeyStore::Add(string const& id, string const& record){
+	if (id.size() != KEYSTORE_ID_LENGTH) return false;
+	size_t slot = lookup((const byte*) id.data());
+	if (slots_[slot] != 0) return false;
+	const size_t length = KEYSTORE_ID_LENGTH + record.size();
+	if (used_ + length > data_.size()){
+		//Grow() copies the records to the new block, and wipes the old one
+		size_t capacity = data_.size() < 256 ? 256 : data_.size();
+		while (used_ + length > capacity) capacity *= 2;
+		data_.Grow(capacity);
+	}
+	Entry entry;
+	entry.offset = used_;
+	entry.length = record.size();
+	memcpy(data_.BytePtr() + used_, id.data(), KEYSTORE_ID_LENGTH);
+	memcpy(data_.BytePtr() + used_ + KEYSTORE_ID_LENGTH, record.data(), record.size());
+	used_ += length;
+	entries_.push_back(entry);
+	//Keeping the index at most half full
+	if (2 * entries_.size() > slots_.size()) rebuildIndex(2 * slots_.size());
+	else slots_[slot] = (uint32_t) entries_.size();
+	return true;
+}
+
+bool KeyStore::Find(string const& id, string& record) const {
+	if (id.size() != KEYSTORE_ID_LENGTH) return false;
+	const uint32_t slot = slots_[lookup((const byte*) id.data())];
+	if (slot == 0) return false;
+	Entry const& entry = entries_[slot - 1];
+	record.assign((const char*) data_.BytePtr() + entry.offset + KEYSTORE_ID_LENGTH, entry.length);
+	return true;
+}
+
+bool KeyStore::Remove(string const& id){
+	if (id.size() != KEYSTORE_ID_LENGTH) return false;
+	const uint32_t slot = slots_[lookup((const byte*) id.data())];
+	if (slot == 0) return false;
+	const size_t index = slot - 1;
+	const size_t offset = entries_[index].offset, length = KEYSTORE_ID_LENGTH + entries_[index].length;
+	//Moving the next records over the removed one, and wiping the bytes that are now unused
+	memmove(data_.BytePtr() + offset, data_.BytePtr() + offset + length, used_ - offset - length);
+	used_ -= length;
+	memset(data_.BytePtr() + used_, 0, length);
+	entries_.erase(entries_.begin() + index);
+	for (size_t i = index; i < entries_.size(); i++) entries_[i].offset -= length;
+	rebuildIndex(slots_.size());
+	return true;
+}
+
+void KeyStore::Clear(){
+	//New() doesn't keep the content : the old block is wiped
+	data_.New(0);
+	used_ = 0;
+	entries_.clear();
+	slots_.assign(KEYSTORE_MIN_SLOTS, 0);
+}
+
+uint64_t KeyStore::hash(const byte* id){
+	uint64_t h = 0;
+	for (size_t i = 0; i < 8; i++) h = (h << 8) | id[i];
+	return h;
+}
+
+size_t KeyStore::lookup(const byte* id) const {
+	const size_t mask = slots_.size() - 1;
+	size_t slot = (size_t) hash(id) & mask;
+	while (slots_[slot] != 0 && memcmp(data_.BytePtr() + entries_[slots_[slot] - 1].offset, id, KEYSTORE_ID_LENGTH) != 0){
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void KeyStore::rebuildIndex(size_t capacity){
+	slots_.assign(capacity, 0);
+	for (size_t i = 0; i < entries_.size(); i++){
+		slots_[lookup(data_.BytePtr() + entries_[i].offset)] = (uint32_t) (i + 1);
+	}
+}
+
+/*
+* Key store files
+*/
+static const byte KEYSTORE_MAGIC[4] = {'N', 'C', 'K', 'S'};
+static const byte KEYSTORE_VERSION = 1;
+static const byte KEYSTORE_FLAG_ENCRYPTED = 0x01;
+//Header fields
+static const size_t KEYSTORE_FLAGS_OFFSET = 5;
+static const size_t KEYSTORE_COUNT_OFFSET = 8;
+static const size_t KEYSTORE_ITERATIONS_OFFSET = 12;
+static const size_t KEYSTORE_SALT_OFFSET = 16;
+static const size_t KEYSTORE_SALT_LENGTH = 16;
+static const size_t KEYSTORE_TAG_OFFSET = 32;
+static const size_t KEYSTORE_FANOUT_OFFSET = 64;
+//Record length prefix; nonce and tag around encrypted records
+static const size_t KEYSTORE_LENGTH_LENGTH = 4;
+static const size_t KEYSTORE_ENCRYPTION_OVERHEAD = CHACHA20POLY1305_NONCE_LENGTH + CHACHA20POLY1305_TAG_LENGTH;
+
+static uint32_t readUInt32(const byte* p){
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static uint64_t readUInt64(const byte* p){
+	return ((uint64_t) readUInt32(p) << 32) | readUInt32(p + 4);
+}
+
+static void writeUInt32(byte* p, uint32_t v){
+	for (size_t i = 0; i < 4; i++) p[i] = (byte) (v >> (24 - 8 * i));
+}
+
+static void writeUInt64(byte* p, uint64_t v){
+	writeUInt32(p, (uint32_t) (v >> 32));
+	writeUInt32(p + 4, (uint32_t) v);
+}
+
+//Returns false if the write failed
+static bool writeAll(int fd, const byte* data, size_t length){
+	while (length > 0){
+		const ssize_t written = write(fd, data, length);
+		if (written <= 0) return false;
+		data += written;
+		length -= (size_t) written;
+	}
+	return true;
+}
+
+MappedKeyStore::MappedKeyStore(string const& filename, string const& passphrase, bool shared) : data_(0), size_(0), count_(0), encrypted_(false){
+	const int fd = shared ? shm_open(filename.c_str(), O_RDONLY, 0) : open(filename.c_str(), O_RDONLY);
+	if (fd < 0) throw new runtime_error(shared ? "The shared key store can't be opened" : "The key store file can't be opened");
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t) KEYSTORE_HEADER_LENGTH){
+		close(fd);
+		throw new runtime_error("Invalid key store file");
+	}
+	size_ = (size_t) info.st_size;
+	void* mapping = mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+	//The mapping stays valid once the descriptor is closed
+	close(fd);
+	if (mapping == MAP_FAILED) throw new runtime_error("The key store file can't be mapped");
+	//Lookups read a few index entries and a record, anywhere in the file
+	madvise(mapping, size_, MADV_RANDOM);
+	if (shared){
+		//The pages are shared by every process that has the store mapped : locking them in one process keeps them out of swap for all.
+		//They are still used if they can't be locked (RLIMIT_MEMLOCK being too low)
+		mlock(mapping, size_);
+#ifdef MADV_DONTDUMP
+		madvise(mapping, size_, MADV_DONTDUMP);
+#endif
+	}
+	data_ = (const byte*) mapping;
+	try {
+		readHeader(passphrase);
+	} catch (runtime_error* e){
+		munmap((void*) data_, size_);
+		throw e;
+	}
+}
+
+MappedKeyStore::~MappedKeyStore(){
+	munmap((void*) data_, size_);
+}
+
+void MappedKeyStore::readHeader(string const& passphrase){
+	if (memcmp(data_, KEYSTORE_MAGIC, sizeof(KEYSTORE_MAGIC)) != 0 || data_[sizeof(KEYSTORE_MAGIC)] != KEYSTORE_VERSION) throw new runtime_error("Invalid key store file");
+	encrypted_ = (data_[KEYSTORE_FLAGS_OFFSET] & KEYSTORE_FLAG_ENCRYPTED) != 0;
+	count_ = readUInt32(data_ + KEYSTORE_COUNT_OFFSET);
+	//The fan-out table never decreases, and ends with the number of keys, whose index must fit in the file
+	uint32_t previous = 0;
+	for (size_t i = 0; i < 256; i++){
+		const uint32_t keys = readUInt32(data_ + KEYSTORE_FANOUT_OFFSET + 4 * i);
+		if (keys < previous) throw new runtime_error("Invalid key store file");
+		previous = keys;
+	}
+	if (previous != count_ || (size_ - KEYSTORE_HEADER_LENGTH) / KEYSTORE_INDEX_ENTRY_LENGTH < count_) throw new runtime_error("Invalid key store file");
+	if (!encrypted_) return;
+	if (passphrase.empty()) throw new runtime_error("The key store is encrypted : a passphrase is needed");
+	const uint32_t iterations = readUInt32(data_ + KEYSTORE_ITERATIONS_OFFSET);
+	if (iterations == 0) throw new runtime_error("Invalid key store file");
+	deriveKey(passphrase, data_ + KEYSTORE_SALT_OFFSET, iterations, key_);
+	byte tag[CHACHA20POLY1305_TAG_LENGTH];
+	headerTag(key_, data_, tag);
+	if (!CryptoPP::VerifyBufsEqual(tag, data_ + KEYSTORE_TAG_OFFSET, sizeof(tag))){
+		key_.New(0);
+		throw new runtime_error("Invalid passphrase, or the key store file has been modified");
+	}
+}
+
+void MappedKeyStore::deriveKey(string const& passphrase, const byte* salt, unsigned int iterations, SecByteBlock& key){
+	key.New(CHACHA20POLY1305_KEY_LENGTH);
+	PKCS5_PBKDF2_HMAC<SHA256> derivation;
+	derivation.DeriveKey(key.BytePtr(), key.size(), 0, (const byte*) passphrase.data(), passphrase.size(), salt, KEYSTORE_SALT_LENGTH, iterations);
+}
+
+void MappedKeyStore::headerTag(SecByteBlock const& key, const byte* header, byte* tag){
+	byte aad[KEYSTORE_HEADER_LENGTH], nonce[CHACHA20POLY1305_NONCE_LENGTH];
+	memcpy(aad, header, sizeof(aad));
+	memset(aad + KEYSTORE_TAG_OFFSET, 0, CHACHA20POLY1305_TAG_LENGTH);
+	memset(nonce, 0, sizeof(nonce));
+	ChaCha20Poly1305 cipher(key.BytePtr(), nonce);
+	cipher.Begin(aad, sizeof(aad));
+	cipher.Final(tag);
+}
+
+string MappedKeyStore::IdAt(size_t i) const {
+	return string((const char*) data_ + KEYSTORE_HEADER_LENGTH + i * KEYSTORE_INDEX_ENTRY_LENGTH, KEYSTORE_ID_LENGTH);
+}
+
+long MappedKeyStore::lookup(const byte* id) const {
+	const byte* fanout = data_ + KEYSTORE_FANOUT_OFFSET;
+	const byte* index = data_ + KEYSTORE_HEADER_LENGTH;
+	size_t low = id[0] == 0 ? 0 : readUInt32(fanout + 4 * (id[0] - 1)), high = readUInt32(fanout + 4 * id[0]);
+	while (low < high){
+		const size_t middle = low + (high - low) / 2;
+		const int comparison = memcmp(index + middle * KEYSTORE_INDEX_ENTRY_LENGTH, id, KEYSTORE_ID_LENGTH);
+		if (comparison == 0) return (long) middle;
+		if (comparison < 0) low = middle + 1;
+		else high = middle;
+	}
+	return -1;
+}
+
+bool MappedKeyStore::Contains(string const& id) const {
+	return id.size() == KEYSTORE_ID_LENGTH && lookup((const byte*) id.data()) >= 0;
+}
+
+bool MappedKeyStore::Find(string const& id, string& record) const {
+	if (id.size() != KEYSTORE_ID_LENGTH) return false;
+	const long entry = lookup((const byte*) id.data());
+	if (entry < 0) return false;
+	const uint64_t offset = readUInt64(data_ + KEYSTORE_HEADER_LENGTH + entry * KEYSTORE_INDEX_ENTRY_LENGTH + KEYSTORE_ID_LENGTH);
+	if (offset < KEYSTORE_HEADER_LENGTH || offset > size_ - KEYSTORE_LENGTH_LENGTH) throw new runtime_error("Damaged key store record");
+	const uint32_t length = readUInt32(data_ + offset);
+	if (length > size_ - offset - KEYSTORE_LENGTH_LENGTH) throw new runtime_error("Damaged key store record");
+	const byte* stored = data_ + offset + KEYSTORE_LENGTH_LENGTH;
+	if (!encrypted_){
+		record.assign((const char*) stored, length);
+		return true;
+	}
+	if (length <= KEYSTORE_ENCRYPTION_OVERHEAD) throw new runtime_error("Damaged key store record");
+	record.assign(length - KEYSTORE_ENCRYPTION_OVERHEAD, '\0');
+	if (!ChaCha20Poly1305_Decrypt(key_.BytePtr(), stored, (const byte*) id.data(), id.size(), stored + CHACHA20POLY1305_NONCE_LENGTH, length - CHACHA20POLY1305_NONCE_LENGTH, (byte*) &record[0])){
+		throw new runtime_error("A key store record doesn't authenticate : the key store file has been modified");
+	}
+	return true;
+}
+
+//Orders record numbers by ID
+struct KeyStoreIdLess {
+	vector<pair<string, string> > const& records;
+	explicit KeyStoreIdLess(vector<pair<string, string> > const& r) : records(r){}
+	bool operator()(size_t a, size_t b) const { return records[a].first < records[b].first; }
+};
+
+bool MappedKeyStore::writeStore(int fd, vector<pair<string, string> > const& records, string const& passphrase, unsigned int pbkdfIterations){
+	//Sorting record numbers rather than the records : no copy of a record is left unwiped
+	vector<size_t> order(records.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	sort(order.begin(), order.end(), KeyStoreIdLess(records));
+	for (size_t i = 0; i < order.size(); i++){
+		if (records[order[i]].first.size() != KEYSTORE_ID_LENGTH || (i > 0 && records[order[i]].first == records[order[i - 1]].first)) throw new runtime_error("Invalid key ID");
+		if (records[order[i]].second.size() > 0xffffffff - KEYSTORE_ENCRYPTION_OVERHEAD) throw new runtime_error("Invalid key record");
+	}
+	if (records.size() > 0xffffffff) throw new runtime_error("Too many keys");
+	const bool encrypted = !passphrase.empty();
+	AutoSeededRandomPool prng;
+	//Header
+	byte header[KEYSTORE_HEADER_LENGTH];
+	memset(header, 0, sizeof(header));
+	memcpy(header, KEYSTORE_MAGIC, sizeof(KEYSTORE_MAGIC));
+	header[sizeof(KEYSTORE_MAGIC)] = KEYSTORE_VERSION;
+	header[KEYSTORE_FLAGS_OFFSET] = encrypted ? KEYSTORE_FLAG_ENCRYPTED : 0;
+	writeUInt32(header + KEYSTORE_COUNT_OFFSET, (uint32_t) records.size());
+	uint32_t fanout[256];
+	memset(fanout, 0, sizeof(fanout));
+	for (size_t i = 0; i < records.size(); i++) fanout[(byte) records[i].first[0]]++;
+	for (size_t i = 1; i < 256; i++) fanout[i] += fanout[i - 1];
+	for (size_t i = 0; i < 256; i++) writeUInt32(header + KEYSTORE_FANOUT_OFFSET + 4 * i, fanout[i]);
+	SecByteBlock key;
+	if (encrypted){
+		writeUInt32(header + KEYSTORE_ITERATIONS_OFFSET, pbkdfIterations);
+		prng.GenerateBlock(header + KEYSTORE_SALT_OFFSET, KEYSTORE_SALT_LENGTH);
+		deriveKey(passphrase, header + KEYSTORE_SALT_OFFSET, pbkdfIterations, key);
+		headerTag(key, header, header + KEYSTORE_TAG_OFFSET);
+	}
+	//Index
+	vector<byte> index(records.size() * KEYSTORE_INDEX_ENTRY_LENGTH);
+	uint64_t offset = KEYSTORE_HEADER_LENGTH + index.size();
+	for (size_t i = 0; i < order.size(); i++){
+		pair<string, string> const& record = records[order[i]];
+		memcpy(&index[i * KEYSTORE_INDEX_ENTRY_LENGTH], record.first.data(), KEYSTORE_ID_LENGTH);
+		writeUInt64(&index[i * KEYSTORE_INDEX_ENTRY_LENGTH + KEYSTORE_ID_LENGTH], offset);
+		offset += KEYSTORE_LENGTH_LENGTH + record.second.size() + (encrypted ? KEYSTORE_ENCRYPTION_OVERHEAD : 0);
+	}
+	//The magic is written last : a store that is opened while it is being written is rejected
+	memset(header, 0, sizeof(KEYSTORE_MAGIC));
+	bool written = writeAll(fd, header, sizeof(header)) && (index.empty() || writeAll(fd, &index[0], index.size()));
+	SecByteBlock buffer;
+	for (size_t i = 0; written && i < order.size(); i++){
+		pair<string, string> const& record = records[order[i]];
+		const size_t length = record.second.size() + (encrypted ? KEYSTORE_ENCRYPTION_OVERHEAD : 0);
+		buffer.New(KEYSTORE_LENGTH_LENGTH + length);
+		writeUInt32(buffer.BytePtr(), (uint32_t) length);
+		byte* stored = buffer.BytePtr() + KEYSTORE_LENGTH_LENGTH;
+		if (encrypted){
+			prng.GenerateBlock(stored, CHACHA20POLY1305_NONCE_LENGTH);
+			ChaCha20Poly1305_Encrypt(key.BytePtr(), stored, (const byte*) record.first.data(), KEYSTORE_ID_LENGTH, (const byte*) record.second.data(), record.second.size(), stored + CHACHA20POLY1305_NONCE_LENGTH);
+		} else memcpy(stored, record.second.data(), record.second.size());
+		written = writeAll(fd, buffer.BytePtr(), buffer.size());
+	}
+	return written && pwrite(fd, KEYSTORE_MAGIC, sizeof(KEYSTORE_MAGIC), 0) == (ssize_t) sizeof(KEYSTORE_MAGIC);
+}
+
+void MappedKeyStore::Write(string const& filename, vector<pair<string, string> > const& records, string const& passphrase, unsigned int pbkdfIterations){
+	//Written to a new file next to the destination (same as KeyRing::writeFileAtomically), only readable by its owner, then renamed over it
+	string temporary = filename + ".XXXXXX";
+	const int fd = mkstemp(&temporary[0]);
+	if (fd < 0) throw new runtime_error("The key store file can't be written");
+	bool written;
+	try {
+		written = writeStore(fd, records, passphrase, pbkdfIterations);
+	} catch (runtime_error* e){
+		close(fd);
+		unlink(temporary.c_str());
+		throw e;
+	}
+	written = fsync(fd) == 0 && written;
+	written = close(fd) == 0 && written;
+	if (!written || rename(temporary.c_str(), filename.c_str()) != 0){
+		unlink(temporary.c_str());
+		throw new runtime_error("The key store file can't be written");
+	}
+	//Syncing the directory too, for the rename to outlive a crash
+	const size_t slash = filename.rfind('/');
+	const string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+	const int directoryFd = open(directory.c_str(), O_RDONLY);
+	if (directoryFd >= 0){
+		fsync(directoryFd);
+		close(directoryFd);
+	}
+}
+
+void MappedKeyStore::Share(string const& name, vector<pair<string, string> > const& records, string const& passphrase, unsigned int pbkdfIterations){
+	//A new object replaces the previous one : processes that have it mapped keep it until they unmap it
+	shm_unlink(name.c_str());
+	const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) throw new runtime_error("The shared key store can't be created");
+	bool written;
+	try {
+		written = writeStore(fd, records, passphrase, pbkdfIterations);
+	} catch (runtime_error* e){
+		close(fd);
+		shm_unlink(name.c_str());
+		throw e;
+	}
+	written = close(fd) == 0 && written;
+	if (!written){
+		shm_unlink(name.c_str());
+		throw new runtime_error("The shared key store can't be written");
+	}
+}
+
+void MappedKeyStore::Unshare(string const& name){
+	if (shm_unlink(name.c_str()) != 0) throw new runtime_error("There's no shared key store with that name");
+}
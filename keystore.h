@@ -0,0 +1,125 @@
+#ifndef KEYSTORE_H
+#define KEYSTORE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+
+//Length of key IDs, in bytes : a truncated SHA-256 fingerprint of the public key (see KeyRing::getKeyId)
+static const size_t KEYSTORE_ID_LENGTH = 16;
+
+/*
+* Set of encoded key pairs (KeyRing::encodeBuffer records), indexed by key ID.
+* Records are stored back to back in a single SecByteBlock (ID || record), which is wiped when it grows or is freed, rather than in one key map
+* per key. The index is an open addressing hash table (linear probing, at most half full) of record numbers : key IDs being fingerprints,
+* their first 8 bytes are the hash. Lookups are O(1); removing a key moves the records after it, and rebuilds the index.
+* Not thread-safe : it belongs to a MultiKeyRing, and is used from the main thread.
+*/
+class KeyStore {
+
+public:
+	KeyStore();
+
+	size_t Size() const { return entries_.size(); }
+	//ID of the i-th key, in insertion order
+	std::string IdAt(size_t i) const;
+	//Returns false (and leaves the store as it is) if there's already a key with that ID
+	bool Add(std::string const& id, std::string const& record);
+	//Returns false if there's no key with that ID
+	bool Find(std::string const& id, std::string& record) const;
+	bool Remove(std::string const& id);
+	void Clear();
+
+private:
+	struct Entry {
+		//Position of ID || record in data_; length of the record
+		size_t offset, length;
+	};
+	SecByteBlock data_;
+	size_t used_;
+	std::vector<Entry> entries_;
+	//Entry index + 1 in each slot; 0 for an empty slot. The size is a power of 2
+	std::vector<uint32_t> slots_;
+
+	static uint64_t hash(const byte* id);
+	//Slot holding the ID, or the empty slot where it would go
+	size_t lookup(const byte* id) const;
+	void rebuildIndex(size_t capacity);
+};
+
+/*
+* Key store file, opened with mmap : nothing is read from it until a key is looked up, and records are decoded (and decrypted) one by one, when used.
+* Integers are big endian.
+* Header (KEYSTORE_HEADER_LENGTH bytes) :
+*	magic "NCKS" (4 bytes) || version, 1 (1 byte) || flags (1 byte, 0x01 : encrypted records) || 2 zero bytes || number of keys (4 bytes) ||
+*	PBKDF2-HMAC-SHA256 iterations (4 bytes) || salt (16 bytes) || tag (16 bytes) || 16 zero bytes ||
+*	fan-out table : 256 * 4 bytes, the i-th number being the number of keys whose ID's first byte is at most i
+* Index : for each key, sorted by ID, ID (16 bytes) || offset of the record in the file (8 bytes)
+* Records : length (4 bytes) || record. The record is the key pair's KeyRing::encodeBuffer encoding, or, in encrypted stores,
+*	nonce (12 bytes) || ChaCha20-Poly1305 encryption of it, with the key ID as associated data || tag (16 bytes)
+* Encrypted stores : the key is derived from the passphrase once, when the file is opened. The header's tag is the ChaCha20-Poly1305 tag of the
+* header (its tag being zeroed) as associated data, with an empty message and a zero nonce : wrong passphrases are told apart when opening the store.
+* A lookup is a binary search in the fan-out bucket of the ID : IDs being fingerprints, buckets of a 500k keys store hold about 2000 keys.
+* Shared key stores are the same bytes in a POSIX shared memory object (shm_open) rather than a file : a process writes it once (Share), and
+* the others (cluster workers) map it read-only, so that the host holds one copy of the keys whatever the number of processes. Their pages are mlock'ed.
+*/
+static const size_t KEYSTORE_HEADER_LENGTH = 64 + 256 * 4;
+static const size_t KEYSTORE_INDEX_ENTRY_LENGTH = KEYSTORE_ID_LENGTH + 8;
+static const unsigned int KEYSTORE_DEFAULT_PBKDF_ITERATIONS = 8192;
+
+class MappedKeyStore {
+
+public:
+	/*
+	* Throws a runtime_error* if the file can't be mapped, isn't a key store, or if the passphrase is wrong. The passphrase is ignored if the records aren't encrypted.
+	* With shared, filename is the name of a shared key store (see Share)
+	*/
+	MappedKeyStore(std::string const& filename, std::string const& passphrase, bool shared = false);
+	//Unmaps the file and wipes the key
+	~MappedKeyStore();
+
+	size_t Size() const { return count_; }
+	bool Encrypted() const { return encrypted_; }
+	//ID of the i-th key, in the order of the index (sorted)
+	std::string IdAt(size_t i) const;
+	bool Contains(std::string const& id) const;
+	//Returns false if there's no key with that ID. Throws a runtime_error* if its record is damaged, or doesn't authenticate
+	bool Find(std::string const& id, std::string& record) const;
+
+	/*
+	* Writes a key store with the given (ID, record) pairs, encrypted if passphrase isn't empty. The file is written next to filename, then renamed :
+	* a store that is mapped meanwhile keeps its content. Throws a runtime_error* if the file can't be written
+	*/
+	static void Write(std::string const& filename, std::vector<std::pair<std::string, std::string> > const& records, std::string const& passphrase, unsigned int pbkdfIterations = KEYSTORE_DEFAULT_PBKDF_ITERATIONS);
+	/*
+	* Writes a key store to the shared memory object name ("/name"), only accessible to its owner. An existing store with that name is unlinked first :
+	* processes that have it mapped keep its content. Throws a runtime_error* if it can't be written
+	*/
+	static void Share(std::string const& name, std::vector<std::pair<std::string, std::string> > const& records, std::string const& passphrase, unsigned int pbkdfIterations = KEYSTORE_DEFAULT_PBKDF_ITERATIONS);
+	//Removes the name of a shared key store; processes that have it mapped keep it. Throws a runtime_error* if there's none
+	static void Unshare(std::string const& name);
+
+private:
+	const byte* data_;
+	size_t size_, count_;
+	bool encrypted_;
+	SecByteBlock key_;
+	//Not copyable : the mapping belongs to one instance
+	MappedKeyStore(MappedKeyStore const&);
+	MappedKeyStore& operator=(MappedKeyStore const&);
+
+	//Checks the header, and derives the key of encrypted stores. Throws a runtime_error*
+	void readHeader(std::string const& passphrase);
+	//Index entry of the ID, or -1
+	long lookup(const byte* id) const;
+	//Writes the store to fd, and returns false if a write fails. Throws a runtime_error* if a record is invalid
+	static bool writeStore(int fd, std::vector<std::pair<std::string, std::string> > const& records, std::string const& passphrase, unsigned int pbkdfIterations);
+	static void deriveKey(std::string const& passphrase, const byte* salt, unsigned int iterations, SecByteBlock& key);
+	static void headerTag(SecByteBlock const& key, const byte* header, byte* tag);
+};
+
+#endif
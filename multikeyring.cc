@@ -0,0 +1,553 @@
+//Std imports
+#include <string>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <stdexcept>
+
+//Node and class headers import
+#include <node.h>
+#include "multikeyring.h"
+
+using namespace v8;
+using namespace std;
+
+Persistent<Function> MultiKeyRing::constructor;
+Persistent<Function> MultiKeyRing::decryptMethod;
+Persistent<Function> MultiKeyRing::decryptBatchMethod;
+Persistent<Function> MultiKeyRing::signMethod;
+Persistent<Function> MultiKeyRing::signBatchMethod;
+Persistent<Function> MultiKeyRing::agreeMethod;
+Persistent<Function> MultiKeyRing::openSessionMethod;
+Persistent<Function> MultiKeyRing::createKeyPairMethod;
+
+MultiKeyRing::MultiKeyRing() : KeyRing(), mapped_(0){
+}
+
+//The KeyStore wipes the records; keyPair is only set during a call, and freed by ~KeyRing
+MultiKeyRing::~MultiKeyRing(){
+	delete mapped_;
+}
+
+void MultiKeyRing::Init(Handle<Object> exports){
+	//Prepare constructor template
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
+	tpl->SetClassName(String::NewSymbol("MultiKeyRing"));
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+	//Prototype
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(Decrypt)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("decryptBatch"), FunctionTemplate::New(DecryptBatch)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("sign"), FunctionTemplate::New(Sign)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("signBatch"), FunctionTemplate::New(SignBatch)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("agree"), FunctionTemplate::New(Agree)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("openSession"), FunctionTemplate::New(OpenSession)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("publicKeyInfo"), FunctionTemplate::New(PublicKeyInfo)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("createKeyPair"), FunctionTemplate::New(CreateKeyPair)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("load"), FunctionTemplate::New(Load)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("save"), FunctionTemplate::New(Save)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("remove"), FunctionTemplate::New(Remove)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("keyIds"), FunctionTemplate::New(KeyIds)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("size"), FunctionTemplate::New(Size)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("clear"), FunctionTemplate::New(Clear)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("openStore"), FunctionTemplate::New(OpenStore)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("saveStore"), FunctionTemplate::New(SaveStore)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("shareStore"), FunctionTemplate::New(ShareStore)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("attachStore"), FunctionTemplate::New(AttachStore)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("unshareStore"), FunctionTemplate::New(UnshareStore)->GetFunction());
+	//Same as KeyRing's : they don't depend on the key
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("enableNoncePool"), FunctionTemplate::New(KeyRing::EnableNoncePool)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("disableNoncePool"), FunctionTemplate::New(KeyRing::DisableNoncePool)->GetFunction());
+	constructor = Persistent<Function>::New(tpl->GetFunction());
+	decryptMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::Decrypt)->GetFunction());
+	decryptBatchMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::DecryptBatch)->GetFunction());
+	signMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::Sign)->GetFunction());
+	signBatchMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::SignBatch)->GetFunction());
+	agreeMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::Agree)->GetFunction());
+	openSessionMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::OpenSession)->GetFunction());
+	createKeyPairMethod = Persistent<Function>::New(FunctionTemplate::New(KeyRing::CreateKeyPair)->GetFunction());
+	exports->Set(String::NewSymbol("MultiKeyRing"), constructor);
+}
+
+//No params
+Handle<Value> MultiKeyRing::New(const Arguments& args){
+	HandleScope scope;
+	if (args.IsConstructCall()){
+		MultiKeyRing* newInstance = new MultiKeyRing();
+		newInstance->Wrap(args.This());
+		return args.This();
+	} else {
+		//Invoked as a plain function, turn into construct call
+		return scope.Close(constructor->NewInstance());
+	}
+}
+
+static void wipeRecords(vector<pair<string, string> >& records){
+	for (size_t i = 0; i < records.size(); i++){
+		if (!records[i].second.empty()) memset(&records[i].second[0], 0, records[i].second.size());
+	}
+}
+
+Local<Object> MultiKeyRing::addKeyPair(map<string, string>* keyPair){
+	Local<Object> pubKey;
+	try {
+		const string id = getKeyId(keyPair);
+		string record = encodeBuffer(keyPair);
+		//A key that is already there is left as it is. A key of the mapped file is only shown again if it has been removed
+		if (mapped_ != 0 && mapped_->Contains(id)) removed_.erase(id);
+		else store_.Add(id, record);
+		memset(&record[0], 0, record.size());
+		pubKey = keyInfo(keyPair, id);
+	} catch (runtime_error* e){
+		deleteKeyPair(keyPair);
+		throw e;
+	}
+	deleteKeyPair(keyPair);
+	return pubKey;
+}
+
+Local<Object> MultiKeyRing::loadedKeyPair(map<string, string>* loaded){
+	return addKeyPair(loaded);
+}
+
+Local<Object> MultiKeyRing::keyInfo(map<string, string>* keyPair, string const& id){
+	map<string, string>* previous = this->keyPair;
+	this->keyPair = keyPair;
+	Local<Object> pubKey;
+	try {
+		pubKey = PPublicKeyInfo();
+	} catch (runtime_error* e){
+		this->keyPair = previous;
+		throw e;
+	}
+	this->keyPair = previous;
+	pubKey->Set(String::NewSymbol("keyId"), String::New(strHexEncode(id).c_str()));
+	return pubKey;
+}
+
+bool MultiKeyRing::findRecord(string const& id, string& record) const {
+	if (store_.Find(id, record)) return true;
+	return mapped_ != 0 && removed_.find(id) == removed_.end() && mapped_->Find(id, record);
+}
+
+map<string, string>* MultiKeyRing::findKeyPair(Handle<Value> keyIdVal){
+	string record;
+	if (keyIdVal->IsString()){
+		String::Utf8Value keyIdStr(keyIdVal->ToString());
+		string keyId(*keyIdStr);
+		map<string, string>* keyPair = 0;
+		try {
+			if (keyId.size() == 2 * KEYSTORE_ID_LENGTH && findRecord(strHexDecode(keyId), record)) keyPair = decodeBuffer(record);
+		} catch (runtime_error* e){
+			//Damaged or altered key store file, or record
+			if (!record.empty()) memset(&record[0], 0, record.size());
+			ThrowException(Exception::TypeError(String::New(e->what())));
+			delete e;
+			return 0;
+		}
+		if (!record.empty()) memset(&record[0], 0, record.size());
+		if (keyPair != 0) return keyPair;
+	}
+	ThrowException(Exception::TypeError(String::New("Unknown key ID")));
+	return 0;
+}
+
+Handle<Value> MultiKeyRing::forward(const Arguments& args, Persistent<Function> const& method){
+	HandleScope scope;
+	if (args.Length() < 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. Please check the module's documentation")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	map<string, string>* keyPair = instance->findKeyPair(args[0]);
+	if (keyPair == 0) return scope.Close(Undefined());
+	vector<Handle<Value> > argv;
+	for (int i = 1; i < args.Length(); i++) argv.push_back(args[i]);
+	//A callback may call this object again, with another key : the current key map is put back afterwards
+	map<string, string>* previous = instance->keyPair;
+	instance->keyPair = keyPair;
+	Local<Value> result = method->Call(args.This(), argv.size(), argv.empty() ? 0 : &argv[0]);
+	instance->keyPair = previous;
+	deleteKeyPair(keyPair);
+	//Empty when the method threw an exception
+	if (result.IsEmpty()) return scope.Close(Undefined());
+	return scope.Close(result);
+}
+
+/*
+* Signature : same as KeyRing's methods, with the key ID first
+* String keyId, ...
+*/
+Handle<Value> MultiKeyRing::Decrypt(const Arguments& args){
+	return forward(args, decryptMethod);
+}
+
+Handle<Value> MultiKeyRing::DecryptBatch(const Arguments& args){
+	return forward(args, decryptBatchMethod);
+}
+
+Handle<Value> MultiKeyRing::Sign(const Arguments& args){
+	return forward(args, signMethod);
+}
+
+Handle<Value> MultiKeyRing::SignBatch(const Arguments& args){
+	return forward(args, signBatchMethod);
+}
+
+Handle<Value> MultiKeyRing::Agree(const Arguments& args){
+	return forward(args, agreeMethod);
+}
+
+Handle<Value> MultiKeyRing::OpenSession(const Arguments& args){
+	return forward(args, openSessionMethod);
+}
+
+/*
+* Signature
+* String keyId
+*/
+Handle<Value> MultiKeyRing::PublicKeyInfo(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() != 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	map<string, string>* keyPair = instance->findKeyPair(args[0]);
+	if (keyPair == 0) return scope.Close(Undefined());
+	String::Utf8Value keyIdVal(args[0]->ToString());
+	Local<Object> pubKey;
+	try {
+		pubKey = instance->keyInfo(keyPair, strHexDecode(string(*keyIdVal)));
+	} catch (runtime_error* e){
+		deleteKeyPair(keyPair);
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	deleteKeyPair(keyPair);
+	return scope.Close(pubKey);
+}
+
+/*
+* Signature
+* String keyType, Number/String/Object keyOptions (same as KeyRing.createKeyPair), Function callback [optional]
+* Returns the public key info, with the keyId attribute
+*/
+Handle<Value> MultiKeyRing::CreateKeyPair(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 3)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters. You must at least specify the key type and related paremters like key size or curve name")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	//KeyRing.createKeyPair() replaces keyPair : the new key map is taken from it, without saving it to a file
+	const int argc = args.Length() >= 2 ? 2 : 1;
+	Handle<Value> argv[2] = { args[0], argc == 2 ? args[1] : Handle<Value>(Undefined()) };
+	map<string, string>* previous = instance->keyPair;
+	instance->keyPair = 0;
+	Local<Value> created = createKeyPairMethod->Call(args.This(), argc, argv);
+	map<string, string>* keyPair = instance->keyPair;
+	instance->keyPair = previous;
+	if (created.IsEmpty()){
+		deleteKeyPair(keyPair);
+		return scope.Close(Undefined());
+	}
+	Local<Object> pubKey;
+	try {
+		pubKey = instance->addKeyPair(keyPair);
+	} catch (runtime_error* e){
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	if (args.Length() < 3 || args[2]->IsUndefined()) return scope.Close(pubKey);
+	Local<Function> callback = Local<Function>::Cast(args[2]);
+	const unsigned callbackArgc = 1;
+	Local<Value> callbackArgv[callbackArgc] = { pubKey };
+	callback->Call(Context::GetCurrent()->Global(), callbackArgc, callbackArgv);
+	return scope.Close(Undefined());
+}
+
+/*
+* Signature
+* String filename, Boolean legacy [optional], String passphrase [optional], Function callback [optional]
+* Adds the key pair of the file (a KeyRing key file), and returns its public key info with the keyId attribute. With a callback
+* (the last parameter), the file is read on the thread pool, and the callback receives the public key info, or (undefined, error)
+*/
+Handle<Value> MultiKeyRing::Load(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 4)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	String::Utf8Value filenameVal(args[0]->ToString());
+	string filename(*filenameVal), passphrase = "";
+	if (!doesFileExist(filename)){
+		ThrowException(Exception::TypeError(String::New("The given file doesn't exist.")));
+		return scope.Close(Undefined());
+	}
+	const int callbackIndex = args.Length() >= 2 && args[args.Length() - 1]->IsFunction() ? args.Length() - 1 : -1;
+	const bool legacy = args.Length() >= 2 && callbackIndex != 1 && args[1]->BooleanValue();
+	if (args.Length() >= 3 && callbackIndex != 2 && !args[2]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[2]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	if (callbackIndex != -1){
+		queueLoad(args.This(), filename, legacy, passphrase, Local<Function>::Cast(args[callbackIndex]));
+		return scope.Close(Undefined());
+	}
+	Local<Object> pubKey;
+	try {
+		pubKey = instance->addKeyPair(loadKeyPair(filename, legacy, passphrase));
+	} catch (runtime_error* e){
+		//Wrong passphrase or altered file
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	return scope.Close(pubKey);
+}
+
+/*
+* Signature
+* String keyId, String filename, String passphrase [optional], Object options [optional], Function callback [optional]
+* Saves the key pair in a KeyRing key file, as KeyRing.save() does (on the thread pool when a callback is given)
+*/
+Handle<Value> MultiKeyRing::Save(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 2 && args.Length() <= 5)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	const int callbackIndex = args.Length() >= 3 && args[args.Length() - 1]->IsFunction() ? args.Length() - 1 : -1;
+	unsigned int pbkdfIterations = KEYFILE_DEFAULT_PBKDF_ITERATIONS;
+	KDFHash hash = KEYFILE_DEFAULT_KDF;
+	if (args.Length() >= 4 && callbackIndex != 3 && !getSaveOptions(args[3], pbkdfIterations, hash)) return scope.Close(Undefined());
+	map<string, string>* keyPair = instance->findKeyPair(args[0]);
+	if (keyPair == 0) return scope.Close(Undefined());
+	String::Utf8Value filenameVal(args[1]->ToString());
+	string filename(*filenameVal), passphrase = "";
+	if (args.Length() >= 3 && callbackIndex != 2 && !args[2]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[2]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	//The decoded key map is handed to the save job
+	if (callbackIndex != -1){
+		queueSave(filename, keyPair, passphrase, pbkdfIterations, hash, Local<Function>::Cast(args[callbackIndex]));
+		return scope.Close(Undefined());
+	}
+	try {
+		saveKeyPair(filename, keyPair, passphrase, pbkdfIterations, hash);
+	} catch (runtime_error* e){
+		ThrowException(Exception::Error(String::New(e->what())));
+		delete e;
+	}
+	deleteKeyPair(keyPair);
+	return scope.Close(Undefined());
+}
+
+/*
+* Signature
+* String keyId
+* Returns whether there was a key with this ID
+*/
+Handle<Value> MultiKeyRing::Remove(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() != 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	String::Utf8Value keyIdVal(args[0]->ToString());
+	string keyId(*keyIdVal);
+	if (keyId.size() != 2 * KEYSTORE_ID_LENGTH) return scope.Close(Boolean::New(false));
+	const string id = strHexDecode(keyId);
+	bool removed = instance->store_.Remove(id);
+	//The keys of the mapped file are hidden
+	if (!removed && instance->mapped_ != 0 && instance->mapped_->Contains(id)) removed = instance->removed_.insert(id).second;
+	return scope.Close(Boolean::New(removed));
+}
+
+//No params. Key IDs : those of the key store file first (sorted), then the others, in the order they were added
+Handle<Value> MultiKeyRing::KeyIds(const Arguments& args){
+	HandleScope scope;
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	Local<Array> keyIds = Array::New();
+	uint32_t index = 0;
+	if (instance->mapped_ != 0){
+		for (size_t i = 0; i < instance->mapped_->Size(); i++){
+			const string id = instance->mapped_->IdAt(i);
+			if (instance->removed_.find(id) == instance->removed_.end()) keyIds->Set(index++, String::New(strHexEncode(id).c_str()));
+		}
+	}
+	for (size_t i = 0; i < instance->store_.Size(); i++){
+		keyIds->Set(index++, String::New(strHexEncode(instance->store_.IdAt(i)).c_str()));
+	}
+	return scope.Close(keyIds);
+}
+
+//No params
+Handle<Value> MultiKeyRing::Size(const Arguments& args){
+	HandleScope scope;
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	size_t size = instance->store_.Size();
+	if (instance->mapped_ != 0) size += instance->mapped_->Size() - instance->removed_.size();
+	return scope.Close(Number::New(size));
+}
+
+//No params. Removes (and wipes) every key, and closes the key store file
+Handle<Value> MultiKeyRing::Clear(const Arguments& args){
+	HandleScope scope;
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	instance->store_.Clear();
+	delete instance->mapped_;
+	instance->mapped_ = 0;
+	instance->removed_.clear();
+	NoncePool::Release(instance->noncePool_);
+	instance->noncePool_ = 0;
+	return scope.Close(Undefined());
+}
+
+/*
+* Signature
+* String filename, String passphrase [optional]
+* Opens a key store file (written by saveStore). The key ring must be empty. Returns the number of keys
+*/
+Handle<Value> MultiKeyRing::OpenStore(const Arguments& args){
+	return openStore(args, false);
+}
+
+/*
+* Signature
+* String name, String passphrase [optional]
+* Attaches the shared key store name (written by shareStore), read-only. The key ring must be empty. Returns the number of keys
+*/
+Handle<Value> MultiKeyRing::AttachStore(const Arguments& args){
+	return openStore(args, true);
+}
+
+Handle<Value> MultiKeyRing::openStore(const Arguments& args, bool shared){
+	HandleScope scope;
+	if (!(args.Length() == 1 || args.Length() == 2)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	if (instance->mapped_ != 0 || instance->store_.Size() > 0){
+		ThrowException(Exception::TypeError(String::New("The key ring must be empty to open a key store. Call clear() first")));
+		return scope.Close(Undefined());
+	}
+	String::Utf8Value filenameVal(args[0]->ToString());
+	string filename(*filenameVal), passphrase = "";
+	if (shared){
+		filename = sharedStoreName(filename);
+	} else if (!doesFileExist(filename)){
+		ThrowException(Exception::TypeError(String::New("The given file doesn't exist.")));
+		return scope.Close(Undefined());
+	}
+	if (args.Length() == 2 && !args[1]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[1]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	try {
+		instance->mapped_ = new MappedKeyStore(filename, passphrase, shared);
+	} catch (runtime_error* e){
+		//Not a key store file, or wrong passphrase
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	return scope.Close(Number::New(instance->mapped_->Size()));
+}
+
+/*
+* Signature
+* String filename, String passphrase [optional]
+* Writes every key of the key ring to a key store file; its records are encrypted if a passphrase is given. The file is replaced atomically,
+* so it can be the one this key ring has open
+*/
+Handle<Value> MultiKeyRing::SaveStore(const Arguments& args){
+	return writeStore(args, false);
+}
+
+/*
+* Signature
+* String name, String passphrase [optional]
+* Writes every key of the key ring to the shared key store name, for other processes to attach it. A store that already has this name is replaced :
+* the processes that have it attached keep it until they clear() their key ring. Returns the number of keys
+*/
+Handle<Value> MultiKeyRing::ShareStore(const Arguments& args){
+	return writeStore(args, true);
+}
+
+Handle<Value> MultiKeyRing::writeStore(const Arguments& args, bool shared){
+	HandleScope scope;
+	if (!(args.Length() == 1 || args.Length() == 2)){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	MultiKeyRing* instance = ObjectWrap::Unwrap<MultiKeyRing>(args.This());
+	String::Utf8Value filenameVal(args[0]->ToString());
+	string filename(*filenameVal), passphrase = "";
+	if (args.Length() == 2 && !args[1]->IsUndefined()){
+		String::Utf8Value passphraseVal(args[1]->ToString());
+		passphrase = string(*passphraseVal);
+	}
+	//Reserved, so that no copy of a record is left behind when the vector grows
+	vector<pair<string, string> > records;
+	records.reserve(instance->store_.Size() + (instance->mapped_ != 0 ? instance->mapped_->Size() : 0));
+	try {
+		if (instance->mapped_ != 0){
+			for (size_t i = 0; i < instance->mapped_->Size(); i++){
+				const string id = instance->mapped_->IdAt(i);
+				if (instance->removed_.find(id) != instance->removed_.end()) continue;
+				records.push_back(make_pair(id, string()));
+				instance->mapped_->Find(id, records.back().second);
+			}
+		}
+		for (size_t i = 0; i < instance->store_.Size(); i++){
+			const string id = instance->store_.IdAt(i);
+			records.push_back(make_pair(id, string()));
+			instance->store_.Find(id, records.back().second);
+		}
+		if (shared) MappedKeyStore::Share(sharedStoreName(filename), records, passphrase);
+		else MappedKeyStore::Write(filename, records, passphrase);
+	} catch (runtime_error* e){
+		wipeRecords(records);
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+		return scope.Close(Undefined());
+	}
+	const size_t count = records.size();
+	wipeRecords(records);
+	if (shared) return scope.Close(Number::New(count));
+	return scope.Close(Undefined());
+}
+
+/*
+* Signature
+* String name
+* Removes the shared key store name. The processes that have it attached keep it until they clear() their key ring
+*/
+Handle<Value> MultiKeyRing::UnshareStore(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() != 1){
+		ThrowException(Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	String::Utf8Value nameVal(args[0]->ToString());
+	try {
+		MappedKeyStore::Unshare(sharedStoreName(string(*nameVal)));
+	} catch (runtime_error* e){
+		ThrowException(Exception::TypeError(String::New(e->what())));
+		delete e;
+	}
+	return scope.Close(Undefined());
+}
+
+//Shared memory object names start with a slash
+string MultiKeyRing::sharedStoreName(string const& name){
+	return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+}
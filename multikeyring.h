@@ -0,0 +1,80 @@
+#ifndef MULTIKEYRING_H
+#define MULTIKEYRING_H
+
+#include <string>
+#include <map>
+#include <set>
+
+#include <node.h>
+
+#include "keyring.h"
+#include "keystore.h"
+
+/*
+* Key ring holding any number of key pairs, each one designated by its key ID (hex encoded, see KeyRing::getKeyId) : sign(keyId, message),
+* decrypt(keyId, cipherText)... The keys are kept encoded in a KeyStore, rather than in one key map (and one KeyRing object) per key.
+* For each call, the key is looked up, decoded into keyPair, and the KeyRing method is run with the other arguments : parameters, results
+* and errors are the same. The decoded key map is wiped and freed before returning. The nonce pool (enableNoncePool()) is shared by the
+* keys, and rebuilt when the curve changes.
+* A key store file (openStore/saveStore, see MappedKeyStore) can back the key ring : its keys are looked up in the mapped file, and decoded
+* for each call like the others. Keys added afterwards are kept in memory; removing a key of the file only hides it.
+* Shared key stores (shareStore/attachStore) are key stores in shared memory : cluster workers attach the store the primary process wrote,
+* rather than each one loading the keys into its own memory.
+*/
+class MultiKeyRing : public KeyRing {
+
+public:
+	static void Init(v8::Handle<v8::Object> exports);
+
+private:
+	MultiKeyRing();
+	~MultiKeyRing();
+	KeyStore store_;
+	//Opened key store file, or 0
+	MappedKeyStore* mapped_;
+	//IDs of the mapped keys that have been removed
+	std::set<std::string> removed_;
+	//Stores the key pair (then wipes and deletes it), and returns its public key info with the keyId attribute. Throws a runtime_error* if the key is invalid
+	v8::Local<v8::Object> addKeyPair(std::map<std::string, std::string>* keyPair);
+	//Public key info of the key pair, with the keyId attribute. Throws a runtime_error* if an entry is missing
+	v8::Local<v8::Object> keyInfo(std::map<std::string, std::string>* keyPair, std::string const& id);
+	//Encoded key pair, from the KeyStore or from the mapped file. Returns false if there's no such key; throws a runtime_error* if the record is damaged
+	bool findRecord(std::string const& id, std::string& record) const;
+	//Decoded key map of the hex encoded key ID. Throws a TypeError and returns 0 if there's no such key
+	std::map<std::string, std::string>* findKeyPair(v8::Handle<v8::Value> keyIdVal);
+	//Runs the KeyRing method with the key designated by the first argument, and the other arguments
+	static v8::Handle<v8::Value> forward(const v8::Arguments& args, v8::Persistent<v8::Function> const& method);
+	//openStore() / attachStore() and saveStore() / shareStore()
+	static v8::Handle<v8::Value> openStore(const v8::Arguments& args, bool shared);
+	static v8::Handle<v8::Value> writeStore(const v8::Arguments& args, bool shared);
+	static std::string sharedStoreName(std::string const& name);
+	//Adds the key pair loaded by an asynchronous load()
+	v8::Local<v8::Object> loadedKeyPair(std::map<std::string, std::string>* loaded);
+
+	//JS Methods
+	static v8::Handle<v8::Value> New(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Decrypt(const v8::Arguments& args);
+	static v8::Handle<v8::Value> DecryptBatch(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Sign(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SignBatch(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Agree(const v8::Arguments& args);
+	static v8::Handle<v8::Value> OpenSession(const v8::Arguments& args);
+	static v8::Handle<v8::Value> PublicKeyInfo(const v8::Arguments& args);
+	static v8::Handle<v8::Value> CreateKeyPair(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Load(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Save(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Remove(const v8::Arguments& args);
+	static v8::Handle<v8::Value> KeyIds(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Size(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Clear(const v8::Arguments& args);
+	static v8::Handle<v8::Value> OpenStore(const v8::Arguments& args);
+	static v8::Handle<v8::Value> SaveStore(const v8::Arguments& args);
+	static v8::Handle<v8::Value> ShareStore(const v8::Arguments& args);
+	static v8::Handle<v8::Value> AttachStore(const v8::Arguments& args);
+	static v8::Handle<v8::Value> UnshareStore(const v8::Arguments& args);
+	static v8::Persistent<v8::Function> constructor;
+	//KeyRing's methods, run by forward()
+	static v8::Persistent<v8::Function> decryptMethod, decryptBatchMethod, signMethod, signBatchMethod, agreeMethod, openSessionMethod, createKeyPairMethod;
+};
+
+#endif
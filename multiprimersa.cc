@@ -0,0 +1,192 @@
+//Std imports
+#include <string>
+#include <vector>
+
+//Crypto++ imports
+#include <cryptopp/cryptlib.h>
+using CryptoPP::RandomNumberGenerator;
+using CryptoPP::InvalidArgument;
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+using CryptoPP::a_exp_b_mod_c;
+
+#include <cryptopp/nbtheory.h>
+using CryptoPP::PrimeSelector;
+using CryptoPP::RelativelyPrime;
+using CryptoPP::VerifyPrime;
+using CryptoPP::LCM;
+
+#include <cryptopp/modarith.h>
+using CryptoPP::ModularArithmetic;
+
+#include <cryptopp/algparam.h>
+using CryptoPP::MakeParameters;
+#include <cryptopp/argnames.h>
+
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+//Class header
+#include "multiprimersa.h"
+
+using namespace std;
+
+//Same as Crypto++'s (private) RSAPrimeSelector : r - 1 must be coprime with the public exponent
+class MultiPrimeSelector : public PrimeSelector {
+public:
+	MultiPrimeSelector(Integer const& e) : e_(e){}
+	bool IsAcceptable(Integer const& candidate) const { return RelativelyPrime(e_, candidate - Integer::One()); }
+private:
+	Integer e_;
+};
+
+static Integer randomPrime(RandomNumberGenerator& rng, Integer const& min, Integer const& max, MultiPrimeSelector const& selector){
+	Integer prime;
+	prime.GenerateRandom(rng, MakeParameters("RandomNumberType", Integer::PRIME)("Min", min)("Max", max)(CryptoPP::Name::PointerToPrimeSelector(), selector.GetSelectorPointer()));
+	return prime;
+}
+
+unsigned int InvertibleMultiPrimeRSAFunction::MaxPrimes(unsigned int modulusBits){
+	if (modulusBits < 1024) return 2;
+	if (modulusBits < 4096) return 3;
+	if (modulusBits < 8192) return 4;
+	return 5;
+}
+
+void InvertibleMultiPrimeRSAFunction::GenerateRandomWithPrimes(RandomNumberGenerator& rng, unsigned int modulusBits, unsigned int primeCount){
+	if (primeCount < 2 || primeCount > MaxPrimes(modulusBits)) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: invalid number of primes for this modulus size");
+	if (primeCount == 2){
+		primes_.clear();
+		exponents_.clear();
+		coefficients_.clear();
+		GenerateRandomWithKeySize(rng, modulusBits);
+		return;
+	}
+	const Integer e(17);
+	MultiPrimeSelector selector(e);
+	//The first primes have primeBits bits and their two top bits set (as Crypto++ does for two primes); the last one is picked so that n has exactly modulusBits bits
+	const unsigned int primeBits = modulusBits / primeCount;
+	vector<Integer> primes;
+	Integer n;
+	bool distinct;
+	do {
+		primes.clear();
+		n = Integer::One();
+		for (unsigned int i = 0; i < primeCount - 1; i++){
+			primes.push_back(randomPrime(rng, Integer(182) << (primeBits - 8), Integer::Power2(primeBits) - Integer::One(), selector));
+			n *= primes.back();
+		}
+		const Integer min = (Integer::Power2(modulusBits - 1) + n - Integer::One()) / n, max = (Integer::Power2(modulusBits) - Integer::One()) / n;
+		primes.push_back(randomPrime(rng, min, max, selector));
+		n *= primes.back();
+		distinct = true;
+		for (size_t i = 0; i < primes.size(); i++){
+			for (size_t j = i + 1; j < primes.size(); j++) distinct = distinct && primes[i] != primes[j];
+		}
+	} while (!distinct);
+	Integer lambda = Integer::One();
+	for (size_t i = 0; i < primes.size(); i++) lambda = LCM(lambda, primes[i] - Integer::One());
+	setPrimes(n, e, e.InverseMod(lambda), primes);
+}
+
+void InvertibleMultiPrimeRSAFunction::Initialize(Integer const& n, Integer const& e, Integer const& d, vector<Integer> const& primes){
+	if (primes.empty()){
+		primes_.clear();
+		exponents_.clear();
+		coefficients_.clear();
+		InvertibleRSAFunction::Initialize(n, e, d);
+		return;
+	}
+	if (primes.size() < 2) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: at least two primes are needed");
+	Integer product = Integer::One();
+	for (size_t i = 0; i < primes.size(); i++){
+		if (primes[i] <= Integer::One()) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: invalid prime");
+		product *= primes[i];
+	}
+	if (product != n) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: the primes aren't the factors of the modulus");
+	setPrimes(n, e, d, primes);
+}
+
+void InvertibleMultiPrimeRSAFunction::setPrimes(Integer const& n, Integer const& e, Integer const& d, vector<Integer> const& primes){
+	primes_ = primes;
+	exponents_.clear();
+	coefficients_.clear();
+	Integer product = Integer::One();
+	for (size_t i = 0; i < primes.size(); i++){
+		exponents_.push_back(d % (primes[i] - Integer::One()));
+		coefficients_.push_back(i == 0 ? Integer::Zero() : product.InverseMod(primes[i]));
+		if (i > 0 && coefficients_.back().IsZero()) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: the primes must be distinct");
+		if ((e * exponents_.back()) % (primes[i] - Integer::One()) != Integer::One()) throw InvalidArgument("InvertibleMultiPrimeRSAFunction: the private exponent doesn't match the primes");
+		product *= primes[i];
+	}
+	//The first two primes are handed to InvertibleRSAFunction as p and q, for its getters
+	InvertibleRSAFunction::Initialize(n, e, d, primes[0], primes[1], exponents_[0], exponents_[1], primes[1].InverseMod(primes[0]));
+}
+
+/*
+* Same blinding and final check as InvertibleRSAFunction::CalculateInverse; the CRT recombination is Garner's algorithm (RFC 8017, section 5.1.2) :
+* y is built modulo r_1, then r_1 * r_2, ..., then n
+*/
+Integer InvertibleMultiPrimeRSAFunction::CalculateInverse(RandomNumberGenerator& rng, Integer const& x) const {
+	if (primes_.size() <= 2) return InvertibleRSAFunction::CalculateInverse(rng, x);
+	DoQuickSanityCheck();
+	ModularArithmetic modn(m_n);
+	Integer r, rInv;
+	do {
+		r.Randomize(rng, Integer::One(), m_n - Integer::One());
+		rInv = modn.MultiplicativeInverse(r);
+	} while (rInv.IsZero());
+	Integer re = modn.Exponentiate(r, m_e);
+	re = modn.Multiply(re, x);
+	Integer y = a_exp_b_mod_c(re % primes_[0], exponents_[0], primes_[0]);
+	Integer product = primes_[0];
+	for (size_t i = 1; i < primes_.size(); i++){
+		const Integer yi = a_exp_b_mod_c(re % primes_[i], exponents_[i], primes_[i]);
+		//Integer's % is never negative
+		y += product * ((coefficients_[i] * (yi - y % primes_[i])) % primes_[i]);
+		product *= primes_[i];
+	}
+	y = modn.Multiply(y, rInv);
+	if (modn.Exponentiate(y, m_e) != x) throw CryptoPP::Exception(CryptoPP::Exception::OTHER_ERROR, "InvertibleMultiPrimeRSAFunction: computational error during private key operation");
+	return y;
+}
+
+bool InvertibleMultiPrimeRSAFunction::Validate(RandomNumberGenerator& rng, unsigned int level) const {
+	if (primes_.size() <= 2) return InvertibleRSAFunction::Validate(rng, level);
+	bool pass = RSAFunction::Validate(rng, level);
+	pass = pass && m_d > Integer::One() && m_d.IsOdd() && m_d < m_n;
+	Integer product = Integer::One();
+	for (size_t i = 0; i < primes_.size() && pass; i++){
+		const Integer& prime = primes_[i];
+		pass = pass && prime > Integer::One() && prime.IsOdd() && prime < m_n;
+		pass = pass && exponents_[i].IsPositive() && exponents_[i] < prime;
+		if (level >= 1){
+			pass = pass && (m_e * exponents_[i]) % (prime - Integer::One()) == Integer::One();
+			pass = pass && (i == 0 || (coefficients_[i] * product) % prime == Integer::One());
+		}
+		if (level >= 2) pass = pass && VerifyPrime(rng, prime, level - 2);
+		product *= prime;
+	}
+	if (level >= 1) pass = pass && product == m_n;
+	return pass;
+}
+
+void MultiPrimeRSA_DecryptBatch(MultiPrimeRSAES_OAEP_SHA_Decryptor const& decryptor, vector<string> const& cipherTexts, vector<string>& plainTexts, vector<string>& errors, size_t first, size_t count){
+	AutoSeededRandomPool prng;
+	const size_t cipherTextLength = decryptor.FixedCiphertextLength();
+	CryptoPP::SecByteBlock plainText(decryptor.FixedMaxPlaintextLength());
+	for (size_t i = first; i < first + count && i < cipherTexts.size(); i++){
+		if (cipherTexts[i].size() != cipherTextLength){
+			errors[i] = "Invalid ciphertext length";
+			continue;
+		}
+		try {
+			const CryptoPP::DecodingResult decoded = decryptor.Decrypt(prng, (const byte*) cipherTexts[i].data(), cipherTexts[i].size(), plainText.BytePtr());
+			if (decoded.isValidCoding) plainTexts[i] = string((const char*) plainText.BytePtr(), decoded.messageLength);
+			else errors[i] = "Invalid ciphertext";
+		} catch (CryptoPP::Exception const& e){
+			errors[i] = e.what();
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef MULTIPRIMERSA_H
+#define MULTIPRIMERSA_H
+
+#include <string>
+#include <vector>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/rsa.h>
+#include <cryptopp/oaep.h>
+#include <cryptopp/pssr.h>
+#include <cryptopp/sha.h>
+
+/*
+* Multi-prime RSA (RFC 8017, section 3.2) : the modulus is the product of u >= 2 distinct primes r_1, ..., r_u, and the private key operation
+* is done with the CRT over every prime. Exponentiations modulo primes of n/u bits cost about u^2 times less than modulo two primes of n/2 bits each,
+* so a 4096-bit private operation gets roughly 2.25 times faster with 3 primes and 4 times faster with 4 primes.
+* The public key (modulus, public exponent) is an ordinary RSA public key : ciphertexts and signatures are interchangeable with two-prime keys.
+*
+* When no prime is given, InvertibleMultiPrimeRSAFunction behaves exactly like Crypto++'s InvertibleRSAFunction (the two primes being recovered
+* from the private exponent), so the schemes below can be used for every RSA key.
+*/
+class InvertibleMultiPrimeRSAFunction : public CryptoPP::InvertibleRSAFunction {
+public:
+	//Largest number of primes accepted for a given modulus size, as in OpenSSL : 2 below 1024 bits, 3 below 4096 bits, 4 below 8192 bits, 5 otherwise
+	static unsigned int MaxPrimes(unsigned int modulusBits);
+
+	//Generates a key pair with primeCount primes of about the same size and the public exponent 17 (as InvertibleRSAFunction::GenerateRandomWithKeySize)
+	void GenerateRandomWithPrimes(CryptoPP::RandomNumberGenerator& rng, unsigned int modulusBits, unsigned int primeCount);
+	/*
+	* primes : every prime factor of n, or none (two-prime key, factored from d). Throws a CryptoPP::InvalidArgument if the primes aren't
+	* a factorization of n matching e and d
+	*/
+	void Initialize(Integer const& n, Integer const& e, Integer const& d, std::vector<Integer> const& primes);
+	using CryptoPP::InvertibleRSAFunction::Initialize;
+
+	//Every prime of the key, r_1 and r_2 included. Empty for keys initialized without their primes
+	std::vector<Integer> const& GetPrimes() const { return primes_; }
+
+	Integer CalculateInverse(CryptoPP::RandomNumberGenerator& rng, Integer const& x) const;
+	bool Validate(CryptoPP::RandomNumberGenerator& rng, unsigned int level) const;
+
+private:
+	//r_1 ... r_u, d_i = d mod (r_i - 1), and t_i = (r_1 * ... * r_(i-1))^-1 mod r_i (t_1 is unused)
+	std::vector<Integer> primes_, exponents_, coefficients_;
+	void setPrimes(Integer const& n, Integer const& e, Integer const& d, std::vector<Integer> const& primes);
+};
+
+//Key types for Crypto++'s trapdoor function schemes, the private key being an InvertibleMultiPrimeRSAFunction
+struct MultiPrimeRSA {
+	static std::string StaticAlgorithmName() { return "RSA"; }
+	typedef CryptoPP::RSAFunction PublicKey;
+	typedef InvertibleMultiPrimeRSAFunction PrivateKey;
+};
+
+//Drop-in replacements for RSAES_OAEP_SHA_Decryptor and RSASS<PSS, H>::Signer
+typedef CryptoPP::TF_ES<CryptoPP::OAEP<CryptoPP::SHA1>, MultiPrimeRSA>::Decryptor MultiPrimeRSAES_OAEP_SHA_Decryptor;
+template <class H>
+struct MultiPrimeRSASS_PSS {
+	typedef typename CryptoPP::TF_SS<CryptoPP::PSS, H, MultiPrimeRSA>::Signer Signer;
+};
+
+/*
+* OAEP decryption of cipherTexts[first] to cipherTexts[first + count - 1], with a decryptor shared between threads (its key is only read).
+* plainTexts[i] receives the plaintext; when a ciphertext can't be decrypted, plainTexts[i] is left empty and errors[i] gets the reason.
+* Each call has its own random generator (for the blinding), so calls on different ranges can run at the same time
+*/
+void MultiPrimeRSA_DecryptBatch(MultiPrimeRSAES_OAEP_SHA_Decryptor const& decryptor, std::vector<std::string> const& cipherTexts, std::vector<std::string>& plainTexts, std::vector<std::string>& errors, size_t first, size_t count);
+
+#endif
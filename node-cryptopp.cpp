@@ -8,15 +8,65 @@ Written by the Syrian watermelon
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <exception>
 
 #include <v8.h>
 #include <node.h>
+#include <node_buffer.h>
+#include <uv.h>
 
 //Loading the KeyRing class
 #include "keyring.h"
 
+//Key ring with many key pairs, looked up by key ID
+#include "multikeyring.h"
+
+//Deterministic ECDSA nonces
+#include "rfc6979.h"
+
+//Batched ECDSA signatures
+#include "ecbatch.h"
+
+//Dedicated secp256r1 and secp256k1 implementations
+#include "fastec.h"
+
+//Binary curves arithmetic (sect* curves)
+#include "fastec2n.h"
+
+//X-only ECDH on prime curves
+#include "ecladder.h"
+
+//X25519 and Ed25519
+#include "curve25519.h"
+
+//Authenticated symmetric encryption (cryptopp.aead)
+#include "aead.h"
+
+//ECIES with ChaCha20-Poly1305
+#include "eciesaead.h"
+
+//Key derivation functions (cryptopp.kdf)
+#include "kdf.h"
+//Key-encryption key cache for encrypted key files (cryptopp.kekCache)
+#include "kekcache.h"
+
+//Multi-prime RSA
+#include "multiprimersa.h"
+
+//SEC1 point encodings
+#include "ecpoint.h"
+
+//Number of jobs for the work split over the thread pool
+#include "threadpool.h"
+
+//mlock'ed per-thread arena for secret scratch buffers
+#include "secarena.h"
+
+//randomBytes and randomFill
+#include "random.h"
+
 //Importing AES
 #include <cryptopp/aes.h>
 using CryptoPP::AES;
@@ -134,30 +184,30 @@ std::string strHexDecode(std::string const& e){
 }
 
 std::string IntegerToHexStr(CryptoPP::Integer const& i){
-    byte bigEndian[i.MinEncodedSize()];
-    i.Encode(bigEndian, sizeof(bigEndian));
-    return bufferHexEncode(bigEndian, sizeof(bigEndian));
+    ArenaByteBlock bigEndian(i.MinEncodedSize());
+    i.Encode(bigEndian, bigEndian.size());
+    return bufferHexEncode(bigEndian, bigEndian.size());
 }
 
 CryptoPP::Integer HexStrToInteger(std::string const& hexStr){
-    byte buffer[hexStr.size() / 2];
-    bufferHexDecode(hexStr, buffer, sizeof(buffer));
+    ArenaByteBlock buffer(hexStr.size() / 2);
+    bufferHexDecode(hexStr, buffer, buffer.size());
     CryptoPP::Integer i;
-    i.Decode(buffer, sizeof(buffer));
+    i.Decode(buffer, buffer.size());
     return i;
 }
 
 std::string PolynomialMod2ToHexStr(CryptoPP::PolynomialMod2 const& i){
-    byte bigEndian[i.MinEncodedSize()];
-    i.Encode(bigEndian, sizeof(bigEndian));
-    return bufferHexEncode(bigEndian, sizeof(bigEndian));
+    ArenaByteBlock bigEndian(i.MinEncodedSize());
+    i.Encode(bigEndian, bigEndian.size());
+    return bufferHexEncode(bigEndian, bigEndian.size());
 }
 
 CryptoPP::PolynomialMod2 HexStrToPolynomialMod2(std::string const& hexStr){
-    byte buffer[hexStr.size() / 2];
-    bufferHexDecode(hexStr, buffer, sizeof(buffer));
+    ArenaByteBlock buffer(hexStr.size() / 2);
+    bufferHexDecode(hexStr, buffer, buffer.size());
     CryptoPP::PolynomialMod2 i;
-    i.Decode(buffer, sizeof(buffer));
+    i.Decode(buffer, buffer.size());
     return i;
 }
 
@@ -199,10 +249,9 @@ std::string strBase64Decode(std::string const& e){
 }
 
 std::string IntegerToBase64Str(CryptoPP::Integer const& i){
-    byte bigEndian[i.MinEncodedSize()];
-    std::cout << "Buffer size on encoding : " << sizeof(bigEndian) << std::endl;
-    i.Encode(bigEndian, sizeof(bigEndian));
-    return bufferBase64Encode(bigEndian, sizeof(bigEndian));
+    ArenaByteBlock bigEndian(i.MinEncodedSize());
+    i.Encode(bigEndian, bigEndian.size());
+    return bufferBase64Encode(bigEndian, bigEndian.size());
 }
 
 // Finally functional
@@ -217,11 +266,11 @@ CryptoPP::Integer Base64StrToInteger(std::string const& base64Str){
     //std::cout << "Padding length : " << base64Padding << std::endl;
     int bufferSize = (int)((3.0/4) * base64Str.length() - base64Padding);
     //std::cout << "Buffer size : " << bufferSize << std::endl;
-    byte buffer[bufferSize];
-    //std::cout << "Buffer size on decoding : " << sizeof(buffer) << std::endl;
-    bufferBase64Decode(base64Str, buffer, sizeof(buffer));
+    ArenaByteBlock buffer(bufferSize > 0 ? bufferSize : 0);
+    //std::cout << "Buffer size on decoding : " << buffer.size() << std::endl;
+    bufferBase64Decode(base64Str, buffer, buffer.size());
     CryptoPP::Integer i;
-    i.Decode(buffer, sizeof(buffer));
+    i.Decode(buffer, buffer.size());
     return i;
 }
 
@@ -273,47 +322,6 @@ Handle<Value> base64Decode(const Arguments& args){
     }
 }
 
-/*
-* Generation of batikh
-*/
-
-Handle<Value> randomBytes(const Arguments& args){
-    HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
-        try {
-            std::string encoding = "hex";
-            if (args.Length() == 2){
-                String::AsciiValue encodingVal(args[1]->ToString());
-                std::string encodingInput(*encodingVal);
-                if (encodingInput == "hex" || encodingInput == "base64"){
-                    encoding = encodingInput;
-                } else {
-                    ThrowException(v8::Exception::TypeError(String::New("When used, the \"encoding\" parameters must either be \"hex\" for hexadecimal or \"base64\" for Base64 encoding")));
-                    return scope.Close(Undefined());
-                }
-            }
-            Local<v8::Integer> numBytesVal = Local<v8::Integer>::Cast(args[0]);
-            unsigned int numBytes = numBytesVal->Value();
-            byte randomBytes[numBytes];
-            AutoSeededRandomPool prng;
-            prng.GenerateBlock(randomBytes, sizeof(randomBytes));
-            std::string randomString = "";
-            if (encoding == "hex"){
-                randomString = bufferHexEncode(randomBytes, sizeof(randomBytes));
-            } else {
-                randomString = bufferBase64Encode(randomBytes, sizeof(randomBytes));
-            }
-            return scope.Close(String::New(randomString.c_str()));
-        } catch (CryptoPP::Exception& e){
-            ThrowException(v8::Exception::Error(String::New(e.what())));
-            return scope.Close(Undefined());
-        }
-    } else {
-        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters. generateBytes methods takes only the number of bytes to be generated.")));
-        return scope.Close(Undefined());
-    }
-}
-
 /*
 *  ECIES key generation, encryption, decryption
 */
@@ -392,11 +400,75 @@ OID getBCurveFromName(std::string curveName){
     } else ThrowException(v8::Exception::TypeError(String::New("Invalid binary curve name")));
 }
 
-// Method signature : ecies.prime.generateKeyPair(curveName, [callback(keyPair)]); returns keyPair object if callback == undefined
+/*
+* EC public keys : either {x, y} objects (hex encoded coordinates), or hex encoded SEC1 points, compressed (02 or 03 || x) or not (04 || x || y).
+* See ecpoint.h; decompressed points are cached
+*/
+
+//Returns false if publicKeyVal is neither an {x, y} object nor an encoded point of the curve. The coordinates of {x, y} objects aren't checked here
+bool getPublicPointP(Local<Value> publicKeyVal, OID const& curve, ECPPoint& point){
+    if (publicKeyVal->IsString()){
+        String::AsciiValue encodedVal(publicKeyVal);
+        return ECPoint_DecodeP(curve, strHexDecode(std::string(*encodedVal)), point);
+    }
+    if (!publicKeyVal->IsObject()) return false;
+    Local<Object> publicKeyObj = publicKeyVal->ToObject();
+    if (!(publicKeyObj->Has(String::NewSymbol("x")) && publicKeyObj->Has(String::NewSymbol("y")))) return false;
+    String::AsciiValue xVal(publicKeyObj->Get(String::NewSymbol("x"))->ToString()), yVal(publicKeyObj->Get(String::NewSymbol("y"))->ToString());
+    point = ECPPoint(HexStrToInteger(*xVal), HexStrToInteger(*yVal));
+    return true;
+}
+
+bool getPublicPointB(Local<Value> publicKeyVal, OID const& curve, EC2NPoint& point){
+    if (publicKeyVal->IsString()){
+        String::AsciiValue encodedVal(publicKeyVal);
+        return ECPoint_DecodeB(curve, strHexDecode(std::string(*encodedVal)), point);
+    }
+    if (!publicKeyVal->IsObject()) return false;
+    Local<Object> publicKeyObj = publicKeyVal->ToObject();
+    if (!(publicKeyObj->Has(String::NewSymbol("x")) && publicKeyObj->Has(String::NewSymbol("y")))) return false;
+    String::AsciiValue xVal(publicKeyObj->Get(String::NewSymbol("x"))->ToString()), yVal(publicKeyObj->Get(String::NewSymbol("y"))->ToString());
+    point = EC2NPoint(HexStrToPolynomialMod2(*xVal), HexStrToPolynomialMod2(*yVal));
+    return true;
+}
+
+//The hex encoded compressed point, or an {x, y} object
+Local<Value> publicPointValueP(OID const& curve, ECPPoint const& point, bool compressed){
+    if (compressed) return String::New(strHexEncode(ECPoint_EncodeP(curve, point, true)).c_str());
+    Local<Object> publicKeyObj = Object::New();
+    publicKeyObj->Set(String::NewSymbol("x"), String::New(IntegerToHexStr(point.x).c_str()));
+    publicKeyObj->Set(String::NewSymbol("y"), String::New(IntegerToHexStr(point.y).c_str()));
+    return publicKeyObj;
+}
+
+Local<Value> publicPointValueB(OID const& curve, EC2NPoint const& point, bool compressed){
+    if (compressed) return String::New(strHexEncode(ECPoint_EncodeB(curve, point, true)).c_str());
+    Local<Object> publicKeyObj = Object::New();
+    publicKeyObj->Set(String::NewSymbol("x"), String::New(PolynomialMod2ToHexStr(point.x).c_str()));
+    publicKeyObj->Set(String::NewSymbol("y"), String::New(PolynomialMod2ToHexStr(point.y).c_str()));
+    return publicKeyObj;
+}
+
+//EC generateKeyPair(curveName, [options], [callback]) methods : options is {compressed : boolean}. Returns the index of the callback parameter, or -1 after throwing a TypeError
+int keyPairOptions(const Arguments& args, bool& compressed){
+    compressed = false;
+    if (args.Length() < 2 || args[1]->IsFunction() || args[1]->IsUndefined()) return 1;
+    if (!args[1]->IsObject()){
+        ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+        return -1;
+    }
+    compressed = args[1]->ToObject()->Get(String::NewSymbol("compressed"))->BooleanValue();
+    return 2;
+}
+
+// Method signature : ecies.prime.generateKeyPair(curveName, [options], [callback(keyPair)]); returns keyPair object if callback == undefined. options is {compressed}, compressed giving the public key as a hex encoded compressed point
 Handle<Value> eciesGenerateKeyPairP(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             String::Utf8Value curveVal(args[0]->ToString());
             std::string curveName(*curveVal);
             Local<Value> result = Local<Value>::New(Undefined());
@@ -411,16 +483,13 @@ Handle<Value> eciesGenerateKeyPairP(const Arguments& args){
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(IntegerToHexStr(privateKey).c_str()));
-            Local<Object> publicKeyObj = Object::New();
-            publicKeyObj->Set(String::NewSymbol("x"), String::New(IntegerToHexStr(publicKey.x).c_str()));
-            publicKeyObj->Set(String::NewSymbol("y"), String::New(IntegerToHexStr(publicKey.y).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), publicKeyObj);
+            keyPair->Set(String::NewSymbol("publicKey"), publicPointValueP(curve, publicKey, compressed));
             result = keyPair;
             //Returning the result
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -447,35 +516,39 @@ Handle<Value> eciesGenerateKeyPairP(const Arguments& args){
         const ECPPoint publicKey = bpc.Exponentiate(params.GetGroupPrecomputation(), d.GetKey().GetPrivateExponent());
 }*/
 
-//Method signature : ecies.binary.generateKeyPair(curveName, [callback(keyPair)]); returns keyPair objec if callback == undefined
+//Method signature : ecies.binary.generateKeyPair(curveName, [options], [callback(keyPair)]); returns keyPair objec if callback == undefined. options : same as ecies.prime.generateKeyPair
 Handle<Value> eciesGenerateKeyPairB(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             String::Utf8Value curveVal(args[0]->ToString());
             std::string curveName(*curveVal);
             Local<Value> result = Local<Value>::New(Undefined());
             OID curve = getBCurveFromName(curveName);
-            //Initializing decryptor
+            //Generating the key pair, with Crypto++'s decryptor if the curve has no fast implementation
             AutoSeededRandomPool prng;
-            ECIES<EC2N>::Decryptor d(prng, curve);
-            CryptoPP::Integer privateKey = d.GetKey().GetPrivateExponent();
-            const DL_GroupParameters_EC<EC2N>& params = d.GetKey().GetGroupParameters();
-            const DL_FixedBasePrecomputation<EC2NPoint>& bpc = params.GetBasePrecomputation();
-            const EC2NPoint publicKey = bpc.Exponentiate(params.GetGroupPrecomputation(), d.GetKey().GetPrivateExponent());
+            CryptoPP::Integer privateKey;
+            EC2NPoint publicKey;
+            if (!FastEC_GenerateKeyPair(FastEC2N::For(curve), prng, privateKey, publicKey)){
+                ECIES<EC2N>::Decryptor d(prng, curve);
+                privateKey = d.GetKey().GetPrivateExponent();
+                const DL_GroupParameters_EC<EC2N>& params = d.GetKey().GetGroupParameters();
+                const DL_FixedBasePrecomputation<EC2NPoint>& bpc = params.GetBasePrecomputation();
+                publicKey = bpc.Exponentiate(params.GetGroupPrecomputation(), d.GetKey().GetPrivateExponent());
+            }
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(IntegerToHexStr(privateKey).c_str()));
-            Local<Object> publicKeyObj = Object::New();
-            publicKeyObj->Set(String::NewSymbol("x"), String::New(PolynomialMod2ToHexStr(publicKey.x).c_str()));
-            publicKeyObj->Set(String::NewSymbol("y"), String::New(PolynomialMod2ToHexStr(publicKey.y).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), publicKeyObj);
+            keyPair->Set(String::NewSymbol("publicKey"), publicPointValueB(curve, publicKey, compressed));
             result = keyPair;
             //Returning the result
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -491,39 +564,65 @@ Handle<Value> eciesGenerateKeyPairB(const Arguments& args){
     }
 }
 
-//Method signature : ecies.prime.encrypt(plainText, publicKey, curveName, [callback(cipherText)]); returns cipherText if callback == undefined
+//Method signature : ecies.prime.encrypt(plainText, publicKey, curveName, [options], [callback(cipherText)]); returns cipherText if callback == undefined
+//publicKey is an {x, y} object or a hex encoded point. options is an object with the optional attributes dem : "xor-hmac" (default, Crypto++'s ECIES) or "chacha20-poly1305",
+//and compressed : whether the ephemeral point of "xor-hmac" ciphertexts is compressed (it always is with "chacha20-poly1305")
 Handle<Value> eciesEncryptP(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 3 || args.Length() == 4){
+    if (args.Length() >= 3 && args.Length() <= 5){
         try {
             //Casting arguments
             String::Utf8Value plainTextVal(args[0]->ToString());
             String::AsciiValue curveNameVal(args[2]->ToString());
-            std::string plainText(*plainTextVal), curveName(*curveNameVal), cipherText;
-            Local<Object> publicKeyObj = Local<Object>::Cast(args[1]);
+            std::string plainText(*plainTextVal), curveName(*curveNameVal), cipherText, dem = "xor-hmac";
+            bool compressed = false;
+            //The callback used to be the 4th parameter, before options were added
+            int callbackIndex = 4;
+            if (args.Length() >= 4 && args[3]->IsFunction()){
+                callbackIndex = 3;
+            } else if (args.Length() >= 4 && args[3]->IsObject()){
+                Local<Value> demVal = Local<Object>::Cast(args[3])->Get(String::NewSymbol("dem"));
+                if (!demVal->IsUndefined()){
+                    String::AsciiValue demStr(demVal->ToString());
+                    dem = std::string(*demStr);
+                }
+                compressed = Local<Object>::Cast(args[3])->Get(String::NewSymbol("compressed"))->BooleanValue();
+            } else if (args.Length() >= 4 && !args[3]->IsUndefined()){
+                ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+                return scope.Close(Undefined());
+            }
+            if (!(dem == "xor-hmac" || dem == "chacha20-poly1305")){
+                ThrowException(v8::Exception::TypeError(String::New("Unknown DEM. Possible values are \"xor-hmac\" and \"chacha20-poly1305\"")));
+                return scope.Close(Undefined());
+            }
             Local<Value> result = Local<Value>::New(Undefined());
             OID curve = getPCurveFromName(curveName);
             //Casting the public key and encrypting the plaintext
-            if (!(publicKeyObj->Has(String::New("x")) && publicKeyObj->Has(String::New("y")))) {
+            ECPPoint publicKey;
+            if (!getPublicPointP(args[1], curve, publicKey)){
                 ThrowException(v8::Exception::TypeError(String::New("Invalid public key object")));
                 return scope.Close(Local<Value>::New(Undefined()));
             }
             AutoSeededRandomPool prng;
             ECIES<ECP>::Encryptor e;
-            Local<String> xVal, yVal;
-            xVal = Local<String>::Cast(publicKeyObj->Get(String::New("x")));
-            yVal = Local<String>::Cast(publicKeyObj->Get(String::New("y")));
-            const ECPPoint publicKey(HexStrToInteger(*(String::AsciiValue(xVal))), HexStrToInteger(*(String::AsciiValue(yVal))));
-            e.AccessKey().AccessGroupParameters().Initialize(curve);
-            e.AccessKey().SetPublicElement(publicKey);
-            StringSource(plainText, true, new PK_EncryptorFilter(prng, e, new StringSink(cipherText)));
+            if (dem == "chacha20-poly1305"){
+                if (!ECIES_AEADEncrypt(curve, prng, publicKey, plainText, cipherText)){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid public key")));
+                    return scope.Close(Undefined());
+                }
+            } else if (!FastECIES_Encrypt(FastEC::For(curve), prng, publicKey, plainText, cipherText)){
+                e.AccessKey().AccessGroupParameters().Initialize(curve);
+                e.AccessKey().SetPublicElement(publicKey);
+                StringSource(plainText, true, new PK_EncryptorFilter(prng, e, new StringSink(cipherText)));
+            }
+            if (compressed && dem == "xor-hmac") ECPoint_CompressPrefixP(curve, cipherText);
             cipherText = strHexEncode(cipherText);
             result = String::New(cipherText.c_str());
             //Returning the result
-            if (args.Length() == 3){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[3]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -540,6 +639,8 @@ Handle<Value> eciesEncryptP(const Arguments& args){
 }
 
 //Method signature : ecies.prime.decrypt(cipherText, privateKey, curveName, [callback(plainText)]); return plainText if callback == undefined
+//Both DEMs are accepted, and so are the envelopes of ecies.prime.encryptMulti. ChaCha20-Poly1305 ciphertexts start with a compressed point, as do
+//"xor-hmac" ciphertexts encrypted with the compressed option : these are tried as the latter when they don't authenticate as the former
 Handle<Value> eciesDecryptP(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
@@ -553,15 +654,29 @@ Handle<Value> eciesDecryptP(const Arguments& args){
             OID curve = getPCurveFromName(curveName);
             //Decrypting
             AutoSeededRandomPool prng;
-            ECIES<ECP>::Decryptor d;
-            d.AccessKey().AccessGroupParameters().Initialize(curve);
-            d.AccessKey().SetPrivateExponent(privateKey);
-            try {
-                StringSource(cipherText, true, new PK_DecryptorFilter(prng, d, new StringSink(plainText)));
-            } catch (CryptoPP::Exception const& ex){
-                std::cerr << "Exception : " << std::endl << ex.what() << std::endl;
-                std::cerr << "Error type : " << ex.GetErrorType() << std::endl;
-                std::cerr << "What : " << ex.GetWhat() << std::endl;
+            //Invalid ciphertexts are left to Crypto++, so that they are reported the same way on every curve
+            //A compressed ephemeral point : ChaCha20-Poly1305, or else "xor-hmac" once the point is decompressed
+            bool done = false;
+            if (ECIES_IsAEADCipherText(cipherText)){
+                done = ECIES_AEADDecrypt(curve, privateKey, cipherText, plainText);
+                if (!done && !ECPoint_DecompressPrefixP(curve, cipherText)){
+                    std::cerr << "Invalid ECIES ciphertext" << std::endl;
+                    done = true;
+                }
+            }
+            if (!done && ECIES_IsMultiCipherText(cipherText)){
+                if (!ECIES_MultiDecrypt(curve, privateKey, cipherText, plainText)) std::cerr << "Invalid ECIES envelope" << std::endl;
+            } else if (!done && !FastECIES_Decrypt(FastEC::For(curve), privateKey, cipherText, plainText)){
+                ECIES<ECP>::Decryptor d;
+                d.AccessKey().AccessGroupParameters().Initialize(curve);
+                d.AccessKey().SetPrivateExponent(privateKey);
+                try {
+                    StringSource(cipherText, true, new PK_DecryptorFilter(prng, d, new StringSink(plainText)));
+                } catch (CryptoPP::Exception const& ex){
+                    std::cerr << "Exception : " << std::endl << ex.what() << std::endl;
+                    std::cerr << "Error type : " << ex.GetErrorType() << std::endl;
+                    std::cerr << "What : " << ex.GetWhat() << std::endl;
+                }
             }
             result = String::New(plainText.c_str());
             //Returning the result
@@ -584,39 +699,166 @@ Handle<Value> eciesDecryptP(const Arguments& args){
     }
 }
 
-//Method signature ecies.binary.encrypt(plainText, publicKey, curveName, [callback(cipherText)]); returns cipherText if no callback is given
-Handle<Value> eciesEncryptB(const Arguments& args){
+/*
+* Multi-recipient encryption on the thread pool : the recipients are split evenly into jobs wrapping the data key, the first job also encrypting the message
+*/
+struct EciesMultiTask {
+    EciesMultiTask(OID const& curve, RandomNumberGenerator& rng, std::vector<ECPPoint> const& recipients, std::string const& plainText) : encryption(curve, rng, recipients, plainText), valid(true){}
+    ECIESMultiEncryption encryption;
+    //Jobs not done yet. valid is only cleared by the jobs, and read once they are all done
+    size_t pending;
+    bool valid;
+    Persistent<Function> callback;
+};
+
+struct EciesMultiJob {
+    uv_work_t request;
+    EciesMultiTask* task;
+    size_t first, count;
+    bool valid;
+};
+
+static void EciesMultiWork(uv_work_t* req){
+    EciesMultiJob* job = static_cast<EciesMultiJob*>(req->data);
+    if (job->first == 0) job->task->encryption.EncryptPayload();
+    job->valid = job->task->encryption.Wrap(job->first, job->count);
+}
+
+//Back on the main thread. The last job to finish calls the callback, with (null, error) if a key couldn't be wrapped
+static void EciesMultiDone(uv_work_t* req, int status){
+    HandleScope scope;
+    EciesMultiJob* job = static_cast<EciesMultiJob*>(req->data);
+    EciesMultiTask* task = job->task;
+    task->valid = task->valid && job->valid;
+    delete job;
+    if (--task->pending > 0) return;
+    Local<Function> callback = Local<Function>::New(task->callback);
+    const unsigned argc = 2;
+    Local<Value> argv[argc];
+    if (task->valid){
+        argv[0] = String::New(strHexEncode(task->encryption.Envelope()).c_str());
+        argv[1] = Local<Value>::New(Null());
+    } else {
+        argv[0] = Local<Value>::New(Null());
+        argv[1] = v8::Exception::Error(String::New("Invalid public key"));
+    }
+    task->callback.Dispose();
+    delete task;
+    node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+//Method signature : ecies.prime.encryptMulti(plainText, publicKeys, curveName, [callback(envelope, error)]); returns the envelope if callback == undefined
+//publicKeys is an array of {x, y} objects or hex encoded points. The message is encrypted once, and its key wrapped for each recipient (in parallel when there is a callback)
+Handle<Value> eciesEncryptMultiP(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
+        try {
+            if (!args[1]->IsArray()){
+                ThrowException(v8::Exception::TypeError(String::New("publicKeys must be an array")));
+                return scope.Close(Undefined());
+            }
+            if (args.Length() == 4 && !args[3]->IsUndefined() && !args[3]->IsFunction()){
+                ThrowException(v8::Exception::TypeError(String::New("callback must be a function")));
+                return scope.Close(Undefined());
+            }
+            //Casting arguments
+            String::Utf8Value plainTextVal(args[0]->ToString());
+            String::AsciiValue curveNameVal(args[2]->ToString());
+            std::string plainText(*plainTextVal), curveName(*curveNameVal);
+            OID curve = getPCurveFromName(curveName);
+            DL_GroupParameters_EC<ECP> params(curve);
+            //Casting the public keys. Checking they are points of the curve is cheap, and lets the error name the faulty key
+            Local<Array> publicKeysArr = Local<Array>::Cast(args[1]);
+            std::vector<ECPPoint> publicKeys;
+            for (unsigned int i = 0; i < publicKeysArr->Length(); i++){
+                ECPPoint publicKey;
+                const bool valid = getPublicPointP(publicKeysArr->Get(i), curve, publicKey) && params.GetCurve().VerifyPoint(publicKey);
+                publicKeys.push_back(publicKey);
+                if (!valid){
+                    ThrowException(v8::Exception::TypeError(String::New(("Invalid public key at index " + CryptoPP::IntToString(i)).c_str())));
+                    return scope.Close(Undefined());
+                }
+            }
+            AutoSeededRandomPool prng;
+            EciesMultiTask* task = new EciesMultiTask(curve, prng, publicKeys, plainText);
+            if (args.Length() == 3 || args[3]->IsUndefined()){
+                task->encryption.EncryptPayload();
+                const bool valid = task->encryption.Wrap(0, publicKeys.size());
+                const std::string envelope = valid ? strHexEncode(task->encryption.Envelope()) : "";
+                delete task;
+                if (!valid){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid public key")));
+                    return scope.Close(Undefined());
+                }
+                return scope.Close(String::New(envelope.c_str()));
+            }
+            task->callback = Persistent<Function>::New(Local<Function>::Cast(args[3]));
+            const size_t count = publicKeys.size(), jobs = count == 0 ? 1 : (count < ThreadPoolSize() ? count : ThreadPoolSize());
+            task->pending = jobs;
+            for (size_t i = 0, first = 0; i < jobs; i++){
+                EciesMultiJob* job = new EciesMultiJob();
+                job->request.data = job;
+                job->task = task;
+                job->first = first;
+                job->count = count / jobs + (i < count % jobs ? 1 : 0);
+                first += job->count;
+                uv_queue_work(uv_default_loop(), &job->request, EciesMultiWork, EciesMultiDone);
+            }
+            return scope.Close(Undefined());
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature ecies.binary.encrypt(plainText, publicKey, curveName, [options], [callback(cipherText)]); returns cipherText if no callback is given
+//publicKey is an {x, y} object or a hex encoded point. options is {compressed}, as in ecies.prime.encrypt
+Handle<Value> eciesEncryptB(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() >= 3 && args.Length() <= 5){
         try {
             //Casting the arguments
             String::Utf8Value plainTextVal(args[0]->ToString());
             String::AsciiValue curveNameVal(args[2]->ToString());
             std::string plainText(*plainTextVal), curveName(*curveNameVal), cipherText;
-            Local<Object> publicKeyObj = Local<Object>::Cast(args[1]);
+            bool compressed = false;
+            //The callback used to be the 4th parameter, before options were added
+            int callbackIndex = 4;
+            if (args.Length() >= 4 && args[3]->IsFunction()){
+                callbackIndex = 3;
+            } else if (args.Length() >= 4 && args[3]->IsObject()){
+                compressed = Local<Object>::Cast(args[3])->Get(String::NewSymbol("compressed"))->BooleanValue();
+            } else if (args.Length() >= 4 && !args[3]->IsUndefined()){
+                ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+                return scope.Close(Undefined());
+            }
             Local<Value> result = Local<Value>::New(Undefined());
             OID curve = getBCurveFromName(curveName);
             //Casting the public key and encrypting the plaintext
-            if (!(publicKeyObj->Has(String::New("x")) && publicKeyObj->Has(String::New("y")))) {
+            EC2NPoint publicKey;
+            if (!getPublicPointB(args[1], curve, publicKey)){
                 ThrowException(v8::Exception::TypeError(String::New("Invalid public key object")));
                 return scope.Close(Local<Value>::New(Undefined()));
             }
             AutoSeededRandomPool prng;
-            ECIES<EC2N>::Encryptor e;
-            Local<String> xVal, yVal;
-            xVal = Local<String>::Cast(publicKeyObj->Get(String::New("x")));
-            yVal = Local<String>::Cast(publicKeyObj->Get(String::New("y")));
-            const EC2NPoint publicKey(HexStrToPolynomialMod2(*(String::AsciiValue(xVal))), HexStrToPolynomialMod2(*(String::AsciiValue(yVal))));
-            e.AccessKey().AccessGroupParameters().Initialize(curve);
-            e.AccessKey().SetPublicElement(publicKey);
-            StringSource(plainText, true, new PK_EncryptorFilter(prng, e, new StringSink(cipherText)));
+            if (!FastECIES_Encrypt(FastEC2N::For(curve), prng, publicKey, plainText, cipherText)){
+                ECIES<EC2N>::Encryptor e;
+                e.AccessKey().AccessGroupParameters().Initialize(curve);
+                e.AccessKey().SetPublicElement(publicKey);
+                StringSource(plainText, true, new PK_EncryptorFilter(prng, e, new StringSink(cipherText)));
+            }
+            if (compressed) ECPoint_CompressPrefixB(curve, cipherText);
             cipherText = strHexEncode(cipherText);
             result = String::New(cipherText.c_str());
             //Returning the result
-            if (args.Length() == 3){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[3]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -632,7 +874,7 @@ Handle<Value> eciesEncryptB(const Arguments& args){
     }
 }
 
-//Method signature : ecies.binary.decrypt(cipherText, privateKey, curveName, [callback(plainText)]); return plainText if no callback is given
+//Method signature : ecies.binary.decrypt(cipherText, privateKey, curveName, [callback(plainText)]); return plainText if no callback is given. The ephemeral point can be compressed
 Handle<Value> eciesDecryptB(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
@@ -644,12 +886,15 @@ Handle<Value> eciesDecryptB(const Arguments& args){
             cipherText = strHexDecode(cipherText);
             Local<Value> result = Local<Value>::New(Undefined());
             OID curve = getBCurveFromName(curveName);
-            //Decrypting the ciphertext
-            AutoSeededRandomPool prng;
-            ECIES<EC2N>::Decryptor d;
-            d.AccessKey().AccessGroupParameters().Initialize(curve);
-            d.AccessKey().SetPrivateExponent(privateKey);
-            StringSource(cipherText, true, new PK_DecryptorFilter(prng, d, new StringSink(plainText)));
+            ECPoint_DecompressPrefixB(curve, cipherText);
+            //Decrypting the ciphertext. Invalid ciphertexts are left to Crypto++, so that they are reported the same way on every curve
+            if (!FastECIES_Decrypt(FastEC2N::For(curve), privateKey, cipherText, plainText)){
+                AutoSeededRandomPool prng;
+                ECIES<EC2N>::Decryptor d;
+                d.AccessKey().AccessGroupParameters().Initialize(curve);
+                d.AccessKey().SetPrivateExponent(privateKey);
+                StringSource(cipherText, true, new PK_DecryptorFilter(prng, d, new StringSink(plainText)));
+            }
             result = String::New(plainText.c_str());
             //Returning the result
             if (args.Length() == 3){
@@ -675,11 +920,14 @@ Handle<Value> eciesDecryptB(const Arguments& args){
 * ECDSA key generation, signature and verification -- Uses SHA256
 */
 
-//Method signature : ecdsa.prime.generateKeyPair(curveName, [callback(keyPair)])
+//Method signature : ecdsa.prime.generateKeyPair(curveName, [options], [callback(keyPair)]); options : same as ecies.prime.generateKeyPair
 Handle<Value> ecdsaGenerateKeyPairP(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             String::AsciiValue curveNameVal(args[0]->ToString());
             std::string curveName(*curveNameVal);
             Local<Value> result = Local<Value>::New(Undefined());
@@ -697,16 +945,13 @@ Handle<Value> ecdsaGenerateKeyPairP(const Arguments& args){
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(IntegerToHexStr(privateExponent).c_str()));
-            Local<Object> publicKeyObj = Object::New();
-            publicKeyObj->Set(String::NewSymbol("x"), String::New(IntegerToHexStr(publicPoint.x).c_str()));
-            publicKeyObj->Set(String::NewSymbol("y"), String::New(IntegerToHexStr(publicPoint.y).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), publicKeyObj);
+            keyPair->Set(String::NewSymbol("publicKey"), publicPointValueP(curve, publicPoint, compressed));
             result = keyPair;
            //Returning the result
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -722,7 +967,8 @@ Handle<Value> ecdsaGenerateKeyPairP(const Arguments& args){
     }
 }
 
-//Method signature : ecdsa.prime.sign(message, privateKey, curveName, [hashName], [callback(signature)]); if no callback is given then the signature is returned
+//Method signature : ecdsa.prime.sign(message, privateKey, curveName, [hashName | options], [callback(signature)]); if no callback is given then the signature is returned
+//options is an object with the optional attributes hashName and deterministic (RFC 6979 nonces when true)
 Handle<Value> ecdsaSignMessageP(const Arguments& args){
     HandleScope scope;
     if (args.Length() >= 3 && args.Length() <= 5){
@@ -730,30 +976,46 @@ Handle<Value> ecdsaSignMessageP(const Arguments& args){
             String::Utf8Value messageVal(args[0]->ToString());
             String::AsciiValue privateKeyVal(args[1]->ToString()), curveNameVal(args[2]->ToString());
             std::string curveName(*curveNameVal), message(*messageVal), privateKeyStr(*privateKeyVal), signature, hashName = "";
+            bool deterministic = false;
             if (args.Length() >= 4){
-                if (!args[3]->IsUndefined()){
+                if (args[3]->IsObject() && !args[3]->IsFunction()){
+                    Local<Object> optionsObj = Local<Object>::Cast(args[3]);
+                    if (optionsObj->Has(String::NewSymbol("hashName")) && !optionsObj->Get(String::NewSymbol("hashName"))->IsUndefined()){
+                        String::Utf8Value hashNameVal(optionsObj->Get(String::NewSymbol("hashName"))->ToString());
+                        hashName = std::string(*hashNameVal);
+                    }
+                    deterministic = optionsObj->Get(String::NewSymbol("deterministic"))->BooleanValue();
+                } else if (!args[3]->IsUndefined()){
                     String::Utf8Value hashNameVal(args[3]->ToString());
                     hashName = std::string(*hashNameVal);
-                    if (!(hashName == "sha1" || hashName == "sha256")){
-                        ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name")));
-                        return scope.Close(Undefined());
-                    }
+                }
+                if (!(hashName == "" || hashName == "sha1" || hashName == "sha256")){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name")));
+                    return scope.Close(Undefined());
                 }
             }
             Local<Value> result = Local<Value>::New(Undefined());
             //Checking the existence of the curve
             OID curve = getPCurveFromName(curveName);
             //Method body
-            AutoSeededRandomPool prng;
-            if (hashName == "" || hashName == "sha1"){
+            const DL_GroupParameters_EC<ECP> params(curve);
+            const CryptoPP::Integer privateExponent = HexStrToInteger(privateKeyStr);
+            FastEC const* fast = FastEC::For(curve);
+            if (fast != 0){
+                if (hashName == "" || hashName == "sha1") FastECDSA_Sign<SHA1>(fast, privateExponent, message, deterministic, signature);
+                else FastECDSA_Sign<SHA256>(fast, privateExponent, message, deterministic, signature);
+            } else if (deterministic){
+                if (hashName == "" || hashName == "sha1") signature = ECDSA_DeterministicSign<SHA1>(params, privateExponent, message);
+                else signature = ECDSA_DeterministicSign<SHA256>(params, privateExponent, message);
+            } else if (hashName == "" || hashName == "sha1"){
+                AutoSeededRandomPool prng;
                 ECDSA<ECP, SHA1>::PrivateKey privateKey;
-                privateKey.Initialize(prng, curve);
-                privateKey.SetPrivateExponent(HexStrToInteger(privateKeyStr));
+                privateKey.Initialize(params, privateExponent);
                 StringSource(message, true, new SignerFilter(prng, ECDSA<ECP, SHA1>::Signer(privateKey), new StringSink(signature)));
             } else {
+                AutoSeededRandomPool prng;
                 ECDSA<ECP, SHA256>::PrivateKey privateKey;
-                privateKey.Initialize(prng, curve);
-                privateKey.SetPrivateExponent(HexStrToInteger(privateKeyStr));
+                privateKey.Initialize(params, privateExponent);
                 StringSource(message, true, new SignerFilter(prng, ECDSA<ECP, SHA256>::Signer(privateKey), new StringSink(signature)));
             }
             signature = strHexEncode(signature);
@@ -779,14 +1041,82 @@ Handle<Value> ecdsaSignMessageP(const Arguments& args){
     }
 }
 
+//Method signature : ecdsa.prime.signBatch(messages, privateKey, curveName, [hashName | options], [callback(signatures)]); messages is an array of strings, signatures is the array of their signatures, in the same order. options is {hashName, deterministic}, like in ecdsa.prime.sign
+Handle<Value> ecdsaSignBatchP(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() >= 3 && args.Length() <= 5){
+        if (!args[0]->IsArray()){
+            ThrowException(v8::Exception::TypeError(String::New("messages must be an array")));
+            return scope.Close(Undefined());
+        }
+        try {
+            Local<Array> messagesArray = Local<Array>::Cast(args[0]);
+            String::AsciiValue privateKeyVal(args[1]->ToString()), curveNameVal(args[2]->ToString());
+            std::string curveName(*curveNameVal), privateKeyStr(*privateKeyVal), hashName = "";
+            bool deterministic = false;
+            if (args.Length() >= 4){
+                if (args[3]->IsObject() && !args[3]->IsFunction()){
+                    Local<Object> optionsObj = Local<Object>::Cast(args[3]);
+                    if (optionsObj->Has(String::NewSymbol("hashName")) && !optionsObj->Get(String::NewSymbol("hashName"))->IsUndefined()){
+                        String::Utf8Value hashNameVal(optionsObj->Get(String::NewSymbol("hashName"))->ToString());
+                        hashName = std::string(*hashNameVal);
+                    }
+                    deterministic = optionsObj->Get(String::NewSymbol("deterministic"))->BooleanValue();
+                } else if (!args[3]->IsUndefined()){
+                    String::Utf8Value hashNameVal(args[3]->ToString());
+                    hashName = std::string(*hashNameVal);
+                }
+                if (!(hashName == "" || hashName == "sha1" || hashName == "sha256")){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name")));
+                    return scope.Close(Undefined());
+                }
+            }
+            std::vector<std::string> messages(messagesArray->Length());
+            for (unsigned int i = 0; i < messagesArray->Length(); i++){
+                String::Utf8Value messageVal(messagesArray->Get(i)->ToString());
+                messages[i] = std::string(*messageVal);
+            }
+            //Checking the existence of the curve
+            OID curve = getPCurveFromName(curveName);
+            //Method body
+            const DL_GroupParameters_EC<ECP> params(curve);
+            const CryptoPP::Integer privateExponent = HexStrToInteger(privateKeyStr);
+            std::vector<std::string> signatures;
+            if (hashName == "" || hashName == "sha1") signatures = ECDSA_BatchSign<SHA1>(params, curveName, privateExponent, messages, deterministic);
+            else signatures = ECDSA_BatchSign<SHA256>(params, curveName, privateExponent, messages, deterministic);
+            Local<Array> result = Array::New(signatures.size());
+            for (unsigned int i = 0; i < signatures.size(); i++){
+                result->Set(i, String::New(strHexEncode(signatures[i]).c_str()));
+            }
+            // Returning the result
+            if (args.Length() < 5){
+                return scope.Close(result);
+            } else {
+                if (args[4]->IsUndefined()) return scope.Close(result);
+                Local<Function> callback = Local<Function>::Cast(args[4]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
 //Method signature : ecdsa.prime.verify(message, signature, publicKey, curveName, [hashName], [callback(authentic)]); if no callback is given then the methods returns a boolean, whether the message is authentic or not
+//publicKey is an {x, y} object or a hex encoded point
 Handle<Value> ecdsaVerifyMessageP(const Arguments& args){
     HandleScope scope;
     if (args.Length() >= 4 && args.Length() <= 6){
         try {
             String::Utf8Value messageVal(args[0]->ToString());
             String::AsciiValue signatureVal(args[1]->ToString()), curveNameVal(args[3]->ToString());
-            Local<Object> publicKeyObj = Local<Object>::Cast(args[2]);
             std::string message(*messageVal), signature(*signatureVal), curveName(*curveNameVal), hashName = "";
             if (args.Length() >= 5){
                 if (!args[4]->IsUndefined()){
@@ -798,33 +1128,30 @@ Handle<Value> ecdsaVerifyMessageP(const Arguments& args){
                     }
                 }
             }
-            //Checking the existence of the curve
-            if (!(publicKeyObj->Has(String::New("x")) && publicKeyObj->Has(String::New("y")))){
+            //Checking the existence of the curve and casting the public key
+            OID curve = getPCurveFromName(curveName);
+            ECPPoint publicElement;
+            if (!getPublicPointP(args[2], curve, publicElement)){
                 ThrowException(v8::Exception::TypeError(String::New("Invalid public key object")));
                 return scope.Close(Local<Value>::New(Undefined()));
             }
-            OID curve = getPCurveFromName(curveName);
             //Method body
             bool valid = false;
             AutoSeededRandomPool prng;
             if (hashName == "" || hashName == "sha1"){
                 ECDSA<ECP, SHA1>::PublicKey publicKey;
-                Local<String> xVal, yVal;
-                xVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("x")));
-                yVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("y")));
-                const ECPPoint publicElement(HexStrToInteger(*(String::AsciiValue(xVal))), HexStrToInteger(*(String::AsciiValue(yVal))));
-                publicKey.Initialize(curve, publicElement);
                 signature = strHexDecode(signature);
-                StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<ECP, SHA1>::Verifier(publicKey), new ArraySink( (byte*)&valid, sizeof(valid) )));
+                if (!FastECDSA_Verify<SHA1>(FastEC::For(curve), publicElement, message, signature, valid)){
+                    publicKey.Initialize(curve, publicElement);
+                    StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<ECP, SHA1>::Verifier(publicKey), new ArraySink( (byte*)&valid, sizeof(valid) )));
+                }
             } else {
                 ECDSA<ECP, SHA256>::PublicKey publicKey;
-                Local<String> xVal, yVal;
-                xVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("x")));
-                yVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("y")));
-                const ECPPoint publicElement(HexStrToInteger(*(String::AsciiValue(xVal))), HexStrToInteger(*(String::AsciiValue(yVal))));
-                publicKey.Initialize(curve, publicElement);
                 signature = strHexDecode(signature);
-                StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<ECP, SHA256>::Verifier(publicKey), new ArraySink( (byte*)&valid, sizeof(valid) )));
+                if (!FastECDSA_Verify<SHA256>(FastEC::For(curve), publicElement, message, signature, valid)){
+                    publicKey.Initialize(curve, publicElement);
+                    StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<ECP, SHA256>::Verifier(publicKey), new ArraySink( (byte*)&valid, sizeof(valid) )));
+                }
             }
             //Returning the result
             if (args.Length() < 6){
@@ -848,11 +1175,14 @@ Handle<Value> ecdsaVerifyMessageP(const Arguments& args){
 
 }
 
-//Method signature : cryptopp.ecdsa.binary.generateKeyPair(curveName, [callback(keyPair)])
+//Method signature : cryptopp.ecdsa.binary.generateKeyPair(curveName, [options], [callback(keyPair)]); options : same as ecies.prime.generateKeyPair
 Handle<Value> ecdsaGenerateKeyPairB(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             //Casting the curveName parameter
             String::AsciiValue curveNameVal(args[0]->ToString());
             std::string curveName(*curveNameVal);
@@ -860,26 +1190,27 @@ Handle<Value> ecdsaGenerateKeyPairB(const Arguments& args){
             OID curve = getBCurveFromName(curveName);
             //Generating the keypair
             AutoSeededRandomPool prng;
-            ECDSA<EC2N, SHA256>::PrivateKey privateKey;
-            ECDSA<EC2N, SHA256>::PublicKey publicKey;
-            privateKey.Initialize(prng, curve);
-            privateKey.MakePublicKey(publicKey);
+            CryptoPP::Integer privateExponent;
+            CryptoPP::EC2NPoint publicPoint;
+            if (!FastEC_GenerateKeyPair(FastEC2N::For(curve), prng, privateExponent, publicPoint)){
+                ECDSA<EC2N, SHA256>::PrivateKey privateKey;
+                ECDSA<EC2N, SHA256>::PublicKey publicKey;
+                privateKey.Initialize(prng, curve);
+                privateKey.MakePublicKey(publicKey);
+                privateExponent = privateKey.GetPrivateExponent();
+                publicPoint = publicKey.GetPublicElement();
+            }
             //Building the result object
-            const CryptoPP::Integer privateExponent = privateKey.GetPrivateExponent();
-            const CryptoPP::EC2NPoint publicPoint = publicKey.GetPublicElement();
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(IntegerToHexStr(privateExponent).c_str()));
-            Local<Object> pubKeyObj = Object::New();
-            pubKeyObj->Set(String::NewSymbol("x"), String::New(PolynomialMod2ToHexStr(publicPoint.x).c_str()));
-            pubKeyObj->Set(String::NewSymbol("y"), String::New(PolynomialMod2ToHexStr(publicPoint.y).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), pubKeyObj);
+            keyPair->Set(String::NewSymbol("publicKey"), publicPointValueB(curve, publicPoint, compressed));
             result = keyPair;
             //Return the resulting object
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -895,40 +1226,65 @@ Handle<Value> ecdsaGenerateKeyPairB(const Arguments& args){
     }
 }
 
-//Method signature : cryptopp.ecdsa.binary.sign(message, privateKey, curveName, [callback(signature)])
+//Method signature : cryptopp.ecdsa.binary.sign(message, privateKey, curveName, [hashName | options], [callback(signature)]); if no callback is given then the signature is returned
+//options is {hashName, deterministic}, as in ecdsa.prime.sign. The hash function defaults to SHA256 on binary curves
 Handle<Value> ecdsaSignMessageB(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 3 || args.Length() == 4){
+    if (args.Length() >= 3 && args.Length() <= 5){
         try {
             //Casting parameters
             String::Utf8Value messageVal(args[0]->ToString());
-            String::AsciiValue curveNameVal(args[1]->ToString()), privateKeyVal(args[2]->ToString());
-            std::string message(*messageVal), curveName(*curveNameVal), privateKeyStr(*privateKeyVal), signature;
+            String::AsciiValue privateKeyVal(args[1]->ToString()), curveNameVal(args[2]->ToString());
+            std::string message(*messageVal), curveName(*curveNameVal), privateKeyStr(*privateKeyVal), signature, hashName = "sha256";
+            bool deterministic = false;
+            if (args.Length() >= 4){
+                if (args[3]->IsObject() && !args[3]->IsFunction()){
+                    Local<Object> optionsObj = Local<Object>::Cast(args[3]);
+                    if (optionsObj->Has(String::NewSymbol("hashName")) && !optionsObj->Get(String::NewSymbol("hashName"))->IsUndefined()){
+                        String::Utf8Value hashNameVal(optionsObj->Get(String::NewSymbol("hashName"))->ToString());
+                        hashName = std::string(*hashNameVal);
+                    }
+                    deterministic = optionsObj->Get(String::NewSymbol("deterministic"))->BooleanValue();
+                } else if (!args[3]->IsUndefined()){
+                    String::Utf8Value hashNameVal(args[3]->ToString());
+                    hashName = std::string(*hashNameVal);
+                }
+                if (!(hashName == "sha1" || hashName == "sha256")){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name")));
+                    return scope.Close(Undefined());
+                }
+            }
             Local<Value> result = Local<Value>::New(Undefined());
             //Checking curve existence and loading it.
-            try {
-                OID curve = getBCurveFromName(curveName);
-                std::cout << "Curve OID loaded" << std::endl;
-                //Generating the signature
+            OID curve = getBCurveFromName(curveName);
+            const CryptoPP::Integer privateExponent = HexStrToInteger(privateKeyStr);
+            FastEC2N const* fast = FastEC2N::For(curve);
+            //Generating the signature
+            if (fast != 0){
+                if (hashName == "sha1") FastECDSA_Sign<SHA1>(fast, privateExponent, message, deterministic, signature);
+                else FastECDSA_Sign<SHA256>(fast, privateExponent, message, deterministic, signature);
+            } else if (deterministic){
+                ThrowException(v8::Exception::TypeError(String::New("Deterministic signatures aren't available on this curve")));
+                return scope.Close(Undefined());
+            } else if (hashName == "sha1"){
+                AutoSeededRandomPool prng;
+                ECDSA<EC2N, SHA1>::PrivateKey privateKey;
+                privateKey.Initialize(curve, privateExponent);
+                StringSource(message, true, new SignerFilter(prng, ECDSA<EC2N, SHA1>::Signer(privateKey), new StringSink(signature)));
+            } else {
                 AutoSeededRandomPool prng;
-                std::cout << "Generator initialized" << std::endl;
                 ECDSA<EC2N, SHA256>::PrivateKey privateKey;
-                privateKey.Initialize(prng, curve);
-                std::cout << "Curve initialized" << std::endl;
-                privateKey.SetPrivateExponent(HexStrToInteger(privateKeyStr));
-                std::cout << "Key initialized" << std::endl;
+                privateKey.Initialize(curve, privateExponent);
                 StringSource(message, true, new SignerFilter(prng, ECDSA<EC2N, SHA256>::Signer(privateKey), new StringSink(signature)));
-                signature = strHexEncode(signature);
-                result = String::New(signature.c_str());
-            } catch (CryptoPP::Exception& e){
-                std::cout << "An exception occured :" << std::endl << e.what() << std::endl;
-                ThrowException(v8::Exception::TypeError(String::New(e.what())));
-                return scope.Close(Undefined());
             }
-            if (args.Length() == 3){
+            signature = strHexEncode(signature);
+            result = String::New(signature.c_str());
+            // Returning the result
+            if (args.Length() < 5){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[3]);
+                if (args[4]->IsUndefined()) return scope.Close(result);
+                Local<Function> callback = Local<Function>::Cast(args[4]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -944,38 +1300,55 @@ Handle<Value> ecdsaSignMessageB(const Arguments& args){
     }
 }
 
-//Method signature : cryptopp.ecdsa.verify(message, signature, publicKey, curveName, [callback(isValid)])
+//Method signature : cryptopp.ecdsa.binary.verify(message, signature, publicKey, curveName, [hashName], [callback(isValid)]); publicKey is an {x, y} object or a hex encoded point
+//hashName defaults to SHA256, as in ecdsa.binary.sign. The callback can also be given in place of hashName
 Handle<Value> ecdsaVerifyMessageB(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 4 || args.Length() == 5){
+    if (args.Length() >= 4 && args.Length() <= 6){
         try {
             //Casting parameters
             String::Utf8Value messageVal(args[0]->ToString());
             String::AsciiValue signatureVal(args[1]->ToString()), curveNameVal(args[3]->ToString());
-            std::string message(*messageVal), signature(*signatureVal), curveName(*curveNameVal);
+            std::string message(*messageVal), signature(*signatureVal), curveName(*curveNameVal), hashName = "sha256";
+            int callbackIndex = 5;
+            if (args.Length() >= 5 && args[4]->IsFunction()){
+                callbackIndex = 4;
+            } else if (args.Length() >= 5 && !args[4]->IsUndefined()){
+                String::Utf8Value hashNameVal(args[4]->ToString());
+                hashName = std::string(*hashNameVal);
+                if (!(hashName == "sha1" || hashName == "sha256")){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid hash function name")));
+                    return scope.Close(Undefined());
+                }
+            }
             bool isValid = false;
-            Local<Object> publicKeyObj = Local<Object>::Cast(args[2]);
-            //Checking curve existence and loading it. Checking attributes of public key object
-            if (!(publicKeyObj->Has(String::New("x")) && publicKeyObj->Has(String::New("y")))){
+            //Checking curve existence and loading it. Casting the public key
+            OID curve = getBCurveFromName(curveName);
+            EC2NPoint publicElement;
+            if (!getPublicPointB(args[2], curve, publicElement)){
                 ThrowException(v8::Exception::TypeError(String::New("Invalid public key object")));
                 return scope.Close(Local<Value>::New(Undefined()));
             }
-            OID curve = getBCurveFromName(curveName);
             //Verifying signature
-            AutoSeededRandomPool prng;
-            ECDSA<EC2N, SHA256>::PublicKey publicKey;
-            Local<String> xVal, yVal;
-            xVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("x")));
-            yVal = Local<String>::Cast(publicKeyObj->Get(String::NewSymbol("y")));
-            const EC2NPoint publicElement(HexStrToPolynomialMod2(*(String::AsciiValue(xVal))), HexStrToPolynomialMod2(*(String::AsciiValue(yVal))));
-            publicKey.Initialize(curve, publicElement);
             signature = strHexDecode(signature);
-            StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<EC2N, SHA256>::Verifier(publicKey), new ArraySink( (byte*) &isValid, sizeof(isValid) )));
+            if (hashName == "sha1"){
+                if (!FastECDSA_Verify<SHA1>(FastEC2N::For(curve), publicElement, message, signature, isValid)){
+                    ECDSA<EC2N, SHA1>::PublicKey publicKey;
+                    publicKey.Initialize(curve, publicElement);
+                    StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<EC2N, SHA1>::Verifier(publicKey), new ArraySink( (byte*) &isValid, sizeof(isValid) )));
+                }
+            } else {
+                if (!FastECDSA_Verify<SHA256>(FastEC2N::For(curve), publicElement, message, signature, isValid)){
+                    ECDSA<EC2N, SHA256>::PublicKey publicKey;
+                    publicKey.Initialize(curve, publicElement);
+                    StringSource(signature+message, true, new SignatureVerificationFilter(ECDSA<EC2N, SHA256>::Verifier(publicKey), new ArraySink( (byte*) &isValid, sizeof(isValid) )));
+                }
+            }
             //Return the result
-            if (args.Length() == 4){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(Boolean::New(isValid));
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[4]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(Boolean::New(isValid)) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -993,11 +1366,33 @@ Handle<Value> ecdsaVerifyMessageB(const Arguments& args){
 
 // ECDH key agreement algorithm : key generation and secret agreement
 
-// Method signature : cryptopp.ecdh.prime.generateKeyPair(curveName, [callback(keyPair)])
+//Crypto++'s ECDH takes uncompressed public keys : compressed ones are decompressed (binary tells which kind of curve it is). Returns false if that fails
+bool uncompressedPublicKey(OID const& curve, bool binary, SecByteBlock& publicKey){
+    if (publicKey.size() == 0 || !(publicKey[0] == 0x02 || publicKey[0] == 0x03)) return true;
+    const std::string compressed((const char*) publicKey.BytePtr(), publicKey.size());
+    std::string uncompressed;
+    if (!(binary ? ECPoint_DecompressB(curve, compressed, uncompressed) : ECPoint_DecompressP(curve, compressed, uncompressed))) return false;
+    publicKey.Assign((const byte*) uncompressed.data(), uncompressed.size());
+    return true;
+}
+
+//Crypto++'s ECDH reads PrivateKeyLength() bytes : hex private keys that lost their leading zeros are padded back. Returns false if the key is too long
+bool fixedLengthPrivateKey(size_t length, SecByteBlock& privateKey){
+    const CryptoPP::Integer x(privateKey.BytePtr(), privateKey.size());
+    if (x.ByteCount() > length) return false;
+    privateKey.New(length);
+    x.Encode(privateKey.BytePtr(), length);
+    return true;
+}
+
+// Method signature : cryptopp.ecdh.prime.generateKeyPair(curveName, [options], [callback(keyPair)]); options : same as ecies.prime.generateKeyPair
 Handle<Value> ecdhGenerateKeyPairP(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             String::AsciiValue curveNameVal(args[0]->ToString());
             std::string curveName(*curveNameVal);
             Local<Value> result = Local<Value>::New(Undefined());
@@ -1005,19 +1400,25 @@ Handle<Value> ecdhGenerateKeyPairP(const Arguments& args){
             OID curve = getPCurveFromName(curveName);
             //Method body
             AutoSeededX917RNG<AES> prng;
-            ECDH<ECP>::Domain dhDomain(curve);
-            SecByteBlock privKey(dhDomain.PrivateKeyLength()), publicKey(dhDomain.PublicKeyLength());
-            dhDomain.GenerateKeyPair(prng, privKey, publicKey);
+            SecByteBlock privKey, publicKey;
+            if (!FastECDH_GenerateKeyPair(FastEC::For(curve), prng, privKey, publicKey)){
+                ECDH<ECP>::Domain dhDomain(curve);
+                privKey.New(dhDomain.PrivateKeyLength());
+                publicKey.New(dhDomain.PublicKeyLength());
+                dhDomain.GenerateKeyPair(prng, privKey, publicKey);
+            }
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(SecByteBlockToHexStr(privKey).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), String::New(SecByteBlockToHexStr(publicKey).c_str()));
+            std::string publicKeyStr((const char*) publicKey.BytePtr(), publicKey.size());
+            if (compressed) ECPoint_CompressPrefixP(curve, publicKeyStr);
+            keyPair->Set(String::NewSymbol("publicKey"), String::New(strHexEncode(publicKeyStr).c_str()));
             result = keyPair;
             //Returning the result
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -1034,7 +1435,7 @@ Handle<Value> ecdhGenerateKeyPairP(const Arguments& args){
 
 }
 
-//Method signature : cryptopp.ecdh.prime.agree(yourPrivateKey, counterpartsPublicKey, curveName, [callback(secret)]) : returns the secret if no callback is given
+//Method signature : cryptopp.ecdh.prime.agree(yourPrivateKey, counterpartsPublicKey, curveName, [callback(secret)]) : returns the secret if no callback is given. The public key can be uncompressed, compressed or x-only
 Handle<Value> ecdhAgreeP(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
@@ -1045,12 +1446,29 @@ Handle<Value> ecdhAgreeP(const Arguments& args){
             //Checking the existence of the curve
             OID curve = getPCurveFromName(curveName);
             //Method body
-            ECDH<ECP>::Domain dhDomain(curve);
             SecByteBlock privateKey = HexStrToSecByteBlock(privateKeyStr);
             SecByteBlock publicKey = HexStrToSecByteBlock(publicKeyStr);
-            SecByteBlock secret(dhDomain.AgreedValueLength());
-            dhDomain.Agree(secret, privateKey, publicKey);
-            result = String::New(SecByteBlockToHexStr(secret).c_str());
+            SecByteBlock secret;
+            //FastEC first (uncompressed keys only), then the x-only ladder, which takes compressed and x-only keys without decompressing them
+            ECLadder const* ladder = ECLadder::For(curve);
+            if (ladder != 0){
+                if (!FastECDH_Agree(FastEC::For(curve), privateKey, publicKey, secret) && !ladder->Agree(privateKey, publicKey, secret)){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid key")));
+                    return scope.Close(Undefined());
+                }
+            } else if (!uncompressedPublicKey(curve, false, publicKey)){
+                ThrowException(v8::Exception::TypeError(String::New("Invalid public key")));
+                return scope.Close(Undefined());
+            } else if (!FastECDH_Agree(FastEC::For(curve), privateKey, publicKey, secret)){
+                ECDH<ECP>::Domain dhDomain(curve);
+                secret.New(dhDomain.AgreedValueLength());
+                if (!fixedLengthPrivateKey(dhDomain.PrivateKeyLength(), privateKey) || !dhDomain.Agree(secret, privateKey, publicKey)){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid key")));
+                    return scope.Close(Undefined());
+                }
+            }
+            //Fixed-length encoding, like KeyRing.agree
+            result = String::New(bufferHexEncode(secret.BytePtr(), secret.SizeInBytes()).c_str());
             //Returning the result
             if (args.Length() == 3){
                 return scope.Close(result);
@@ -1071,11 +1489,14 @@ Handle<Value> ecdhAgreeP(const Arguments& args){
     }
 }
 
-//Method signature : cryptopp.ecdh.binary.generateKeyPair(curveName, [callback(keyPair)])
+//Method signature : cryptopp.ecdh.binary.generateKeyPair(curveName, [options], [callback(keyPair)]); options : same as ecies.prime.generateKeyPair
 Handle<Value> ecdhGenerateKeyPairB(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
+            bool compressed;
+            const int callbackIndex = keyPairOptions(args, compressed);
+            if (callbackIndex < 0) return scope.Close(Undefined());
             String::AsciiValue curveNameVal(args[0]->ToString());
             std::string curveName(*curveNameVal);
             Local<Value> result = Local<Value>::New(Undefined());
@@ -1083,18 +1504,24 @@ Handle<Value> ecdhGenerateKeyPairB(const Arguments& args){
             OID curve = getBCurveFromName(curveName);
             //Method body
             AutoSeededX917RNG<AES> prng;
-            ECDH<EC2N>::Domain dhDomain(curve);
-            SecByteBlock privKey(dhDomain.PrivateKeyLength()), pubKey(dhDomain.PublicKeyLength());
-            dhDomain.GenerateKeyPair(prng, privKey, pubKey);
+            SecByteBlock privKey, pubKey;
+            if (!FastECDH_GenerateKeyPair(FastEC2N::For(curve), prng, privKey, pubKey)){
+                ECDH<EC2N>::Domain dhDomain(curve);
+                privKey.New(dhDomain.PrivateKeyLength());
+                pubKey.New(dhDomain.PublicKeyLength());
+                dhDomain.GenerateKeyPair(prng, privKey, pubKey);
+            }
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("curveName"), String::New(curveName.c_str()));
             keyPair->Set(String::NewSymbol("privateKey"), String::New(SecByteBlockToHexStr(privKey).c_str()));
-            keyPair->Set(String::NewSymbol("publicKey"), String::New(SecByteBlockToHexStr(pubKey).c_str()));
+            std::string publicKeyStr((const char*) pubKey.BytePtr(), pubKey.size());
+            if (compressed) ECPoint_CompressPrefixB(curve, publicKeyStr);
+            keyPair->Set(String::NewSymbol("publicKey"), String::New(strHexEncode(publicKeyStr).c_str()));
             result = keyPair;
-            if (args.Length() == 1){
+            if (args.Length() <= callbackIndex || args[callbackIndex]->IsUndefined()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[callbackIndex]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -1110,7 +1537,7 @@ Handle<Value> ecdhGenerateKeyPairB(const Arguments& args){
     }
 }
 
-//Method signature : cryptopp.ecdh.binary.agree(yourPrivateKey, counterpartsPublicKey, curveName, [callback(secret)])
+//Method signature : cryptopp.ecdh.binary.agree(yourPrivateKey, counterpartsPublicKey, curveName, [callback(secret)]); the public key can be compressed
 Handle<Value> ecdhAgreeB(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
@@ -1121,12 +1548,22 @@ Handle<Value> ecdhAgreeB(const Arguments& args){
             //Checking curve existence and loading it
             OID curve = getBCurveFromName(curveName);
             //Method body
-            ECDH<EC2N>::Domain dhDomain(curve);
             SecByteBlock privateKey = HexStrToSecByteBlock(privateKeyStr);
             SecByteBlock publicKey = HexStrToSecByteBlock(publicKeyStr);
-            SecByteBlock secret(dhDomain.AgreedValueLength());
-            dhDomain.Agree(secret, privateKey, publicKey);
-            result = String::New(SecByteBlockToHexStr(secret).c_str());
+            if (!uncompressedPublicKey(curve, true, publicKey)){
+                ThrowException(v8::Exception::TypeError(String::New("Invalid public key")));
+                return scope.Close(Undefined());
+            }
+            SecByteBlock secret;
+            if (!FastECDH_Agree(FastEC2N::For(curve), privateKey, publicKey, secret)){
+                ECDH<EC2N>::Domain dhDomain(curve);
+                secret.New(dhDomain.AgreedValueLength());
+                if (!fixedLengthPrivateKey(dhDomain.PrivateKeyLength(), privateKey) || !dhDomain.Agree(secret, privateKey, publicKey)){
+                    ThrowException(v8::Exception::TypeError(String::New("Invalid key")));
+                    return scope.Close(Undefined());
+                }
+            }
+            result = String::New(bufferHexEncode(secret.BytePtr(), secret.SizeInBytes()).c_str());
             //Returning the result
             if (args.Length() == 3){
                 return scope.Close(result);
@@ -1147,14 +1584,111 @@ Handle<Value> ecdhAgreeB(const Arguments& args){
     }
 }
 
+/*
+* SEC1 point encoding conversions, for keys stored in either format
+*/
+
+//Shared by the 4 methods below. Returns the hex encoded compressed point, or the {x, y} object
+Handle<Value> ecpointConvert(const Arguments& args, bool binary, bool compress){
+    HandleScope scope;
+    if (args.Length() == 2){
+        try {
+            String::AsciiValue curveNameVal(args[1]->ToString());
+            std::string curveName(*curveNameVal);
+            OID curve = binary ? getBCurveFromName(curveName) : getPCurveFromName(curveName);
+            ECPPoint pointP;
+            EC2NPoint pointB;
+            if (!(binary ? getPublicPointB(args[0], curve, pointB) : getPublicPointP(args[0], curve, pointP))){
+                ThrowException(v8::Exception::TypeError(String::New("Invalid public key")));
+                return scope.Close(Undefined());
+            }
+            return scope.Close(binary ? publicPointValueB(curve, pointB, compress) : publicPointValueP(curve, pointP, compress));
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.ecpoint.prime.compress(publicKey, curveName) : returns the hex encoded compressed point. publicKey is an {x, y} object or a hex encoded point
+Handle<Value> ecpointCompressP(const Arguments& args){
+    return ecpointConvert(args, false, true);
+}
+
+//Method signature : cryptopp.ecpoint.prime.decompress(publicKey, curveName) : returns the {x, y} object
+Handle<Value> ecpointDecompressP(const Arguments& args){
+    return ecpointConvert(args, false, false);
+}
+
+//Method signature : cryptopp.ecpoint.binary.compress(publicKey, curveName)
+Handle<Value> ecpointCompressB(const Arguments& args){
+    return ecpointConvert(args, true, true);
+}
+
+//Method signature : cryptopp.ecpoint.binary.decompress(publicKey, curveName)
+Handle<Value> ecpointDecompressB(const Arguments& args){
+    return ecpointConvert(args, true, false);
+}
+
+//Method signature : cryptopp.ecpoint.cacheCapacity([capacity]) : sets the maximum number of decompressed points kept in the cache when capacity is given, and returns it
+Handle<Value> ecpointCacheCapacity(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() > 1){
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+    if (args.Length() == 1 && !args[0]->IsUndefined()){
+        if (!args[0]->IsNumber() || args[0]->NumberValue() < 0){
+            ThrowException(v8::Exception::TypeError(String::New("capacity must be a number, 0 or more")));
+            return scope.Close(Undefined());
+        }
+        ECPoint_SetCacheCapacity((size_t) args[0]->NumberValue());
+    }
+    return scope.Close(Number::New((double) ECPoint_CacheCapacity()));
+}
+
+//Method signature : cryptopp.hardwareSupport() : returns {gf2m}, the carry-less multiplication kernel of the binary curves in use ("pclmul" or "portable"). The AEAD code paths are given by cryptopp.aead.hardwareSupport()
+Handle<Value> hardwareSupport(const Arguments& args){
+    HandleScope scope;
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("gf2m"), String::New(GF2m_KernelName()));
+    return scope.Close(result);
+}
+
 /*
 * RSA encryption algorithm; key generation, encryption and decryption, signature and verification
 */
 
-// Method signature : cryptopp.rsa.generateKeyPair(sizeInBits, [callback(keyPair)])
+//RSA private key. privateExponent is either the hex encoded private exponent, or an object with the privateExponent and primes (array of hex encoded primes) attributes for multi-prime keys
+void rsaPrivateKey(Local<Value> privateExpVal, std::string const& modulusStr, std::string const& publicExpStr, InvertibleMultiPrimeRSAFunction& privateParams){
+    std::vector<CryptoPP::Integer> primes;
+    std::string privateExpStr;
+    if (privateExpVal->IsObject()){
+        Local<Object> privateKeyObj = Local<Object>::Cast(privateExpVal);
+        String::AsciiValue exponentVal(privateKeyObj->Get(String::NewSymbol("privateExponent"))->ToString());
+        privateExpStr = std::string(*exponentVal);
+        Local<Value> primesVal = privateKeyObj->Get(String::NewSymbol("primes"));
+        if (primesVal->IsArray()){
+            Local<Array> primesArray = Local<Array>::Cast(primesVal);
+            for (unsigned int i = 0; i < primesArray->Length(); i++){
+                String::AsciiValue primeVal(primesArray->Get(i)->ToString());
+                primes.push_back(HexStrToInteger(std::string(*primeVal)));
+            }
+        }
+    } else {
+        String::AsciiValue exponentVal(privateExpVal->ToString());
+        privateExpStr = std::string(*exponentVal);
+    }
+    privateParams.Initialize(HexStrToInteger(modulusStr), HexStrToInteger(publicExpStr), HexStrToInteger(privateExpStr), primes);
+}
+
+// Method signature : cryptopp.rsa.generateKeyPair(sizeInBits, [options], [callback(keyPair)])
 Handle<Value> rsaGenerateKeyPair(const Arguments& args){
     HandleScope scope;
-    if (args.Length() == 1 || args.Length() == 2){
+    if (args.Length() >= 1 && args.Length() <= 3){
         try {
             Local<Value> result;
             //Casting the keySize parameters
@@ -1165,6 +1699,16 @@ Handle<Value> rsaGenerateKeyPair(const Arguments& args){
                 ThrowException(v8::Exception::RangeError(String::New("Invalid key size. Allowed key sizes : between 1024 and 16384 bits")));
                 return scope.Close(Undefined());
             }
+            //Optional {primes} object, for multi-prime keys
+            int primeCount = 2;
+            if (args.Length() >= 2 && args[1]->IsObject() && !args[1]->IsFunction()){
+                Local<Value> primeCountVal = Local<Object>::Cast(args[1])->Get(String::NewSymbol("primes"));
+                if (!primeCountVal->IsUndefined()) primeCount = primeCountVal->Int32Value();
+            }
+            if (!(primeCount >= 2 && (unsigned int) primeCount <= InvertibleMultiPrimeRSAFunction::MaxPrimes(keySize))){
+                ThrowException(v8::Exception::RangeError(String::New("Invalid number of primes. Allowed : 2 below 1024 bits, up to 3 below 4096 bits, up to 4 below 8192 bits, up to 5 otherwise")));
+                return scope.Close(Undefined());
+            }
             /*bool validKeySize = false;
             int testedKeySize = 1024;
             while (testedKeySize <= 16384){
@@ -1179,18 +1723,23 @@ Handle<Value> rsaGenerateKeyPair(const Arguments& args){
             }*/
             //Generating the key pair
             AutoSeededRandomPool prng;
-            InvertibleRSAFunction keyPairParams;
-            keyPairParams.GenerateRandomWithKeySize(prng, keySize);
+            InvertibleMultiPrimeRSAFunction keyPairParams;
+            keyPairParams.GenerateRandomWithPrimes(prng, keySize, primeCount);
             //Building the result object
             Local<Object> keyPair = Object::New();
             keyPair->Set(String::NewSymbol("modulus"), String::New(IntegerToHexStr(keyPairParams.GetModulus()).c_str()));
             keyPair->Set(String::NewSymbol("publicExponent"), String::New(IntegerToHexStr(keyPairParams.GetPublicExponent()).c_str()));
             keyPair->Set(String::NewSymbol("privateExponent"), String::New(IntegerToHexStr(keyPairParams.GetPrivateExponent()).c_str()));
+            if (primeCount > 2){
+                Local<Array> primes = Array::New(primeCount);
+                for (int i = 0; i < primeCount; i++) primes->Set(i, String::New(IntegerToHexStr(keyPairParams.GetPrimes()[i]).c_str()));
+                keyPair->Set(String::NewSymbol("primes"), primes);
+            }
             result = keyPair;
-            if (args.Length() == 1){
+            if (!args[args.Length() - 1]->IsFunction()){
                 return scope.Close(result);
             } else {
-                Local<Function> callback = Local<Function>::Cast(args[1]);
+                Local<Function> callback = Local<Function>::Cast(args[args.Length() - 1]);
                 const unsigned argc = 1;
                 Local<Value> argv[argc] = { Local<Value>::New(result) };
                 callback->Call(Context::GetCurrent()->Global(), argc, argv);
@@ -1211,10 +1760,15 @@ Handle<Value> rsaEncrypt(const Arguments& args){
     HandleScope scope;
     if (args.Length() == 3 || args.Length() == 4){
         try {
-            //Casting arguments
-            String::Utf8Value plainTextVal(args[0]->ToString());
+            //Casting arguments. A Buffer plainText is taken as is (binary keys), a string as UTF-8
             String::AsciiValue modulusVal(args[1]->ToString()), publicExpVal(args[2]->ToString());
-            std::string plainText(*plainTextVal), modulusStr(*modulusVal), publicExpStr(*publicExpVal), cipherText;
+            std::string plainText, modulusStr(*modulusVal), publicExpStr(*publicExpVal), cipherText;
+            if (node::Buffer::HasInstance(args[0])){
+                plainText.assign(node::Buffer::Data(args[0]), node::Buffer::Length(args[0]));
+            } else {
+                String::Utf8Value plainTextVal(args[0]->ToString());
+                plainText.assign(*plainTextVal, plainTextVal.length());
+            }
             Local<Value> result;
             //Encrypting the plainText
             AutoSeededRandomPool prng;
@@ -1250,15 +1804,14 @@ Handle<Value> rsaDecrypt(const Arguments& args){
     if (args.Length() == 4 || args.Length() == 5){
         try {
             //Casting arguments
-            String::AsciiValue cipherTextVal(args[0]->ToString()), modulusVal(args[1]->ToString()), privateExpVal(args[2]->ToString()), publicExpVal(args[3]->ToString());
-            std::string cipherText(*cipherTextVal), modulusStr(*modulusVal), privateExpStr(*privateExpVal), publicExpStr(*publicExpVal), plainText;
+            String::AsciiValue cipherTextVal(args[0]->ToString()), modulusVal(args[1]->ToString()), publicExpVal(args[3]->ToString());
+            std::string cipherText(*cipherTextVal), modulusStr(*modulusVal), publicExpStr(*publicExpVal), plainText;
             Local<Value> result = Local<Value>::New(Undefined());
             //Decrypting cipherText
             AutoSeededRandomPool prng;
-            InvertibleRSAFunction privateParams;
-            privateParams.Initialize(HexStrToInteger(modulusStr), HexStrToInteger(publicExpStr), HexStrToInteger(privateExpStr));
-            RSA::PrivateKey privateKey(privateParams);
-            RSAES_OAEP_SHA_Decryptor decryptor(privateKey);
+            InvertibleMultiPrimeRSAFunction privateParams;
+            rsaPrivateKey(args[2], modulusStr, publicExpStr, privateParams);
+            MultiPrimeRSAES_OAEP_SHA_Decryptor decryptor(privateParams);
             cipherText = strHexDecode(cipherText);
             StringSource(cipherText, true, new PK_DecryptorFilter(prng, decryptor, new StringSink(plainText)));
             result = String::New(plainText.c_str());
@@ -1289,8 +1842,8 @@ Handle<Value> rsaSign(const Arguments& args){
         try {
             //Casting arguments
             String::Utf8Value messageVal(args[0]->ToString());
-            String::AsciiValue modulusVal(args[1]->ToString()), privateExpVal(args[2]->ToString()), publicExpVal(args[3]->ToString());
-            std::string message(*messageVal), modulusStr(*modulusVal), privateExpStr(*privateExpVal), publicExpStr(*publicExpVal), signature, hashName = "";
+            String::AsciiValue modulusVal(args[1]->ToString()), publicExpVal(args[3]->ToString());
+            std::string message(*messageVal), modulusStr(*modulusVal), publicExpStr(*publicExpVal), signature, hashName = "";
             //Casting the hashName argument
             if (args.Length() >= 5){
                 if (!args[4]->IsUndefined()){
@@ -1305,14 +1858,13 @@ Handle<Value> rsaSign(const Arguments& args){
             Local<Value> result = Local<Value>::New(Undefined());
             //Signing the message
             AutoSeededRandomPool prng;
-            InvertibleRSAFunction privateParams;
-            privateParams.Initialize(HexStrToInteger(modulusStr), HexStrToInteger(publicExpStr), HexStrToInteger(privateExpStr));
-            RSA::PrivateKey privateKey(privateParams);
+            InvertibleMultiPrimeRSAFunction privateParams;
+            rsaPrivateKey(args[2], modulusStr, publicExpStr, privateParams);
             if (hashName == "" || hashName == "sha1"){
-                RSASS<PSS, SHA1>::Signer signer(privateKey);
+                MultiPrimeRSASS_PSS<SHA1>::Signer signer(privateParams);
                 StringSource(message, true, new SignerFilter(prng, signer, new StringSink(signature)));
             } else {
-                RSASS<PSS, SHA256>::Signer signer(privateKey);
+                MultiPrimeRSASS_PSS<SHA256>::Signer signer(privateParams);
                 StringSource(message, true, new SignerFilter(prng, signer, new StringSink(signature)));
             }
             signature = strHexEncode(signature);
@@ -1513,10 +2065,244 @@ Handle<Value> dsaVerify(const Arguments& args){
     }
 }
 
+//Method signature : cryptopp.x25519.generateKeyPair([callback(keyPair)]) : keyPair is {privateKey, publicKey}, both 32 bytes long, hex encoded
+Handle<Value> x25519GenerateKeyPair(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 0 || args.Length() == 1){
+        try {
+            Local<Value> result = Local<Value>::New(Undefined());
+            //Method body
+            AutoSeededRandomPool prng;
+            SecByteBlock privateKey, publicKey;
+            X25519_GenerateKeyPair(prng, privateKey, publicKey);
+            Local<Object> keyPair = Object::New();
+            keyPair->Set(String::NewSymbol("privateKey"), String::New(bufferHexEncode(privateKey.BytePtr(), privateKey.SizeInBytes()).c_str()));
+            keyPair->Set(String::NewSymbol("publicKey"), String::New(bufferHexEncode(publicKey.BytePtr(), publicKey.SizeInBytes()).c_str()));
+            result = keyPair;
+            //Returning the result
+            if (args.Length() == 0){
+                return scope.Close(result);
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[0]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.x25519.agree(yourPrivateKey, counterpartsPublicKey, [callback(secret)]) : returns the hex encoded 32-byte secret if no callback is given
+Handle<Value> x25519Agree(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 2 || args.Length() == 3){
+        try {
+            String::AsciiValue privateKeyVal(args[0]->ToString()), publicKeyVal(args[1]->ToString());
+            const std::string privateKeyStr = strHexDecode(std::string(*privateKeyVal)), publicKeyStr = strHexDecode(std::string(*publicKeyVal));
+            if (privateKeyStr.size() != CURVE25519_KEY_LENGTH || publicKeyStr.size() != CURVE25519_KEY_LENGTH){
+                ThrowException(v8::Exception::TypeError(String::New("Invalid key length")));
+                return scope.Close(Undefined());
+            }
+            Local<Value> result = Local<Value>::New(Undefined());
+            //Method body
+            const SecByteBlock privateKey((const byte*) privateKeyStr.data(), privateKeyStr.size()), publicKey((const byte*) publicKeyStr.data(), publicKeyStr.size());
+            SecByteBlock secret;
+            if (!X25519_Agree(privateKey, publicKey, secret)){
+                ThrowException(v8::Exception::Error(String::New("Invalid public key")));
+                return scope.Close(Undefined());
+            }
+            result = String::New(bufferHexEncode(secret.BytePtr(), secret.SizeInBytes()).c_str());
+            //Returning the result
+            if (args.Length() == 2){
+                return scope.Close(result);
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[2]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.ed25519.generateKeyPair([callback(keyPair)]) : keyPair is {privateKey, publicKey}, both 32 bytes long, hex encoded. The private key is the RFC 8032 seed
+Handle<Value> ed25519GenerateKeyPair(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 0 || args.Length() == 1){
+        try {
+            Local<Value> result = Local<Value>::New(Undefined());
+            //Method body
+            AutoSeededRandomPool prng;
+            SecByteBlock privateKey;
+            std::string publicKey;
+            Ed25519_GenerateKeyPair(prng, privateKey, publicKey);
+            Local<Object> keyPair = Object::New();
+            keyPair->Set(String::NewSymbol("privateKey"), String::New(bufferHexEncode(privateKey.BytePtr(), privateKey.SizeInBytes()).c_str()));
+            keyPair->Set(String::NewSymbol("publicKey"), String::New(strHexEncode(publicKey).c_str()));
+            result = keyPair;
+            //Returning the result
+            if (args.Length() == 0){
+                return scope.Close(result);
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[0]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.ed25519.sign(message, privateKey, [callback(signature)]) : returns the hex encoded 64-byte signature if no callback is given
+Handle<Value> ed25519Sign(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 2 || args.Length() == 3){
+        try {
+            String::Utf8Value messageVal(args[0]->ToString());
+            String::AsciiValue privateKeyVal(args[1]->ToString());
+            const std::string message(*messageVal), privateKeyStr = strHexDecode(std::string(*privateKeyVal));
+            if (privateKeyStr.size() != CURVE25519_KEY_LENGTH){
+                ThrowException(v8::Exception::TypeError(String::New("Invalid key length")));
+                return scope.Close(Undefined());
+            }
+            Local<Value> result = Local<Value>::New(Undefined());
+            //Method body
+            const SecByteBlock privateKey((const byte*) privateKeyStr.data(), privateKeyStr.size());
+            std::string signature;
+            Ed25519_Sign(privateKey, message, signature);
+            result = String::New(strHexEncode(signature).c_str());
+            //Returning the result
+            if (args.Length() == 2){
+                return scope.Close(result);
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[2]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.ed25519.verify(message, signature, publicKey, [callback(isValid)]) : returns a boolean if no callback is given. Malformed signatures and public keys are reported as invalid
+Handle<Value> ed25519Verify(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 3 || args.Length() == 4){
+        try {
+            String::Utf8Value messageVal(args[0]->ToString());
+            String::AsciiValue signatureVal(args[1]->ToString()), publicKeyVal(args[2]->ToString());
+            const std::string message(*messageVal), signature = strHexDecode(std::string(*signatureVal)), publicKey = strHexDecode(std::string(*publicKeyVal));
+            //Method body
+            const bool isValid = Ed25519_Verify(publicKey, message, signature);
+            //Returning the result
+            if (args.Length() == 3){
+                return scope.Close(Boolean::New(isValid));
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[3]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(Boolean::New(isValid)) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
+//Method signature : cryptopp.ed25519.verifyBatch(messages, signatures, publicKeys, [callback(results)]) : the three arrays have the same length; results[i] tells whether signatures[i] is a valid signature of messages[i] by publicKeys[i]. The signatures are checked together, which is much faster than verifying them one by one
+Handle<Value> ed25519VerifyBatch(const Arguments& args){
+    HandleScope scope;
+    if (args.Length() == 3 || args.Length() == 4){
+        if (!(args[0]->IsArray() && args[1]->IsArray() && args[2]->IsArray())){
+            ThrowException(v8::Exception::TypeError(String::New("messages, signatures and publicKeys must be arrays")));
+            return scope.Close(Undefined());
+        }
+        Local<Array> messagesArray = Local<Array>::Cast(args[0]), signaturesArray = Local<Array>::Cast(args[1]), publicKeysArray = Local<Array>::Cast(args[2]);
+        if (signaturesArray->Length() != messagesArray->Length() || publicKeysArray->Length() != messagesArray->Length()){
+            ThrowException(v8::Exception::TypeError(String::New("messages, signatures and publicKeys must have the same length")));
+            return scope.Close(Undefined());
+        }
+        try {
+            std::vector<std::string> messages(messagesArray->Length()), signatures(messagesArray->Length()), publicKeys(messagesArray->Length());
+            for (unsigned int i = 0; i < messagesArray->Length(); i++){
+                String::Utf8Value messageVal(messagesArray->Get(i)->ToString());
+                String::AsciiValue signatureVal(signaturesArray->Get(i)->ToString()), publicKeyVal(publicKeysArray->Get(i)->ToString());
+                messages[i] = std::string(*messageVal);
+                signatures[i] = strHexDecode(std::string(*signatureVal));
+                publicKeys[i] = strHexDecode(std::string(*publicKeyVal));
+            }
+            //Method body
+            std::vector<bool> valid;
+            Ed25519_VerifyBatch(publicKeys, messages, signatures, valid);
+            Local<Array> result = Array::New(valid.size());
+            for (unsigned int i = 0; i < valid.size(); i++){
+                result->Set(i, Boolean::New(valid[i]));
+            }
+            //Returning the result
+            if (args.Length() == 3){
+                return scope.Close(result);
+            } else {
+                Local<Function> callback = Local<Function>::Cast(args[3]);
+                const unsigned argc = 1;
+                Local<Value> argv[argc] = { Local<Value>::New(result) };
+                callback->Call(Context::GetCurrent()->Global(), argc, argv);
+                return scope.Close(Undefined());
+            }
+        } catch (CryptoPP::Exception& e){
+            ThrowException(v8::Exception::Error(String::New(e.what())));
+            return scope.Close(Undefined());
+        }
+    } else {
+        ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+        return scope.Close(Undefined());
+    }
+}
+
 // Lib initialization method
 void init(Handle<Object> exports){
     // Binding the keyManager class
     KeyRing::Init(exports);
+    // Binding the MultiKeyRing class
+    MultiKeyRing::Init(exports);
+    // Setting the cryptopp.aead object
+    AEAD_Init(exports);
+    // Setting the cryptopp.kdf object
+    KDF_Init(exports);
+    // Setting the cryptopp.kekCache object
+    KEKCache_Init(exports);
     // Setting the cryptopp.hex object
 	Local<Object> hexObj = Object::New();
 	hexObj->Set(String::NewSymbol("encode"), FunctionTemplate::New(hexEncode)->GetFunction());
@@ -1527,8 +2313,10 @@ void init(Handle<Object> exports){
     base64Obj->Set(String::NewSymbol("encode"), FunctionTemplate::New(base64Encode)->GetFunction());
     base64Obj->Set(String::NewSymbol("decode"), FunctionTemplate::New(base64Decode)->GetFunction());
     exports->Set(String::NewSymbol("base64"), base64Obj);
-    // Setting the generateBytes method
-    exports->Set(String::NewSymbol("randomBytes"), FunctionTemplate::New(randomBytes)->GetFunction());
+    // Setting the randomBytes and randomFill methods
+    Random_Init(exports);
+    // Setting the hardwareSupport method
+    exports->Set(String::NewSymbol("hardwareSupport"), FunctionTemplate::New(hardwareSupport)->GetFunction());
     //Setting the cryptopp.ecies object
     Local<Object> eciesObj = Object::New();
     Local<Object> eciesPrimeObj = Object::New();
@@ -1536,6 +2324,7 @@ void init(Handle<Object> exports){
     eciesPrimeObj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(eciesGenerateKeyPairP)->GetFunction());
     eciesPrimeObj->Set(String::NewSymbol("encrypt"), FunctionTemplate::New(eciesEncryptP)->GetFunction());
     eciesPrimeObj->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(eciesDecryptP)->GetFunction());
+    eciesPrimeObj->Set(String::NewSymbol("encryptMulti"), FunctionTemplate::New(eciesEncryptMultiP)->GetFunction());
     eciesBinaryObj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(eciesGenerateKeyPairB)->GetFunction());
     eciesBinaryObj->Set(String::NewSymbol("encrypt"), FunctionTemplate::New(eciesEncryptB)->GetFunction());
     eciesBinaryObj->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(eciesDecryptB)->GetFunction());
@@ -1548,6 +2337,7 @@ void init(Handle<Object> exports){
     Local<Object> ecdsaBinaryObj = Object::New();
     ecdsaPrimeObj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(ecdsaGenerateKeyPairP)->GetFunction());
     ecdsaPrimeObj->Set(String::NewSymbol("sign"), FunctionTemplate::New(ecdsaSignMessageP)->GetFunction());
+    ecdsaPrimeObj->Set(String::NewSymbol("signBatch"), FunctionTemplate::New(ecdsaSignBatchP)->GetFunction());
     ecdsaPrimeObj->Set(String::NewSymbol("verify"), FunctionTemplate::New(ecdsaVerifyMessageP)->GetFunction());
     ecdsaBinaryObj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(ecdsaGenerateKeyPairB)->GetFunction());
     ecdsaBinaryObj->Set(String::NewSymbol("sign"), FunctionTemplate::New(ecdsaSignMessageB)->GetFunction());
@@ -1566,6 +2356,18 @@ void init(Handle<Object> exports){
     ecdhObj->Set(String::NewSymbol("prime"), ecdhPrimeObj);
     ecdhObj->Set(String::NewSymbol("binary"), ecdhBinaryObj);
     exports->Set(String::NewSymbol("ecdh"), ecdhObj);
+    //Setting the cryptopp.ecpoint object
+    Local<Object> ecpointObj = Object::New();
+    Local<Object> ecpointPrimeObj = Object::New();
+    Local<Object> ecpointBinaryObj = Object::New();
+    ecpointPrimeObj->Set(String::NewSymbol("compress"), FunctionTemplate::New(ecpointCompressP)->GetFunction());
+    ecpointPrimeObj->Set(String::NewSymbol("decompress"), FunctionTemplate::New(ecpointDecompressP)->GetFunction());
+    ecpointBinaryObj->Set(String::NewSymbol("compress"), FunctionTemplate::New(ecpointCompressB)->GetFunction());
+    ecpointBinaryObj->Set(String::NewSymbol("decompress"), FunctionTemplate::New(ecpointDecompressB)->GetFunction());
+    ecpointObj->Set(String::NewSymbol("prime"), ecpointPrimeObj);
+    ecpointObj->Set(String::NewSymbol("binary"), ecpointBinaryObj);
+    ecpointObj->Set(String::NewSymbol("cacheCapacity"), FunctionTemplate::New(ecpointCacheCapacity)->GetFunction());
+    exports->Set(String::NewSymbol("ecpoint"), ecpointObj);
     //Setting the cryptopp.rsa object
     Local<Object> rsaObj = Object::New();
     rsaObj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(rsaGenerateKeyPair)->GetFunction());
@@ -1580,6 +2382,18 @@ void init(Handle<Object> exports){
     dsaObj->Set(String::NewSymbol("sign"), FunctionTemplate::New(dsaSign)->GetFunction());
     dsaObj->Set(String::NewSymbol("verify"), FunctionTemplate::New(dsaVerify)->GetFunction());
     exports->Set(String::NewSymbol("dsa"), dsaObj);
+    //Setting the cryptopp.x25519 object
+    Local<Object> x25519Obj = Object::New();
+    x25519Obj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(x25519GenerateKeyPair)->GetFunction());
+    x25519Obj->Set(String::NewSymbol("agree"), FunctionTemplate::New(x25519Agree)->GetFunction());
+    exports->Set(String::NewSymbol("x25519"), x25519Obj);
+    //Setting the cryptopp.ed25519 object
+    Local<Object> ed25519Obj = Object::New();
+    ed25519Obj->Set(String::NewSymbol("generateKeyPair"), FunctionTemplate::New(ed25519GenerateKeyPair)->GetFunction());
+    ed25519Obj->Set(String::NewSymbol("sign"), FunctionTemplate::New(ed25519Sign)->GetFunction());
+    ed25519Obj->Set(String::NewSymbol("verify"), FunctionTemplate::New(ed25519Verify)->GetFunction());
+    ed25519Obj->Set(String::NewSymbol("verifyBatch"), FunctionTemplate::New(ed25519VerifyBatch)->GetFunction());
+    exports->Set(String::NewSymbol("ed25519"), ed25519Obj);
 }
 
 NODE_MODULE(cryptopp, init)
@@ -0,0 +1,97 @@
+#include <vector>
+
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+#include "noncepool.h"
+#include "fastec.h"
+
+using namespace std;
+
+NoncePool::NoncePool(string const& curveName, OID const& curve, unsigned int size, unsigned int refillThreshold) : curveName_(curveName), params_(curve), size_(size), refillThreshold_(refillThreshold), refilling_(false), released_(false){
+	q_ = params_.GetSubgroupOrder();
+	if (refillThreshold_ >= size_) refillThreshold_ = size_ - 1;
+	uv_mutex_init(&mutex_);
+	refillReq_.data = this;
+	ScheduleRefill();
+}
+
+NoncePool::~NoncePool(){
+	for (deque<Tuple*>::iterator it = tuples_.begin(); it != tuples_.end(); it++){
+		delete *it;
+	}
+	tuples_.clear();
+	uv_mutex_destroy(&mutex_);
+}
+
+void NoncePool::Release(NoncePool* pool){
+	if (pool == 0) return;
+	//Whether a refill is running is only changed on the main thread, no need to lock here
+	if (pool->refilling_) pool->released_ = true;
+	else delete pool;
+}
+
+unsigned int NoncePool::Available(){
+	uv_mutex_lock(&mutex_);
+	unsigned int available = tuples_.size();
+	uv_mutex_unlock(&mutex_);
+	return available;
+}
+
+NoncePool::Tuple* NoncePool::Take(){
+	Tuple* tuple = 0;
+	uv_mutex_lock(&mutex_);
+	if (!tuples_.empty()){
+		tuple = tuples_.front();
+		tuples_.pop_front();
+	}
+	unsigned int available = tuples_.size();
+	uv_mutex_unlock(&mutex_);
+	if (available <= refillThreshold_) ScheduleRefill();
+	return tuple;
+}
+
+void NoncePool::ScheduleRefill(){
+	if (refilling_ || released_) return;
+	refilling_ = true;
+	uv_queue_work(uv_default_loop(), &refillReq_, RefillWork, RefillDone);
+}
+
+//Runs on a worker thread : the scalar multiplications happen here
+void NoncePool::RefillWork(uv_work_t* req){
+	NoncePool* pool = static_cast<NoncePool*>(req->data);
+	uv_mutex_lock(&pool->mutex_);
+	unsigned int missing = pool->size_ - pool->tuples_.size();
+	uv_mutex_unlock(&pool->mutex_);
+	if (missing == 0) return;
+	AutoSeededRandomPool prng;
+	const Integer& q = pool->params_.GetSubgroupOrder();
+	FastEC const* fast = FastEC::For(pool->params_);
+	vector<Tuple*> batch;
+	batch.reserve(missing);
+	while (batch.size() < missing){
+		Tuple* tuple = new Tuple();
+		tuple->k.Randomize(prng, Integer::One(), q - 1);
+		if (fast != 0){
+			Integer y;
+			fast->MultiplyBase(tuple->k, tuple->r, y);
+			tuple->r %= q;
+		} else tuple->r = pool->params_.ConvertElementToInteger(pool->params_.ExponentiateBase(tuple->k)) % q;
+		if (tuple->r.IsZero()){
+			delete tuple;
+			continue;
+		}
+		tuple->kInv = tuple->k.InverseMod(q);
+		batch.push_back(tuple);
+	}
+	uv_mutex_lock(&pool->mutex_);
+	pool->tuples_.insert(pool->tuples_.end(), batch.begin(), batch.end());
+	uv_mutex_unlock(&pool->mutex_);
+}
+
+//Back on the main thread
+void NoncePool::RefillDone(uv_work_t* req, int status){
+	NoncePool* pool = static_cast<NoncePool*>(req->data);
+	pool->refilling_ = false;
+	if (pool->released_) delete pool;
+}
@@ -0,0 +1,84 @@
+#ifndef NONCEPOOL_H
+#define NONCEPOOL_H
+
+#include <string>
+#include <deque>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::DL_GroupParameters_EC;
+#include <cryptopp/asn.h>
+using CryptoPP::OID;
+
+#include <uv.h>
+
+#include "rfc6979.h"
+
+/*
+* Pool of precomputed ECDSA nonces, (k, k^-1 mod n, r = x(kG) mod n), for one curve.
+* The pool is refilled on the libuv thread pool when it runs low, so that the online part of a signature is only s = k^-1 * (e + x * r) mod n.
+* A tuple is removed from the pool when it's used, and its Integers (whose limbs live in SecBlocks) are zeroed when it is freed.
+* The pool must be created, used and released from the main thread.
+*/
+class NoncePool {
+
+public:
+	NoncePool(std::string const& curveName, OID const& curve, unsigned int size = 64, unsigned int refillThreshold = 16);
+	//Frees the pool, or defers it to the end of the refill job if one is running
+	static void Release(NoncePool* pool);
+
+	std::string const& CurveName() const { return curveName_; }
+	unsigned int Size() const { return size_; }
+	unsigned int RefillThreshold() const { return refillThreshold_; }
+	unsigned int Available();
+
+	//Signs the message with the next tuple. Returns false (without touching signature) if the pool is empty
+	template <class H>
+	bool Sign(Integer const& x, std::string const& message, std::string& signature);
+
+private:
+	struct Tuple {
+		Integer k, kInv, r;
+	};
+
+	~NoncePool();
+	Tuple* Take();
+	void ScheduleRefill();
+	static void RefillWork(uv_work_t* req);
+	static void RefillDone(uv_work_t* req, int status);
+
+	std::string curveName_;
+	//Only used by the refill job, Crypto++ group parameters are not safe to share between threads
+	DL_GroupParameters_EC<ECP> params_;
+	//Subgroup order, for the main thread
+	Integer q_;
+	unsigned int size_, refillThreshold_;
+	std::deque<Tuple*> tuples_;
+	uv_mutex_t mutex_;
+	uv_work_t refillReq_;
+	bool refilling_;
+	bool released_;
+};
+
+template <class H>
+bool NoncePool::Sign(Integer const& x, std::string const& message, std::string& signature){
+	Tuple* tuple = Take();
+	if (tuple == 0) return false;
+	byte digest[H::DIGESTSIZE];
+	H().CalculateDigest(digest, (const byte*) message.data(), message.size());
+	const Integer e = RFC6979_bits2int(digest, sizeof(digest), q_.BitCount());
+	const Integer s = (tuple->kInv * (e + x * tuple->r)) % q_;
+	bool success = s.NotZero();
+	if (success){
+		const size_t qLength = q_.ByteCount();
+		signature.assign(2 * qLength, '\0');
+		tuple->r.Encode((byte*) &signature[0], qLength);
+		s.Encode((byte*) &signature[qLength], qLength);
+	}
+	delete tuple;
+	return success;
+}
+
+#endif
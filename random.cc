@@ -0,0 +1,441 @@
+//Std imports
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+//POSIX imports
+#include <pthread.h>
+
+//Crypto++ imports
+#include <cryptopp/osrng.h>
+using CryptoPP::AutoSeededRandomPool;
+
+#include <cryptopp/filters.h>
+using CryptoPP::StringSource;
+using CryptoPP::StringSink;
+
+#include <cryptopp/hex.h>
+using CryptoPP::HexEncoder;
+
+#include <cryptopp/base64.h>
+using CryptoPP::Base64Encoder;
+
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+
+//Node and class headers import
+#include <node.h>
+#include <node_buffer.h>
+#include "random.h"
+#include "secarena.h"
+#include "threadpool.h"
+
+using namespace v8;
+using namespace std;
+
+struct ThreadGenerator {
+	AutoSeededRandomPool pool;
+	//Bytes generated since the pool was last seeded
+	size_t generated;
+	ThreadGenerator() : generated(0){}
+};
+
+static pthread_once_t generatorKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t generatorKey;
+
+static void deleteGenerator(void* generator){
+	delete static_cast<ThreadGenerator*>(generator);
+}
+
+static void createGeneratorKey(){
+	pthread_key_create(&generatorKey, deleteGenerator);
+}
+
+static ThreadGenerator& threadGenerator(){
+	pthread_once(&generatorKeyOnce, createGeneratorKey);
+	ThreadGenerator* generator = static_cast<ThreadGenerator*>(pthread_getspecific(generatorKey));
+	if (generator == 0){
+		//Seeded from the OS on construction
+		generator = new ThreadGenerator();
+		pthread_setspecific(generatorKey, generator);
+	}
+	return *generator;
+}
+
+void Random_Generate(byte* output, size_t length){
+	ThreadGenerator& generator = threadGenerator();
+	while (length > 0){
+		if (generator.generated >= RANDOM_RESEED_INTERVAL){
+			generator.pool.Reseed();
+			generator.generated = 0;
+		}
+		const size_t n = min(length, RANDOM_RESEED_INTERVAL - generator.generated);
+		generator.pool.GenerateBlock(output, n);
+		generator.generated += n;
+		output += n;
+		length -= n;
+	}
+}
+
+/*
+* The main thread's buffered bytes. current has its bytes from position on left to hand out, spare is being refilled or ready.
+* Only used from the main thread : the refill job only writes to spare, which isn't read until the job is done
+*/
+struct RandomBuffer {
+	byte* current;
+	byte* spare;
+	size_t position;
+	bool spareReady, refilling;
+	uv_work_t refillRequest;
+	//Set by the refill job
+	bool refillFailed;
+};
+
+static RandomBuffer randomBuffer;
+
+static void RefillWork(uv_work_t* req){
+	try {
+		Random_Generate(randomBuffer.spare, RANDOM_BUFFER_SIZE);
+		randomBuffer.refillFailed = false;
+	} catch (CryptoPP::Exception& e){
+		randomBuffer.refillFailed = true;
+	}
+}
+
+//Back on the main thread. If the refill failed, the next swap queues another one
+static void RefillDone(uv_work_t* req, int status){
+	randomBuffer.refilling = false;
+	randomBuffer.spareReady = !randomBuffer.refillFailed;
+}
+
+static void queueRefill(){
+	randomBuffer.refilling = true;
+	uv_queue_work(uv_default_loop(), &randomBuffer.refillRequest, RefillWork, RefillDone);
+}
+
+//Swaps the buffers if the spare one is ready, and queues the refill of the used up one. Returns false if it isn't ready
+static bool swapBuffers(){
+	if (randomBuffer.current == 0){
+		//First use : the buffers are never released, as the main thread lives as long as the process
+		randomBuffer.current = static_cast<byte*>(SecureArena_Allocate(RANDOM_BUFFER_SIZE));
+		randomBuffer.spare = static_cast<byte*>(SecureArena_Allocate(RANDOM_BUFFER_SIZE));
+		Random_Generate(randomBuffer.current, RANDOM_BUFFER_SIZE);
+		randomBuffer.position = 0;
+		queueRefill();
+		return true;
+	}
+	if (!randomBuffer.spareReady){
+		if (!randomBuffer.refilling) queueRefill();
+		return false;
+	}
+	std::swap(randomBuffer.current, randomBuffer.spare);
+	randomBuffer.position = 0;
+	randomBuffer.spareReady = false;
+	queueRefill();
+	return true;
+}
+
+//Main thread only. Copies length bytes from the buffer to output, and wipes them from the buffer
+static void readBuffered(byte* output, size_t length){
+	if (length > RANDOM_BUFFERED_MAX_REQUEST){
+		Random_Generate(output, length);
+		return;
+	}
+	while (length > 0){
+		if ((randomBuffer.current == 0 || randomBuffer.position == RANDOM_BUFFER_SIZE) && !swapBuffers()){
+			//The refill is late
+			Random_Generate(output, length);
+			return;
+		}
+		const size_t n = min(length, RANDOM_BUFFER_SIZE - randomBuffer.position);
+		memcpy(output, randomBuffer.current + randomBuffer.position, n);
+		SecureWipeArray(randomBuffer.current + randomBuffer.position, n);
+		randomBuffer.position += n;
+		output += n;
+		length -= n;
+	}
+}
+
+enum RandomEncoding {
+	RANDOM_HEX,
+	RANDOM_BASE64,
+	RANDOM_BUFFER
+};
+
+static Local<Value> encodeBytes(const byte* bytes, size_t length, RandomEncoding encoding){
+	string encoded;
+	if (encoding == RANDOM_HEX) StringSource(bytes, length, true, new HexEncoder(new StringSink(encoded)));
+	else StringSource(bytes, length, true, new Base64Encoder(new StringSink(encoded), false)); // "False" parameter prevents inserting line breaks
+	return String::New(encoded.data(), encoded.size());
+}
+
+/*
+* A generation running on the thread pool, split into jobs that each fill their own slice of the output.
+* The output is the Buffer (kept alive until the task is done), or a scratch buffer for the string encodings
+*/
+struct RandomTask {
+	RandomEncoding encoding;
+	byte* output;
+	size_t length;
+	ArenaByteBlock bytes;
+	//Jobs not done yet
+	size_t pending;
+	string error;
+	Persistent<Object> outputHandle;
+	Persistent<Function> callback;
+};
+
+struct RandomJob {
+	uv_work_t request;
+	RandomTask* task;
+	size_t offset, length;
+	string error;
+};
+
+static void RandomWork(uv_work_t* req){
+	RandomJob* job = static_cast<RandomJob*>(req->data);
+	try {
+		Random_Generate(job->task->output + job->offset, job->length);
+	} catch (CryptoPP::Exception& e){
+		job->error = e.what();
+	}
+}
+
+//Back on the main thread. The last job to finish calls the callback, with (bytes) or (undefined, error)
+static void RandomDone(uv_work_t* req, int status){
+	HandleScope scope;
+	RandomJob* job = static_cast<RandomJob*>(req->data);
+	RandomTask* task = job->task;
+	if (task->error.empty()) task->error = job->error;
+	delete job;
+	if (--task->pending > 0) return;
+	Local<Function> callback = Local<Function>::New(task->callback);
+	const unsigned argc = 2;
+	Local<Value> argv[argc] = { Local<Value>::New(Undefined()), Local<Value>::New(Undefined()) };
+	if (!task->error.empty()) argv[1] = v8::Exception::Error(String::New(task->error.c_str()));
+	else if (task->encoding == RANDOM_BUFFER) argv[0] = Local<Value>::New(task->outputHandle);
+	else argv[0] = encodeBytes(task->output, task->length, task->encoding);
+	task->outputHandle.Dispose();
+	task->callback.Dispose();
+	delete task;
+	node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
+}
+
+static void queueTask(Local<Function> callback, RandomEncoding encoding, Local<Object> buffer, byte* output, size_t length){
+	RandomTask* task = new RandomTask();
+	task->encoding = encoding;
+	task->length = length;
+	if (encoding == RANDOM_BUFFER){
+		task->output = output;
+		task->outputHandle = Persistent<Object>::New(buffer);
+	} else {
+		task->bytes.New(length);
+		task->output = task->bytes.BytePtr();
+	}
+	task->callback = Persistent<Function>::New(callback);
+	//Slices of RANDOM_ASYNC_THRESHOLD bytes at least, spread evenly over the jobs
+	const size_t slices = length / RANDOM_ASYNC_THRESHOLD;
+	const size_t jobs = slices < ThreadPoolSize() ? slices : ThreadPoolSize();
+	task->pending = jobs;
+	for (size_t i = 0, offset = 0; i < jobs; i++){
+		RandomJob* job = new RandomJob();
+		job->request.data = job;
+		job->task = task;
+		job->offset = offset;
+		job->length = length / jobs + (i < length % jobs ? 1 : 0);
+		offset += job->length;
+		uv_queue_work(uv_default_loop(), &job->request, RandomWork, RandomDone);
+	}
+}
+
+/*
+* Fills length bytes, and returns them (or passes them to the callback). For RANDOM_BUFFER, output is in the given Buffer, which is the result.
+* For the string encodings, bytes are generated in a scratch buffer (wiped afterwards) and buffer and output are ignored.
+* With a callback, outputs of RANDOM_ASYNC_THRESHOLD bytes or more are filled on the thread pool
+*/
+static Handle<Value> generate(Local<Value> callbackVal, RandomEncoding encoding, Local<Object> buffer, byte* output, size_t length){
+	HandleScope scope;
+	const bool hasCallback = !callbackVal.IsEmpty() && !callbackVal->IsUndefined();
+	if (hasCallback && !callbackVal->IsFunction()){
+		ThrowException(v8::Exception::TypeError(String::New("callback must be a function")));
+		return scope.Close(Undefined());
+	}
+	if (hasCallback && length >= RANDOM_ASYNC_THRESHOLD){
+		queueTask(Local<Function>::Cast(callbackVal), encoding, buffer, output, length);
+		return scope.Close(Undefined());
+	}
+	Local<Value> result;
+	try {
+		if (encoding == RANDOM_BUFFER){
+			Random_Generate(output, length);
+			result = buffer;
+		} else {
+			ArenaByteBlock bytes(length);
+			Random_Generate(bytes.BytePtr(), length);
+			result = encodeBytes(bytes.BytePtr(), length, encoding);
+		}
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	if (!hasCallback) return scope.Close(result);
+	Local<Function> callback = Local<Function>::Cast(callbackVal);
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { result };
+	callback->Call(Context::GetCurrent()->Global(), argc, argv);
+	return scope.Close(Undefined());
+}
+
+//A byte count, between 0 and RANDOM_MAX_LENGTH. Throws a TypeError or a RangeError and returns false otherwise
+static bool getLength(Local<Value> value, const char* name, size_t& length){
+	if (!value->IsUint32()){
+		ThrowException(v8::Exception::TypeError(String::New((string(name) + " must be a non-negative integer").c_str())));
+		return false;
+	}
+	length = value->Uint32Value();
+	if (length > RANDOM_MAX_LENGTH){
+		ThrowException(v8::Exception::RangeError(String::New((string(name) + " must be at most 1073741823").c_str())));
+		return false;
+	}
+	return true;
+}
+
+/*
+* Method signature : cryptopp.randomBytes(length, [encoding], [callback(bytes)]) or cryptopp.randomBytes(buffer, [callback(buffer)])
+* encoding is "hex" (default), "base64" or "buffer". The callback can take the place of encoding. Given a Buffer, fills all of it
+*/
+static Handle<Value> randomBytes(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() < 1 || args.Length() > 3 || (node::Buffer::HasInstance(args[0]) && args.Length() > 2)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	if (node::Buffer::HasInstance(args[0])){
+		Local<Object> buffer = args[0]->ToObject();
+		return scope.Close(generate(args.Length() == 2 ? args[1] : Local<Value>(), RANDOM_BUFFER, buffer, (byte*) node::Buffer::Data(buffer), node::Buffer::Length(buffer)));
+	}
+	size_t length;
+	if (!getLength(args[0], "length", length)) return scope.Close(Undefined());
+	RandomEncoding encoding = RANDOM_HEX;
+	const bool callbackAsEncoding = args.Length() == 2 && args[1]->IsFunction();
+	if (args.Length() >= 2 && !args[1]->IsUndefined() && !callbackAsEncoding){
+		String::AsciiValue encodingVal(args[1]->ToString());
+		const string encodingName(*encodingVal);
+		if (encodingName == "hex") encoding = RANDOM_HEX;
+		else if (encodingName == "base64") encoding = RANDOM_BASE64;
+		else if (encodingName == "buffer") encoding = RANDOM_BUFFER;
+		else {
+			ThrowException(v8::Exception::TypeError(String::New("When used, the \"encoding\" parameters must either be \"hex\" for hexadecimal, \"base64\" for Base64 encoding or \"buffer\" for a Buffer")));
+			return scope.Close(Undefined());
+		}
+	}
+	Local<Value> callbackVal = callbackAsEncoding ? args[1] : (args.Length() == 3 ? args[2] : Local<Value>());
+	if (encoding != RANDOM_BUFFER) return scope.Close(generate(callbackVal, encoding, Local<Object>(), 0, length));
+	Local<Object> buffer = Local<Object>::New(node::Buffer::New(length)->handle_);
+	return scope.Close(generate(callbackVal, RANDOM_BUFFER, buffer, (byte*) node::Buffer::Data(buffer), length));
+}
+
+/*
+* Method signature : cryptopp.randomFill(buffer, [offset], [length], [callback(buffer)])
+* Fills length bytes of the Buffer (up to its end by default) from offset (0 by default), and returns it. The callback is the last parameter
+*/
+static Handle<Value> randomFill(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() < 1 || args.Length() > 4){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	if (!node::Buffer::HasInstance(args[0])){
+		ThrowException(v8::Exception::TypeError(String::New("buffer must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> buffer = args[0]->ToObject();
+	const size_t bufferLength = node::Buffer::Length(buffer);
+	const int callbackIndex = args.Length() > 1 && args[args.Length() - 1]->IsFunction() ? args.Length() - 1 : args.Length();
+	if (callbackIndex == 4){
+		ThrowException(v8::Exception::TypeError(String::New("callback must be a function")));
+		return scope.Close(Undefined());
+	}
+	size_t offset = 0;
+	if (callbackIndex > 1 && !args[1]->IsUndefined() && !getLength(args[1], "offset", offset)) return scope.Close(Undefined());
+	if (offset > bufferLength){
+		ThrowException(v8::Exception::RangeError(String::New("offset is out of the buffer's bounds")));
+		return scope.Close(Undefined());
+	}
+	size_t length = bufferLength - offset;
+	if (callbackIndex > 2 && !args[2]->IsUndefined()){
+		if (!getLength(args[2], "length", length)) return scope.Close(Undefined());
+		if (length > bufferLength - offset){
+			ThrowException(v8::Exception::RangeError(String::New("offset + length is out of the buffer's bounds")));
+			return scope.Close(Undefined());
+		}
+	}
+	Local<Value> callbackVal = callbackIndex < args.Length() ? args[callbackIndex] : Local<Value>();
+	return scope.Close(generate(callbackVal, RANDOM_BUFFER, buffer, (byte*) node::Buffer::Data(buffer) + offset, length));
+}
+
+//Method signature : cryptopp.random.bytes(length) : a new Buffer of random bytes
+static Handle<Value> randomBufferedBytes(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() != 1){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	size_t length;
+	if (!getLength(args[0], "length", length)) return scope.Close(Undefined());
+	Local<Object> buffer = Local<Object>::New(node::Buffer::New(length)->handle_);
+	try {
+		readBuffered((byte*) node::Buffer::Data(buffer), length);
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(buffer);
+}
+
+//No params. A random integer between 0 and 2^32 - 1
+static Handle<Value> randomBufferedUint32(const Arguments& args){
+	HandleScope scope;
+	byte bytes[4];
+	try {
+		readBuffered(bytes, sizeof(bytes));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	const uint32_t value = ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | (uint32_t) bytes[3];
+	SecureWipeArray(bytes, sizeof(bytes));
+	return scope.Close(v8::Integer::NewFromUnsigned(value));
+}
+
+//Method signature : cryptopp.random.fill(buffer) : fills the Buffer, and returns it
+static Handle<Value> randomBufferedFill(const Arguments& args){
+	HandleScope scope;
+	if (args.Length() != 1){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	if (!node::Buffer::HasInstance(args[0])){
+		ThrowException(v8::Exception::TypeError(String::New("buffer must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	Local<Object> buffer = args[0]->ToObject();
+	try {
+		readBuffered((byte*) node::Buffer::Data(buffer), node::Buffer::Length(buffer));
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(buffer);
+}
+
+void Random_Init(Handle<Object> exports){
+	exports->Set(String::NewSymbol("randomBytes"), FunctionTemplate::New(randomBytes)->GetFunction());
+	exports->Set(String::NewSymbol("randomFill"), FunctionTemplate::New(randomFill)->GetFunction());
+	Local<Object> randomObj = Object::New();
+	randomObj->Set(String::NewSymbol("bytes"), FunctionTemplate::New(randomBufferedBytes)->GetFunction());
+	randomObj->Set(String::NewSymbol("uint32"), FunctionTemplate::New(randomBufferedUint32)->GetFunction());
+	randomObj->Set(String::NewSymbol("fill"), FunctionTemplate::New(randomBufferedFill)->GetFunction());
+	exports->Set(String::NewSymbol("random"), randomObj);
+}
@@ -0,0 +1,36 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstddef>
+
+#include <cryptopp/config.h>
+
+#include <node.h>
+
+#include "buffers.h"
+
+/*
+* Random bytes : cryptopp.randomBytes(), cryptopp.randomFill() and cryptopp.random.
+* Each thread (the main thread and the libuv pool's) has its own generator, an AutoSeededRandomPool seeded from the OS on first use
+* and reseeded every RANDOM_RESEED_INTERVAL bytes, so that a call only costs the generation itself. Bytes are written straight
+* into the output Buffer. With a callback, outputs of RANDOM_ASYNC_THRESHOLD bytes or more are filled on the thread pool,
+* in slices that run in parallel.
+*
+* cryptopp.random serves small requests (session IDs, tokens, nonces) from a buffer of RANDOM_BUFFER_SIZE bytes on the arena (see secarena.h) :
+* a request is a memcpy, the bytes handed out being wiped from the buffer. A second buffer is refilled on the thread pool while the first
+* one is used up, the two being swapped when it is. Requests over RANDOM_BUFFERED_MAX_REQUEST bytes, and requests made while a refill
+* is late, are generated directly. The buffers are the main thread's, where JS runs; the thread pool's threads use their own generators.
+*/
+static const size_t RANDOM_RESEED_INTERVAL = 1024 * 1024;
+static const size_t RANDOM_ASYNC_THRESHOLD = 64 * 1024;
+static const size_t RANDOM_BUFFER_SIZE = 4096;
+static const size_t RANDOM_BUFFERED_MAX_REQUEST = 1024;
+static const size_t RANDOM_MAX_LENGTH = BUFFER_MAX_LENGTH;
+
+//Fills output with length bytes from the calling thread's generator. Throws a CryptoPP::OS_RNG_Err if the generator can't be seeded
+void Random_Generate(byte* output, size_t length);
+
+//Sets cryptopp.randomBytes, cryptopp.randomFill and the cryptopp.random object
+void Random_Init(v8::Handle<v8::Object> exports);
+
+#endif
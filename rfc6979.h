@@ -0,0 +1,125 @@
+#ifndef RFC6979_H
+#define RFC6979_H
+
+#include <string>
+#include <cstring>
+
+#include <cryptopp/integer.h>
+using CryptoPP::Integer;
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+#include <cryptopp/hmac.h>
+using CryptoPP::HMAC;
+#include <cryptopp/eccrypto.h>
+using CryptoPP::ECP;
+using CryptoPP::ECPPoint;
+using CryptoPP::DL_GroupParameters_EC;
+
+#include "secarena.h"
+
+/*
+* Deterministic ECDSA nonces (RFC 6979, section 3.2).
+* The nonce k is derived with HMAC_DRBG, seeded with the private key and the message digest. Signing then doesn't draw any entropy
+* and the same (key, message, hash) triplet always gives the same signature.
+*/
+
+//bits2int : the leftmost qlen bits of the given byte string, as an integer
+inline Integer RFC6979_bits2int(const byte* data, size_t length, unsigned int qlen){
+	Integer x(data, length);
+	if (length * 8 > qlen) x >>= (length * 8 - qlen);
+	return x;
+}
+
+template <class H>
+class RFC6979_NonceGenerator {
+public:
+	RFC6979_NonceGenerator(Integer const& q, Integer const& x, const byte* digest, size_t digestLength) : q_(q), qlen_(q.BitCount()), rlen_((q.BitCount() + 7) / 8), V_(H::DIGESTSIZE), K_(H::DIGESTSIZE){
+		//int2octets(x) || bits2octets(h1)
+		ArenaByteBlock seed(2 * rlen_);
+		x.Encode(seed.BytePtr(), rlen_);
+		Integer z = RFC6979_bits2int(digest, digestLength, qlen_);
+		if (z >= q_) z -= q_;
+		z.Encode(seed.BytePtr() + rlen_, rlen_);
+		//Steps b. to g.
+		memset(V_.BytePtr(), 0x01, V_.size());
+		memset(K_.BytePtr(), 0x00, K_.size());
+		Reseed(seed.BytePtr(), seed.size());
+	}
+
+	//Step h. Each call gives the next candidate, so a caller can ask for another k if r or s turns out to be 0
+	Integer NextK(){
+		while (true){
+			ArenaByteBlock T(rlen_);
+			size_t tlen = 0;
+			while (tlen < rlen_){
+				Update(V_);
+				size_t n = V_.size() < rlen_ - tlen ? V_.size() : rlen_ - tlen;
+				memcpy(T.BytePtr() + tlen, V_.BytePtr(), n);
+				tlen += n;
+			}
+			Integer k = RFC6979_bits2int(T.BytePtr(), T.size(), qlen_);
+			//Preparing the state for a potential next call
+			byte zero = 0x00;
+			HMAC<H> hmac(K_.BytePtr(), K_.size());
+			hmac.Update(V_.BytePtr(), V_.size());
+			hmac.Update(&zero, 1);
+			hmac.Final(K_.BytePtr());
+			Update(V_);
+			if (k.NotZero() && k < q_) return k;
+		}
+	}
+
+private:
+	//K = HMAC_K(V || 0x00 || seed); V = HMAC_K(V); K = HMAC_K(V || 0x01 || seed); V = HMAC_K(V)
+	void Reseed(const byte* seed, size_t seedLength){
+		for (byte i = 0x00; i <= 0x01; i++){
+			HMAC<H> hmac(K_.BytePtr(), K_.size());
+			hmac.Update(V_.BytePtr(), V_.size());
+			hmac.Update(&i, 1);
+			hmac.Update(seed, seedLength);
+			hmac.Final(K_.BytePtr());
+			Update(V_);
+		}
+	}
+
+	//V = HMAC_K(V)
+	void Update(ArenaByteBlock& V){
+		HMAC<H> hmac(K_.BytePtr(), K_.size());
+		hmac.Update(V.BytePtr(), V.size());
+		hmac.Final(V.BytePtr());
+	}
+
+	Integer q_;
+	unsigned int qlen_;
+	size_t rlen_;
+	//HMAC_DRBG state, on the arena as generators are created for every signature
+	ArenaByteBlock V_, K_;
+};
+
+/*
+* ECDSA signature with an RFC 6979 nonce. The output has the same layout as Crypto++'s SignerFilter output (r || s, each as long as the subgroup order)
+* so that the usual verification methods accept it.
+*/
+template <class H>
+std::string ECDSA_DeterministicSign(DL_GroupParameters_EC<ECP> const& params, Integer const& x, std::string const& message){
+	const Integer& q = params.GetSubgroupOrder();
+	byte digest[H::DIGESTSIZE];
+	H().CalculateDigest(digest, (const byte*) message.data(), message.size());
+	//Message representative, computed like Crypto++'s DSA encoding method does (truncated but not reduced)
+	const Integer e = RFC6979_bits2int(digest, sizeof(digest), q.BitCount());
+	RFC6979_NonceGenerator<H> generator(q, x, digest, sizeof(digest));
+	Integer r, s;
+	do {
+		Integer k = generator.NextK();
+		r = params.ConvertElementToInteger(params.ExponentiateBase(k)) % q;
+		if (r.IsZero()) continue;
+		s = (k.InverseMod(q) * (e + x * r)) % q;
+	} while (r.IsZero() || s.IsZero());
+	const size_t qLength = q.ByteCount();
+	std::string signature(2 * qLength, '\0');
+	r.Encode((byte*) &signature[0], qLength);
+	s.Encode((byte*) &signature[qLength], qLength);
+	return signature;
+}
+
+#endif
@@ -0,0 +1,174 @@
+//Std imports
+#include <new>
+#include <stdint.h>
+
+//POSIX imports
+#include <sys/mman.h>
+#include <pthread.h>
+
+//Crypto++ imports
+#include <cryptopp/misc.h>
+using CryptoPP::SecureWipeArray;
+using CryptoPP::UnalignedAllocate;
+using CryptoPP::UnalignedDeallocate;
+
+#include "secarena.h"
+
+//Size classes : 32, 64, ..., SECARENA_MAX_BLOCK
+static const size_t MIN_BLOCK = 32;
+static const unsigned int CLASS_COUNT = 8;
+//Slots of the chunk registry. Past that many chunks (across all threads), blocks come from the heap
+static const size_t REGISTRY_SIZE = 4096;
+
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+struct Arena {
+	FreeBlock* freeLists[CLASS_COUNT];
+	//Blocks of this arena released by other threads. Pushed with a CAS, taken all at once by the owner
+	FreeBlock* volatile remoteFrees;
+	size_t chunkCounts[CLASS_COUNT];
+};
+
+//At the start of every chunk, in the place of its first block
+struct ChunkHeader {
+	Arena* owner;
+	size_t blockSize;
+};
+
+static pthread_once_t arenaKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t arenaKey;
+//Bases of the chunks, to tell arena blocks from heap ones on release. Chunks are never unmapped, so slots are only ever set (with a CAS)
+static uintptr_t volatile registry[REGISTRY_SIZE];
+
+static void createArenaKey(){
+	//No destructor : blocks of a thread may be released by others after it has exited, so arenas are never freed.
+	//The threads that use it (main and libuv pool) live as long as the process anyway
+	pthread_key_create(&arenaKey, 0);
+}
+
+static Arena* threadArena(){
+	pthread_once(&arenaKeyOnce, createArenaKey);
+	Arena* arena = static_cast<Arena*>(pthread_getspecific(arenaKey));
+	if (arena == 0){
+		arena = new Arena();
+		pthread_setspecific(arenaKey, arena);
+	}
+	return arena;
+}
+
+static size_t registrySlot(uintptr_t base){
+	return (base / SECARENA_CHUNK_SIZE * 2654435761u) % REGISTRY_SIZE;
+}
+
+static bool isChunk(uintptr_t base){
+	for (size_t i = registrySlot(base), probes = 0; probes < REGISTRY_SIZE; i = (i + 1) % REGISTRY_SIZE, probes++){
+		const uintptr_t slot = registry[i];
+		if (slot == base) return true;
+		if (slot == 0) return false;
+	}
+	return false;
+}
+
+static bool registerChunk(uintptr_t base){
+	for (size_t i = registrySlot(base), probes = 0; probes < REGISTRY_SIZE; i = (i + 1) % REGISTRY_SIZE, probes++){
+		if (registry[i] == 0 && __sync_bool_compare_and_swap(&registry[i], (uintptr_t) 0, base)) return true;
+	}
+	return false;
+}
+
+static unsigned int sizeClass(size_t size){
+	unsigned int sizeClass = 0;
+	for (size_t blockSize = MIN_BLOCK; blockSize < size; blockSize *= 2) sizeClass++;
+	return sizeClass;
+}
+
+//Maps a chunk aligned on its size (so that a block's chunk is found by masking its address), and splits it into blocks of the class. Returns false if it can't be mapped
+static bool addChunk(Arena* arena, unsigned int sizeClass){
+	if (arena->chunkCounts[sizeClass] >= SECARENA_MAX_CLASS_CHUNKS) return false;
+	//Twice the size, the unaligned parts being unmapped
+	void* region = mmap(0, 2 * SECARENA_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED) return false;
+	const uintptr_t start = (uintptr_t) region;
+	const uintptr_t base = (start + SECARENA_CHUNK_SIZE - 1) & ~(uintptr_t) (SECARENA_CHUNK_SIZE - 1);
+	if (base > start) munmap(region, base - start);
+	if (start + 2 * SECARENA_CHUNK_SIZE > base + SECARENA_CHUNK_SIZE) munmap((void*) (base + SECARENA_CHUNK_SIZE), start + SECARENA_CHUNK_SIZE - base);
+	if (!registerChunk(base)){
+		munmap((void*) base, SECARENA_CHUNK_SIZE);
+		return false;
+	}
+	//Still used if it can't be locked (RLIMIT_MEMLOCK being too low)
+	mlock((void*) base, SECARENA_CHUNK_SIZE);
+#ifdef MADV_DONTDUMP
+	madvise((void*) base, SECARENA_CHUNK_SIZE, MADV_DONTDUMP);
+#endif
+	arena->chunkCounts[sizeClass]++;
+	const size_t blockSize = MIN_BLOCK << sizeClass;
+	ChunkHeader* header = reinterpret_cast<ChunkHeader*>(base);
+	header->owner = arena;
+	header->blockSize = blockSize;
+	FreeBlock*& freeList = arena->freeLists[sizeClass];
+	for (uintptr_t block = base + SECARENA_CHUNK_SIZE - blockSize; block > base; block -= blockSize){
+		FreeBlock* freeBlock = reinterpret_cast<FreeBlock*>(block);
+		freeBlock->next = freeList;
+		freeList = freeBlock;
+	}
+	return true;
+}
+
+//Moves the blocks released by other threads back to the free lists
+static void collectRemoteFrees(Arena* arena){
+	FreeBlock* block = __sync_lock_test_and_set(&arena->remoteFrees, (FreeBlock*) 0);
+	while (block != 0){
+		FreeBlock* next = block->next;
+		const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>((uintptr_t) block & ~(uintptr_t) (SECARENA_CHUNK_SIZE - 1));
+		FreeBlock*& freeList = arena->freeLists[sizeClass(header->blockSize)];
+		block->next = freeList;
+		freeList = block;
+		block = next;
+	}
+}
+
+static void* heapAllocate(size_t size){
+	//Throws bad_alloc on failure
+	return UnalignedAllocate(size);
+}
+
+void* SecureArena_Allocate(size_t size){
+	if (size == 0) size = 1;
+	if (size > SECARENA_MAX_BLOCK) return heapAllocate(size);
+	Arena* arena = threadArena();
+	const unsigned int blockClass = sizeClass(size);
+	FreeBlock*& freeList = arena->freeLists[blockClass];
+	if (freeList == 0 && arena->remoteFrees != 0) collectRemoteFrees(arena);
+	if (freeList == 0 && !addChunk(arena, blockClass)) return heapAllocate(size);
+	FreeBlock* block = freeList;
+	freeList = block->next;
+	block->next = 0;
+	return block;
+}
+
+void SecureArena_Release(void* block, size_t size){
+	if (block == 0) return;
+	if (size == 0) size = 1;
+	SecureWipeArray(static_cast<byte*>(block), size);
+	const uintptr_t base = (uintptr_t) block & ~(uintptr_t) (SECARENA_CHUNK_SIZE - 1);
+	if (size > SECARENA_MAX_BLOCK || !isChunk(base)){
+		UnalignedDeallocate(block);
+		return;
+	}
+	Arena* owner = reinterpret_cast<ChunkHeader*>(base)->owner;
+	FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+	if (owner == threadArena()){
+		FreeBlock*& freeList = owner->freeLists[sizeClass(reinterpret_cast<ChunkHeader*>(base)->blockSize)];
+		freeBlock->next = freeList;
+		freeList = freeBlock;
+		return;
+	}
+	FreeBlock* head;
+	do {
+		head = owner->remoteFrees;
+		freeBlock->next = head;
+	} while (!__sync_bool_compare_and_swap(&owner->remoteFrees, head, freeBlock));
+}
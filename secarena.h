@@ -0,0 +1,54 @@
+#ifndef SECARENA_H
+#define SECARENA_H
+
+#include <cstddef>
+
+#include <cryptopp/config.h>
+#include <cryptopp/secblock.h>
+using CryptoPP::AllocatorBase;
+
+/*
+* Allocator for short-lived secrets : private exponents being decoded, derived keys, DRBG states, scratch buffers.
+* Each thread (the main thread and the libuv pool's) has its own slabs : 64KB chunks of mlock'ed pages (excluded from core dumps where madvise
+* allows it), each one split into blocks of a single size, 32 to 4096 bytes. Blocks are wiped when they are released and go back to a free list,
+* so that the sign / decrypt paths reuse the same few pages instead of going through malloc, and secrets only ever live in those pages.
+* Blocks released by another thread than the one that allocated them are handed back to it without a lock.
+* A chunk keeps its block size, and a thread maps at most SECARENA_MAX_CLASS_CHUNKS chunks per block size (1MB in all); larger buffers,
+* and blocks asked for once those are all in use, come from the heap, and are wiped when released too.
+*/
+static const size_t SECARENA_CHUNK_SIZE = 64 * 1024;
+static const size_t SECARENA_MAX_BLOCK = 4096;
+static const size_t SECARENA_MAX_CLASS_CHUNKS = 2;
+
+//Never returns 0 for a non-zero size (throws std::bad_alloc)
+void* SecureArena_Allocate(size_t size);
+//Wipes the size bytes of the block, and releases it. size is the one given to SecureArena_Allocate
+void SecureArena_Release(void* block, size_t size);
+
+//Crypto++ allocator (same interface as AllocatorWithCleanup) on the arena
+template <class T>
+class ArenaAllocator : public AllocatorBase<T> {
+public:
+	CRYPTOPP_INHERIT_ALLOCATOR_TYPES
+
+	pointer allocate(size_type n, const void* = 0){
+		this->CheckSize(n);
+		if (n == 0) return 0;
+		return (pointer) SecureArena_Allocate(n * sizeof(T));
+	}
+
+	void deallocate(void* p, size_type n){
+		if (p != 0) SecureArena_Release(p, n * sizeof(T));
+	}
+
+	pointer reallocate(T* p, size_type oldSize, size_type newSize, bool preserve){
+		return CryptoPP::StandardReallocate(*this, p, oldSize, newSize, preserve);
+	}
+
+	template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+};
+
+//SecByteBlock on the arena, for the module's own secret buffers
+typedef CryptoPP::SecBlock<byte, ArenaAllocator<byte> > ArenaByteBlock;
+
+#endif
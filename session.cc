@@ -0,0 +1,220 @@
+//Std imports
+#include <string>
+#include <cstring>
+#include <memory>
+
+//Crypto++ imports
+#include <cryptopp/cryptlib.h>
+
+//Node and class headers import
+#include <node.h>
+#include <node_buffer.h>
+#include "session.h"
+
+using namespace v8;
+using namespace std;
+
+Persistent<Function> KeySession::constructor;
+
+KeySession::KeySession() : algorithm_(AEAD_AES_GCM), sendSequence_(0), closed_(false){
+}
+
+//SecByteBlocks wipe themselves
+KeySession::~KeySession(){
+}
+
+void KeySession::Init(){
+	//Prepare constructor template
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
+	tpl->SetClassName(String::NewSymbol("KeySession"));
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+	//Prototype
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("encrypt"), FunctionTemplate::New(Encrypt)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("decrypt"), FunctionTemplate::New(Decrypt)->GetFunction());
+	tpl->PrototypeTemplate()->Set(String::NewSymbol("close"), FunctionTemplate::New(Close)->GetFunction());
+	constructor = Persistent<Function>::New(tpl->GetFunction());
+}
+
+Handle<Object> KeySession::Create(AEADAlgorithm algorithm, SecByteBlock const& keyMaterial, bool sendsWithFirstKey){
+	HandleScope scope;
+	//Checking that the algorithm accepts the keys before handing out the session
+	byte iv[SESSION_IV_LENGTH];
+	memset(iv, 0, sizeof(iv));
+	delete AEAD_NewCipher(algorithm, true, keyMaterial.BytePtr(), SESSION_KEY_LENGTH, iv, sizeof(iv), SESSION_TAG_LENGTH);
+	Local<Object> instance = constructor->NewInstance();
+	KeySession* session = ObjectWrap::Unwrap<KeySession>(instance);
+	session->algorithm_ = algorithm;
+	const byte* first = keyMaterial.BytePtr();
+	const byte* second = first + SESSION_KEY_LENGTH + SESSION_IV_LENGTH;
+	const byte* send = sendsWithFirstKey ? first : second;
+	const byte* receive = sendsWithFirstKey ? second : first;
+	session->sendKey_.Assign(send, SESSION_KEY_LENGTH);
+	session->sendIV_.Assign(send + SESSION_KEY_LENGTH, SESSION_IV_LENGTH);
+	session->receiveKey_.Assign(receive, SESSION_KEY_LENGTH);
+	session->receiveIV_.Assign(receive + SESSION_KEY_LENGTH, SESSION_IV_LENGTH);
+	return scope.Close(instance);
+}
+
+Handle<Value> KeySession::New(const Arguments& args){
+	HandleScope scope;
+	KeySession* session = new KeySession();
+	session->Wrap(args.This());
+	return args.This();
+}
+
+//The sequence number is XORed into the last 8 bytes of the base IV
+void KeySession::sequenceIV(SecByteBlock const& baseIV, uint64_t sequence, byte iv[]){
+	memcpy(iv, baseIV.BytePtr(), SESSION_IV_LENGTH);
+	for (size_t i = 0; i < SESSION_SEQUENCE_LENGTH; i++) iv[SESSION_IV_LENGTH - 1 - i] ^= (byte) (sequence >> (8 * i));
+}
+
+//Reads the optional {aad, output} object. Throws a TypeError and returns false if it's invalid
+static bool getSessionOptions(const Arguments& args, string& aad, Local<Value>& output){
+	aad = "";
+	output = Local<Value>::New(Undefined());
+	if (args.Length() < 2 || args[1]->IsUndefined() || args[1]->IsFunction()) return true;
+	if (!args[1]->IsObject()){
+		ThrowException(v8::Exception::TypeError(String::New("options must be an object")));
+		return false;
+	}
+	Local<Object> optionsObj = Local<Object>::Cast(args[1]);
+	Local<Value> aadVal = optionsObj->Get(String::NewSymbol("aad"));
+	if (!aadVal->IsUndefined()){
+		if (!node::Buffer::HasInstance(aadVal)){
+			ThrowException(v8::Exception::TypeError(String::New("aad must be a Buffer")));
+			return false;
+		}
+		aad = string(node::Buffer::Data(aadVal->ToObject()), node::Buffer::Length(aadVal->ToObject()));
+	}
+	output = optionsObj->Get(String::NewSymbol("output"));
+	return true;
+}
+
+//Same rules as cryptopp.aead's output option
+static bool getSessionOutput(Local<Value> outputVal, size_t length, Local<Object>& output){
+	if (outputVal->IsUndefined()){
+		output = Local<Object>::New(node::Buffer::New(length)->handle_);
+		return true;
+	}
+	if (!(node::Buffer::HasInstance(outputVal) && node::Buffer::Length(outputVal->ToObject()) == length)){
+		ThrowException(v8::Exception::TypeError(String::New("output must be a Buffer with the same length as the result")));
+		return false;
+	}
+	output = outputVal->ToObject();
+	return true;
+}
+
+//The result is returned, or passed to the callback (last parameter) if there is one
+static Handle<Value> sessionResult(const Arguments& args, Local<Value> result){
+	HandleScope scope;
+	if (args.Length() == 0 || !args[args.Length() - 1]->IsFunction()) return scope.Close(result);
+	Local<Function> callback = Local<Function>::Cast(args[args.Length() - 1]);
+	const unsigned argc = 1;
+	Local<Value> argv[argc] = { result };
+	callback->Call(Context::GetCurrent()->Global(), argc, argv);
+	return scope.Close(Undefined());
+}
+
+/*
+* Buffer plainText, Object options (optional : {aad, output}), Function callback (optional)
+* Returns the message (sequence number || ciphertext || tag), in output if given
+*/
+Handle<Value> KeySession::Encrypt(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 3)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	KeySession* session = ObjectWrap::Unwrap<KeySession>(args.This());
+	if (session->closed_){
+		ThrowException(v8::Exception::Error(String::New("The session has been closed")));
+		return scope.Close(Undefined());
+	}
+	if (!node::Buffer::HasInstance(args[0])){
+		ThrowException(v8::Exception::TypeError(String::New("plainText must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	string aad;
+	Local<Value> outputVal;
+	if (!getSessionOptions(args, aad, outputVal)) return scope.Close(Undefined());
+	Local<Object> input = args[0]->ToObject(), output;
+	const size_t messageLength = node::Buffer::Length(input);
+	if (!getSessionOutput(outputVal, SESSION_SEQUENCE_LENGTH + messageLength + SESSION_TAG_LENGTH, output)) return scope.Close(Undefined());
+	if (session->sendSequence_ == ~(uint64_t) 0){
+		ThrowException(v8::Exception::Error(String::New("The session has run out of sequence numbers")));
+		return scope.Close(Undefined());
+	}
+	const uint64_t sequence = session->sendSequence_++;
+	byte* out = (byte*) node::Buffer::Data(output);
+	byte iv[SESSION_IV_LENGTH];
+	sequenceIV(session->sendIV_, sequence, iv);
+	try {
+		auto_ptr<AEADCipher> cipher(AEAD_NewCipher(session->algorithm_, true, session->sendKey_.BytePtr(), session->sendKey_.size(), iv, sizeof(iv), SESSION_TAG_LENGTH));
+		//The message is moved first, output being allowed to overlap it (in-place encryption with input = output.slice(8, -16))
+		memmove(out + SESSION_SEQUENCE_LENGTH, node::Buffer::Data(input), messageLength);
+		for (size_t i = 0; i < SESSION_SEQUENCE_LENGTH; i++) out[i] = (byte) (sequence >> (8 * (SESSION_SEQUENCE_LENGTH - 1 - i)));
+		AEAD_Encrypt(*cipher, string((const char*) out, SESSION_SEQUENCE_LENGTH) + aad, out + SESSION_SEQUENCE_LENGTH, messageLength, out + SESSION_SEQUENCE_LENGTH, SESSION_TAG_LENGTH);
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(sessionResult(args, Local<Value>::New(output)));
+}
+
+/*
+* Buffer message, Object options (optional : {aad, output}), Function callback (optional)
+* Returns the plaintext, in output if given, or null if the message doesn't authenticate
+*/
+Handle<Value> KeySession::Decrypt(const Arguments& args){
+	HandleScope scope;
+	if (!(args.Length() >= 1 && args.Length() <= 3)){
+		ThrowException(v8::Exception::TypeError(String::New("Invalid number of parameters")));
+		return scope.Close(Undefined());
+	}
+	KeySession* session = ObjectWrap::Unwrap<KeySession>(args.This());
+	if (session->closed_){
+		ThrowException(v8::Exception::Error(String::New("The session has been closed")));
+		return scope.Close(Undefined());
+	}
+	if (!node::Buffer::HasInstance(args[0])){
+		ThrowException(v8::Exception::TypeError(String::New("message must be a Buffer")));
+		return scope.Close(Undefined());
+	}
+	string aad;
+	Local<Value> outputVal;
+	if (!getSessionOptions(args, aad, outputVal)) return scope.Close(Undefined());
+	Local<Object> input = args[0]->ToObject(), output;
+	const size_t inputLength = node::Buffer::Length(input);
+	if (inputLength < SESSION_SEQUENCE_LENGTH + SESSION_TAG_LENGTH){
+		ThrowException(v8::Exception::TypeError(String::New("message is too short")));
+		return scope.Close(Undefined());
+	}
+	if (!getSessionOutput(outputVal, inputLength - SESSION_SEQUENCE_LENGTH - SESSION_TAG_LENGTH, output)) return scope.Close(Undefined());
+	const byte* in = (const byte*) node::Buffer::Data(input);
+	uint64_t sequence = 0;
+	for (size_t i = 0; i < SESSION_SEQUENCE_LENGTH; i++) sequence = (sequence << 8) | in[i];
+	byte iv[SESSION_IV_LENGTH];
+	sequenceIV(session->receiveIV_, sequence, iv);
+	bool valid;
+	try {
+		auto_ptr<AEADCipher> cipher(AEAD_NewCipher(session->algorithm_, false, session->receiveKey_.BytePtr(), session->receiveKey_.size(), iv, sizeof(iv), SESSION_TAG_LENGTH));
+		const string associatedData = string((const char*) in, SESSION_SEQUENCE_LENGTH) + aad;
+		valid = AEAD_Decrypt(*cipher, associatedData, in + SESSION_SEQUENCE_LENGTH, inputLength - SESSION_SEQUENCE_LENGTH, (byte*) node::Buffer::Data(output), SESSION_TAG_LENGTH);
+	} catch (CryptoPP::Exception& e){
+		ThrowException(v8::Exception::Error(String::New(e.what())));
+		return scope.Close(Undefined());
+	}
+	return scope.Close(sessionResult(args, valid ? Local<Value>::New(output) : Local<Value>::New(Null())));
+}
+
+//Wipes the keys. The session can't be used afterwards
+Handle<Value> KeySession::Close(const Arguments& args){
+	HandleScope scope;
+	KeySession* session = ObjectWrap::Unwrap<KeySession>(args.This());
+	session->sendKey_.New(0);
+	session->sendIV_.New(0);
+	session->receiveKey_.New(0);
+	session->receiveIV_.New(0);
+	session->closed_ = true;
+	return scope.Close(Undefined());
+}
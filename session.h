@@ -0,0 +1,52 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+#include <stdint.h>
+
+#include <cryptopp/secblock.h>
+using CryptoPP::SecByteBlock;
+
+#include <node.h>
+
+#include "aead.h"
+
+/*
+* Encrypted session between two key pairs, created by KeyRing.openSession() (ECDH and X25519 key pairs).
+* Each direction has its own key and base IV, derived with HKDF from the shared secret; the party whose public key is the lowest
+* (byte-wise) uses the first key to send. Keys never leave native memory.
+* Message : sequence number (8 bytes, big endian) || ciphertext || tag (16 bytes). The IV is the base IV XORed with the sequence number,
+* which is authenticated along with the caller's associated data. Replays are not detected : that's up to the protocol using the session.
+*/
+class KeySession : public node::ObjectWrap {
+
+public:
+	static void Init();
+	//keyMaterial : HKDF output, SESSION_KEY_MATERIAL_LENGTH bytes. Throws a CryptoPP::Exception if the algorithm doesn't accept the keys
+	static v8::Handle<v8::Object> Create(AEADAlgorithm algorithm, SecByteBlock const& keyMaterial, bool sendsWithFirstKey);
+
+private:
+	KeySession();
+	~KeySession();
+	AEADAlgorithm algorithm_;
+	SecByteBlock sendKey_, sendIV_, receiveKey_, receiveIV_;
+	uint64_t sendSequence_;
+	//Set by close() : the keys are wiped
+	bool closed_;
+	static void sequenceIV(SecByteBlock const& baseIV, uint64_t sequence, byte iv[]);
+
+	static v8::Handle<v8::Value> New(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Encrypt(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Decrypt(const v8::Arguments& args);
+	static v8::Handle<v8::Value> Close(const v8::Arguments& args);
+	static v8::Persistent<v8::Function> constructor;
+};
+
+//Key and IV lengths for each direction; HKDF output length
+static const size_t SESSION_KEY_LENGTH = 32;
+static const size_t SESSION_IV_LENGTH = 12;
+static const size_t SESSION_KEY_MATERIAL_LENGTH = 2 * (SESSION_KEY_LENGTH + SESSION_IV_LENGTH);
+static const size_t SESSION_SEQUENCE_LENGTH = 8;
+static const size_t SESSION_TAG_LENGTH = 16;
+
+#endif
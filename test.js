@@ -41,6 +41,75 @@ assert.equal(base64Test, base64Decoded, 'Problem with base64 encoding');
 var randomBytes1 = cryptopp.randomBytes(5, 'base64');
 var randomBytes2 = cryptopp.randomBytes(10);
 log('\n### Testing random bytes generation ###\nRandom bytes : ' + randomBytes1 + '\nOther random bytes : ' + randomBytes2);
+assert.equal(randomBytes2.length, 20, 'Invalid hex random bytes length');
+assert.equal(new Buffer(randomBytes1, 'base64').length, 5, 'Invalid base64 random bytes length');
+var randomBuffer = cryptopp.randomBytes(32, 'buffer');
+assert(Buffer.isBuffer(randomBuffer) && randomBuffer.length == 32, 'randomBytes didn\'t return a 32-byte Buffer');
+assert.notEqual(randomBuffer.toString('hex'), cryptopp.randomBytes(32, 'buffer').toString('hex'), 'Two random Buffers are the same');
+assert.equal(cryptopp.randomBytes(0, 'buffer').length, 0, 'Invalid empty random Buffer');
+var reusedBuffer = new Buffer(64);
+reusedBuffer.fill(0);
+assert.equal(cryptopp.randomBytes(reusedBuffer), reusedBuffer, 'randomBytes didn\'t return the given Buffer');
+assert.notEqual(reusedBuffer.slice(0, 32).toString('hex'), new Array(65).join('0'), 'randomBytes didn\'t fill the given Buffer');
+reusedBuffer.fill(0);
+assert.equal(cryptopp.randomFill(reusedBuffer, 8, 16), reusedBuffer, 'randomFill didn\'t return the given Buffer');
+assert.equal(reusedBuffer.slice(0, 8).toString('hex') + reusedBuffer.slice(24).toString('hex'), new Array(97).join('0'), 'randomFill wrote out of its range');
+assert.notEqual(reusedBuffer.slice(8, 24).toString('hex'), new Array(33).join('0'), 'randomFill didn\'t fill its range');
+reusedBuffer.fill(0);
+cryptopp.randomFill(reusedBuffer, 60);
+assert.equal(reusedBuffer.slice(0, 60).toString('hex'), new Array(121).join('0'), 'randomFill wrote before its offset');
+assert.throws(function(){ cryptopp.randomFill(reusedBuffer, 60, 5); }, RangeError, 'randomFill accepted a range out of the buffer');
+assert.throws(function(){ cryptopp.randomFill(reusedBuffer, 65); }, RangeError, 'randomFill accepted an offset out of the buffer');
+assert.throws(function(){ cryptopp.randomBytes(-1); }, TypeError, 'randomBytes accepted a negative length');
+assert.throws(function(){ cryptopp.randomBytes(16, 'utf8'); }, TypeError, 'randomBytes accepted an unknown encoding');
+cryptopp.randomBytes(16, 'buffer', function(smallRandomBuffer){
+	assert.equal(smallRandomBuffer.length, 16, 'Invalid random Buffer length (callback)');
+});
+//Large outputs are filled on the thread pool, in slices
+var largeRandomBuffer = new Buffer(1024 * 1024 + 3);
+largeRandomBuffer.fill(0);
+cryptopp.randomFill(largeRandomBuffer, function(filledBuffer, err){
+	assert.equal(err, undefined, 'Async randomFill failed');
+	assert.equal(filledBuffer, largeRandomBuffer, 'Async randomFill didn\'t pass the given Buffer');
+	//Every 4096-byte block of the output (the slices' first and last ones included) has been written
+	for (var offset = 0; offset < filledBuffer.length; offset += 4096){
+		var block = filledBuffer.slice(offset, Math.min(offset + 4096, filledBuffer.length));
+		assert.notEqual(block.toString('hex'), new Array(2 * block.length + 1).join('0'), 'Async randomFill left a block unwritten at ' + offset);
+	}
+	log('Async randomFill of ' + filledBuffer.length + ' bytes done');
+});
+cryptopp.randomBytes(200000, 'hex', function(largeRandomHex){
+	assert.equal(largeRandomHex.length, 400000, 'Invalid async hex random bytes length');
+});
+
+// Testing the buffered random bytes (cryptopp.random)
+var sessionIds = {};
+//Enough requests to go through the buffer several times, whether its refills are on time or not
+for (var i = 0; i < 2000; i++){
+	var sessionId = cryptopp.random.bytes(16);
+	assert(Buffer.isBuffer(sessionId) && sessionId.length == 16, 'random.bytes didn\'t return a 16-byte Buffer');
+	assert(!sessionIds[sessionId.toString('hex')], 'random.bytes returned the same bytes twice');
+	sessionIds[sessionId.toString('hex')] = true;
+}
+assert.equal(cryptopp.random.bytes(0).length, 0, 'Invalid empty random.bytes Buffer');
+assert.equal(cryptopp.random.bytes(5000).length, 5000, 'Invalid random.bytes length for a request larger than the buffer');
+var randomUint32s = [];
+for (var i = 0; i < 100; i++){
+	var randomUint32 = cryptopp.random.uint32();
+	assert(randomUint32 >= 0 && randomUint32 <= 0xffffffff && Math.floor(randomUint32) == randomUint32, 'random.uint32 didn\'t return a 32-bit unsigned integer');
+	randomUint32s.push(randomUint32);
+}
+assert(randomUint32s.some(function(value){ return value != randomUint32s[0]; }), 'random.uint32 always returned the same value');
+var filledBuffer = new Buffer(48);
+filledBuffer.fill(0);
+assert.equal(cryptopp.random.fill(filledBuffer), filledBuffer, 'random.fill didn\'t return the given Buffer');
+assert.notEqual(filledBuffer.toString('hex'), new Array(97).join('0'), 'random.fill didn\'t fill the Buffer');
+assert.throws(function(){ cryptopp.random.bytes(-1); }, TypeError, 'random.bytes accepted a negative length');
+assert.throws(function(){ cryptopp.random.fill('not a buffer'); }, TypeError, 'random.fill accepted a string');
+//Once the first refill is done, requests are served from the buffer again
+setTimeout(function(){
+	assert.equal(cryptopp.random.bytes(32).length, 32, 'Invalid random.bytes length after a refill');
+}, 10);
 
 // Testing RSA encryption/decryption
 var rsaTest = "testing RSA encryption/decryption";
@@ -69,6 +138,16 @@ assert(typeof isRsaSignValid === 'boolean', 'The RSA signature verification resu
 assert(typeof otherIsRsaSignValid === 'boolean', 'The RSA signature verification result must be a boolean!');
 //assert.deepEqual(fuzzingRsaValid, false, 'RSA signatures can spoofed with fuzzing!');
 
+//Multi-prime RSA : the public key is used as any other RSA public key
+log('\n### Testing multi-prime RSA ###');
+var multiPrimeKeyPair = cryptopp.rsa.generateKeyPair(2048, {primes: 3});
+assert.equal(multiPrimeKeyPair.primes.length, 3, 'The multi-prime RSA key pair should have 3 primes');
+var multiPrimeCipher = cryptopp.rsa.encrypt(rsaTest, multiPrimeKeyPair.modulus, multiPrimeKeyPair.publicExponent);
+assert.equal(cryptopp.rsa.decrypt(multiPrimeCipher, multiPrimeKeyPair.modulus, multiPrimeKeyPair, multiPrimeKeyPair.publicExponent), rsaTest, 'The multi-prime RSA decrypted message is invalid');
+var multiPrimeSignature = cryptopp.rsa.sign(rsaSignTest, multiPrimeKeyPair.modulus, multiPrimeKeyPair, multiPrimeKeyPair.publicExponent, 'sha256');
+assert.equal(cryptopp.rsa.verify(rsaSignTest, multiPrimeSignature, multiPrimeKeyPair.modulus, multiPrimeKeyPair.publicExponent, 'sha256'), true, 'The multi-prime RSA signature is invalid');
+assert.throws(function(){ cryptopp.rsa.generateKeyPair(2048, {primes: 4}); }, 'A 4-prime 2048-bit key should be refused');
+
 if (useFuzzing){
 	log('RSA fuzzing test : generating random data and passing it through RSA methods to check that exceptions are raised');
 	function RsaEncFuzzing(){
@@ -147,6 +226,50 @@ log("Cipher :\n" + eciesCipher);
 var eciesDecrypted = cryptopp.ecies.prime.decrypt(eciesCipher, eciesKeyPair.privateKey, "secp256r1");
 log("Plain text (decrypted) : " + eciesDecrypted);
 assert.equal(eciesTest, eciesDecrypted, 'The decrypted ECIES message is invalid (prime fields)');
+//ChaCha20-Poly1305 as DEM : compressed ephemeral point, ciphertext and tag
+['secp256r1', 'secp384r1'].forEach(function(curveName){
+	var demKeyPair = cryptopp.ecies.prime.generateKeyPair(curveName);
+	var demCipher = cryptopp.ecies.prime.encrypt(eciesTest, demKeyPair.publicKey, curveName, {dem: 'chacha20-poly1305'});
+	assert.ok(demCipher.substr(0, 2) == '02' || demCipher.substr(0, 2) == '03', 'The ChaCha20-Poly1305 ECIES ciphertext doesn\'t start with a compressed point (' + curveName + ')');
+	assert.equal(cryptopp.ecies.prime.decrypt(demCipher, demKeyPair.privateKey, curveName), eciesTest, 'The decrypted ECIES message is invalid (ChaCha20-Poly1305, ' + curveName + ')');
+	var tampered = demCipher.substr(0, demCipher.length - 2) + (demCipher.substr(demCipher.length - 2) == '00' ? '01' : '00');
+	assert.equal(cryptopp.ecies.prime.decrypt(tampered, demKeyPair.privateKey, curveName), '', 'A tampered ECIES ciphertext was decrypted (ChaCha20-Poly1305, ' + curveName + ')');
+});
+//Multi-recipient envelopes : every recipient decrypts the same envelope, others can't
+var multiKeyPairs = [0, 1, 2].map(function(){ return cryptopp.ecies.prime.generateKeyPair('secp256r1'); });
+var multiPublicKeys = multiKeyPairs.map(function(keyPair){ return keyPair.publicKey; });
+var multiEnvelope = cryptopp.ecies.prime.encryptMulti(eciesTest, multiPublicKeys, 'secp256r1');
+assert.equal(multiEnvelope.substr(0, 10), '1000000003', 'The ECIES envelope doesn\'t start with its type and recipient count');
+multiKeyPairs.forEach(function(keyPair, i){
+	assert.equal(cryptopp.ecies.prime.decrypt(multiEnvelope, keyPair.privateKey, 'secp256r1'), eciesTest, 'Recipient ' + i + ' couldn\'t decrypt the ECIES envelope');
+});
+assert.equal(cryptopp.ecies.prime.decrypt(multiEnvelope, eciesKeyPair.privateKey, 'secp256r1'), '', 'A non-recipient decrypted the ECIES envelope');
+assert.throws(function(){
+	cryptopp.ecies.prime.encryptMulti(eciesTest, [multiPublicKeys[0], {x: multiPublicKeys[1].x, y: multiPublicKeys[0].y}], 'secp256r1');
+}, /index 1/, 'encryptMulti accepted a point that isn\'t on the curve');
+cryptopp.ecies.prime.encryptMulti(eciesTest, multiPublicKeys, 'secp256r1', function(envelope, err){
+	assert.equal(err, null, 'Asynchronous encryptMulti failed');
+	assert.equal(envelope.length, multiEnvelope.length, 'Asynchronous and synchronous ECIES envelopes don\'t have the same length');
+	assert.equal(cryptopp.ecies.prime.decrypt(envelope, multiKeyPairs[2].privateKey, 'secp256r1'), eciesTest, 'The asynchronous ECIES envelope couldn\'t be decrypted');
+});
+
+//Compressed points : keys and ciphertexts
+var compressedKeyPair = cryptopp.ecies.prime.generateKeyPair('secp256r1', {compressed: true});
+assert(typeof compressedKeyPair.publicKey === 'string' && compressedKeyPair.publicKey.length == 66, 'The compressed ECIES public key should be a 33-byte hex string');
+var compressedCipher = cryptopp.ecies.prime.encrypt(eciesTest, compressedKeyPair.publicKey, 'secp256r1', {compressed: true});
+assert(compressedCipher.substr(0, 2) == '02' || compressedCipher.substr(0, 2) == '03', 'The ephemeral point of the ECIES ciphertext isn\'t compressed');
+assert.equal(compressedCipher.length, cryptopp.ecies.prime.encrypt(eciesTest, compressedKeyPair.publicKey, 'secp256r1').length - 64, 'The compressed ECIES ciphertext should be shorter by a field element');
+assert.equal(cryptopp.ecies.prime.decrypt(compressedCipher, compressedKeyPair.privateKey, 'secp256r1'), eciesTest, 'The compressed ECIES ciphertext couldn\'t be decrypted');
+var decompressedPoint = cryptopp.ecpoint.prime.decompress(compressedKeyPair.publicKey, 'secp256r1');
+assert.equal(cryptopp.ecpoint.prime.compress(decompressedPoint, 'secp256r1'), compressedKeyPair.publicKey, 'Compressing the decompressed point should give the same point');
+assert.equal(cryptopp.ecies.prime.decrypt(cryptopp.ecies.prime.encrypt(eciesTest, decompressedPoint, 'secp256r1'), compressedKeyPair.privateKey, 'secp256r1'), eciesTest, 'The decompressed ECIES public key doesn\'t work');
+assert.throws(function(){
+	cryptopp.ecpoint.prime.decompress('02' + Array(65).join('f'), 'secp256r1');
+}, TypeError, 'A compressed point whose x isn\'t a field element was accepted');
+var ecpointCacheCapacity = cryptopp.ecpoint.cacheCapacity();
+assert.equal(cryptopp.ecpoint.cacheCapacity(0), 0, 'The point cache couldn\'t be disabled');
+assert.deepEqual(cryptopp.ecpoint.prime.decompress(compressedKeyPair.publicKey, 'secp256r1'), decompressedPoint, 'Decompression without the cache gives another point');
+cryptopp.ecpoint.cacheCapacity(ecpointCacheCapacity);
 
 if (useFuzzing){
 	/*
@@ -179,6 +302,10 @@ log('Cipher :\n' + eciesCipher);
 eciesDecrypted = cryptopp.ecies.binary.decrypt(eciesCipher, eciesKeyPair.privateKey, 'sect283r1');
 log('Plain text (decrypted) : ' + eciesDecrypted);
 assert.equal(eciesTest, eciesDecrypted, 'The decrypted ECIES message is invalid (binary fields)');
+compressedKeyPair = cryptopp.ecies.binary.generateKeyPair('sect283r1', {compressed: true});
+compressedCipher = cryptopp.ecies.binary.encrypt(eciesTest, compressedKeyPair.publicKey, 'sect283r1', {compressed: true});
+assert.equal(cryptopp.ecies.binary.decrypt(compressedCipher, compressedKeyPair.privateKey, 'sect283r1'), eciesTest, 'The compressed ECIES ciphertext couldn\'t be decrypted (binary fields)');
+assert.equal(cryptopp.ecpoint.binary.compress(cryptopp.ecpoint.binary.decompress(compressedKeyPair.publicKey, 'sect283r1'), 'sect283r1'), compressedKeyPair.publicKey, 'Compressing the decompressed point should give the same point (binary fields)');
 
 if (useFuzzing){
 	/*function eciesBinaryKeyPairFuzzing(){
@@ -215,10 +342,55 @@ var ecdsaIsNotValid = cryptopp.ecdsa.prime.verify(ecdsaTest, ecdsaSignature, oth
 log("Is valid : " + ecdsaIsValid);
 assert.deepEqual(ecdsaIsValid, true, 'The ECDSA signature is invalid (prime fields)');
 assert.deepEqual(ecdsaIsNotValid, false, 'ECDSA signatures verification does not work!!!');
+assert.equal(cryptopp.ecdsa.prime.verify(ecdsaTest, ecdsaSignature, cryptopp.ecpoint.prime.compress(ecdsaKeyPair.publicKey, 'secp256r1'), 'secp256r1'), true, 'The ECDSA signature couldn\'t be verified with the compressed public key');
 assert(typeof ecdsaIsValid === 'boolean', 'The ECDSA signature verification result must be a boolean!');
 assert(typeof ecdsaIsNotValid === 'boolean', 'The ECDSA signature verification result must be a boolean!');
 //assert.deepEqual(fuzzingEcdsaValid, false, 'ECDSA signatures can be spoofed with fuzzing!');
 
+//Deterministic (RFC 6979) ECDSA signatures
+var ecdsaDetSignature1 = cryptopp.ecdsa.prime.sign(ecdsaTest, ecdsaKeyPair.privateKey, "secp256r1", {hashName: 'sha256', deterministic: true});
+var ecdsaDetSignature2 = cryptopp.ecdsa.prime.sign(ecdsaTest, ecdsaKeyPair.privateKey, "secp256r1", {hashName: 'sha256', deterministic: true});
+log("Deterministic signature : " + ecdsaDetSignature1);
+assert.equal(ecdsaDetSignature1, ecdsaDetSignature2, 'Deterministic ECDSA signatures of the same message are different');
+assert.deepEqual(cryptopp.ecdsa.prime.verify(ecdsaTest, ecdsaDetSignature1, ecdsaKeyPair.publicKey, "secp256r1", 'sha256'), true, 'The deterministic ECDSA signature is invalid');
+//RFC 6979 known answers, message "sample" with SHA-256 : appendix A.2.5 (P-256, fixed-width arithmetic) and A.2.6 (P-384, generic path). Signatures are r || s
+var rfc6979Vectors = [
+	{
+		curveName: 'secp256r1',
+		privateKey: 'C9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721',
+		signature: 'EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716' + 'F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8'
+	},
+	{
+		curveName: 'secp384r1',
+		privateKey: '6B9D3DAD2E1B8C1C05B19875B6659F4DE23C3B667BF297BA9AA47740787137D896D5724E4C70A825F872C9EA60D2EDF5',
+		signature: '21B13D1E013C7FA1392D03C5F99AF8B30C570C6F98D4EA8E354B63A21D3DAA33BDE1E888E63355D92FA2B3C36D8FB2CD' + 'F3AA443FB107745BF4BD77CB3891674632068A10CA67E3D45DB2266FA7D1FEEBEFDC63ECCD1AC42EC0CB8668A4FA0AB0'
+	}
+];
+rfc6979Vectors.forEach(function(vector){
+	var vectorSignature = cryptopp.ecdsa.prime.sign('sample', vector.privateKey, vector.curveName, {hashName: 'sha256', deterministic: true});
+	assert.equal(vectorSignature.toUpperCase(), vector.signature, 'Wrong RFC 6979 signature on ' + vector.curveName);
+});
+
+//Batched ECDSA signatures
+var ecdsaBatchMessages = [ecdsaTest, "Another message", "", "A third one"];
+var ecdsaBatchSignatures = cryptopp.ecdsa.prime.signBatch(ecdsaBatchMessages, ecdsaKeyPair.privateKey, "secp256r1", 'sha256');
+assert.equal(ecdsaBatchSignatures.length, ecdsaBatchMessages.length, 'Wrong number of batch ECDSA signatures');
+for (var i = 0; i < ecdsaBatchMessages.length; i++){
+	assert.deepEqual(cryptopp.ecdsa.prime.verify(ecdsaBatchMessages[i], ecdsaBatchSignatures[i], ecdsaKeyPair.publicKey, "secp256r1", 'sha256'), true, 'A batch ECDSA signature is invalid');
+}
+var ecdsaDetBatchSignatures = cryptopp.ecdsa.prime.signBatch(ecdsaBatchMessages, ecdsaKeyPair.privateKey, "secp256r1", {hashName: 'sha256', deterministic: true});
+assert.equal(ecdsaDetBatchSignatures[0], ecdsaDetSignature1, 'Deterministic batch ECDSA signatures differ from single ones');
+
+//secp256r1 and secp256k1 have dedicated implementations; other prime curves go through Crypto++
+var k1KeyPair = cryptopp.ecdsa.prime.generateKeyPair('secp256k1');
+var k1Signature = cryptopp.ecdsa.prime.sign(ecdsaTest, k1KeyPair.privateKey, 'secp256k1', 'sha256');
+assert.deepEqual(cryptopp.ecdsa.prime.verify(ecdsaTest, k1Signature, k1KeyPair.publicKey, 'secp256k1', 'sha256'), true, 'The secp256k1 ECDSA signature is invalid');
+assert.deepEqual(cryptopp.ecdsa.prime.verify(ecdsaTest + '.', k1Signature, k1KeyPair.publicKey, 'secp256k1', 'sha256'), false, 'A secp256k1 ECDSA signature was accepted for another message');
+assert.equal(cryptopp.ecies.prime.decrypt(cryptopp.ecies.prime.encrypt(ecdsaTest, k1KeyPair.publicKey, 'secp256k1'), k1KeyPair.privateKey, 'secp256k1'), ecdsaTest, 'The decrypted ECIES message is invalid (secp256k1)');
+var p384KeyPair = cryptopp.ecdsa.prime.generateKeyPair('secp384r1');
+var p384Signature = cryptopp.ecdsa.prime.sign(ecdsaTest, p384KeyPair.privateKey, 'secp384r1', {hashName: 'sha256', deterministic: true});
+assert.deepEqual(cryptopp.ecdsa.prime.verify(ecdsaTest, p384Signature, p384KeyPair.publicKey, 'secp384r1', 'sha256'), true, 'The secp384r1 ECDSA signature is invalid');
+
 if (useFuzzing){
 	/*function ecdsaPrimeKeyPairFuzzing(){
 		cryptopp.ecdsa.prime.createKeyPair(rand());
@@ -242,13 +414,33 @@ if (useFuzzing){
 }
 
 //Testing ECDSA signing and verification on binary fields
-/*ecdsaKeyPair = cryptopp.ecdsa.binary.generateKeyPair('sect283r1');
+ecdsaKeyPair = cryptopp.ecdsa.binary.generateKeyPair('sect283r1');
 console.log('\n### Testing ECDSA signing and verification on binary fields ###\nCurve name : ' + ecdsaKeyPair.curveName + '\nPrivate key : ' + ecdsaKeyPair.privateKey + '\nPublic key :\n\tx : ' + ecdsaKeyPair.publicKey.x + '\n\ty : ' + ecdsaKeyPair.publicKey.y);
 ecdsaSignature = cryptopp.ecdsa.binary.sign(ecdsaTest, ecdsaKeyPair.privateKey, 'sect283r1');
 console.log('Signature : ' + ecdsaSignature);
 ecdsaIsValid = cryptopp.ecdsa.binary.verify(ecdsaTest, ecdsaSignature, ecdsaKeyPair.publicKey, 'sect283r1');
 assert(typeof ecdsaIsValid === 'boolean', 'The ECDSA signature verification result must be a boolean!');
-console.log('Is valid : ' + ecdsaIsValid);*/
+assert(ecdsaIsValid, 'The ECDSA signature is invalid (binary fields)');
+assert(!cryptopp.ecdsa.binary.verify(ecdsaTest + '.', ecdsaSignature, ecdsaKeyPair.publicKey, 'sect283r1'), 'The ECDSA signature of another message was accepted (binary fields)');
+console.log('Is valid : ' + ecdsaIsValid);
+//The curves of the legacy keys, with both hash functions, deterministic nonces and compressed keys
+['sect233k1', 'sect283k1', 'sect571r1'].forEach(function(curveName){
+	var binaryKeyPair = cryptopp.ecdsa.binary.generateKeyPair(curveName, {compressed: true});
+	['sha1', 'sha256'].forEach(function(hashName){
+		var binarySignature = cryptopp.ecdsa.binary.sign(ecdsaTest, binaryKeyPair.privateKey, curveName, hashName);
+		assert(cryptopp.ecdsa.binary.verify(ecdsaTest, binarySignature, binaryKeyPair.publicKey, curveName, hashName), 'Invalid ECDSA signature on ' + curveName + ' with ' + hashName);
+		var deterministicSignature = cryptopp.ecdsa.binary.sign(ecdsaTest, binaryKeyPair.privateKey, curveName, {hashName: hashName, deterministic: true});
+		assert.equal(cryptopp.ecdsa.binary.sign(ecdsaTest, binaryKeyPair.privateKey, curveName, {hashName: hashName, deterministic: true}), deterministicSignature, 'Deterministic ECDSA signatures differ on ' + curveName);
+		assert(cryptopp.ecdsa.binary.verify(ecdsaTest, deterministicSignature, binaryKeyPair.publicKey, curveName, hashName), 'Invalid deterministic ECDSA signature on ' + curveName);
+	});
+	cryptopp.ecdsa.binary.verify(ecdsaTest, cryptopp.ecdsa.binary.sign(ecdsaTest, binaryKeyPair.privateKey, curveName), binaryKeyPair.publicKey, curveName, function(isValid){
+		assert(isValid, 'Invalid ECDSA signature on ' + curveName + ' (callback)');
+	});
+	var binaryEciesKeyPair = cryptopp.ecies.binary.generateKeyPair(curveName);
+	assert.equal(cryptopp.ecies.binary.decrypt(cryptopp.ecies.binary.encrypt(eciesTest, binaryEciesKeyPair.publicKey, curveName), binaryEciesKeyPair.privateKey, curveName), eciesTest, 'The ECIES ciphertext couldn\'t be decrypted on ' + curveName);
+});
+assert(cryptopp.hardwareSupport().gf2m == 'pclmul' || cryptopp.hardwareSupport().gf2m == 'portable', 'Unknown GF(2^m) kernel');
+assert.equal(cryptopp.aead.hardwareSupport().gf2m, undefined, 'The GF(2^m) kernel is reported with the AEAD code paths');
 
 //Testing ECDH key agreement protocol on prime fields
 log("\n### Testing ECDH key agreement on prime fields ###");
@@ -263,6 +455,26 @@ var secret2 = cryptopp.ecdh.prime.agree(keyPair2.privateKey, keyPair1.publicKey,
 assert.equal(secret1, secret2, 'The shared secret isn\'t the same (prime fields)');
 log("Secret 1 :\n" + secret1);
 log("Secret 2 :\n" + secret2);
+keyPair1 = cryptopp.ecdh.prime.generateKeyPair('secp256k1');
+keyPair2 = cryptopp.ecdh.prime.generateKeyPair('secp256k1');
+assert.equal(cryptopp.ecdh.prime.agree(keyPair1.privateKey, keyPair2.publicKey, 'secp256k1'), cryptopp.ecdh.prime.agree(keyPair2.privateKey, keyPair1.publicKey, 'secp256k1'), 'The shared secret isn\'t the same (secp256k1)');
+keyPair1 = cryptopp.ecdh.prime.generateKeyPair('secp256r1', {compressed: true});
+keyPair2 = cryptopp.ecdh.prime.generateKeyPair('secp256r1');
+assert.equal(keyPair1.publicKey.length, 66, 'The compressed ECDH public key should be 33 bytes long');
+assert.equal(cryptopp.ecdh.prime.agree(keyPair1.privateKey, keyPair2.publicKey, 'secp256r1'), cryptopp.ecdh.prime.agree(keyPair2.privateKey, keyPair1.publicKey, 'secp256r1'), 'The shared secret isn\'t the same (compressed public key)');
+//x-only public keys (x alone), on curves of every field size handled by the ladder
+['secp256r1', 'secp256k1', 'secp160r1', 'secp112r2', 'secp384r1', 'secp521r1'].forEach(function(curveName){
+	var ladderKeyPair1 = cryptopp.ecdh.prime.generateKeyPair(curveName), ladderKeyPair2 = cryptopp.ecdh.prime.generateKeyPair(curveName, {compressed: true});
+	var xOnlyPublicKey = ladderKeyPair2.publicKey.substring(2);
+	var ladderSecret = cryptopp.ecdh.prime.agree(ladderKeyPair2.privateKey, ladderKeyPair1.publicKey, curveName);
+	assert.equal(cryptopp.ecdh.prime.agree(ladderKeyPair1.privateKey, ladderKeyPair2.publicKey, curveName), ladderSecret, 'The shared secret isn\'t the same (' + curveName + ')');
+	assert.equal(cryptopp.ecdh.prime.agree(ladderKeyPair1.privateKey, xOnlyPublicKey, curveName), ladderSecret, 'The shared secret isn\'t the same (x-only public key, ' + curveName + ')');
+	assert.equal(ladderSecret.length, xOnlyPublicKey.length, 'The ECDH secret should be as long as a field element (' + curveName + ')');
+});
+//x = 0 isn't on secp256k1 (y^2 = 7 has no solution)
+assert.throws(function(){
+	cryptopp.ecdh.prime.agree(keyPair1.privateKey, new Array(65).join('0'), 'secp256k1');
+}, 'An x-only public key that isn\'t on the curve should be rejected');
 
 if (useFuzzing){
 	function ecdhAgreePrimeFuzzing(){
@@ -274,8 +486,130 @@ if (useFuzzing){
 	} catch (e){}
 }
 
+//Testing X25519 and Ed25519
+log('\n### Testing X25519 key agreement ###');
+keyPair1 = cryptopp.x25519.generateKeyPair();
+keyPair2 = cryptopp.x25519.generateKeyPair();
+assert.equal(cryptopp.x25519.agree(keyPair1.privateKey, keyPair2.publicKey), cryptopp.x25519.agree(keyPair2.privateKey, keyPair1.publicKey), 'The shared secret isn\'t the same (X25519)');
+//RFC 7748, section 6.1
+assert.equal(cryptopp.x25519.agree('77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a', 'de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f').toLowerCase(), '4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742', 'Invalid X25519 secret for the RFC 7748 test vector');
+
+log('\n### Testing Ed25519 signatures ###');
+var ed25519KeyPair = cryptopp.ed25519.generateKeyPair();
+var ed25519Message = 'Testing Ed25519';
+var ed25519Signature = cryptopp.ed25519.sign(ed25519Message, ed25519KeyPair.privateKey);
+log('Signature : ' + ed25519Signature);
+assert.equal(cryptopp.ed25519.verify(ed25519Message, ed25519Signature, ed25519KeyPair.publicKey), true, 'Invalid Ed25519 signature');
+assert.equal(cryptopp.ed25519.verify(ed25519Message + '.', ed25519Signature, ed25519KeyPair.publicKey), false, 'Ed25519 signature valid for another message');
+//RFC 8032, section 7.1, test 2
+assert.equal(cryptopp.ed25519.sign(cryptopp.hex.decode('72'), '4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb').toLowerCase(), '92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00', 'Invalid Ed25519 signature for the RFC 8032 test vector');
+var batchMessages = [], batchSignatures = [], batchPublicKeys = [];
+for (var i = 0; i < 8; i++){
+	var batchKeyPair = cryptopp.ed25519.generateKeyPair();
+	batchMessages.push('Batch message ' + i);
+	batchSignatures.push(cryptopp.ed25519.sign(batchMessages[i], batchKeyPair.privateKey));
+	batchPublicKeys.push(batchKeyPair.publicKey);
+}
+var batchResults = cryptopp.ed25519.verifyBatch(batchMessages, batchSignatures, batchPublicKeys);
+for (var i = 0; i < 8; i++) assert.equal(batchResults[i], true, 'Ed25519 batch verification rejected a valid signature');
+batchMessages[5] += '.';
+batchResults = cryptopp.ed25519.verifyBatch(batchMessages, batchSignatures, batchPublicKeys);
+for (var i = 0; i < 8; i++) assert.equal(batchResults[i], i != 5, 'Ed25519 batch verification didn\'t single out the invalid signature');
+
+//Testing AEAD
+log('\n### Testing AES-GCM, AES-CCM and ChaCha20-Poly1305 ###');
+log('Hardware support : ' + JSON.stringify(cryptopp.aead.hardwareSupport()));
+//GCM test case 2 (AES-128, zero key and IV)
+var zeroKey = new Buffer(16), zeroIV = new Buffer(12), zeroBlock = new Buffer(16);
+zeroKey.fill(0); zeroIV.fill(0); zeroBlock.fill(0);
+assert.equal(cryptopp.aead.encrypt('aes-gcm', zeroKey, zeroIV, zeroBlock).toString('hex'), '0388dace60b6a392f328c2b971b2fe78ab6e47d42cec13bdf53a67b21257bddf', 'Invalid AES-GCM ciphertext for the test vector');
+var aeadKey = crypto.randomBytes(32), aeadIV = crypto.randomBytes(12), aeadAAD = new Buffer('associated data');
+var aeadMessage = new Buffer('Testing authenticated encryption');
+['aes-gcm', 'aes-ccm'].forEach(function(algorithm){
+	var aeadCipher = cryptopp.aead.encrypt(algorithm, aeadKey, aeadIV, aeadMessage, {aad: aeadAAD});
+	assert.equal(aeadCipher.length, aeadMessage.length + 16, 'Invalid ' + algorithm + ' ciphertext length');
+	assert.equal(cryptopp.aead.decrypt(algorithm, aeadKey, aeadIV, aeadCipher, {aad: aeadAAD}).toString(), aeadMessage.toString(), algorithm + ' plaintexts are not the same');
+	assert.equal(cryptopp.aead.decrypt(algorithm, aeadKey, aeadIV, aeadCipher, {aad: new Buffer('other data')}), null, algorithm + ' accepted the wrong associated data');
+	aeadCipher[3] ^= 1;
+	assert.equal(cryptopp.aead.decrypt(algorithm, aeadKey, aeadIV, aeadCipher, {aad: aeadAAD}), null, algorithm + ' accepted a tampered ciphertext');
+	aeadCipher[3] ^= 1;
+	//Shorter tags
+	var shortTagCipher = cryptopp.aead.encrypt(algorithm, aeadKey, aeadIV, aeadMessage, {tagLength: 12});
+	assert.equal(cryptopp.aead.decrypt(algorithm, aeadKey, aeadIV, shortTagCipher, {tagLength: 12}).toString(), aeadMessage.toString(), algorithm + ' plaintexts are not the same (12-byte tag)');
+	//In-place encryption and decryption
+	var inPlace = new Buffer(aeadMessage.length + 16);
+	aeadMessage.copy(inPlace);
+	cryptopp.aead.encrypt(algorithm, aeadKey, aeadIV, inPlace.slice(0, aeadMessage.length), {aad: aeadAAD, output: inPlace});
+	assert.equal(inPlace.toString('hex'), aeadCipher.toString('hex'), algorithm + ' in-place encryption gave another ciphertext');
+	cryptopp.aead.decrypt(algorithm, aeadKey, aeadIV, inPlace, {aad: aeadAAD, output: inPlace.slice(0, aeadMessage.length)});
+	assert.equal(inPlace.slice(0, aeadMessage.length).toString(), aeadMessage.toString(), algorithm + ' in-place decryption failed');
+	//Streams give the same result as the one-shot methods
+	var encryptor = cryptopp.aead.createEncryptor(algorithm, aeadKey, aeadIV, {aad: aeadAAD, messageLength: aeadMessage.length});
+	var streamed = Buffer.concat([encryptor.update(aeadMessage.slice(0, 10)), encryptor.update(aeadMessage.slice(10)), encryptor.final()]);
+	assert.equal(streamed.toString('hex'), aeadCipher.toString('hex'), algorithm + ' stream encryption gave another ciphertext');
+	var decryptor = cryptopp.aead.createDecryptor(algorithm, aeadKey, aeadIV, {aad: aeadAAD, messageLength: aeadMessage.length});
+	var streamedPlainText = decryptor.update(aeadCipher.slice(0, aeadMessage.length));
+	assert.equal(decryptor.final(aeadCipher.slice(aeadMessage.length)), true, algorithm + ' stream decryption rejected the tag');
+	assert.equal(streamedPlainText.toString(), aeadMessage.toString(), algorithm + ' stream decryption failed');
+});
+//Large inputs are processed on the thread pool when a callback is given
+var largeMessage = crypto.randomBytes(1 << 20);
+cryptopp.aead.encrypt('aes-gcm', aeadKey, aeadIV, largeMessage, undefined, function(largeCipher){
+	cryptopp.aead.decrypt('aes-gcm', aeadKey, aeadIV, largeCipher, undefined, function(largePlainText){
+		assert.equal(largePlainText.toString('hex'), largeMessage.toString('hex'), 'Asynchronous AES-GCM decryption failed');
+		log('Asynchronous AES-GCM round trip succeeded');
+	});
+});
+//ChaCha20-Poly1305, RFC 8439 section 2.8.2
+var chachaKey = new Buffer('808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f', 'hex'), chachaNonce = new Buffer('070000004041424344454647', 'hex');
+var chachaAAD = new Buffer('50515253c0c1c2c3c4c5c6c7', 'hex');
+var chachaMessage = new Buffer('Ladies and Gentlemen of the class of \'99: If I could offer you only one tip for the future, sunscreen would be it.');
+var chachaCipher = cryptopp.aead.encrypt('chacha20-poly1305', chachaKey, chachaNonce, chachaMessage, {aad: chachaAAD});
+assert.equal(chachaCipher.toString('hex'), 'd31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc3ff4def08e4b7a9de576d26586cec64b61161ae10b594f09e26a7e902ecbd0600691', 'Invalid ChaCha20-Poly1305 ciphertext for the test vector');
+assert.equal(cryptopp.aead.decrypt('chacha20-poly1305', chachaKey, chachaNonce, chachaCipher, {aad: chachaAAD}).toString(), chachaMessage.toString(), 'ChaCha20-Poly1305 plaintexts are not the same');
+chachaCipher[0] ^= 1;
+assert.equal(cryptopp.aead.decrypt('chacha20-poly1305', chachaKey, chachaNonce, chachaCipher, {aad: chachaAAD}), null, 'ChaCha20-Poly1305 accepted a tampered ciphertext');
+chachaCipher[0] ^= 1;
+//Streaming over a message long enough for the SIMD code paths, in uneven pieces
+var chachaLarge = crypto.randomBytes(100000);
+var chachaLargeCipher = cryptopp.aead.encrypt('chacha20-poly1305', aeadKey, aeadIV, chachaLarge);
+var chachaEncryptor = cryptopp.aead.createEncryptor('chacha20-poly1305', aeadKey, aeadIV);
+var chachaPieces = [];
+for (var offset = 0; offset < chachaLarge.length; offset += 777) chachaPieces.push(chachaEncryptor.update(chachaLarge.slice(offset, offset + 777)));
+chachaPieces.push(chachaEncryptor.final());
+assert.equal(Buffer.concat(chachaPieces).toString('hex'), chachaLargeCipher.toString('hex'), 'ChaCha20-Poly1305 stream encryption gave another ciphertext');
+cryptopp.aead.decrypt('chacha20-poly1305', aeadKey, aeadIV, chachaLargeCipher, undefined, function(chachaLargePlainText){
+	assert.equal(chachaLargePlainText.toString('hex'), chachaLarge.toString('hex'), 'Asynchronous ChaCha20-Poly1305 decryption failed');
+	log('Asynchronous ChaCha20-Poly1305 decryption succeeded');
+});
+
+//Testing key derivation
+log('\n### Testing key derivation ###');
+//PBKDF2-HMAC-SHA1, RFC 6070
+assert.equal(cryptopp.kdf.pbkdf2('password', 'salt', 1, 20, 'sha1').toString('hex'), '0c60c80f961f0e71f3a9b524af6012062fe037a6', 'Invalid PBKDF2 key for the test vector');
+var kdfPassword = 'passwordPASSWORDpassword', kdfSalt = new Buffer('saltSALTsaltSALTsaltSALTsaltSALTsalt');
+assert.equal(cryptopp.kdf.pbkdf2(kdfPassword, kdfSalt, 4096, 25, 'sha1').toString('hex'), '3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038', 'Invalid multi-block PBKDF2 key for the test vector');
+//Multi-block key, split across the thread pool
+var kdfSyncKey = cryptopp.kdf.pbkdf2(kdfPassword, kdfSalt, 1000, 300, 'sha512');
+cryptopp.kdf.pbkdf2(kdfPassword, kdfSalt, 1000, 300, 'sha512', function(kdfAsyncKey){
+	assert.equal(kdfAsyncKey.toString('hex'), kdfSyncKey.toString('hex'), 'Asynchronous PBKDF2 gave another key');
+	log('Asynchronous PBKDF2 succeeded');
+});
+//Keys past the largest Buffer are rejected before anything is allocated
+assert.throws(function(){
+	cryptopp.kdf.pbkdf2(kdfPassword, kdfSalt, 1, 0x40000000);
+}, RangeError, 'A PBKDF2 key longer than the largest Buffer was accepted');
+//HKDF-SHA256, RFC 5869 test case 1
+var hkdfSecret = new Buffer('0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b', 'hex');
+var hkdfOptions = {salt: new Buffer('000102030405060708090a0b0c', 'hex'), info: new Buffer('f0f1f2f3f4f5f6f7f8f9', 'hex')};
+var hkdfExpected = '3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865';
+assert.equal(cryptopp.kdf.hkdf(hkdfSecret, 42, hkdfOptions).toString('hex'), hkdfExpected, 'Invalid HKDF key for the test vector');
+cryptopp.kdf.hkdf(hkdfSecret, 42, hkdfOptions, function(hkdfKey){
+	assert.equal(hkdfKey.toString('hex'), hkdfExpected, 'Asynchronous HKDF gave another key');
+	log('Asynchronous HKDF succeeded');
+});
+
 //Testing ECDH on binary fields
-/*
 log('\n### Testing ECDH key agreement on binary fields ###');
 keyPair1 = cryptopp.ecdh.binary.generateKeyPair('sect283r1');
 keyPair2 = cryptopp.ecdh.binary.generateKeyPair('sect283r1');
@@ -287,5 +621,14 @@ log('Calculating second secret');
 secret2 = cryptopp.ecdh.binary.agree(keyPair2.privateKey, keyPair1.publicKey, keyPair2.curveName);
 log('Secret 1 :\n' + secret1 + '\nSecret 2 :\n' + secret2);
 assert.equal(secret1, secret2, 'The shared secret isn\'t the same (binary fields)');
-*/
+//Many key pairs, so that some private keys have leading zero bytes, and compressed public keys
+for (var i = 0; i < 20; i++){
+	keyPair1 = cryptopp.ecdh.binary.generateKeyPair('sect233k1');
+	keyPair2 = cryptopp.ecdh.binary.generateKeyPair('sect233k1', {compressed: true});
+	assert.equal(cryptopp.ecdh.binary.agree(keyPair1.privateKey, keyPair2.publicKey, 'sect233k1'), cryptopp.ecdh.binary.agree(keyPair2.privateKey, keyPair1.publicKey, 'sect233k1'), 'The shared secret isn\'t the same (sect233k1)');
+}
+assert.throws(function(){
+	cryptopp.ecdh.binary.agree(keyPair1.privateKey, '04' + keyPair1.publicKey.substring(2, keyPair1.publicKey.length - 2) + '00', 'sect233k1');
+}, 'An invalid public key was accepted for ECDH (binary fields)');
+
 log('\nCRYPTOPP TEST SCRIPT ENDED SUCCESSFULLY');
@@ -0,0 +1,14 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstdlib>
+
+//Number of threads of the libuv thread pool (UV_THREADPOOL_SIZE, 4 by default, 128 at most) : the number of jobs a batch is split into, at most
+inline size_t ThreadPoolSize(){
+	const char* value = getenv("UV_THREADPOOL_SIZE");
+	const int size = value != 0 ? atoi(value) : 0;
+	if (size <= 0) return 4;
+	return size > 128 ? 128 : (size_t) size;
+}
+
+#endif